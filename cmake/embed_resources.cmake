@@ -0,0 +1,63 @@
+# Generates a header with the contents of the given files as constexpr
+# arrays, so that the engine can start without reading its own resources
+# from disk. Run in script mode:
+#
+#   cmake -DROOT=<dir> -DOUTPUT=<header> -DRESOURCES=<a|b|...>
+#         -P embed_resources.cmake
+#
+# Resources are named by their path relative to ROOT, the same name the
+# vfs uses for them.
+
+if (NOT DEFINED ROOT OR NOT DEFINED OUTPUT OR NOT DEFINED RESOURCES)
+    message(FATAL_ERROR "ROOT, OUTPUT and RESOURCES must be defined")
+endif()
+
+string(REPLACE "|" ";" RESOURCES "${RESOURCES}")
+list(SORT RESOURCES)
+
+set(DATA "")
+set(TABLE "")
+set(INDEX 0)
+foreach (RESOURCE ${RESOURCES})
+    file(RELATIVE_PATH NAME ${ROOT} ${RESOURCE})
+    file(READ ${RESOURCE} HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR SIZE "${HEX_LENGTH} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," HEX "${HEX}")
+    # 16 bytes per line
+    string(REPEAT "0x[0-9a-f][0-9a-f]," 16 LINE)
+    string(REGEX REPLACE "(${LINE})" "\\1\n    " HEX "${HEX}")
+    string(APPEND DATA "// ${NAME}\n"
+           "inline constexpr unsigned char data_${INDEX}[] = {\n"
+           "    ${HEX}0x00};\n\n")
+    # The trailing zero is not part of the resource, It lets text
+    # resources be used as C strings
+    string(APPEND TABLE "    {\"${NAME}\", data_${INDEX}, ${SIZE}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+string(CONCAT CONTENT
+    "// Generated by cmake/embed_resources.cmake, do not edit\n\n"
+    "#pragma once\n\n"
+    "#include <cstddef>\n"
+    "#include <string_view>\n\n"
+    "namespace brenta::embedded\n{\n\n"
+    "struct resource\n{\n"
+    "    std::string_view name;\n"
+    "    const unsigned char *data;\n"
+    "    std::size_t size;\n"
+    "};\n\n"
+    "${DATA}"
+    "inline constexpr resource resources[] = {\n"
+    "${TABLE}"
+    "    {\"\", nullptr, 0}};\n\n"
+    "inline constexpr std::size_t resource_count = ${INDEX};\n\n"
+    "} // namespace brenta::embedded\n")
+
+# Only touch the header when It changes, everything includes It
+if (EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} OLD_CONTENT)
+endif()
+if (NOT "${OLD_CONTENT}" STREQUAL "${CONTENT}")
+    file(WRITE ${OUTPUT} "${CONTENT}")
+endif()
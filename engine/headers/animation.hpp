@@ -0,0 +1,271 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace brenta
+{
+
+namespace enums
+{
+
+/**
+ * @brief Property of a joint animated by a channel
+ */
+enum animation_property
+{
+    TRANSLATION,
+    ROTATION,
+    SCALE
+};
+
+} // namespace enums
+
+namespace types
+{
+
+/**
+ * @brief Local transform of a joint relative to its parent
+ */
+struct joint_pose
+{
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+/**
+ * @brief A joint of a skeleton
+ *
+ * The inverse bind matrix brings a vertex from model space to the
+ * space of the joint in the bind pose.
+ */
+struct joint
+{
+    std::string name;
+    /* Index of the parent joint, -1 for a root */
+    int parent = -1;
+    glm::mat4 inverse_bind = glm::mat4(1.0f);
+    /* Local transform used when a clip does not animate the joint */
+    joint_pose bind_pose;
+};
+
+/**
+ * @brief Hierarchy of joints that deforms a skinned model
+ *
+ * Parents always come before their children, so the joints can be
+ * walked in order to accumulate the transforms.
+ */
+struct skeleton
+{
+    std::vector<joint> joints;
+
+    /**
+     * @brief Find a joint by name
+     * @return The index of the joint, -1 if there is none
+     */
+    int find(const std::string &name) const;
+};
+
+/**
+ * @brief Value of an animated property at a point in time
+ */
+template <typename T> struct keyframe
+{
+    /* Time in seconds from the start of the clip */
+    float time;
+    T value;
+};
+
+/**
+ * @brief Keyframes of the local transform of one joint
+ */
+struct animation_track
+{
+    std::uint32_t joint;
+    std::vector<keyframe<glm::vec3>> translations;
+    std::vector<keyframe<glm::quat>> rotations;
+    std::vector<keyframe<glm::vec3>> scales;
+};
+
+/**
+ * @brief An animation of a skeleton, like a walk cycle
+ */
+struct animation_clip
+{
+    std::string name;
+    /* Length of the clip in seconds */
+    float duration = 0.0f;
+    std::vector<animation_track> tracks;
+};
+
+/**
+ * @brief An animated property of a joint in a compressed clip
+ */
+struct compressed_channel
+{
+    std::uint16_t joint;
+    enums::animation_property property;
+    /* The channel never changes, its only key is constant */
+    bool is_constant;
+    /* Quantization range of translations and scales */
+    glm::vec3 min;
+    glm::vec3 extent;
+    std::uint16_t constant[3];
+};
+
+/**
+ * @brief Animation clip in compressed form
+ *
+ * The clip is split in segments of equal duration. The keys of all
+ * the channels in a segment are stored next to each other, so that
+ * sampling a character touches one small block of memory. Every
+ * segment starts and ends with a key of each channel, so It can be
+ * sampled on its own. Key times are 16 bit fractions of the segment,
+ * key values three 16 bit integers: translations and scales relative
+ * to the range of their channel, rotations with the smallest three
+ * encoding. See animation_compression.
+ */
+struct compressed_clip
+{
+    std::string name;
+    /* Length of the clip in seconds */
+    float duration = 0.0f;
+    float segment_duration = 0.0f;
+    std::uint32_t segment_count = 0;
+    std::vector<compressed_channel> channels;
+    /* First key of every channel in every segment, segment major,
+     * plus the end of the last one */
+    std::vector<std::uint32_t> key_offsets;
+    std::vector<std::uint16_t> times;
+    /* Three components per key */
+    std::vector<std::uint16_t> values;
+};
+
+/**
+ * @brief Playback state of an animated character
+ *
+ * The skeleton and the clip are owned by the model, the state only
+ * points to them. The pose and the palette are the output of the
+ * animator and are resized on the first update.
+ */
+struct animation_state
+{
+    const types::skeleton *skeleton = nullptr;
+    const compressed_clip *clip = nullptr;
+    /* Playback position in seconds */
+    float time = 0.0f;
+    float speed = 1.0f;
+    bool loop = true;
+    std::vector<joint_pose> pose;
+    /* Skinning matrix of every joint, ready for the GPU */
+    std::vector<glm::mat4> palette;
+};
+
+} // namespace types
+
+/**
+ * @brief Skeletal pose evaluation
+ *
+ * Turns the playback state of many characters into the joint palettes
+ * used for skinning. Each character is sampled and its transforms are
+ * accumulated along the hierarchy independently, so evaluate spreads
+ * the characters over the thread_pool. The matrix products, which are
+ * most of the work, use SSE when the target supports It.
+ */
+class animator
+{
+  public:
+    animator() = delete;
+
+    /**
+     * @brief Sample the local pose of a skeleton from a raw clip
+     *
+     * Compressed clips are sampled by animation_compression. Keyframes
+     * are interpolated linearly, rotations with a normalized
+     * lerp along the shortest path. Joints that the clip does not
+     * animate take their bind pose.
+     *
+     * @param clip Clip to sample
+     * @param skeleton Skeleton animated by the clip
+     * @param time Time in seconds, clamped to the clip
+     * @param pose Output, one entry per joint
+     */
+    static void sample(const types::animation_clip &clip,
+                       const types::skeleton &skeleton, float time,
+                       std::span<types::joint_pose> pose);
+    /**
+     * @brief Compute the skinning matrices of a pose
+     *
+     * @param skeleton Skeleton of the pose
+     * @param pose Local pose, one entry per joint
+     * @param palette Output, one matrix per joint
+     */
+    static void compute_palette(const types::skeleton &skeleton,
+                                std::span<const types::joint_pose> pose,
+                                std::span<glm::mat4> palette);
+    /**
+     * @brief Advance a character and compute its palette
+     *
+     * A state without a skeleton is left untouched, a state without a
+     * clip gets the bind pose.
+     *
+     * @param state Character to update
+     * @param delta Elapsed time in seconds
+     */
+    static void update(types::animation_state &state, float delta);
+    /**
+     * @brief Update many characters in parallel
+     *
+     * @param states Characters to update
+     * @param delta Elapsed time in seconds
+     */
+    static void evaluate(std::span<types::animation_state *const> states,
+                         float delta);
+
+    /**
+     * @brief Build the matrix of a local transform
+     */
+    static glm::mat4 compose(const types::joint_pose &pose);
+    /**
+     * @brief Multiply two matrices, with SSE when available
+     */
+    static glm::mat4 multiply(const glm::mat4 &a, const glm::mat4 &b);
+
+  private:
+    /* Characters updated by the same job, amortizes the dispatch of
+     * the thread_pool over skeletons with few joints */
+    static constexpr std::size_t batch_size = 8;
+};
+
+} // namespace brenta
@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "animation.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <span>
+
+namespace brenta
+{
+
+/**
+ * @brief Compression of skeletal animation clips
+ *
+ * Raw keyframe tracks take more memory than the meshes they animate.
+ * compress turns a types::animation_clip in a types::compressed_clip:
+ *
+ * - channels that never leave the bind pose are dropped, channels
+ *   that never change keep a single key;
+ * - every other channel drops the keys that linear interpolation of
+ *   their neighbours reproduces within the tolerance;
+ * - the remaining keys are quantized to 16 bits, rotations with the
+ *   smallest three encoding (6 bytes instead of 16);
+ * - the keys are grouped in segments of a fixed duration, so that
+ *   sampling a character reads a small contiguous block.
+ *
+ * sample decodes only the two keys around the requested time in
+ * every channel. The model compresses the clips at import, the
+ * animator samples them.
+ */
+class animation_compression
+{
+  public:
+    animation_compression() = delete;
+
+    /**
+     * @brief Default largest error of the key reduction
+     *
+     * In model space units for translations and scales, in radians
+     * for rotations.
+     */
+    static constexpr float default_tolerance = 0.0005f;
+    /**
+     * @brief Default duration of a segment, in seconds
+     */
+    static constexpr float default_segment_duration = 0.25f;
+
+    /**
+     * @brief Compress a clip
+     *
+     * @param clip Clip to compress
+     * @param skeleton Skeleton animated by the clip
+     * @param tolerance Largest error of the key reduction
+     * @param segment_duration Duration of a segment in seconds
+     * @return The compressed clip
+     */
+    static types::compressed_clip
+    compress(const types::animation_clip &clip,
+             const types::skeleton &skeleton,
+             float tolerance = default_tolerance,
+             float segment_duration = default_segment_duration);
+    /**
+     * @brief Sample the local pose of a skeleton
+     *
+     * Joints that the clip does not animate take their bind pose.
+     *
+     * @param clip Clip to sample
+     * @param skeleton Skeleton animated by the clip
+     * @param time Time in seconds, clamped to the clip
+     * @param pose Output, one entry per joint
+     */
+    static void sample(const types::compressed_clip &clip,
+                       const types::skeleton &skeleton, float time,
+                       std::span<types::joint_pose> pose);
+
+    /**
+     * @brief Get the memory used by a compressed clip, in bytes
+     */
+    static std::size_t get_size(const types::compressed_clip &clip);
+    /**
+     * @brief Get the memory used by a raw clip, in bytes
+     */
+    static std::size_t get_size(const types::animation_clip &clip);
+
+    /**
+     * @brief Encode a unit quaternion with the smallest three encoding
+     *
+     * The largest component is dropped and rebuilt from the others,
+     * which fit in 15 bits each. The index of the dropped component
+     * takes the two remaining bits.
+     */
+    static void encode_rotation(glm::quat rotation, std::uint16_t out[3]);
+    /**
+     * @brief Decode a quaternion encoded by encode_rotation
+     */
+    static glm::quat decode_rotation(const std::uint16_t in[3]);
+};
+
+} // namespace brenta
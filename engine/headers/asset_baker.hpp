@@ -0,0 +1,221 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace brenta
+{
+
+namespace enums
+{
+
+/**
+ * @brief Kinds of assets the baker knows how to convert
+ *
+ * - TEXTURE: png, jpg, tga and bmp images, baked to block
+ *   compressed DDS files next to the source
+ * - MODEL: anything Assimp imports, baked to the mesh cache
+ * - FONT: ttf and otf fonts, baked to .glyphs files next to the
+ *   source, see text::bake
+ * - SHADER: GLSL sources, tracked only
+ */
+enum asset_kind
+{
+    TEXTURE,
+    MODEL,
+    FONT,
+    SHADER
+};
+
+} // namespace enums
+
+namespace types
+{
+
+/**
+ * @brief A node of the bake dependency graph
+ *
+ * Every bakeable file found by the scan is a node. The hash covers
+ * the content of the input, the content of its dependencies and the
+ * settings that change the output, so the node needs to be baked
+ * again only when the hash changes or an output goes missing.
+ */
+struct bake_node
+{
+    std::string input;
+    enums::asset_kind kind;
+    std::uint64_t hash = 0;
+    /* Files the output depends on, like the materials of an OBJ */
+    std::vector<std::string> dependencies;
+    /* Files written by the last successful bake */
+    std::vector<std::string> outputs;
+};
+
+/**
+ * @brief Summary of a bake
+ */
+struct bake_report
+{
+    std::size_t total = 0;
+    std::size_t baked = 0;
+    std::size_t up_to_date = 0;
+    std::size_t failed = 0;
+};
+
+} // namespace types
+
+/**
+ * @brief Offline asset baker
+ *
+ * Without an offline step every run imports the models with Assimp,
+ * decodes the images with stb_image and rasterizes the fonts with
+ * FreeType. The baker walks the asset directories and converts them
+ * to the formats the runtime loads directly:
+ *
+ * - textures to BC7 (with alpha) or BC1 DDS files with the whole
+ *   mipmap chain, picked up by texture::decode_image
+ * - models to the mesh cache, with the processing steps that are
+ *   enabled in mesh_optimizer, mesh_simplifier and meshlet_builder
+ * - fonts to baked glyph bitmaps, picked up by text::load
+ *
+ * OpenGL 3.3 has no portable program binaries, so shaders are only
+ * tracked in the graph and stay as they are.
+ *
+ * The dependency graph is stored in a manifest between runs, and
+ * only the nodes whose hash changed are baked again, in parallel on
+ * the thread_pool. Outputs of inputs that were removed are deleted.
+ * The brenta-bake tool is a command line front end for this class.
+ */
+class asset_baker
+{
+  public:
+    /**
+     * @brief Version of the manifest and of the bake settings
+     *
+     * Bump this every time the output of a converter changes, every
+     * node will be baked again.
+     */
+    static constexpr std::uint32_t version = 1;
+
+    asset_baker() = delete;
+
+    /**
+     * @brief Find the kind of an asset from its extension
+     *
+     * @param path Path to the file
+     * @param kind Output kind
+     * @return false if the file is not something the baker converts
+     */
+    static bool classify(const std::string &path, enums::asset_kind &kind);
+    /**
+     * @brief Find the files an asset depends on
+     *
+     * Only OBJ materials are tracked, the textures they reference are
+     * baked as nodes of their own.
+     *
+     * @param path Path to the asset
+     * @param kind Kind of the asset
+     * @return Paths of the dependencies
+     */
+    static std::vector<std::string>
+    find_dependencies(const std::string &path, enums::asset_kind kind);
+    /**
+     * @brief Walk the roots and build the nodes of the graph
+     *
+     * Hashes are computed in parallel.
+     *
+     * @param roots Directories to walk recursively
+     * @return The nodes, sorted by input path
+     */
+    static std::vector<types::bake_node>
+    scan(const std::vector<std::string> &roots);
+    /**
+     * @brief Hash a node
+     *
+     * @param node The node, with its dependencies already found
+     * @return Hash of the input, the dependencies and the settings
+     */
+    static std::uint64_t hash_node(const types::bake_node &node);
+    /**
+     * @brief Check if a node needs to be baked
+     *
+     * @param node The node from the current scan
+     * @param previous Nodes from the manifest
+     * @return true if the node is new, changed or lost an output
+     */
+    static bool is_dirty(const types::bake_node &node,
+                         const std::vector<types::bake_node> &previous);
+    /**
+     * @brief Bake a single node
+     *
+     * Fills the outputs of the node on success.
+     *
+     * @param node The node to bake
+     * @return true on success
+     */
+    static bool bake_node(types::bake_node &node);
+    /**
+     * @brief Bake every dirty asset and update the manifest
+     *
+     * @param roots Directories to walk recursively
+     * @param manifest_path Path to the manifest
+     * @param force Bake every node, even if It is up to date
+     * @return Summary of the bake
+     */
+    static types::bake_report bake(const std::vector<std::string> &roots,
+                                   const std::string &manifest_path,
+                                   bool force = false);
+    /**
+     * @brief Read a manifest
+     *
+     * @param path Path to the manifest
+     * @param nodes Output nodes
+     * @return false if the file is missing or from another version
+     */
+    static bool read_manifest(const std::string &path,
+                              std::vector<types::bake_node> &nodes);
+    /**
+     * @brief Write a manifest
+     *
+     * @param path Path to the manifest
+     * @param nodes Nodes to store
+     * @return true on success
+     */
+    static bool write_manifest(const std::string &path,
+                               const std::vector<types::bake_node> &nodes);
+
+  private:
+    static bool bake_texture(types::bake_node &node);
+    static bool bake_model(types::bake_node &node);
+    static bool bake_font(types::bake_node &node);
+};
+
+} // namespace brenta
@@ -0,0 +1,237 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief Contents of an asset
+ *
+ * Points either straight inside a memory mapped pack or file, or to
+ * decompressed memory. The memory stays valid as long as a copy of
+ * the asset is alive, even if the pack is unmounted meanwhile.
+ */
+class asset
+{
+  public:
+    asset()
+    {
+    }
+    /**
+     * @brief Construct an asset
+     *
+     * @param bytes The contents
+     * @param owner Keeps the memory of bytes alive
+     */
+    asset(std::span<const unsigned char> bytes,
+          std::shared_ptr<const void> owner);
+
+    /**
+     * @brief Check if the asset was found
+     */
+    bool is_valid() const;
+    const unsigned char *data() const;
+    std::size_t size() const;
+    /**
+     * @brief View the contents as text
+     */
+    std::string_view str() const;
+    /**
+     * @brief Get a part of the asset
+     *
+     * The part keeps the whole asset alive, nothing is copied.
+     *
+     * @param offset First byte of the part
+     * @param size Size of the part, clamped to the end of the asset
+     * @return The part, not valid if offset is past the end
+     */
+    asset slice(std::size_t offset, std::size_t size) const;
+
+  private:
+    std::span<const unsigned char> bytes;
+    std::shared_ptr<const void> owner;
+};
+
+} // namespace types
+
+/**
+ * @brief Single file asset container
+ *
+ * A pack stores many assets in one file: a header, the blobs aligned
+ * to 16 bytes, and a table of contents sorted by the hash of the
+ * asset paths. Packs are memory mapped, so an uncompressed asset is
+ * served straight from the mapping without copying It. Compressed
+ * assets are split in chunks that are compressed with LZ4
+ * independently and decompressed in parallel on the thread_pool.
+ *
+ * Assets are looked up by path relative to the working directory,
+ * absolute paths are made relative first. load falls back to the
+ * file system when no mounted pack has the asset, so the engine runs
+ * the same from loose files and from a pack.
+ *
+ * Packs are written with asset_pack::writer.
+ */
+class asset_pack
+{
+  public:
+    /**
+     * @brief Version of the pack format
+     */
+    static constexpr std::uint32_t version = 1;
+    /**
+     * @brief Size of the compressed chunks before compression
+     */
+    static constexpr std::size_t chunk_size = 256 * 1024;
+
+    asset_pack() = delete;
+
+    /**
+     * @brief Mount a pack
+     *
+     * Packs mounted later take precedence over earlier ones.
+     *
+     * @param path Path to the pack file
+     * @return true if the pack was mapped and is valid
+     */
+    static bool mount(const std::string &path);
+    /**
+     * @brief Unmount every pack
+     *
+     * Assets loaded before stay valid.
+     */
+    static void unmount_all();
+    /**
+     * @brief Check if at least one pack is mounted
+     */
+    static bool is_mounted();
+
+    /**
+     * @brief Check if a mounted pack has an asset
+     */
+    static bool contains(const std::string &path);
+    /**
+     * @brief Check if an asset is in a pack or on the file system
+     */
+    static bool exists(const std::string &path);
+    /**
+     * @brief Load an asset
+     *
+     * Searches the mounted packs and then the file system, files are
+     * memory mapped. Safe to call from any thread.
+     *
+     * @param path Path to the asset
+     * @return The asset, not valid if It was not found or is corrupted
+     */
+    static types::asset load(const std::string &path);
+
+    /**
+     * @brief Get the name of an asset inside packs
+     *
+     * @param path Path to the asset
+     * @return The path relative to the working directory, normalized
+     * and with forward slashes
+     */
+    static std::string get_key(const std::string &path);
+
+    /**
+     * @brief Writer of pack files
+     */
+    class writer;
+
+  private:
+    struct pack;
+
+    static std::vector<std::shared_ptr<const pack>> packs;
+    static std::mutex mutex;
+
+    static bool find(const std::string &key,
+                     std::shared_ptr<const pack> &found, std::size_t &index);
+    static types::asset load_from_pack(const std::string &key);
+};
+
+/**
+ * @brief Writer of pack files
+ *
+ * Collects assets in memory and writes them in a single pack.
+ */
+class asset_pack::writer
+{
+  public:
+    /**
+     * @brief Add an asset from memory
+     *
+     * @param name Path the asset will be loaded with
+     * @param data Contents of the asset
+     * @param compress Whether to compress the asset with LZ4
+     */
+    writer &add(const std::string &name, std::span<const unsigned char> data,
+                bool compress = false);
+    /**
+     * @brief Add an asset from a file
+     *
+     * @param path Path to the file, also used as the name of the asset
+     * @param compress Whether to compress the asset with LZ4
+     * @return false if the file could not be read
+     */
+    bool add_file(const std::string &path, bool compress = false);
+    /**
+     * @brief Write the pack
+     *
+     * Chunks are compressed in parallel on the thread_pool.
+     *
+     * @param path Path of the pack file
+     * @return true if the pack was written
+     */
+    bool write(const std::string &path) const;
+
+  private:
+    struct entry
+    {
+        std::string name;
+        std::vector<unsigned char> data;
+        bool compress;
+    };
+
+    std::vector<entry> entries;
+};
+
+} // namespace brenta
@@ -45,6 +45,9 @@ namespace types
  * - create and delete buffer object
  * - bind and unbind buffer object
  * - copy data to the buffer object
+ *
+ * A buffer owns its OpenGL object: It can be moved but not copied,
+ * and the object is deleted when the buffer is destroyed.
  */
 class buffer
 {
@@ -52,12 +55,12 @@ class buffer
     /**
      * @brief Buffer object id, generated by OpenGL
      */
-    unsigned int id;
+    unsigned int id = 0;
     /**
      * @brief Buffer object target (like GL_ARRAY_BUFFER,
      *        GL_ELEMENT_ARRAY_BUFFER...)
      */
-    GLenum target;
+    GLenum target = 0;
 
     /**
      * @brief Default constructor, does nothing
@@ -76,17 +79,25 @@ class buffer
      * when it goes out of scope.
      */
     buffer(GLenum input_target);
+    buffer(const buffer &) = delete;
+    buffer &operator=(const buffer &) = delete;
+    buffer(buffer &&other) noexcept;
+    buffer &operator=(buffer &&other) noexcept;
+    /**
+     * @brief Delete the buffer object, if any
+     */
+    ~buffer();
 
     /**
      * @brief Bind the buffer object
      *
      * Buffers must be bound before they can be used!
      */
-    void bind();
+    void bind() const;
     /**
      * @brief Unbind the buffer object
      */
-    void unbind();
+    void unbind() const;
     /**
      * @brief Delete the buffer object
      */
@@ -150,6 +161,16 @@ class buffer
      * Same as CopyVertices but for target GL_ELEMENT_ARRAY_BUFFER.
      */
     void copy_indices(GLsizeiptr size, const void *data, GLenum usage);
+    /**
+     * @brief Copy data inside the buffer object
+     * @param offset Offset from the start of the buffer in bytes
+     * @param size Size of the data in bytes
+     * @param data Pointer to the data
+     *
+     * Updates a range of a buffer whose storage was already allocated
+     * with one of the methods above.
+     */
+    void copy_sub_data(GLintptr offset, GLsizeiptr size, const void *data);
 };
 
 } // namespace types
@@ -0,0 +1,150 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "meshlet_builder.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief View of a camera in the model space of an instance
+ */
+struct cluster_frustum
+{
+    /* Left, right, bottom, top, near and far planes, normalized and
+     * facing inwards */
+    glm::vec4 planes[6];
+    glm::vec3 camera;
+    /* False for mirrored instances, whose winding is flipped */
+    bool backface;
+};
+
+/**
+ * @brief Cluster culling statistics
+ */
+struct cluster_stats
+{
+    std::size_t tested = 0;
+    std::size_t frustum_culled = 0;
+    std::size_t backface_culled = 0;
+    std::size_t triangles_drawn = 0;
+};
+
+/**
+ * @brief A contiguous range of the index buffer to draw
+ */
+struct index_range
+{
+    std::uint32_t offset;
+    std::uint32_t count;
+};
+
+} // namespace types
+
+/**
+ * @brief Per cluster CPU culling
+ *
+ * Tests the meshlets of a mesh against the view frustum and their
+ * normal cone against the camera position before drawing, so that
+ * only the visible clusters are sent to the GPU. The tests run in the
+ * model space of the instance, so the meshlet bounds never need to be
+ * transformed. Adjacent visible clusters are merged in a single range.
+ *
+ * The culler keeps statistics of the current frame, call new_frame
+ * once per frame and get_stats to read the ones of the last one.
+ */
+class cluster_culler
+{
+  public:
+    cluster_culler() = delete;
+
+    /**
+     * @brief Enable or disable cluster culling
+     */
+    static void set_enabled(bool enabled);
+    /**
+     * @brief Check if cluster culling is enabled
+     */
+    static bool is_enabled();
+
+    /**
+     * @brief Compute the view of a camera in model space
+     *
+     * @param model Model matrix of the instance
+     * @param view View matrix of the camera
+     * @param projection Projection matrix of the camera
+     * @return The frustum to test the meshlets of the instance with
+     */
+    static types::cluster_frustum make_frustum(const glm::mat4 &model,
+                                               const glm::mat4 &view,
+                                               const glm::mat4 &projection);
+    /**
+     * @brief Check if a meshlet is inside the frustum
+     */
+    static bool in_frustum(const types::meshlet &meshlet,
+                           const types::cluster_frustum &frustum);
+    /**
+     * @brief Check if every triangle of a meshlet faces away
+     */
+    static bool is_backfacing(const types::meshlet &meshlet,
+                              const types::cluster_frustum &frustum);
+    /**
+     * @brief Cull a list of meshlets
+     *
+     * @param meshlets Meshlets of a mesh
+     * @param frustum Frustum of the instance
+     * @param ranges Output ranges of visible indices, cleared first
+     */
+    static void cull(const std::vector<types::meshlet> &meshlets,
+                     const types::cluster_frustum &frustum,
+                     std::vector<types::index_range> &ranges);
+
+    /**
+     * @brief Start collecting the statistics of a new frame
+     */
+    static void new_frame();
+    /**
+     * @brief Get the statistics of the last complete frame
+     */
+    static types::cluster_stats get_stats();
+
+  private:
+    static bool enabled;
+    static types::cluster_stats current;
+    static types::cluster_stats last;
+};
+
+} // namespace brenta
@@ -0,0 +1,81 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "asset_pack.hpp"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace brenta
+{
+
+/**
+ * @brief Resources compiled into the binary
+ *
+ * The build embeds the engine shaders, and the default font when
+ * BRENTA_EMBED_FONT is on, as constexpr data generated by
+ * cmake/embed_resources.cmake. They are named by their path in the
+ * source tree, like "engine/shaders/text.vs", and the vfs finds
+ * them before the file system so the engine never opens a file for
+ * its own resources.
+ */
+class embedded_assets
+{
+  public:
+    embedded_assets() = delete;
+
+    /**
+     * @brief Check if a resource is embedded
+     *
+     * @param path Path of the resource, matched like asset_pack keys
+     */
+    static bool contains(const std::string &path);
+    /**
+     * @brief Load an embedded resource
+     *
+     * Nothing is copied, the asset points to the data of the binary.
+     *
+     * @param path Path of the resource
+     * @return The resource, not valid if It is not embedded
+     */
+    static types::asset load(const std::string &path);
+    /**
+     * @brief Get an embedded resource as text
+     *
+     * @param path Path of the resource
+     * @return The contents, empty if It is not embedded
+     */
+    static std::string_view get_text(const std::string &path);
+    /**
+     * @brief Get the number of embedded resources
+     */
+    static std::size_t get_count();
+};
+
+} // namespace brenta
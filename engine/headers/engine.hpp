@@ -26,24 +26,52 @@
 
 #pragma once
 
+#include "animation.hpp"
+#include "asset_baker.hpp"
+#include "asset_pack.hpp"
 #include "buffer.hpp"
 #include "camera.hpp"
+#include "cluster_culler.hpp"
+#include "embedded_assets.hpp"
 #include "engine_audio.hpp"
 #include "engine_input.hpp"
 #include "engine_logger.hpp"
 #include "engine_time.hpp"
 #include "frame_buffer.hpp"
+#include "geometry_arena.hpp"
 #include "gl_helper.hpp"
+#include "gltf.hpp"
+#include "gltf_model.hpp"
 #include "gui.hpp"
+#include "json.hpp"
+#include "lod_selector.hpp"
+#include "lz4.hpp"
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
 #include "model.hpp"
+#include "model_registry.hpp"
+#include "obj_parser.hpp"
 #include "particles.hpp"
+#include "render_queue.hpp"
 #include "screen.hpp"
 #include "shader.hpp"
+#include "skinning.hpp"
 #include "text.hpp"
 #include "texture.hpp"
+#include "texture_cache.hpp"
+#include "texture_compression.hpp"
+#include "texture_streamer.hpp"
+#include "thread_pool.hpp"
 #include "translation.hpp"
+#include "uniform_buffers.hpp"
 #include "vao.hpp"
+#include "vfs.hpp"
+
+#include <utility>
+#include <vector>
 
 namespace brenta
 {
@@ -79,13 +107,40 @@ class engine
     bool gl_cull_face;
     bool gl_multisample;
     bool gl_depth_test;
+    bool uses_mesh_cache;
+    std::string mesh_cache_directory;
+    bool uses_texture_streaming;
+    std::size_t texture_upload_budget;
+    bool uses_mesh_optimizer;
+    bool uses_packed_vertices;
+    bool uses_lods;
+    unsigned int lod_levels;
+    float lod_threshold;
+    bool uses_meshlets;
+    bool keeps_cpu_data;
+    bool uses_geometry_arena;
+    std::size_t geometry_page_size;
+    std::string asset_pack_path;
+    bool uses_gpu_skinning;
+    std::vector<std::pair<std::string, std::string>> mount_points;
+    bool uses_io_uring;
+    bool uses_native_obj;
 
     engine(bool uses_screen, bool uses_audio, bool uses_input, bool uses_logger,
            bool uses_text, int screen_width, int screen_height,
            bool screen_is_mouse_captured, bool screen_msaa, bool screen_vsync,
            const char *screen_title, oak::level log_level, std::string log_file,
            std::string text_font, int text_size, bool gl_blending,
-           bool gl_cull_face, bool gl_multisample, bool gl_depth_test);
+           bool gl_cull_face, bool gl_multisample, bool gl_depth_test,
+           bool uses_mesh_cache, std::string mesh_cache_directory,
+           bool uses_texture_streaming, std::size_t texture_upload_budget,
+           bool uses_mesh_optimizer, bool uses_packed_vertices,
+           bool uses_lods, unsigned int lod_levels, float lod_threshold,
+           bool uses_meshlets, bool keeps_cpu_data,
+           bool uses_geometry_arena, std::size_t geometry_page_size,
+           std::string asset_pack_path, bool uses_gpu_skinning,
+           std::vector<std::pair<std::string, std::string>> mount_points,
+           bool uses_io_uring, bool uses_native_obj);
     ~engine();
 
     class builder;
@@ -120,6 +175,24 @@ class engine::builder
     bool gl_cull_face = true;
     bool gl_multisample = true;
     bool gl_depth_test = true;
+    bool uses_mesh_cache = false;
+    std::string mesh_cache_directory = "cache/meshes";
+    bool uses_texture_streaming = false;
+    std::size_t texture_upload_budget = 8 * 1024 * 1024;
+    bool uses_mesh_optimizer = false;
+    bool uses_packed_vertices = false;
+    bool uses_lods = false;
+    unsigned int lod_levels = 4;
+    float lod_threshold = 1.0f;
+    bool uses_meshlets = false;
+    bool keeps_cpu_data = true;
+    bool uses_geometry_arena = false;
+    std::size_t geometry_page_size = 16 * 1024 * 1024;
+    std::string asset_pack_path = "";
+    bool uses_gpu_skinning = true;
+    std::vector<std::pair<std::string, std::string>> mount_points;
+    bool uses_io_uring = false;
+    bool uses_native_obj = false;
 
     builder &use_screen(bool uses_screen);
     builder &use_audio(bool uses_audio);
@@ -140,6 +213,24 @@ class engine::builder
     builder &set_gl_cull_face(bool gl_cull_face);
     builder &set_gl_multisample(bool gl_multisample);
     builder &set_gl_depth_test(bool gl_depth_test);
+    builder &use_mesh_cache(bool uses_mesh_cache);
+    builder &set_mesh_cache_directory(std::string mesh_cache_directory);
+    builder &use_texture_streaming(bool uses_texture_streaming);
+    builder &set_texture_upload_budget(std::size_t texture_upload_budget);
+    builder &use_mesh_optimizer(bool uses_mesh_optimizer);
+    builder &use_packed_vertices(bool uses_packed_vertices);
+    builder &use_lods(bool uses_lods);
+    builder &set_lod_levels(unsigned int lod_levels);
+    builder &set_lod_threshold(float lod_threshold);
+    builder &use_meshlets(bool uses_meshlets);
+    builder &set_keep_cpu_data(bool keeps_cpu_data);
+    builder &use_geometry_arena(bool uses_geometry_arena);
+    builder &set_geometry_page_size(std::size_t geometry_page_size);
+    builder &set_asset_pack(std::string asset_pack_path);
+    builder &use_gpu_skinning(bool uses_gpu_skinning);
+    builder &mount_directory(std::string prefix, std::string directory);
+    builder &use_io_uring(bool uses_io_uring);
+    builder &use_native_obj(bool uses_native_obj);
 
     engine build();
 };
@@ -191,12 +282,38 @@ class engine::builder
  * - **brenta::gl**: provides some useful OpenGL functions.
  * - **brenta::mesh**: a 3D openGL mesh.
  * - **brenta::model**: a 3D openGL model.
+ * - **brenta::model_registry**: shares models loaded more than once.
+ * - **brenta::mesh_cache**: baked binary cache of imported models.
+ * - **brenta::obj_parser**: loads OBJ models without Assimp.
+ * - **brenta::gltf**: reads glTF and GLB files.
+ * - **brenta::gltf_model**: draws glTF models from their own buffers.
+ * - **brenta::types::json**: a small JSON parser.
+ * - **brenta::mesh_optimizer**: vertex cache and fetch optimization.
+ * - **brenta::mesh_simplifier**: generates levels of detail.
+ * - **brenta::lod_selector**: picks the level of detail to draw.
+ * - **brenta::meshlet_builder**: splits meshes in clusters of triangles.
+ * - **brenta::cluster_culler**: skips the clusters that are not visible.
+ * - **brenta::geometry_arena**: shared buffers for static meshes.
+ * - **brenta::asset_pack**: serves the assets from a single file.
+ * - **brenta::vfs**: mount points and batched asynchronous reads.
+ * - **brenta::embedded_assets**: resources compiled into the binary.
+ * - **brenta::asset_baker**: converts the assets offline, see brenta-bake.
+ * - **brenta::lz4**: LZ4 block compression.
+ * - **brenta::animator**: evaluates skeletal animations in parallel.
+ * - **brenta::skinning**: deforms skinned meshes on the GPU or the CPU.
  * - **brenta::particle_emitter**: create and customize particles.
+ * - **brenta::render_queue**: sorts the draws of a frame.
  * - **brenta::shader**: manages the shaders.
+ * - **brenta::uniform_buffers**: camera, lights and object uniform blocks.
  * - **brenta::texture**: manages the textures.
+ * - **brenta::texture_cache**: shares textures loaded more than once.
+ * - **brenta::texture_compression**: BC1-BC7 textures, DDS and KTX2.
+ * - **brenta::texture_streamer**: uploads textures in the background.
+ * - **brenta::thread_pool**: runs CPU heavy work on worker threads.
  * - **brenta::types::translation**: manages the translations.
  * - **brenta::types::vao**: wrapper around the Vertex Array Objects.
  * - **brenta::types::buffer**: wrapper around the Buffers.
+ * - **brenta::types::texture_object**: owner of an OpenGL texture.
  * - **brenta::types::framebuffer**: framebuffer wrapper.
  * - **brenta::time**: manages the time.
  * - **brenta::camera**: manages the camera.
@@ -0,0 +1,228 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "buffer.hpp"
+#include "vao.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief First fit allocator of ranges inside a fixed capacity
+ *
+ * Only does the bookkeeping, the memory itself lives elsewhere (in
+ * the buffers of the geometry_arena). Freed ranges are merged with
+ * their free neighbours.
+ */
+class range_allocator
+{
+  public:
+    range_allocator()
+    {
+    }
+    /**
+     * @brief Construct an allocator with everything free
+     *
+     * @param capacity Number of units that can be allocated
+     */
+    explicit range_allocator(std::size_t capacity);
+
+    /**
+     * @brief Allocate a range
+     *
+     * @param size Number of units to allocate
+     * @param alignment The offset is a multiple of It
+     * @param offset Output offset of the range
+     * @return false if there is no free range large enough
+     */
+    bool allocate(std::size_t size, std::size_t alignment,
+                  std::size_t &offset);
+    /**
+     * @brief Give back a range returned by allocate
+     */
+    void free(std::size_t offset, std::size_t size);
+
+    std::size_t get_capacity() const;
+    /**
+     * @brief Get the number of units not allocated
+     */
+    std::size_t get_free() const;
+
+  private:
+    std::size_t capacity = 0;
+    std::size_t free_units = 0;
+    /* Offset to size of the free ranges */
+    std::map<std::size_t, std::size_t> free_ranges;
+};
+
+/**
+ * @brief Geometry of a mesh inside the geometry_arena
+ *
+ * Owns its ranges, that are given back to the arena when It is
+ * destroyed. It can be moved but not copied.
+ */
+class geometry_range
+{
+  public:
+    static constexpr std::uint32_t no_page = ~0u;
+
+    /* Page holding the geometry */
+    std::uint32_t page = no_page;
+    /* Index of the first vertex in the page, to use as base vertex */
+    std::uint32_t base_vertex = 0;
+    std::uint32_t vertex_count = 0;
+    /* Offset and size of the indices in the page, in bytes */
+    std::size_t index_offset = 0;
+    std::size_t index_size = 0;
+
+    geometry_range()
+    {
+    }
+    geometry_range(const geometry_range &) = delete;
+    geometry_range &operator=(const geometry_range &) = delete;
+    geometry_range(geometry_range &&other) noexcept;
+    geometry_range &operator=(geometry_range &&other) noexcept;
+    ~geometry_range();
+
+    /**
+     * @brief Check if the range holds geometry
+     */
+    bool is_valid() const;
+};
+
+} // namespace types
+
+/**
+ * @brief Shared storage for the geometry of static meshes
+ *
+ * Sub-allocates vertices and indices out of a few large buffers
+ * (pages) instead of creating a buffer per mesh. Every page stores a
+ * single vertex format and has its own VAO, so meshes in the same
+ * page are drawn with glDrawElementsBaseVertex without changing any
+ * binding in between. Indices are relative to the first vertex of
+ * their mesh, so 16 bit indices can share a page with 32 bit ones.
+ *
+ * Pages are created when needed, a mesh larger than the page size
+ * gets a page of its own. Must be used from the thread that owns the
+ * OpenGL context.
+ */
+class geometry_arena
+{
+  public:
+    geometry_arena() = delete;
+
+    /**
+     * @brief Enable the arena
+     *
+     * No OpenGL object is created until the first allocation.
+     *
+     * @param page_size Size of the vertex and index buffers of a page
+     * in bytes
+     */
+    static void init(std::size_t page_size);
+    /**
+     * @brief Delete every page and disable the arena
+     *
+     * Ranges still alive afterwards are left dangling and do nothing
+     * when destroyed.
+     */
+    static void destroy();
+    /**
+     * @brief Check if the arena is enabled
+     */
+    static bool is_enabled();
+
+    /**
+     * @brief Upload the geometry of a mesh
+     *
+     * @param vertices Vertex data
+     * @param vertex_count Number of vertices
+     * @param packed Whether the vertices are types::packed_vertex
+     * @param indices Index data, 16 or 32 bit
+     * @return The allocated range, invalid if the arena is disabled
+     */
+    static types::geometry_range allocate(std::span<const std::byte> vertices,
+                                          std::size_t vertex_count,
+                                          bool packed,
+                                          std::span<const std::byte> indices);
+    /**
+     * @brief Give back the ranges of a mesh
+     *
+     * Called by the destructor of the range.
+     */
+    static void free(types::geometry_range &range);
+    /**
+     * @brief Bind the VAO of the page of a range
+     *
+     * Does nothing if the page is already bound.
+     */
+    static void bind(const types::geometry_range &range);
+    /**
+     * @brief Get the VAO of the page holding a range
+     * @return The VAO, 0 if the range is not valid
+     */
+    static unsigned int get_vertex_array(const types::geometry_range &range);
+
+    /**
+     * @brief Get the number of pages
+     */
+    static std::size_t get_page_count();
+    /**
+     * @brief Get the number of bytes allocated to meshes
+     */
+    static std::size_t get_used_bytes();
+
+  private:
+    struct page
+    {
+        bool packed;
+        types::vao vao;
+        types::buffer vbo;
+        types::buffer ebo;
+        types::range_allocator vertices;
+        types::range_allocator indices;
+    };
+
+    static bool enabled;
+    static std::size_t page_size;
+    static std::vector<page> pages;
+
+    static std::size_t add_page(bool packed, std::size_t vertex_size,
+                                std::size_t index_size);
+};
+
+} // namespace brenta
@@ -32,13 +32,61 @@
 
 #include <glad/glad.h> /* OpenGL driver */
 
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/* Object identifiers of GL_KHR_debug, the extension is not part of
+ * OpenGL 3.3 so glad does not declare them */
+#ifndef GL_BUFFER
+#define GL_BUFFER 0x82E0
+#endif
+#ifndef GL_PROGRAM
+#define GL_PROGRAM 0x82E2
+#endif
+#ifndef GL_VERTEX_ARRAY
+#define GL_VERTEX_ARRAY 0x8074
+#endif
+
 namespace brenta
 {
 
+namespace types
+{
+
+/**
+ * @brief State changes of a frame
+ */
+struct gl_state_stats
+{
+    /* Calls that reached the driver */
+    std::size_t issued = 0;
+    /* Calls dropped because the state was already set */
+    std::size_t filtered = 0;
+};
+
+} // namespace types
+
 /**
  * @brief OpenGL helper functions
  *
  * This class contains helper functions to interact with OpenGL.
+ *
+ * OpenGL errors are checked only when the engine is built with
+ * BRENTA_GL_DEBUG, which is the case of Debug builds. Then the driver
+ * reports them through a GL_KHR_debug callback as they happen, and
+ * check_error only marks where the code is, so that the messages
+ * can name the last check passed. Without the extension check_error
+ * falls back on glGetError. In the other builds check_error, the
+ * callback and the object labels compile to nothing.
+ *
+ * The bindings and the capabilities changed through this class are
+ * remembered, and setting them to the value they already have does
+ * not reach the driver. Code that changes them directly must call
+ * invalidate_state afterwards. The texture sampling parameters live
+ * in shared sampler objects, see get_sampler. Call new_frame once
+ * per frame and get_stats to read the calls of the last one.
  */
 class gl
 {
@@ -106,6 +154,54 @@ class gl
      */
     static void draw_elements(GLenum mode, int count, GLenum type,
                               const void *indices);
+    /**
+     * @brief Multi Draw Elements
+     *
+     * This function draws several ranges of the element array with a
+     * single call.
+     *
+     * @param mode    Specifies what kind of primitives to render
+     * @param counts  Number of elements of every range
+     * @param type    Specifies the type of the values in indices
+     * @param indices Offsets of the ranges in the element array buffer
+     * @param drawcount Number of ranges
+     */
+    static void multi_draw_elements(GLenum mode, const GLsizei *counts,
+                                    GLenum type, const void *const *indices,
+                                    GLsizei drawcount);
+    /**
+     * @brief Draw Elements Base Vertex
+     *
+     * Like draw_elements, base_vertex is added to every index before
+     * fetching the vertex.
+     *
+     * @param mode    Specifies what kind of primitives to render
+     * @param count   Specifies the number of elements to be rendered
+     * @param type    Specifies the type of the values in indices
+     * @param indices Offset of the first index in the element array buffer
+     * @param base_vertex Constant added to every index
+     */
+    static void draw_elements_base_vertex(GLenum mode, int count, GLenum type,
+                                          const void *indices,
+                                          GLint base_vertex);
+    /**
+     * @brief Multi Draw Elements Base Vertex
+     *
+     * Like multi_draw_elements, every range has its own base vertex.
+     *
+     * @param mode    Specifies what kind of primitives to render
+     * @param counts  Number of elements of every range
+     * @param type    Specifies the type of the values in indices
+     * @param indices Offsets of the ranges in the element array buffer
+     * @param drawcount Number of ranges
+     * @param base_vertices Constant added to the indices of every range
+     */
+    static void multi_draw_elements_base_vertex(GLenum mode,
+                                                const GLsizei *counts,
+                                                GLenum type,
+                                                const void *const *indices,
+                                                GLsizei drawcount,
+                                                const GLint *base_vertices);
     /**
      * @brief Clear
      *
@@ -113,11 +209,169 @@ class gl
      */
     static void clear();
     /**
-     * @brief Enable Depth Test
+     * @brief Bind a Vertex Array Object
      *
-     * This function enables the depth test.
+     * The bound VAO is remembered and binding It again does nothing,
+     * so every VAO must be bound through this function.
+     *
+     * @param n The VAO, 0 to unbind
      */
     static void bind_vertex_array(unsigned int n);
+    /**
+     * @brief Get the bound Vertex Array Object
+     * @return The VAO bound with bind_vertex_array
+     */
+    static unsigned int get_vertex_array();
+    /**
+     * @brief Forget a Vertex Array Object that is being deleted
+     *
+     * OpenGL unbinds a bound VAO when It is deleted.
+     *
+     * @param n The deleted VAO
+     */
+    static void forget_vertex_array(unsigned int n);
+    /**
+     * @brief Use a program
+     *
+     * @param program The program, 0 for none
+     */
+    static void use_program(unsigned int program);
+    /**
+     * @brief Get the program in use
+     *
+     * @return The program, or unknown after invalidate_state until the
+     * next use_program
+     */
+    static unsigned int get_program();
+    /**
+     * @brief Bind a buffer
+     *
+     * GL_ELEMENT_ARRAY_BUFFER belongs to the VAO state, so It is
+     * always bound.
+     *
+     * @param target Target, like GL_ARRAY_BUFFER
+     * @param buffer The buffer, 0 to unbind
+     */
+    static void bind_buffer(GLenum target, unsigned int buffer);
+    /**
+     * @brief Bind a buffer to an indexed binding point
+     *
+     * Always issued, the generic binding of the target changes too.
+     *
+     * @param target GL_UNIFORM_BUFFER or GL_TRANSFORM_FEEDBACK_BUFFER
+     * @param index The binding point
+     * @param buffer The buffer, 0 to unbind
+     */
+    static void bind_buffer_base(GLenum target, unsigned int index,
+                                 unsigned int buffer);
+    /**
+     * @brief Forget a buffer that is being deleted
+     *
+     * OpenGL unbinds a bound buffer when It is deleted.
+     *
+     * @param buffer The deleted buffer
+     */
+    static void forget_buffer(unsigned int buffer);
+    /**
+     * @brief Select the active texture unit
+     *
+     * @param unit GL_TEXTURE0 plus the number of the unit
+     */
+    static void active_texture(GLenum unit);
+    /**
+     * @brief Get the active texture unit
+     * @return GL_TEXTURE0 plus the number of the unit
+     */
+    static GLenum get_active_texture();
+    /**
+     * @brief Bind a texture to the active unit
+     *
+     * @param target Target, like GL_TEXTURE_2D
+     * @param texture The texture, 0 to unbind
+     */
+    static void bind_texture(GLenum target, unsigned int texture);
+    /**
+     * @brief Forget a texture that is being deleted
+     *
+     * OpenGL unbinds a bound texture from every unit when It is
+     * deleted.
+     *
+     * @param texture The deleted texture
+     */
+    static void forget_texture(unsigned int texture);
+    /**
+     * @brief Bind a sampler object to a texture unit
+     *
+     * A sampler overrides the sampling parameters of the texture
+     * bound to the unit, 0 gives them back.
+     *
+     * @param unit Number of the unit, starting at 0
+     * @param sampler The sampler, 0 for none
+     */
+    static void bind_sampler(unsigned int unit, unsigned int sampler);
+    /**
+     * @brief Get a sampler object
+     *
+     * Samplers are created the first time a combination of parameters
+     * is asked for and shared afterwards, there are only a handful of
+     * them in practice.
+     *
+     * @param wrapping Wrapping of the S and T coordinates
+     * @param filtering_min Minifying filter
+     * @param filtering_mag Magnifying filter
+     * @return The sampler, deleted by destroy
+     */
+    static unsigned int get_sampler(GLint wrapping, GLint filtering_min,
+                                    GLint filtering_mag);
+    /**
+     * @brief Bind a framebuffer for drawing and reading
+     *
+     * @param framebuffer The framebuffer, 0 for the window
+     */
+    static void bind_framebuffer(unsigned int framebuffer);
+    /**
+     * @brief Forget a framebuffer that is being deleted
+     *
+     * OpenGL binds the window back when the framebuffer is deleted.
+     *
+     * @param framebuffer The deleted framebuffer
+     */
+    static void forget_framebuffer(unsigned int framebuffer);
+    /**
+     * @brief Enable or disable a capability
+     *
+     * GL_BLEND, GL_CULL_FACE and GL_DEPTH_TEST are remembered, the
+     * other capabilities are always set.
+     *
+     * @param capability The capability
+     * @param enabled If It should be enabled
+     */
+    static void set_capability(GLenum capability, bool enabled);
+    /**
+     * @brief Enable or disable writing in the depth buffer
+     */
+    static void set_depth_mask(bool enabled);
+    /**
+     * @brief Forget all the state
+     *
+     * The next change of every binding and capability is issued.
+     */
+    static void invalidate_state();
+    /**
+     * @brief Start a new frame
+     *
+     * The statistics of the frame that ends become the ones returned
+     * by get_stats.
+     */
+    static void new_frame();
+    /**
+     * @brief Get the state changes of the last frame
+     */
+    static types::gl_state_stats get_stats();
+    /**
+     * @brief Delete the samplers and forget the state
+     */
+    static void destroy();
     /**
      * @brief Check OpenGL error
      *
@@ -125,8 +379,88 @@ class gl
      *
      * @return The error code
      */
+#ifdef BRENTA_GL_DEBUG
     static GLenum check_error_(const char *file, int line);
+#else
+    static GLenum check_error_(const char *, int)
+    {
+        return GL_NO_ERROR;
+    }
+#endif
 #define check_error() gl::check_error_(__FILE__, __LINE__)
+
+    /**
+     * @brief Report the OpenGL errors through GL_KHR_debug
+     *
+     * Installs a synchronous message callback, called by load_opengl
+     * in debug builds. The callback can be turned off and on at
+     * runtime, for example around code that expects errors.
+     *
+     * @param enabled If the messages should be reported
+     * @return true if the driver supports GL_KHR_debug
+     */
+#ifdef BRENTA_GL_DEBUG
+    static bool set_debug_output(bool enabled);
+#else
+    static bool set_debug_output(bool)
+    {
+        return false;
+    }
+#endif
+    /**
+     * @brief Name an object in the debug messages
+     *
+     * @param identifier Kind of object, like GL_BUFFER or GL_TEXTURE
+     * @param name The object
+     * @param label The name shown in the messages
+     */
+#ifdef BRENTA_GL_DEBUG
+    static void set_label(GLenum identifier, unsigned int name,
+                          std::string_view label);
+#else
+    static void set_label(GLenum, unsigned int, std::string_view)
+    {
+    }
+#endif
+
+    /* Value of a binding whose state is not known */
+    static constexpr unsigned int unknown = ~0u;
+
+  private:
+    /* Texture units whose bindings are remembered */
+    static constexpr unsigned int max_texture_units = 32;
+
+    struct texture_unit
+    {
+        unsigned int texture_2d = 0;
+        unsigned int texture_buffer = 0;
+        unsigned int sampler = 0;
+    };
+
+    struct sampler
+    {
+        GLint wrapping;
+        GLint filtering_min;
+        GLint filtering_mag;
+        unsigned int id;
+    };
+
+    static unsigned int vertex_array;
+    static unsigned int program;
+    static unsigned int framebuffer;
+    /* Indexed by buffer_slot */
+    static std::array<unsigned int, 8> buffers;
+    static unsigned int active_unit;
+    static std::array<texture_unit, max_texture_units> texture_units;
+    /* Blend, cull face and depth test: 0, 1 or unknown */
+    static std::array<unsigned int, 3> capabilities;
+    static unsigned int depth_mask;
+    static std::vector<sampler> samplers;
+    static types::gl_state_stats current;
+    static types::gl_state_stats last;
+
+    /* Count a call, true if It must be issued */
+    static bool changes(unsigned int &state, unsigned int value);
 };
 
 } // namespace brenta
@@ -0,0 +1,367 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "animation.hpp"
+#include "asset_pack.hpp"
+#include "json.hpp"
+#include "texture.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace brenta
+{
+
+namespace enums
+{
+
+/**
+ * @brief How the values of an animation channel change between keys
+ */
+enum gltf_interpolation
+{
+    GLTF_LINEAR,
+    GLTF_STEP,
+    GLTF_CUBICSPLINE
+};
+
+} // namespace enums
+
+namespace types
+{
+
+/**
+ * @brief A range of bytes of a glTF buffer
+ */
+struct gltf_buffer_view
+{
+    unsigned int buffer = 0;
+    std::size_t offset = 0;
+    std::size_t length = 0;
+    /* Distance between two elements, 0 if they are tightly packed */
+    unsigned int stride = 0;
+};
+
+/**
+ * @brief Typed elements in a buffer view
+ *
+ * glTF uses the OpenGL enums for the component types, so they are
+ * given to glVertexAttribPointer as they are.
+ */
+struct gltf_accessor
+{
+    /* -1 if every element is zero */
+    int buffer_view = -1;
+    /* From the start of the buffer view */
+    std::size_t offset = 0;
+    GLenum component_type = GL_FLOAT;
+    /* 1 for SCALAR, 2 to 4 for VEC, 16 for MAT4 */
+    unsigned int components = 1;
+    std::size_t count = 0;
+    bool normalized = false;
+};
+
+/**
+ * @brief Vertex attributes of a glTF primitive
+ *
+ * Same locations as the vertex shaders of the engine.
+ */
+enum gltf_attribute
+{
+    GLTF_POSITION,
+    GLTF_NORMAL,
+    GLTF_TEXCOORD,
+    GLTF_JOINTS,
+    GLTF_WEIGHTS,
+    GLTF_ATTRIBUTE_COUNT
+};
+
+/**
+ * @brief A part of a mesh drawn with one material
+ */
+struct gltf_primitive
+{
+    /* Accessor of every attribute, -1 if missing */
+    int attributes[GLTF_ATTRIBUTE_COUNT] = {-1, -1, -1, -1, -1};
+    /* -1 if the vertices are drawn in order */
+    int indices = -1;
+    int material = -1;
+    GLenum mode = GL_TRIANGLES;
+};
+
+struct gltf_mesh
+{
+    std::string name;
+    std::vector<gltf_primitive> primitives;
+};
+
+/**
+ * @brief A node of the scene hierarchy
+ */
+struct gltf_node
+{
+    std::string name;
+    int parent = -1;
+    std::vector<int> children;
+    int mesh = -1;
+    int skin = -1;
+    /* Local transform */
+    joint_pose pose;
+    glm::mat4 local = glm::mat4(1.0f);
+    /* Transform from the node to the scene */
+    glm::mat4 world = glm::mat4(1.0f);
+};
+
+/**
+ * @brief The parts of a metallic roughness material the engine uses
+ */
+struct gltf_material
+{
+    std::string name;
+    glm::vec4 base_color = glm::vec4(1.0f);
+    /* Textures, -1 if missing */
+    int base_color_texture = -1;
+    int metallic_roughness_texture = -1;
+    int normal_texture = -1;
+};
+
+struct gltf_image
+{
+    /* Path relative to the model, empty if the image is in a buffer
+     * view */
+    std::string uri;
+    int buffer_view = -1;
+    std::string mime_type;
+    /* Filled by gltf_model::import_model */
+    image decoded;
+};
+
+struct gltf_skin
+{
+    std::string name;
+    /* Nodes moved by the joints */
+    std::vector<int> joints;
+    /* Accessor of MAT4, -1 for identity matrices */
+    int inverse_bind_matrices = -1;
+};
+
+/**
+ * @brief An animated property of a node
+ */
+struct gltf_channel
+{
+    int node = -1;
+    enums::animation_property property = enums::TRANSLATION;
+    /* Accessors of the key times and values */
+    int input = -1;
+    int output = -1;
+    enums::gltf_interpolation interpolation = enums::GLTF_LINEAR;
+};
+
+struct gltf_animation
+{
+    std::string name;
+    std::vector<gltf_channel> channels;
+};
+
+/**
+ * @brief Contents of a glTF or GLB file
+ *
+ * The buffers are views on the file: the binary chunk of a GLB file
+ * and the external .bin files are memory mapped by the virtual file
+ * system, so vertex data can be uploaded without being copied.
+ */
+struct gltf_data
+{
+    std::string path;
+    std::string directory;
+    std::vector<asset> buffers;
+    std::vector<gltf_buffer_view> buffer_views;
+    std::vector<gltf_accessor> accessors;
+    std::vector<gltf_mesh> meshes;
+    std::vector<gltf_node> nodes;
+    /* Root nodes of the scene */
+    std::vector<int> scene;
+    std::vector<gltf_material> materials;
+    /* Image of every texture */
+    std::vector<int> textures;
+    std::vector<gltf_image> images;
+    std::vector<gltf_skin> skins;
+    std::vector<gltf_animation> animations;
+};
+
+} // namespace types
+
+/**
+ * @brief glTF 2.0 reader
+ *
+ * Reads .gltf files, with their buffers in .bin files or data URIs,
+ * and binary .glb files. The JSON part is parsed in a document
+ * model, the buffers are left untouched: accessors describe where
+ * the elements are and gltf_model hands them to OpenGL as they are.
+ *
+ * The node hierarchy, the metallic roughness materials, the skins
+ * and the animations are read. Sparse accessors and the extensions
+ * that compress the buffers are not supported.
+ */
+class gltf
+{
+  public:
+    /**
+     * @brief First word of a GLB file, "glTF"
+     */
+    static constexpr std::uint32_t glb_magic = 0x46546C67;
+    /**
+     * @brief Type of the JSON chunk of a GLB file, "JSON"
+     */
+    static constexpr std::uint32_t json_chunk = 0x4E4F534A;
+    /**
+     * @brief Type of the binary chunk of a GLB file, "BIN"
+     */
+    static constexpr std::uint32_t bin_chunk = 0x004E4942;
+
+    gltf() = delete;
+
+    /**
+     * @brief Check if a file is a glTF or GLB file
+     */
+    static bool can_load(const std::string &path);
+    /**
+     * @brief Read a glTF or GLB file
+     *
+     * The file and its buffers are read through the virtual file
+     * system. Safe to call from any thread.
+     *
+     * @param path Path to the file
+     * @param data The contents of the file
+     * @return false if the file could not be read or is malformed
+     */
+    static bool load(const std::string &path, types::gltf_data &data);
+    /**
+     * @brief Parse a glTF or GLB file already in memory
+     *
+     * External buffers are read relative to data.directory.
+     *
+     * @param file Contents of the file
+     * @param data The contents of the file, with path and directory
+     * already set
+     * @return false if the file is malformed
+     */
+    static bool parse(const types::asset &file, types::gltf_data &data);
+
+    /**
+     * @brief Get the size of an element of an accessor, in bytes
+     */
+    static std::size_t get_element_size(const types::gltf_accessor &accessor);
+    /**
+     * @brief Get the distance between two elements of an accessor
+     */
+    static std::size_t get_stride(const types::gltf_data &data,
+                                  const types::gltf_accessor &accessor);
+    /**
+     * @brief Get the first byte of an accessor
+     * @return The first element, nullptr if the accessor has no
+     * buffer view
+     */
+    static const unsigned char *get_pointer(const types::gltf_data &data,
+                                            const types::gltf_accessor &a);
+    /**
+     * @brief Read an accessor as floats
+     *
+     * Normalized integers are converted to [0, 1] or [-1, 1].
+     *
+     * @param data The glTF file
+     * @param accessor Index of the accessor
+     * @return count * components floats
+     */
+    static std::vector<float> read_floats(const types::gltf_data &data,
+                                          int accessor);
+    /**
+     * @brief Read an accessor of integers
+     * @return count * components values
+     */
+    static std::vector<std::uint32_t>
+    read_integers(const types::gltf_data &data, int accessor);
+
+    /**
+     * @brief Get the path an image is cached under
+     *
+     * The path of the file for external images, the path of the model
+     * followed by the index of the image for embedded ones.
+     */
+    static std::string get_image_key(const types::gltf_data &data,
+                                     int image);
+
+    /**
+     * @brief Build the skeleton of a skin
+     *
+     * Joints are reordered so that parents come before children, the
+     * parent of a joint is its closest ancestor in the skin.
+     *
+     * @param data The glTF file
+     * @param skin Index of the skin
+     * @param remap Skeleton index of every joint of the skin, empty if
+     * the order did not change
+     * @return The skeleton
+     */
+    static types::skeleton build_skeleton(const types::gltf_data &data,
+                                          int skin,
+                                          std::vector<std::uint16_t> &remap);
+    /**
+     * @brief Convert the animations to clips of a skeleton
+     *
+     * Channels of nodes that are not joints of the skin are dropped.
+     * Step keys are held until the next one, of cubic spline keys the
+     * values are kept and the tangents dropped.
+     *
+     * @param data The glTF file
+     * @param skin Index of the skin
+     * @param remap The remap returned by build_skeleton
+     * @return One clip per animation
+     */
+    static std::vector<types::animation_clip>
+    build_animations(const types::gltf_data &data, int skin,
+                     const std::vector<std::uint16_t> &remap);
+
+  private:
+    static bool parse_json(const types::json &doc, types::gltf_data &data);
+    static bool load_buffers(const types::json &doc,
+                             const types::asset &glb_buffer,
+                             types::gltf_data &data);
+    static bool validate(const types::gltf_data &data);
+    static void compute_world(types::gltf_data &data);
+    static bool decode_base64(std::string_view text,
+                              std::vector<unsigned char> &out);
+};
+
+} // namespace brenta
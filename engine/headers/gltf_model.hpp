@@ -0,0 +1,225 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "animation_compression.hpp"
+#include "buffer.hpp"
+#include "gltf.hpp"
+#include "shader.hpp"
+#include "texture_cache.hpp"
+#include "vao.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief A glTF primitive uploaded to the GPU
+ */
+struct gltf_draw
+{
+    vao vertex_array;
+    GLenum mode = GL_TRIANGLES;
+    unsigned int count = 0;
+    /* 0 to draw the vertices in order */
+    GLenum index_type = 0;
+    std::size_t index_offset = 0;
+    /* Base color texture, 0 if there is none */
+    unsigned int texture = 0;
+    bool skinned = false;
+};
+
+/**
+ * @brief A node of a glTF model with something to draw
+ */
+struct gltf_instance
+{
+    glm::mat4 transform = glm::mat4(1.0f);
+    /* Range of draws */
+    std::size_t first = 0;
+    std::size_t count = 0;
+};
+
+} // namespace types
+
+/**
+ * @brief Model loaded from a glTF or GLB file
+ *
+ * Unlike model, the vertices are not converted to types::vertex:
+ * every buffer view used by the primitives is uploaded to a buffer of
+ * its own straight from the memory mapped file, and the vertex arrays
+ * read the attributes with the type, stride and offset of their
+ * accessors. Positions, normals and texture coordinates go to the
+ * locations of the engine shaders, joints and weights too.
+ *
+ * The node hierarchy gives the transform of every mesh, written to
+ * the Object uniform block before drawing it. The first skin becomes the
+ * skeleton and the animations its clips, which are compressed like
+ * the ones of model. Skinned meshes are deformed on the GPU only:
+ * with CPU skinning they are drawn in the bind pose.
+ *
+ * Of the materials, the base color texture is bound as the diffuse
+ * texture. A glTF model owns its buffers, so It can be moved but not
+ * copied.
+ */
+class gltf_model
+{
+  public:
+    /**
+     * @brief Empty constructor
+     *
+     * Does nothing
+     */
+    gltf_model()
+    {
+    }
+    /**
+     * @brief Load a glTF or GLB file
+     *
+     * @param path Path to the file
+     * @param wrapping Texture wrapping mode
+     * @param filtering_min Texture filtering mode
+     * @param filtering_mag Texture filtering mode
+     * @param has_mipmap If the texture has a mipmap
+     * @param mipmap_min Mipmap filtering mode
+     * @param mipmap_mag Mipmap filtering mode
+     */
+    gltf_model(const std::string &path, GLint wrapping = GL_REPEAT,
+               GLint filtering_min = GL_NEAREST,
+               GLint filtering_mag = GL_LINEAR,
+               GLboolean has_mipmap = GL_TRUE,
+               GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+               GLint mipmap_mag = GL_LINEAR);
+    /**
+     * @brief Upload an imported file
+     *
+     * Must be called from the thread that owns the OpenGL context.
+     *
+     * @param data Data returned by import_model, with the same texture
+     * parameters
+     */
+    gltf_model(types::gltf_data &&data, GLint wrapping = GL_REPEAT,
+               GLint filtering_min = GL_NEAREST,
+               GLint filtering_mag = GL_LINEAR,
+               GLboolean has_mipmap = GL_TRUE,
+               GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+               GLint mipmap_mag = GL_LINEAR);
+    gltf_model(const gltf_model &) = delete;
+    gltf_model &operator=(const gltf_model &) = delete;
+    gltf_model(gltf_model &&) noexcept = default;
+    gltf_model &operator=(gltf_model &&) noexcept = default;
+
+    /**
+     * @brief Read a file and decode its textures
+     *
+     * Does not touch OpenGL, so It can run on a worker thread. The
+     * images are read in one batch and decoded in parallel, the ones
+     * already in the texture cache are skipped.
+     *
+     * @return The file, with no nodes if It could not be read
+     */
+    static types::gltf_data
+    import_model(const std::string &path, GLint wrapping = GL_REPEAT,
+                 GLint filtering_min = GL_NEAREST,
+                 GLint filtering_mag = GL_LINEAR,
+                 GLboolean has_mipmap = GL_TRUE,
+                 GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+                 GLint mipmap_mag = GL_LINEAR);
+
+    /**
+     * @brief Draw the model
+     *
+     * @param shader Shader to use
+     * @param model_matrix Transform of the whole model
+     * @param palette Skinning matrices of the instance computed by the
+     * animator, empty for the bind pose
+     */
+    void draw(types::shader_name_t shader,
+              const glm::mat4 &model_matrix = glm::mat4(1.0f),
+              std::span<const glm::mat4> palette = {});
+
+    /**
+     * @brief Check if the model is deformed by a skeleton
+     */
+    bool has_skeleton() const;
+    /**
+     * @brief Get the skeleton of the first skin
+     * @return The skeleton, with no joints for a static model
+     */
+    const types::skeleton &get_skeleton() const;
+    /**
+     * @brief Get the animation clips of the skeleton
+     */
+    const std::vector<types::compressed_clip> &get_animations() const;
+    /**
+     * @brief Find an animation clip by name
+     * @return The clip, nullptr if there is none
+     */
+    const types::compressed_clip *
+    find_animation(const std::string &name) const;
+
+  private:
+    GLint wrapping = GL_REPEAT;
+    GLint filtering_min = GL_NEAREST;
+    GLint filtering_mag = GL_LINEAR;
+    GLboolean has_mipmap = GL_TRUE;
+    GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR;
+    GLint mipmap_mag = GL_LINEAR;
+
+    std::vector<types::buffer> buffers;
+    std::vector<types::gltf_draw> draws;
+    std::vector<types::gltf_instance> instances;
+    std::vector<texture_cache::reference> textures_loaded;
+
+    types::skeleton skeleton;
+    std::vector<types::compressed_clip> animations;
+    /* Transform of the skinned meshes: the joints already hold the
+     * nodes below the skeleton */
+    glm::mat4 skeleton_transform = glm::mat4(1.0f);
+
+    /* Uniforms of the last shader the model was drawn with */
+    types::shader_name_t uniforms_shader;
+    types::uniform<int> diffuse_sampler;
+    types::uniform<glm::vec3> pos_scale;
+    types::uniform<glm::vec3> pos_offset;
+    types::uniform<bool> oct_normals;
+
+    void upload(types::gltf_data &data);
+    void resolve_uniforms(const types::shader_name_t &shader);
+    unsigned int load_texture(types::gltf_data &data, int material);
+};
+
+} // namespace brenta
@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace brenta
+{
+
+namespace enums
+{
+
+/**
+ * @brief Type of a JSON value
+ */
+enum json_type
+{
+    JSON_NULL,
+    JSON_BOOLEAN,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+};
+
+} // namespace enums
+
+namespace types
+{
+
+/**
+ * @brief A parsed JSON value
+ *
+ * A small read only document model, enough for the metadata of
+ * asset formats like glTF. Looking up a missing member or element
+ * returns a null value, so lookups can be chained and checked once:
+ *
+ * double x = doc["nodes"][0]["translation"][0].as_number();
+ */
+class json
+{
+  public:
+    /**
+     * @brief Maximum nesting of arrays and objects
+     */
+    static constexpr unsigned int max_depth = 256;
+
+    /**
+     * @brief Empty constructor
+     *
+     * The value is null
+     */
+    json()
+    {
+    }
+
+    /**
+     * @brief Parse a JSON document
+     *
+     * @param text The document, in UTF-8
+     * @param out The parsed value
+     * @return false if the document is malformed
+     */
+    static bool parse(std::string_view text, json &out);
+
+    enums::json_type get_type() const;
+    bool is_null() const;
+    bool is_number() const;
+    bool is_string() const;
+    bool is_array() const;
+    bool is_object() const;
+
+    /**
+     * @brief Check if an object has a member
+     */
+    bool contains(std::string_view key) const;
+    /**
+     * @brief Get a member of an object
+     * @return The member, a null value if there is none
+     */
+    const json &operator[](std::string_view key) const;
+    /**
+     * @brief Get an element of an array
+     * @return The element, a null value if there is none
+     */
+    const json &operator[](std::size_t index) const;
+    /**
+     * @brief Get the number of elements of an array or members of an
+     * object
+     */
+    std::size_t size() const;
+
+    bool as_bool(bool fallback = false) const;
+    double as_number(double fallback = 0.0) const;
+    /**
+     * @brief Get a number as an integer
+     * @return The number truncated, fallback if It is not a number
+     */
+    long long as_int(long long fallback = 0) const;
+    /**
+     * @brief Get a string
+     * @return The string, empty if the value is not a string
+     */
+    const std::string &as_string() const;
+    /**
+     * @brief Get the elements of an array
+     */
+    const std::vector<json> &get_elements() const;
+    /**
+     * @brief Get the members of an object, in document order
+     */
+    const std::vector<std::pair<std::string, json>> &get_members() const;
+
+  private:
+    enums::json_type type = enums::JSON_NULL;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<json> elements;
+    std::vector<std::pair<std::string, json>> members;
+
+    static bool parse_value(const char *&p, const char *end, json &out,
+                            unsigned int depth);
+    static bool parse_string(const char *&p, const char *end,
+                             std::string &out);
+};
+
+} // namespace types
+
+} // namespace brenta
@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <span>
+
+namespace brenta
+{
+
+/**
+ * @brief Screen space level of detail selection
+ *
+ * Picks the coarsest level of detail whose geometric error, projected
+ * on the screen, stays under a threshold in pixels. To avoid popping
+ * when an object sits right at a switch distance the selection has a
+ * hysteresis band: a coarser level is taken only when its error falls
+ * below threshold * (1 - hysteresis), and a finer one only when the
+ * current error grows above threshold * (1 + hysteresis). The caller
+ * keeps the current level of every instance between frames.
+ *
+ * The engine sets the threshold and the hysteresis from the engine
+ * builder, see set_lod_threshold.
+ */
+class lod_selector
+{
+  public:
+    lod_selector() = delete;
+
+    /**
+     * @brief Set the largest error allowed on screen, in pixels
+     */
+    static void set_threshold(float pixels);
+    /**
+     * @brief Get the largest error allowed on screen, in pixels
+     */
+    static float get_threshold();
+    /**
+     * @brief Set the width of the hysteresis band
+     *
+     * @param hysteresis Fraction of the threshold, 0.25 means a switch
+     * happens at 75% and 125% of the threshold
+     */
+    static void set_hysteresis(float hysteresis);
+    /**
+     * @brief Get the width of the hysteresis band
+     */
+    static float get_hysteresis();
+
+    /**
+     * @brief Compute how many pixels a model space unit covers
+     *
+     * The distance is measured from the camera to the closest point of
+     * the bounding sphere, a camera inside the sphere gets the finest
+     * level.
+     *
+     * @param model Model matrix of the instance
+     * @param view View matrix of the camera
+     * @param projection Projection matrix of the camera
+     * @param center Center of the bounding sphere in model space
+     * @param radius Radius of the bounding sphere in model space
+     * @param viewport_height Height of the viewport in pixels
+     * @return Pixels per model space unit, 0 for an object behind
+     * the camera
+     */
+    static float pixels_per_unit(const glm::mat4 &model, const glm::mat4 &view,
+                                 const glm::mat4 &projection, glm::vec3 center,
+                                 float radius, float viewport_height);
+    /**
+     * @brief Select a level of detail
+     *
+     * @param errors Error of every level in model space units, finest
+     * first and never decreasing
+     * @param pixels_per_unit Result of pixels_per_unit
+     * @param current Level drawn in the previous frame
+     * @return The level to draw
+     */
+    static unsigned int select(std::span<const float> errors,
+                               float pixels_per_unit, unsigned int current);
+
+  private:
+    static float threshold;
+    static float hysteresis;
+};
+
+} // namespace brenta
@@ -0,0 +1,79 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace brenta
+{
+
+/**
+ * @brief LZ4 block compression
+ *
+ * Compresses and decompresses raw LZ4 blocks, without the frame
+ * format around them: the caller stores the sizes. The compressor is
+ * the simple greedy one, decompression runs at memory speed and is
+ * what asset packs are optimized for.
+ */
+class lz4
+{
+  public:
+    lz4() = delete;
+
+    /**
+     * @brief Get the largest possible size of a compressed block
+     *
+     * @param size Size of the uncompressed data in bytes
+     * @return Size of the compressed block in the worst case
+     */
+    static std::size_t max_compressed_size(std::size_t size);
+    /**
+     * @brief Compress a block
+     *
+     * @param input Data to compress
+     * @param output Compressed block, resized to its size
+     */
+    static void compress(std::span<const unsigned char> input,
+                         std::vector<unsigned char> &output);
+    /**
+     * @brief Decompress a block
+     *
+     * The block is validated, so corrupted data fails instead of
+     * reading or writing out of bounds.
+     *
+     * @param input Compressed block
+     * @param output Destination, sized to the uncompressed size
+     * @return true if the block decompressed to exactly output.size()
+     * bytes
+     */
+    static bool decompress(std::span<const unsigned char> input,
+                           std::span<unsigned char> output);
+};
+
+} // namespace brenta
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief Read-only memory mapped file
+ *
+ * This class maps a whole file in memory with mmap, so that the
+ * contents can be read without copying them in user space buffers.
+ * The mapping is released when the object goes out of scope. The
+ * class can be moved but not copied, since only one object can own
+ * the mapping.
+ */
+class mapped_file
+{
+  public:
+    /**
+     * @brief Empty constructor
+     *
+     * Does not map anything
+     */
+    mapped_file()
+    {
+    }
+    /**
+     * @brief Map a file in memory
+     *
+     * @param path Path to the file
+     *
+     * Check is_open to know if the file was mapped successfully.
+     */
+    mapped_file(const std::string &path);
+    ~mapped_file();
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+    mapped_file(mapped_file &&other) noexcept;
+    mapped_file &operator=(mapped_file &&other) noexcept;
+
+    /**
+     * @brief Map a file in memory
+     *
+     * Any previous mapping is released.
+     *
+     * @param path Path to the file
+     * @return true if the file was mapped
+     */
+    bool open(const std::string &path);
+    /**
+     * @brief Release the mapping
+     */
+    void close();
+    /**
+     * @brief Check if a file is mapped
+     * @return true if a file is mapped
+     */
+    bool is_open() const;
+    /**
+     * @brief Get a pointer to the mapped data
+     * @return Pointer to the first byte of the file
+     */
+    const unsigned char *data() const;
+    /**
+     * @brief Get the size of the mapping
+     * @return Size of the file in bytes
+     */
+    std::size_t size() const;
+
+  private:
+    const unsigned char *ptr = nullptr;
+    std::size_t length = 0;
+};
+
+} // namespace types
+
+} // namespace brenta
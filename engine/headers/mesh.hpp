@@ -27,6 +27,7 @@
 #pragma once
 
 #include "buffer.hpp"
+#include "geometry_arena.hpp"
 #include "gl_helper.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
@@ -35,6 +36,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <cstdint>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -44,6 +47,8 @@ namespace brenta
 namespace types
 {
 
+struct cluster_frustum;
+
 /**
  * @brief The Vertex struct represents a vertex of a 3D model
  *
@@ -57,6 +62,70 @@ struct vertex
     glm::vec2 tex_coords;
 };
 
+/**
+ * @brief The Packed Vertex struct is the compact GPU layout of a vertex
+ *
+ * The position is stored as normalized unsigned shorts relative to the
+ * bounding box of the mesh, the normal is octahedral encoded in two
+ * signed shorts and the texture coordinates are half floats. The fourth
+ * position component is padding to keep the attributes 4 byte aligned.
+ * A packed vertex is 16 bytes, half the size of a vertex.
+ */
+struct packed_vertex
+{
+    std::uint16_t position[4];
+    std::int16_t normal[2];
+    std::uint16_t tex_coords[2];
+};
+
+/**
+ * @brief Joints that deform a vertex of a skinned mesh
+ *
+ * Up to four joints per vertex, unused slots have zero weight. The
+ * weights are normalized unsigned bytes that sum to 255, so a skinned
+ * vertex carries 12 extra bytes. See skinning.
+ */
+struct vertex_skin
+{
+    std::uint16_t joints[4];
+    std::uint8_t weights[4];
+};
+
+/**
+ * @brief A level of detail of a mesh
+ *
+ * Every level is a triangle list in the index buffer of the mesh
+ * that references the same vertices as the full resolution one.
+ */
+struct mesh_lod
+{
+    /* First index of the level in the index buffer */
+    std::uint32_t index_offset;
+    std::uint32_t index_count;
+    /* Geometric error in model space units */
+    float error;
+};
+
+/**
+ * @brief A cluster of nearby triangles of a mesh
+ *
+ * The triangles of a meshlet are a contiguous range of the index
+ * buffer of the mesh. The bounding sphere and the normal cone are in
+ * model space and are used by the cluster_culler.
+ */
+struct meshlet
+{
+    std::uint32_t index_offset;
+    std::uint32_t index_count;
+    glm::vec3 center;
+    float radius;
+    /* Average direction of the triangle normals */
+    glm::vec3 cone_axis;
+    /* Sine of the half angle of the normal cone, 1 if the cluster
+     * can not be back face culled */
+    float cone_cutoff;
+};
+
 /**
  * @brief The Texture struct represents a texture of a 3D model
  *
@@ -71,6 +140,23 @@ struct texture
     std::string path;
 };
 
+/**
+ * @brief The uniforms set by mesh::draw
+ *
+ * They are resolved the first time a mesh is drawn with a shader, so
+ * drawing It again with the same one does not look up any name.
+ */
+struct mesh_uniforms
+{
+    /* Shader the handles belong to, empty before the first draw */
+    shader_name_t shader;
+    /* Sampler of every texture of the mesh, in order */
+    std::vector<uniform<int>> samplers;
+    uniform<glm::vec3> pos_scale;
+    uniform<glm::vec3> pos_offset;
+    uniform<bool> oct_normals;
+};
+
 } // namespace types
 
 /**
@@ -79,12 +165,17 @@ struct texture
  * A mesh is a collection of vertices, indices and textures
  * that represent a 3D model. The mesh can be drawn using
  * a shader and calling the Draw method.
+ *
+ * A mesh owns its OpenGL buffers, so It can be moved but not copied.
  */
 class mesh
 {
   public:
     /**
      * @brief vertices of the mesh
+     *
+     * Empty if the CPU side copy was dropped after the upload, see
+     * set_keep_cpu_data.
      */
     std::vector<types::vertex> vertices;
     /**
@@ -208,6 +299,9 @@ class mesh
     /**
      * @brief Construct a new Mesh object
      *
+     * The vectors are moved into the mesh when the CPU side copy is
+     * kept, otherwise they are released after the upload.
+     *
      * @param vertices Vertices of the mesh
      * @param indices Indices of the mesh
      * @param textures Textures of the mesh
@@ -224,24 +318,196 @@ class mesh
          GLboolean hasMipmap = GL_TRUE,
          GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
          GLint mipmap_max = GL_LINEAR);
+    /**
+     * @brief Construct a new Mesh object from external memory
+     *
+     * The vertices and indices are uploaded to the GPU directly from
+     * the given memory without keeping a CPU side copy, so the vertices
+     * and indices vectors of the mesh stay empty. This is used to upload
+     * meshes straight from a memory mapped cache file.
+     *
+     * A skinned mesh never goes in the geometry_arena: with GPU
+     * skinning It has an extra vertex buffer for the influences, with
+     * CPU skinning It keeps a copy of the bind pose to deform.
+     *
+     * @param vertices Vertices of the mesh
+     * @param indices Indices of the mesh
+     * @param textures Textures of the mesh
+     * @param wrapping Type of texture wrapping
+     * @param filtering_min Minifying texture filtering
+     * @param filtering_mag Magnifying texture filtering
+     * @param hasMipmap Should the texture have a mipmap?
+     * @param mipmap_min Type of mipmap minifying texture filtering
+     * @param mipmap_mag Type of mipmap magnifying texture filtering
+     * @param skin Influences of every vertex, empty for a static mesh
+     */
+    mesh(std::span<const types::vertex> vertices,
+         std::span<const unsigned int> indices,
+         std::vector<types::texture> textures, GLint wrapping = GL_REPEAT,
+         GLint filtering_min = GL_NEAREST, GLint filtering_mag = GL_LINEAR,
+         GLboolean hasMipmap = GL_TRUE,
+         GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+         GLint mipmap_max = GL_LINEAR,
+         std::span<const types::vertex_skin> skin = {});
+    mesh(const mesh &) = delete;
+    mesh &operator=(const mesh &) = delete;
+    mesh(mesh &&) noexcept = default;
+    mesh &operator=(mesh &&) noexcept = default;
     /**
      * @brief The Builder class is used to build a Mesh object
      */
     class builder;
 
+    /**
+     * @brief Keep or drop the CPU side geometry after the upload
+     *
+     * When disabled, meshes created afterwards from vectors release
+     * their vertices and indices once they are on the GPU. Enabled by
+     * default.
+     *
+     * @param keep Whether new meshes should keep their geometry
+     */
+    static void set_keep_cpu_data(bool keep);
+    /**
+     * @brief Check if new meshes keep their CPU side geometry
+     *
+     * @return true if the geometry is kept after the upload
+     */
+    static bool keeps_cpu_data();
+    /**
+     * @brief Enable or disable the packed vertex format
+     *
+     * When enabled, meshes created afterwards upload their vertices as
+     * types::packed_vertex instead of types::vertex. The shader used to
+     * draw them must decode the position with the posScale and posOffset
+     * uniforms and the normal with octahedral decoding when octNormals
+     * is set, like the default shader does.
+     *
+     * @param enabled Whether new meshes should use the packed format
+     */
+    static void set_packed_vertices(bool enabled);
+    /**
+     * @brief Check if the packed vertex format is enabled
+     *
+     * @return true if new meshes use the packed format
+     */
+    static bool uses_packed_vertices();
+    /**
+     * @brief Encode a unit normal with octahedral mapping
+     *
+     * @param normal Unit length normal
+     * @return The normal projected on the octahedron in [-1, 1]
+     */
+    static glm::vec2 encode_octahedral(glm::vec3 normal);
+    /**
+     * @brief Decode an octahedral encoded normal
+     *
+     * @param encoded Normal projected on the octahedron in [-1, 1]
+     * @return The unit length normal
+     */
+    static glm::vec3 decode_octahedral(glm::vec2 encoded);
+    /**
+     * @brief Pack a vertex in the compact format
+     *
+     * @param vertex The vertex to pack
+     * @param scale Size of the bounding box of the mesh
+     * @param offset Minimum corner of the bounding box of the mesh
+     * @return The packed vertex
+     */
+    static types::packed_vertex pack_vertex(const types::vertex &vertex,
+                                            glm::vec3 scale, glm::vec3 offset);
+    /**
+     * @brief Describe the vertex layout of a vertex buffer to a VAO
+     *
+     * @param vao The VAO to set up
+     * @param vbo Buffer holding types::vertex or types::packed_vertex
+     * @param packed Whether the buffer holds packed vertices
+     */
+    static void set_vertex_format(types::vao &vao, const types::buffer &vbo,
+                                  bool packed);
+
     /**
      * @brief Draw the mesh
      *
      * @param shader_name Shader to use to draw the mesh
+     * @param lod Level of detail to draw, clamped to the coarsest one
+     * @param frustum If not null and the mesh has meshlets, only the
+     * meshlets visible from It are drawn at the finest level
+     * @param palette Joint matrices deforming a mesh skinned on the
+     * CPU, with GPU skinning the palette is bound by the model
+     */
+    void draw(types::shader_name_t shader_name, unsigned int lod = 0,
+              const types::cluster_frustum *frustum = nullptr,
+              std::span<const glm::mat4> palette = {});
+    /**
+     * @brief Check if the mesh is deformed by a skeleton
+     */
+    bool is_skinned() const;
+    /**
+     * @brief Get the VAO bound to draw the mesh
+     *
+     * Meshes in the same page of the geometry_arena share It.
+     */
+    unsigned int get_vertex_array() const;
+
+    /**
+     * @brief Set the levels of detail of the mesh
+     *
+     * The first level must be the full resolution mesh. Without levels
+     * the whole index buffer is drawn.
+     *
+     * @param lods Levels inside the index buffer, finest first
+     */
+    void set_lods(std::vector<types::mesh_lod> lods);
+    /**
+     * @brief Get the levels of detail of the mesh
+     * @return The levels, finest first
+     */
+    const std::vector<types::mesh_lod> &get_lods() const;
+    /**
+     * @brief Set the meshlets of the finest level of the mesh
+     *
+     * @param meshlets Meshlets built by meshlet_builder
+     */
+    void set_meshlets(std::vector<types::meshlet> meshlets);
+    /**
+     * @brief Get the meshlets of the finest level of the mesh
      */
-    void draw(types::shader_name_t shader_name);
+    const std::vector<types::meshlet> &get_meshlets() const;
 
   private:
-    // render data
+    // render data, in the geometry_arena when range is valid
+    types::geometry_range range;
     types::vao vao;
     types::buffer vbo;
     types::buffer ebo;
-    void setup_mesh();
+    unsigned int num_indices;
+    /**
+     * @brief Type of the indices, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+     */
+    GLenum index_type = GL_UNSIGNED_INT;
+    std::vector<types::mesh_lod> lods;
+    std::vector<types::meshlet> meshlets;
+    /**
+     * @brief Whether the vertices are uploaded as types::packed_vertex
+     */
+    bool packed = false;
+    glm::vec3 pos_scale = glm::vec3(1.0f);
+    glm::vec3 pos_offset = glm::vec3(0.0f);
+    // skinning data, empty for static meshes
+    types::buffer skin_vbo;
+    std::vector<types::vertex_skin> skin;
+    std::vector<types::vertex> bind_vertices;
+    std::vector<types::vertex> skinned_vertices;
+    bool skinned = false;
+    types::mesh_uniforms uniforms;
+    static bool packed_vertices;
+    static bool keep_cpu_data;
+    void setup_mesh(std::span<const types::vertex> vertices,
+                    std::span<const unsigned int> indices,
+                    std::span<const types::vertex_skin> skin = {});
+    const types::mesh_uniforms &
+    resolve_uniforms(const types::shader_name_t &shader_name);
 };
 
 /**
@@ -252,6 +518,9 @@ class mesh::builder
   private:
     std::vector<types::vertex> vertices = {};
     std::vector<unsigned int> indices = {};
+    std::span<const types::vertex> vertex_span = {};
+    std::span<const unsigned int> index_span = {};
+    std::span<const types::vertex_skin> skin_span = {};
     std::vector<types::texture> textures = {};
     GLint wrapping = GL_REPEAT;
     GLint filtering_min = GL_NEAREST;
@@ -263,6 +532,27 @@ class mesh::builder
   public:
     builder &set_vertices(std::vector<types::vertex> vertices);
     builder &set_indices(std::vector<unsigned int> indices);
+    /**
+     * @brief Upload the vertices from external memory
+     *
+     * The memory is not copied and must stay valid until build is
+     * called. Takes precedence over set_vertices.
+     */
+    builder &set_vertex_span(std::span<const types::vertex> vertices);
+    /**
+     * @brief Upload the indices from external memory
+     *
+     * The memory is not copied and must stay valid until build is
+     * called. Takes precedence over set_indices.
+     */
+    builder &set_index_span(std::span<const unsigned int> indices);
+    /**
+     * @brief Set the influences of a skinned mesh
+     *
+     * The memory is not copied and must stay valid until build is
+     * called.
+     */
+    builder &set_skin_span(std::span<const types::vertex_skin> skin);
     builder &set_textures(std::vector<types::texture> textures);
     builder &set_wrapping(GLint wrapping);
     builder &set_filtering_min(GLint filtering_min);
@@ -0,0 +1,161 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mapped_file.hpp"
+#include "mesh.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief Reference to a texture used by a mesh
+ *
+ * The path is relative to the directory of the model.
+ */
+struct texture_ref
+{
+    std::string type;
+    std::string path;
+};
+
+/**
+ * @brief A mesh stored in the mesh cache
+ *
+ * When loaded from the cache, vertices and indices point directly
+ * inside the memory mapped cache file, so they are valid only as long
+ * as the mapped_file they come from is open.
+ */
+struct cached_mesh
+{
+    std::span<const vertex> vertices;
+    std::span<const unsigned int> indices;
+    std::vector<texture_ref> textures;
+    /* Levels of detail inside indices, empty if there are none */
+    std::vector<mesh_lod> lods;
+    /* Meshlets of the finest level, empty if there are none */
+    std::vector<meshlet> meshlets;
+};
+
+} // namespace types
+
+/**
+ * @brief Baked binary mesh cache
+ *
+ * Importing a model with Assimp is slow even for models that never
+ * change. The mesh cache stores the result of an import in a versioned
+ * binary file containing the vertex and index blobs, the levels of
+ * detail, the meshlets and the texture references of every mesh. On
+ * the next run the file is memory mapped and the meshes are uploaded
+ * to the GPU straight from the mapping, skipping Assimp entirely.
+ *
+ * A cache file is keyed by the path of the source model and the import
+ * flags, and It is invalidated when the modification time or the size
+ * of the source changes or when the format version is bumped.
+ *
+ * The cache is disabled until init is called, the engine does this
+ * for you if you set use_mesh_cache in the engine builder.
+ */
+class mesh_cache
+{
+  public:
+    /**
+     * @brief Version of the cache format
+     *
+     * Bump this every time the layout of the file or of
+     * types::vertex changes, old files will be ignored.
+     */
+    static constexpr std::uint32_t version = 5;
+
+    mesh_cache() = delete;
+
+    /**
+     * @brief Enable the mesh cache
+     *
+     * @param directory Directory where cache files are stored, It
+     * is created if It does not exist
+     */
+    static void init(std::string directory);
+    /**
+     * @brief Disable the mesh cache
+     */
+    static void destroy();
+    /**
+     * @brief Check if the mesh cache is enabled
+     * @return true if init has been called
+     */
+    static bool is_enabled();
+    /**
+     * @brief Get the path of the cache file for a model
+     *
+     * @param source Path to the source model
+     * @param import_flags Assimp post processing flags in the lower 32
+     * bits, engine side processing steps in the upper ones
+     * @return Path of the cache file
+     */
+    static std::string get_cache_path(const std::string &source,
+                                      std::uint64_t import_flags);
+    /**
+     * @brief Load a model from the cache
+     *
+     * @param source Path to the source model
+     * @param import_flags Assimp post processing flags in the lower 32
+     * bits, engine side processing steps in the upper ones
+     * @param file Mapped file that will own the cache data
+     * @param meshes Output meshes, pointing inside file
+     * @return true on a cache hit, false if the cache is missing,
+     * stale or corrupted
+     */
+    static bool load(const std::string &source, std::uint64_t import_flags,
+                     types::mapped_file &file,
+                     std::vector<types::cached_mesh> &meshes);
+    /**
+     * @brief Store a model in the cache
+     *
+     * @param source Path to the source model
+     * @param import_flags Assimp post processing flags in the lower 32
+     * bits, engine side processing steps in the upper ones
+     * @param meshes Meshes to store
+     * @return true if the cache file was written
+     */
+    static bool store(const std::string &source, std::uint64_t import_flags,
+                      const std::vector<types::cached_mesh> &meshes);
+
+  private:
+    static bool enabled;
+    static std::string directory;
+};
+
+} // namespace brenta
@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief Post transform vertex cache statistics of a mesh
+ */
+struct vertex_cache_stats
+{
+    /* Average cache miss ratio, transformed vertices per triangle.
+     * 0.5 is the optimum for a regular grid, 3 the worst case */
+    float acmr = 0.0f;
+    /* Average transform to vertex ratio, 1 is the optimum */
+    float atvr = 0.0f;
+};
+
+} // namespace types
+
+/**
+ * @brief Mesh optimization passes
+ *
+ * Imported meshes keep the vertices and the triangle order of the
+ * source file, which for formats like OBJ means duplicated vertices
+ * and a triangle order that thrashes the post transform vertex cache.
+ * This class provides the passes to fix that, meant to run at import
+ * or bake time:
+ *
+ * - weld: merge identical vertices
+ * - optimize_vertex_cache: reorder triangles for the vertex cache
+ *   (Tom Forsyth's linear-speed algorithm)
+ * - optimize_overdraw: reorder clusters of triangles so that the
+ *   outer ones are drawn first, keeping the cache efficiency
+ * - optimize_vertex_fetch: reorder vertices in the order they are
+ *   used, so that fetches are mostly sequential
+ *
+ * The model runs all of them on every imported mesh when the
+ * optimizer is enabled, the engine does this for you if you set
+ * use_mesh_optimizer in the engine builder.
+ */
+class mesh_optimizer
+{
+  public:
+    /**
+     * @brief Flag added to the mesh cache key of optimized meshes
+     */
+    static constexpr std::uint64_t import_flag = 1ULL << 32;
+    /**
+     * @brief Size of the FIFO cache simulated by analyze
+     */
+    static constexpr unsigned int analyze_cache_size = 16;
+
+    mesh_optimizer() = delete;
+
+    /**
+     * @brief Enable or disable the optimization of imported models
+     */
+    static void set_enabled(bool enabled);
+    /**
+     * @brief Check if imported models are optimized
+     */
+    static bool is_enabled();
+
+    /**
+     * @brief Run every pass on a mesh
+     *
+     * @param vertices The vertices, modified in place
+     * @param indices The triangle list, modified in place
+     */
+    static void optimize(std::vector<types::vertex> &vertices,
+                         std::vector<unsigned int> &indices);
+    /**
+     * @brief Merge bitwise identical vertices
+     *
+     * @param vertices The vertices, modified in place
+     * @param indices The triangle list, remapped
+     */
+    static void weld(std::vector<types::vertex> &vertices,
+                     std::vector<unsigned int> &indices);
+    /**
+     * @brief Reorder triangles for the post transform vertex cache
+     *
+     * @param indices The triangle list, modified in place
+     * @param vertex_count Number of vertices
+     */
+    static void optimize_vertex_cache(std::vector<unsigned int> &indices,
+                                      std::size_t vertex_count);
+    /**
+     * @brief Reorder clusters of triangles to reduce overdraw
+     *
+     * Must run after optimize_vertex_cache. The triangles are split
+     * in clusters where splitting does not raise the cache miss ratio
+     * above threshold times the one of the whole mesh, the clusters
+     * facing outwards are then drawn first.
+     *
+     * @param indices The triangle list, modified in place
+     * @param vertices The vertices
+     * @param threshold Allowed ACMR degradation, 1.05 means 5%
+     */
+    static void optimize_overdraw(std::vector<unsigned int> &indices,
+                                  const std::vector<types::vertex> &vertices,
+                                  float threshold = 1.05f);
+    /**
+     * @brief Reorder vertices in the order they are first used
+     *
+     * Unused vertices are removed.
+     *
+     * @param vertices The vertices, modified in place
+     * @param indices The triangle list, remapped
+     */
+    static void optimize_vertex_fetch(std::vector<types::vertex> &vertices,
+                                      std::vector<unsigned int> &indices);
+    /**
+     * @brief Simulate a FIFO vertex cache
+     *
+     * @param indices The triangle list
+     * @param vertex_count Number of vertices
+     * @param cache_size Number of entries of the simulated cache
+     * @return The cache statistics
+     */
+    static types::vertex_cache_stats
+    analyze(const std::vector<unsigned int> &indices,
+            std::size_t vertex_count,
+            unsigned int cache_size = analyze_cache_size);
+
+  private:
+    static bool enabled;
+};
+
+} // namespace brenta
@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace brenta
+{
+
+/**
+ * @brief Mesh simplification and level of detail generation
+ *
+ * Distant models cover a few pixels but cost as many triangles as
+ * close ones. This class reduces the triangle count of a mesh with
+ * quadric error metric edge collapses (Garland and Heckbert): every
+ * vertex accumulates the planes of the triangles around It and an edge
+ * collapses onto the endpoint that moves the surface the least.
+ *
+ * Vertices are never moved or created, so every level of detail reuses
+ * the vertex buffer of the full resolution mesh and only needs its own
+ * range in the index buffer. Vertices on texture or normal seams are
+ * kept in place and open borders only collapse along themselves, so
+ * the silhouette and the UV layout survive the simplification.
+ *
+ * The model generates the levels of every imported mesh when the
+ * simplifier is enabled, the engine does this for you if you set
+ * use_lods in the engine builder. Use lod_selector to pick the level
+ * to draw.
+ */
+class mesh_simplifier
+{
+  public:
+    /**
+     * @brief Flag added to the mesh cache key of meshes with LODs
+     */
+    static constexpr std::uint64_t import_flag = 1ULL << 33;
+    /**
+     * @brief Maximum number of levels of a mesh, the full one included
+     */
+    static constexpr unsigned int max_levels = 8;
+
+    mesh_simplifier() = delete;
+
+    /**
+     * @brief Enable or disable LOD generation for imported models
+     */
+    static void set_enabled(bool enabled);
+    /**
+     * @brief Check if LODs are generated for imported models
+     */
+    static bool is_enabled();
+    /**
+     * @brief Set the number of levels generated for imported models
+     *
+     * @param levels Number of levels, the full one included, clamped
+     * to max_levels
+     */
+    static void set_levels(unsigned int levels);
+    /**
+     * @brief Get the number of levels generated for imported models
+     */
+    static unsigned int get_levels();
+
+    /**
+     * @brief Simplify a triangle list
+     *
+     * Collapses edges until the index count reaches target_index_count
+     * or the next collapse would exceed target_error.
+     *
+     * @param vertices The vertices
+     * @param indices The triangle list
+     * @param target_index_count Desired number of indices
+     * @param target_error Maximum error, relative to the size of the mesh
+     * @param result_error If not null, set to the error of the result
+     * relative to the size of the mesh
+     * @return The simplified triangle list, indexing the same vertices
+     */
+    static std::vector<unsigned int>
+    simplify(const std::vector<types::vertex> &vertices,
+             const std::vector<unsigned int> &indices,
+             std::size_t target_index_count, float target_error,
+             float *result_error = nullptr);
+    /**
+     * @brief Generate a chain of levels of detail
+     *
+     * Every level targets ratio times the triangles of the previous
+     * one. The levels are appended to indices, the chain stops early
+     * when the simplification can not make progress.
+     *
+     * @param vertices The vertices
+     * @param indices The full resolution triangle list, the coarser
+     * levels are appended to It
+     * @param levels Number of levels, the full one included
+     * @param ratio Triangle ratio between two consecutive levels
+     * @return The levels, finest first, with the error in model units
+     */
+    static std::vector<types::mesh_lod>
+    generate_lods(const std::vector<types::vertex> &vertices,
+                  std::vector<unsigned int> &indices, unsigned int levels,
+                  float ratio = 0.5f);
+
+  private:
+    static bool enabled;
+    static unsigned int levels;
+};
+
+} // namespace brenta
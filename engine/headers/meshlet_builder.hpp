@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mesh.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace brenta
+{
+
+/**
+ * @brief Meshlet builder
+ *
+ * Large meshes are drawn whole even when most of their triangles are
+ * out of the screen or facing away. This class splits the triangles
+ * of a mesh in small clusters of nearby triangles, growing every
+ * cluster from a seed triangle through the neighbours that add the
+ * fewest new vertices. The index buffer is reordered so that every
+ * cluster is a contiguous range, and each cluster gets a bounding
+ * sphere and a cone enclosing the normals of its triangles.
+ *
+ * The model builds the meshlets of every imported mesh when the
+ * builder is enabled, the engine does this for you if you set
+ * use_meshlets in the engine builder.
+ */
+class meshlet_builder
+{
+  public:
+    /**
+     * @brief Flag added to the mesh cache key of meshes with meshlets
+     */
+    static constexpr std::uint64_t import_flag = 1ULL << 34;
+    static constexpr unsigned int default_max_vertices = 64;
+    static constexpr unsigned int default_max_triangles = 124;
+
+    meshlet_builder() = delete;
+
+    /**
+     * @brief Enable or disable meshlets for imported models
+     */
+    static void set_enabled(bool enabled);
+    /**
+     * @brief Check if meshlets are built for imported models
+     */
+    static bool is_enabled();
+
+    /**
+     * @brief Split a triangle list in meshlets
+     *
+     * @param vertices The vertices
+     * @param indices The triangle list, reordered so that every meshlet
+     * is a contiguous range
+     * @param max_vertices Maximum number of unique vertices of a meshlet
+     * @param max_triangles Maximum number of triangles of a meshlet
+     * @return The meshlets, in index buffer order
+     */
+    static std::vector<types::meshlet>
+    build(const std::vector<types::vertex> &vertices,
+          std::vector<unsigned int> &indices,
+          unsigned int max_vertices = default_max_vertices,
+          unsigned int max_triangles = default_max_triangles);
+    /**
+     * @brief Compute the bounding sphere and the normal cone
+     *
+     * @param vertices The vertices
+     * @param indices The triangles of the meshlet
+     * @return A meshlet with the bounds set and an empty range
+     */
+    static types::meshlet
+    compute_bounds(const std::vector<types::vertex> &vertices,
+                   std::span<const unsigned int> indices);
+
+  private:
+    static bool enabled;
+};
+
+} // namespace brenta
@@ -26,23 +26,71 @@
 
 #pragma once
 
+#include "animation.hpp"
+#include "animation_compression.hpp"
+#include "cluster_culler.hpp"
 #include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
 #include "shader.hpp"
+#include "skinning.hpp"
+#include "texture.hpp"
+#include "texture_cache.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <glad/glad.h>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace brenta
 {
 
+namespace types
+{
+
+/**
+ * @brief CPU side result of a model import
+ *
+ * Holds everything needed to upload a model to the GPU: the geometry
+ * of every mesh and the decoded images of the textures they use. The
+ * geometry spans in meshes point either inside vertices and indices
+ * or inside file when the model comes from the mesh cache. Skinned
+ * models also carry their skeleton, their clips and the influences
+ * of the vertices of every mesh.
+ */
+struct model_data
+{
+    std::string directory;
+    bool flip = true;
+    std::vector<cached_mesh> meshes;
+    std::vector<std::vector<vertex>> vertices;
+    std::vector<std::vector<unsigned int>> indices;
+    std::vector<std::vector<vertex_skin>> skins;
+    types::skeleton skeleton;
+    std::vector<compressed_clip> animations;
+    mapped_file file;
+    std::unordered_map<std::string, image> images;
+};
+
+} // namespace types
+
+class model_handle;
+
 /**
  * @brief Model class
  *
- * This class is used to load a model from a file and draw it
+ * This class is used to load a model from a file and draw it.
+ * A model owns its meshes, so It can be moved but not copied: use a
+ * std::shared_ptr or a model_handle to share It.
  */
 class model
 {
@@ -113,6 +161,29 @@ class model
           GLboolean has_mipmap = GL_TRUE,
           GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
           GLint mipmap_mag = GL_LINEAR, bool flip = true);
+    /**
+     * @brief Construct a new Model object from imported data
+     *
+     * Uploads the data to the GPU, must be called from the thread
+     * that owns the OpenGL context.
+     *
+     * @param data Data returned by import_model
+     * @param wrapping Texture wrapping mode
+     * @param filtering_min Texture filtering mode
+     * @param filtering_mag Texture filtering mode
+     * @param hasMipmap If the texture has a mipmap
+     * @param mipmap_min Mipmap filtering mode
+     * @param mipmap_mag Mipmap filtering mode
+     */
+    model(types::model_data &&data, GLint wrapping = GL_REPEAT,
+          GLint filtering_min = GL_NEAREST, GLint filtering_mag = GL_LINEAR,
+          GLboolean has_mipmap = GL_TRUE,
+          GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+          GLint mipmap_mag = GL_LINEAR);
+    model(const model &) = delete;
+    model &operator=(const model &) = delete;
+    model(model &&) noexcept = default;
+    model &operator=(model &&) noexcept = default;
 
     /**
      * @brief Builder class for Model
@@ -123,21 +194,249 @@ class model
      * @brief Draw the model
      *
      * @param shader Shader to use
+     * @param lod Level of detail to draw, see select_lod
+     * @param frustum If not null, meshlets outside of It or facing
+     * away are not drawn, see cluster_culler
+     * @param palette Skinning matrices of the instance computed by the
+     * animator, one per joint. Skinned models are drawn in the bind
+     * pose without It
      */
-    void draw(types::shader_name_t shader);
+    void draw(types::shader_name_t shader, unsigned int lod = 0,
+              const types::cluster_frustum *frustum = nullptr,
+              std::span<const glm::mat4> palette = {});
+    /**
+     * @brief Select the level of detail of an instance of the model
+     *
+     * Uses the bounding sphere of the model and the error of its
+     * levels, see lod_selector.
+     *
+     * @param model_matrix Model matrix of the instance
+     * @param view View matrix of the camera
+     * @param projection Projection matrix of the camera
+     * @param viewport_height Height of the viewport in pixels
+     * @param current Level drawn in the previous frame
+     * @return The level to draw
+     */
+    unsigned int select_lod(const glm::mat4 &model_matrix,
+                            const glm::mat4 &view,
+                            const glm::mat4 &projection,
+                            float viewport_height,
+                            unsigned int current) const;
+    /**
+     * @brief Get the number of levels of detail
+     * @return 1 if the model has only the full resolution meshes
+     */
+    unsigned int get_lod_count() const;
+    /**
+     * @brief Check if the model is deformed by a skeleton
+     */
+    bool has_skeleton() const;
+    /**
+     * @brief Get the first texture bound to draw the model
+     * @return The texture, 0 if the model has none
+     */
+    unsigned int get_material_id() const;
+    /**
+     * @brief Get the first VAO bound to draw the model
+     */
+    unsigned int get_vertex_array() const;
+    /**
+     * @brief Get the skeleton of the model
+     * @return The skeleton, with no joints for a static model
+     */
+    const types::skeleton &get_skeleton() const;
+    /**
+     * @brief Get the animation clips imported with the model
+     */
+    const std::vector<types::compressed_clip> &get_animations() const;
+    /**
+     * @brief Find an animation clip by name
+     * @return The clip, or nullptr if there is none
+     */
+    const types::compressed_clip *
+    find_animation(const std::string &name) const;
+
+    /**
+     * @brief Import a model without touching OpenGL
+     *
+     * Parses the model with Assimp, or with the obj_parser for OBJ
+     * files when It is enabled, or reads It from the mesh cache, then
+     * processes its meshes in parallel and decodes every texture that
+     * is not already in the texture_cache. This is safe to call from
+     * any thread.
+     *
+     * @param path Path to the model
+     * @param wrapping Texture wrapping mode
+     * @param filtering_min Texture filtering mode
+     * @param filtering_mag Texture filtering mode
+     * @param hasMipmap If the texture has a mipmap
+     * @param mipmap_min Mipmap filtering mode
+     * @param mipmap_mag Mipmap filtering mode
+     * @param flip If the textures should be flipped
+     * @return The imported data, with no meshes on failure
+     */
+    static types::model_data
+    import_model(std::string path, GLint wrapping = GL_REPEAT,
+                 GLint filtering_min = GL_NEAREST,
+                 GLint filtering_mag = GL_LINEAR,
+                 GLboolean has_mipmap = GL_TRUE,
+                 GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+                 GLint mipmap_mag = GL_LINEAR, bool flip = true);
+    /**
+     * @brief Load a model asynchronously
+     *
+     * The import runs on the thread_pool, the GPU upload happens on
+     * the main thread the first time the handle is found ready. See
+     * model_handle.
+     *
+     * @param path Path to the model
+     * @param wrapping Texture wrapping mode
+     * @param filtering_min Texture filtering mode
+     * @param filtering_mag Texture filtering mode
+     * @param hasMipmap If the texture has a mipmap
+     * @param mipmap_min Mipmap filtering mode
+     * @param mipmap_mag Mipmap filtering mode
+     * @param flip If the texture should be flipped
+     * @return A handle to the model being loaded
+     */
+    static model_handle load_async(std::string path,
+                                   GLint wrapping = GL_REPEAT,
+                                   GLint filtering_min = GL_NEAREST,
+                                   GLint filtering_mag = GL_LINEAR,
+                                   GLboolean has_mipmap = GL_TRUE,
+                                   GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+                                   GLint mipmap_mag = GL_LINEAR,
+                                   bool flip = true);
+    /**
+     * @brief Get the flags models are cached with
+     *
+     * Depends on the engine side processing steps that are enabled,
+     * see mesh_cache::get_cache_path.
+     *
+     * @return Assimp post processing flags in the lower 32 bits,
+     * engine side processing steps in the upper ones
+     */
+    static std::uint64_t get_cache_flags();
 
   private:
+    static constexpr unsigned int import_flags =
+        aiProcess_Triangulate | aiProcess_FlipUVs;
+
     // model data
     std::vector<mesh> meshes;
-    std::vector<types::texture> textures_loaded;
+    std::vector<texture_cache::reference> textures_loaded;
     std::string directory;
+    // bounding sphere in model space
+    glm::vec3 bounds_center = glm::vec3(0.0f);
+    float bounds_radius = 0.0f;
+    // largest error of the meshes at every level of detail
+    std::vector<float> lod_errors = {0.0f};
+    // skeletal animation, empty for static models
+    types::skeleton skeleton;
+    std::vector<types::compressed_clip> animations;
+    bool gpu_skinned = false;
+
+    void upload(types::model_data &data);
+    types::texture load_texture_ref(const types::texture_ref &ref,
+                                    types::model_data &data);
+
+    static void
+    log_optimization(const std::string &path, const types::model_data &data,
+                     const std::vector<types::vertex_cache_stats> &before,
+                     const std::vector<types::vertex_cache_stats> &after);
+    static bool import_assimp(const std::string &path,
+                              types::model_data &data);
+    static bool import_obj(const std::string &path, types::model_data &data);
+    static void process_meshes(const std::string &path,
+                               types::model_data &data);
+    static bool load_cached_model(std::string path, types::model_data &data);
+    static void store_cached_model(std::string path,
+                                   const types::model_data &data);
+    static void collect_meshes(aiNode *node, const aiScene *scene,
+                               std::vector<aiMesh *> &out);
+    static void process_mesh(aiMesh *mesh, const aiScene *scene,
+                             std::vector<types::vertex> &vertices,
+                             std::vector<unsigned int> &indices,
+                             std::vector<types::texture_ref> &textures);
+    static void process_skin(aiMesh *mesh, const types::skeleton &skeleton,
+                             std::vector<types::vertex_skin> &skin);
+    static void process_skeleton(const aiScene *scene,
+                                 types::skeleton &skeleton);
+    static void
+    collect_joints(const aiNode *node, int parent,
+                   const std::unordered_map<std::string, glm::mat4> &offsets,
+                   types::skeleton &skeleton);
+    static void
+    process_animations(const aiScene *scene, const types::skeleton &skeleton,
+                       std::vector<types::compressed_clip> &clips);
+    static std::vector<types::texture_ref>
+    load_material_textures(aiMaterial *mat, aiTextureType type,
+                           std::string type_name);
+};
+
+/**
+ * @brief Handle to a model loaded asynchronously
+ *
+ * Returned by model::load_async. Copies of a handle share the same
+ * model. Call is_resident once per frame from the main thread: when
+ * the import is complete It uploads the model to the GPU and returns
+ * true, from then on get returns the model. Until then you should
+ * draw a placeholder.
+ */
+class model_handle
+{
+  public:
+    /**
+     * @brief Empty constructor
+     *
+     * The handle is not valid
+     */
+    model_handle()
+    {
+    }
+    /**
+     * @brief Construct a handle to an already resident model
+     *
+     * @param resident The model
+     */
+    model_handle(std::shared_ptr<model> resident);
+
+    /**
+     * @brief Check if the handle refers to a model
+     * @return true if the handle is valid
+     */
+    bool is_valid() const;
+    /**
+     * @brief Check if the model is ready to be drawn
+     *
+     * Finishes the load if the import is complete, so It must be
+     * called from the thread that owns the OpenGL context.
+     *
+     * @return true if the model is on the GPU
+     */
+    bool is_resident();
+    /**
+     * @brief Get the model
+     * @return The model, or nullptr if It is not resident yet
+     */
+    std::shared_ptr<model> get() const;
 
-    void load_model(std::string path);
-    void process_node(aiNode *node, const aiScene *scene);
-    mesh process_mesh(aiMesh *mesh, const aiScene *scene);
-    std::vector<types::texture> load_material_textures(aiMaterial *mat,
-                                                       aiTextureType type,
-                                                       std::string type_name);
+    /**
+     * @brief Check if two handles refer to the same model
+     */
+    bool operator==(const model_handle &other) const = default;
+
+  private:
+    friend class model;
+    friend class model_registry;
+
+    struct state
+    {
+        std::future<types::model_data> pending;
+        std::function<std::shared_ptr<model>(types::model_data &&)> finish;
+        std::shared_ptr<model> resident;
+    };
+    std::shared_ptr<state> shared_state;
 };
 
 /**
@@ -0,0 +1,108 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "model.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace brenta
+{
+
+/**
+ * @brief Engine wide registry of loaded models
+ *
+ * Entities often share a handful of models. Loading a model through
+ * the registry returns a handle to the same model every time It is
+ * requested with the same path and options, so It is imported and
+ * uploaded to the GPU only once.
+ *
+ * The registry does not keep models alive: an entry is reference
+ * counted by the handles pointing to It and is dropped when the last
+ * one is destroyed.
+ */
+class model_registry
+{
+  public:
+    model_registry() = delete;
+
+    /**
+     * @brief Load a model, or share an already loaded one
+     *
+     * The first request for a model starts an asynchronous load with
+     * model::load_async, the next ones get a copy of the same handle.
+     *
+     * @param path Path to the model
+     * @param wrapping Texture wrapping mode
+     * @param filtering_min Texture filtering mode
+     * @param filtering_mag Texture filtering mode
+     * @param hasMipmap If the texture has a mipmap
+     * @param mipmap_min Mipmap filtering mode
+     * @param mipmap_mag Mipmap filtering mode
+     * @param flip If the texture should be flipped
+     * @return A handle to the model
+     */
+    static model_handle load(std::string path, GLint wrapping = GL_REPEAT,
+                             GLint filtering_min = GL_NEAREST,
+                             GLint filtering_mag = GL_LINEAR,
+                             GLboolean has_mipmap = GL_TRUE,
+                             GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+                             GLint mipmap_mag = GL_LINEAR, bool flip = true);
+    /**
+     * @brief Get the number of models in the registry
+     *
+     * Entries whose handles have all been destroyed are removed first.
+     *
+     * @return Number of live models
+     */
+    static std::size_t size();
+    /**
+     * @brief Forget every model
+     *
+     * Handles already returned stay valid.
+     */
+    static void clear();
+
+  private:
+    struct entry
+    {
+        std::string path;
+        std::weak_ptr<model_handle::state> state;
+    };
+
+    static std::unordered_map<std::uint64_t, entry> models;
+    static std::mutex mutex;
+
+    static void collect();
+};
+
+} // namespace brenta
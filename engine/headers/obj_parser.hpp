@@ -0,0 +1,166 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mesh.hpp"
+#include "mesh_cache.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/**
+ * @brief A mesh read from an OBJ file
+ *
+ * One per object and material, like Assimp splits them. The vertices
+ * are welded: face corners with the same position, texture
+ * coordinates and normal share a vertex.
+ */
+struct obj_mesh
+{
+    std::string name;
+    std::string material;
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<texture_ref> textures;
+};
+
+/**
+ * @brief Result of parsing an OBJ file
+ */
+struct obj_data
+{
+    std::vector<obj_mesh> meshes;
+    /* Material libraries referenced with mtllib */
+    std::vector<std::string> libraries;
+};
+
+} // namespace types
+
+/**
+ * @brief Native Wavefront OBJ and MTL parser
+ *
+ * Loads OBJ models without going through Assimp's importer and scene
+ * graph. The file is split in chunks at line boundaries that are
+ * parsed in parallel on the thread_pool, then every mesh is welded
+ * and triangulated on its own worker and emitted directly as the
+ * vertex and index arrays the model uploads.
+ *
+ * The result matches what the model gets from Assimp with its
+ * import flags: polygons are triangulated as fans and the texture
+ * coordinates are flipped vertically. Normals missing from the file
+ * are smoothed from the faces.
+ *
+ * Models use It for .obj files when It is enabled, the engine does
+ * this for you if you set use_native_obj in the engine builder.
+ */
+class obj_parser
+{
+  public:
+    /**
+     * @brief Flag added to the mesh cache key of natively parsed models
+     */
+    static constexpr std::uint64_t import_flag = 1ULL << 35;
+    /**
+     * @brief Size of the chunks parsed in parallel, in bytes
+     */
+    static constexpr std::size_t chunk_size = 64 * 1024;
+
+    obj_parser() = delete;
+
+    /**
+     * @brief Enable or disable the native parser for models
+     */
+    static void set_enabled(bool enabled);
+    /**
+     * @brief Check if models use the native parser
+     */
+    static bool is_enabled();
+    /**
+     * @brief Check if a file is an OBJ model by its extension
+     */
+    static bool can_load(const std::string &path);
+
+    /**
+     * @brief Load an OBJ model and its materials through the vfs
+     *
+     * @param path Path to the model
+     * @param data The meshes, with the textures of their material
+     * @return false if the file could not be read or is malformed
+     */
+    static bool load(const std::string &path, types::obj_data &data);
+    /**
+     * @brief Parse the contents of an OBJ file
+     *
+     * The textures of the meshes are not filled, see parse_materials.
+     *
+     * @param source The contents of the file
+     * @param data The meshes and the material libraries
+     * @return false if a face refers to a missing vertex
+     */
+    static bool parse(std::string_view source, types::obj_data &data);
+    /**
+     * @brief Parse the contents of an MTL file
+     *
+     * Diffuse maps (map_Kd) become "texture_diffuse" textures and
+     * specular maps (map_Ks) "texture_specular" ones.
+     *
+     * @param source The contents of the file
+     * @return The textures of every material, by name
+     */
+    static std::unordered_map<std::string, std::vector<types::texture_ref>>
+    parse_materials(std::string_view source);
+    /**
+     * @brief Parse a decimal floating point number
+     *
+     * Digits are converted eight or four at a time with SWAR
+     * arithmetic, numbers that cannot be converted exactly this way
+     * fall back to std::from_chars.
+     *
+     * @param first Start of the number
+     * @param last End of the input
+     * @param value The number
+     * @return The first character after the number, first if there
+     * is no number
+     */
+    static const char *parse_float(const char *first, const char *last,
+                                   float &value);
+
+  private:
+    static bool enabled;
+};
+
+} // namespace brenta
@@ -163,7 +163,6 @@ class particle_emitter
 
   private:
     camera *cam;
-    void check_opengl_error(const std::string &functionName);
 };
 
 /**
@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "cluster_culler.hpp"
+#include "shader.hpp"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace brenta
+{
+
+class model;
+
+namespace types
+{
+
+/**
+ * @brief A draw submitted to the render_queue
+ *
+ * Holds everything needed to draw a model: the queue sorts the
+ * packets by key and draws them in that order when It is flushed.
+ */
+struct draw_packet
+{
+    /* Sort key, see render_queue::make_key */
+    std::uint64_t key = 0;
+    /* Drawn with depth writes disabled */
+    bool translucent = false;
+    std::shared_ptr<model> target;
+    types::shader_name_t shader;
+    glm::mat4 model_matrix = glm::mat4(1.0f);
+    int atlas_size = 1;
+    int atlas_index = 0;
+    float shininess = 32.0f;
+    unsigned int lod = 0;
+    /* Meshlets outside the frustum are not drawn, when culled */
+    bool culled = false;
+    types::cluster_frustum frustum;
+    /* Must stay valid until the queue is flushed */
+    std::span<const glm::mat4> palette;
+};
+
+/**
+ * @brief Sort key and index of a packet
+ */
+struct sort_entry
+{
+    std::uint64_t key;
+    std::uint32_t index;
+};
+
+} // namespace types
+
+/**
+ * @brief Sorted list of the draws of a frame
+ *
+ * Systems submit draw packets instead of drawing, the queue sorts
+ * them once per frame with a radix sort on their 64 bit keys and
+ * draws them in order. From the most significant bits, a key holds:
+ *
+ * - pass (4 bits): passes are drawn in increasing order.
+ * - translucency (1 bit): opaque packets come before translucent
+ *   ones.
+ * - depth (20 bits): opaque packets are drawn front to back, to make
+ *   the most of the early depth test, translucent ones back to front
+ *   so that they blend correctly. Opaque packets keep only a coarse
+ *   depth, so the packets at a similar distance are sorted by state.
+ * - program (11 bits), material (14 bits), mesh (14 bits): packets
+ *   with the same state are drawn one after the other.
+ *
+ * Ids wider than their field are truncated, which can only make the
+ * order less efficient. Packets with equal keys keep the order they
+ * were submitted in.
+ */
+class render_queue
+{
+  public:
+    render_queue() = delete;
+
+    static constexpr unsigned int pass_bits = 4;
+    static constexpr unsigned int depth_bits = 20;
+    static constexpr unsigned int program_bits = 11;
+    static constexpr unsigned int material_bits = 14;
+    static constexpr unsigned int mesh_bits = 14;
+    /* Depth bits kept by opaque packets */
+    static constexpr unsigned int opaque_depth_bits = 10;
+
+    /**
+     * @brief Pack a sort key
+     *
+     * @param pass Pass of the packet, lower passes are drawn first
+     * @param translucent Whether the packet is blended
+     * @param depth Distance from the camera, clamped to 0
+     * @param program Shader program
+     * @param material Material, for example the first texture
+     * @param mesh Vertex array
+     * @return The key
+     */
+    static std::uint64_t make_key(unsigned int pass, bool translucent,
+                                  float depth, unsigned int program,
+                                  unsigned int material, unsigned int mesh);
+    /**
+     * @brief Sort entries by key
+     *
+     * Least significant digit radix sort on 8 bit digits, stable.
+     * Digits equal in every key are skipped.
+     *
+     * @param entries Entries to sort
+     * @param scratch Reused between calls, resized as needed
+     */
+    static void sort(std::vector<types::sort_entry> &entries,
+                     std::vector<types::sort_entry> &scratch);
+
+    /**
+     * @brief Submit a packet, drawn at the next flush
+     */
+    static void submit(types::draw_packet packet);
+    /**
+     * @brief Sort and draw the packets, then empty the queue
+     *
+     * Must be called once per frame from the thread that owns the
+     * OpenGL context, after every system submitted its packets.
+     */
+    static void flush();
+    /**
+     * @brief Drop the packets without drawing them
+     */
+    static void clear();
+    /**
+     * @brief Get the number of packets waiting for the next flush
+     */
+    static std::size_t get_size();
+
+  private:
+    static std::vector<types::draw_packet> packets;
+    static std::vector<types::sort_entry> entries;
+    static std::vector<types::sort_entry> scratch;
+};
+
+} // namespace brenta
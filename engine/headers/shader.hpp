@@ -27,8 +27,11 @@
 #pragma once
 
 #include "engine_logger.hpp"
+#include "vfs.hpp"
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <fstream>
 #include <glad/glad.h> /* OpenGL driver */
 #include <glm/glm.hpp>
@@ -37,6 +40,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -48,6 +53,81 @@ namespace types
 
 typedef std::string shader_name_t;
 
+/**
+ * @brief Code of one stage of a shader
+ */
+struct shader_source
+{
+    GLenum type;
+    std::string_view code;
+};
+
+/**
+ * @brief Hash of strings that also takes string views, so that maps
+ * keyed by std::string can be searched without allocating
+ */
+struct string_hash
+{
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view text) const
+    {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+
+/**
+ * @brief An active uniform of a program, reflected at link time
+ *
+ * Holds the last value uploaded, so that setting the same value again
+ * does not reach the driver. The value is only remembered when It is
+ * set while the program is in use, as glUniform writes to the current
+ * program.
+ */
+struct uniform_slot
+{
+    std::string name;
+    GLenum type;
+    GLint location;
+    /* OpenGL id of the program */
+    unsigned int program;
+    bool uploaded = false;
+    /* Bytes of the last value, a 4x4 matrix at most */
+    std::array<std::uint32_t, 16> value{};
+};
+
+/**
+ * @brief Uniforms of a linked program
+ */
+struct shader_program
+{
+    unsigned int id = 0;
+    std::vector<uniform_slot> uniforms;
+    /* Slot of every name, array elements included */
+    std::unordered_map<std::string, int, string_hash, std::equal_to<>> slots;
+};
+
+/**
+ * @brief A uniform resolved once by shader::get_uniform
+ *
+ * Setting It is an index in the table of the program, with no lookup
+ * by name. T is the type of the values, checked against the type in
+ * the shader when the handle is resolved.
+ */
+template <typename T> struct uniform
+{
+    /* Index of the program in the shader table */
+    int program = -1;
+    /* Index of the uniform in the program, -1 if It is not active */
+    int slot = -1;
+
+    bool is_valid() const
+    {
+        return slot >= 0;
+    }
+};
+
+
 } // namespace types
 
 /**
@@ -61,6 +141,13 @@ typedef std::string shader_name_t;
  * The shader can be used with the Use method, and the uniforms
  * can be set using the SetBool, SetInt, SetFloat, SetMat4, SetVec3
  * methods.
+ *
+ * The active uniforms of every program are listed when It is linked,
+ * with their locations, so no uniform is looked up in the driver by
+ * name afterwards. Uniforms that are set often can be resolved once
+ * with get_uniform and set through the handle. Either way the value
+ * is compared with the last one uploaded and redundant uploads are
+ * skipped. Uniforms are set in the shader in use: call use first.
  */
 class shader
 {
@@ -95,18 +182,7 @@ class shader
     {
         std::vector<unsigned int> compiled_shaders = {};
         compile_shaders(compiled_shaders, type, path, args...);
-
-        /* shader Program */
-        unsigned int ID = glCreateProgram();
-        std::for_each(compiled_shaders.begin(), compiled_shaders.end(),
-                      [&ID](auto shader) { glAttachShader(ID, shader); });
-
-        glLinkProgram(ID);
-        shader::check_compile_errors(ID, "PROGRAM");
-
-        shader::shaders.insert({shader_name, ID});
-        std::for_each(compiled_shaders.begin(), compiled_shaders.end(),
-                      [](auto shader) { glDeleteShader(shader); });
+        shader::link_program(shader_name, compiled_shaders, nullptr, 0);
     }
 
     /**
@@ -131,26 +207,30 @@ class shader
     {
         std::vector<unsigned int> compiled_shaders = {};
         compile_shaders(compiled_shaders, type, path, args...);
-
-        /* shader Program */
-        unsigned int ID = glCreateProgram();
-        std::for_each(compiled_shaders.begin(), compiled_shaders.end(),
-                      [&ID](auto shader) { glAttachShader(ID, shader); });
-
-        if (feedback_varyings != nullptr)
-        {
-            glTransformFeedbackVaryings(ID, num_varyings, feedback_varyings,
-                                        GL_INTERLEAVED_ATTRIBS);
-        }
-
-        glLinkProgram(ID);
-        shader::check_compile_errors(ID, "PROGRAM");
-
-        shader::shaders.insert({shader_name, ID});
-        std::for_each(compiled_shaders.begin(), compiled_shaders.end(),
-                      [](auto shader) { glDeleteShader(shader); });
+        shader::link_program(shader_name, compiled_shaders, feedback_varyings,
+                             num_varyings);
     }
 
+    /**
+     * @brief Create a new shader from sources in memory
+     *
+     * Same as the create method, but takes the shader code instead of
+     * a path, so that nothing is read from the file system:
+     *
+     * shader::create("TextShader",
+     *                {{GL_VERTEX_SHADER, vertex_code},
+     *                 {GL_FRAGMENT_SHADER, fragment_code}});
+     *
+     * @param shader_name Name of the shader
+     * @param sources Types and code of the shaders to link together
+     * @param feedback_varyings Array of feedback varyings, or nullptr
+     * @param num_varyings Number of feedback varyings
+     */
+    static void create(std::string shader_name,
+                       const std::vector<types::shader_source> &sources,
+                       const GLchar **feedback_varyings = nullptr,
+                       int num_varyings = 0);
+
     static void compile_shaders(std::vector<unsigned int> &compiled)
     {
         return;
@@ -160,31 +240,14 @@ class shader
     static void compile_shaders(std::vector<unsigned int> &compiled,
                                 GLenum type, std::string path, Args... args)
     {
-        std::string code;
-        std::ifstream file;
-        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-        try
-        {
-            file.open(path);
-            std::stringstream stream;
-            stream << file.rdbuf();
-            file.close();
-            code = stream.str();
-        }
-        catch (std::ifstream::failure &e)
+        types::asset file = vfs::read(path);
+        if (!file.is_valid())
         {
             ERROR("Error reading shader file: {}", path);
             return;
         }
 
-        const char *shader_code = code.c_str();
-        unsigned int shader = glCreateShader(type);
-        glShaderSource(shader, 1, &shader_code, NULL);
-        glCompileShader(shader);
-        shader::check_compile_errors(shader, "SHADER");
-
-        compiled.push_back(shader);
+        compiled.push_back(shader::compile_source(type, file.str()));
         compile_shaders(compiled, args...);
     }
 
@@ -264,8 +327,107 @@ class shader
     static void set_vec3(types::shader_name_t shader_name, const GLchar *name,
                          glm::vec3 value);
 
+    /**
+     * @brief Resolve a uniform
+     *
+     * Array elements are named like in GLSL, "lights[2].position".
+     *
+     * @param shader_name Name of the shader
+     * @param name Name of the uniform
+     * @return The handle, not valid if the shader has no such active
+     * uniform or if Its type does not match T
+     */
+    template <typename T>
+    static types::uniform<T>
+    get_uniform(const types::shader_name_t &shader_name,
+                std::string_view name)
+    {
+        types::uniform<T> handle;
+        GLenum type = find_uniform(shader_name, name, handle.program,
+                                   handle.slot);
+        if (handle.slot >= 0 && !accepts<T>(type))
+        {
+            ERROR("Uniform {} of shader {} has a different type", name,
+                  shader_name);
+            handle.slot = -1;
+        }
+        return handle;
+    }
+    /**
+     * @brief Set a uniform through its handle
+     *
+     * Does nothing if the handle is not valid.
+     *
+     * @param handle Handle returned by get_uniform
+     * @param value Value of the uniform
+     */
+    template <typename T>
+    static void set(const types::uniform<T> &handle,
+                    const std::type_identity_t<T> &value)
+    {
+        if (!handle.is_valid())
+            return;
+        upload(shader::programs[handle.program].uniforms[handle.slot],
+               value);
+    }
+
   private:
+    /* Reflected uniforms of every program, in creation order */
+    static std::vector<types::shader_program> programs;
+    static std::unordered_map<types::shader_name_t, int, types::string_hash,
+                              std::equal_to<>>
+        program_of;
+
+    static void reflect_uniforms(types::shader_program &program);
+    /* Slot of a uniform by name, nullptr if It is not active */
+    static types::uniform_slot *find_slot(std::string_view shader_name,
+                                          std::string_view name);
+    static GLenum find_uniform(std::string_view shader_name,
+                               std::string_view name, int &program,
+                               int &slot);
+
+    template <typename T> static bool accepts(GLenum type)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+            return type == GL_BOOL || type == GL_INT;
+        else if constexpr (std::is_same_v<T, int>)
+            return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D
+                   || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE
+                   || type == GL_SAMPLER_BUFFER
+                   || type == GL_SAMPLER_2D_ARRAY;
+        else if constexpr (std::is_same_v<T, float>)
+            return type == GL_FLOAT;
+        else if constexpr (std::is_same_v<T, glm::vec2>)
+            return type == GL_FLOAT_VEC2;
+        else if constexpr (std::is_same_v<T, glm::vec3>)
+            return type == GL_FLOAT_VEC3;
+        else if constexpr (std::is_same_v<T, glm::vec4>)
+            return type == GL_FLOAT_VEC4;
+        else if constexpr (std::is_same_v<T, glm::mat4>)
+            return type == GL_FLOAT_MAT4;
+        else
+            static_assert(!sizeof(T), "Unsupported uniform type");
+    }
+
+    static void upload(types::uniform_slot &slot, bool value);
+    static void upload(types::uniform_slot &slot, int value);
+    static void upload(types::uniform_slot &slot, float value);
+    static void upload(types::uniform_slot &slot, const glm::vec2 &value);
+    static void upload(types::uniform_slot &slot, const glm::vec3 &value);
+    static void upload(types::uniform_slot &slot, const glm::vec4 &value);
+    static void upload(types::uniform_slot &slot, const glm::mat4 &value);
+
     static void check_compile_errors(unsigned int shader, std::string type);
+    static unsigned int compile_source(GLenum type, std::string_view code);
+    /* Links the compiled shaders in a program, registers It as
+     * shader_name and deletes the shaders */
+    static void link_program(const types::shader_name_t &shader_name,
+                             const std::vector<unsigned int> &compiled,
+                             const GLchar **feedback_varyings,
+                             int num_varyings);
+    /* Points the samplers the engine binds itself, like the joint
+     * palette of skinning, to their reserved texture units */
+    static void set_reserved_samplers(unsigned int program);
 };
 
 } // namespace brenta
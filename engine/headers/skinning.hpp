@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "buffer.hpp"
+#include "mesh.hpp"
+#include "shader.hpp"
+#include "texture.hpp"
+
+#include <glm/glm.hpp>
+#include <span>
+
+namespace brenta
+{
+
+/**
+ * @brief Vertex skinning on the GPU or on the CPU
+ *
+ * With GPU skinning the palette of a character is uploaded in a
+ * texture buffer read by the vertex shader (four texels per joint) and
+ * the joints and weights are two extra vertex attributes, at locations
+ * 3 and 4. The shader enables skinning with the skinned uniform and
+ * reads the palette from the jointPalette sampler, bound to the
+ * reserved texture unit palette_unit.
+ *
+ * The CPU fallback deforms the vertices with skin_vertices and
+ * re-uploads them before every draw, for drivers where vertex texture
+ * fetches are slow or for shaders without skinning support.
+ *
+ * GPU skinning is the default, the engine sets the mode from the
+ * engine builder, see use_gpu_skinning.
+ */
+class skinning
+{
+  public:
+    skinning() = delete;
+
+    /**
+     * @brief Largest number of joints that deform a vertex
+     */
+    static constexpr unsigned int max_influences = 4;
+    /**
+     * @brief Texture unit reserved to the joint palette
+     */
+    static constexpr unsigned int palette_unit = 15;
+
+    /**
+     * @brief Choose between GPU and CPU skinning
+     *
+     * Applies to the meshes created afterwards.
+     */
+    static void set_gpu_skinning(bool enabled);
+    /**
+     * @brief Check if meshes are skinned on the GPU
+     */
+    static bool uses_gpu_skinning();
+
+    /**
+     * @brief Pack the influences of a vertex
+     *
+     * Keeps the max_influences heaviest joints and normalizes their
+     * weights.
+     *
+     * @param joints Joints influencing the vertex
+     * @param weights Weight of every joint
+     * @return The packed influences, all zero weights if there are
+     * none
+     */
+    static types::vertex_skin
+    pack_influences(std::span<const std::uint32_t> joints,
+                    std::span<const float> weights);
+    /**
+     * @brief Deform vertices on the CPU
+     *
+     * Positions and normals are transformed by the weighted sum of
+     * the joint matrices, vertices without weights are copied.
+     *
+     * @param vertices Vertices in the bind pose
+     * @param skin Influences of every vertex
+     * @param palette Skinning matrices computed by the animator
+     * @param out Output, as many vertices as the input
+     */
+    static void skin_vertices(std::span<const types::vertex> vertices,
+                              std::span<const types::vertex_skin> skin,
+                              std::span<const glm::mat4> palette,
+                              std::span<types::vertex> out);
+
+    /**
+     * @brief Upload a palette and enable skinning in a shader
+     *
+     * @param shader Shader that draws the skinned meshes
+     * @param palette Skinning matrices computed by the animator
+     */
+    static void bind_palette(types::shader_name_t shader,
+                             std::span<const glm::mat4> palette);
+    /**
+     * @brief Disable skinning in a shader
+     *
+     * Call It after drawing a skinned model, so that the static ones
+     * drawn with the same shader are not deformed.
+     */
+    static void unbind_palette(types::shader_name_t shader);
+    /**
+     * @brief Release the palette buffer
+     *
+     * Called by the engine before the OpenGL context is destroyed.
+     */
+    static void destroy();
+
+  private:
+    static bool gpu_skinning;
+    static types::buffer palette_buffer;
+    static types::texture_object palette_texture;
+    /* The skinned uniform of the last shader a palette was bound to */
+    static types::shader_name_t skinned_shader;
+    static types::uniform<bool> skinned;
+
+    static const types::uniform<bool> &
+    skinned_uniform(const types::shader_name_t &shader);
+};
+
+} // namespace brenta
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <ft2build.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -66,6 +67,11 @@ struct character
  * This class is used to render text on the screen. The text
  * is rendered using the FreeType library to load the font and
  * the characters, and OpenGL to render the text on the screen.
+ *
+ * Rasterizing the glyphs takes a while, so a font can be baked
+ * offline with bake (brenta-bake does this for every font in
+ * assets/fonts). When a baked file sits next to the font, load
+ * uploads the stored bitmaps and skips FreeType entirely.
  */
 class text
 {
@@ -76,6 +82,17 @@ class text
      * Map an ascii character to a Character struct
      */
     static std::map<char, types::character> characters;
+    /**
+     * @brief Pixel height the glyphs are rasterized at
+     */
+    static constexpr unsigned int glyph_pixel_size = 48;
+    /**
+     * @brief Version of the baked font format
+     *
+     * Bump this every time the layout of the file changes, old
+     * files will be ignored.
+     */
+    static constexpr std::uint32_t baked_version = 1;
 
     text() = delete;
     /**
@@ -90,6 +107,13 @@ class text
      * method.
      */
     static void init();
+    /**
+     * @brief Destroy the text subsystem
+     *
+     * Deletes the VAO and the VBO, must be called while the OpenGL
+     * context is still alive.
+     */
+    static void destroy();
 
     /**
      * @brief Load a font
@@ -118,11 +142,37 @@ class text
      */
     static void render_text(std::string text, float x, float y, float scale,
                             glm::vec3 color);
+    /**
+     * @brief Rasterize a font to a baked file
+     *
+     * Stores the bitmaps and the metrics of the first 128 ASCII
+     * characters, so that load does not need FreeType. This does
+     * not need an OpenGL context.
+     *
+     * @param font_path Path to the font file
+     * @param output_path Path to the baked file
+     * @return true on success
+     */
+    static bool bake(const std::string &font_path,
+                     const std::string &output_path);
+    /**
+     * @brief Get the path of the baked version of a font
+     *
+     * @param font_path Path to the font file
+     * @return The same path with the .glyphs extension
+     */
+    static std::string get_baked_path(const std::string &font_path);
 
   private:
     static types::shader_name_t text_shader;
     static types::vao text_vao;
     static types::buffer text_vbo;
+
+    static bool load_baked(const std::string &path);
+    static bool load_font(const std::string &path);
+    static void add_character(unsigned char c, int width, int rows, int left,
+                              int top, unsigned int advance,
+                              const unsigned char *bitmap);
 };
 
 } // namespace brenta
@@ -26,12 +26,95 @@
 
 #pragma once
 
+#include "asset_pack.hpp"
+
+#include <cstddef>
 #include <glad/glad.h> /* OpenGL driver */
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace brenta
 {
 
+namespace types
+{
+
+/**
+ * @brief A mipmap level of a compressed image
+ */
+struct mip_level
+{
+    std::size_t offset; // in bytes, from the start of the pixels
+    std::size_t size;   // in bytes
+    int width;
+    int height;
+};
+
+/**
+ * @brief Image decoded in memory
+ *
+ * Pixels are tightly packed 8 bit channels, as returned by
+ * stb_image. The memory is released when the last copy of
+ * the image is destroyed.
+ *
+ * Block compressed images (see texture_compression) have a non zero
+ * compressed_format and store their whole mipmap chain in pixels,
+ * described by levels.
+ */
+struct image
+{
+    std::shared_ptr<unsigned char> pixels;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::size_t size = 0; // in bytes
+    GLenum compressed_format = 0;
+    std::vector<mip_level> levels;
+};
+
+/**
+ * @brief Owner of an OpenGL texture
+ *
+ * The texture is deleted when the owner is destroyed. It can be
+ * moved but not copied, textures that are shared between models are
+ * owned by the texture_cache and shared through its references.
+ */
+class texture_object
+{
+  public:
+    texture_object()
+    {
+    }
+    /**
+     * @brief Take ownership of a texture
+     *
+     * @param id OpenGL name of the texture
+     */
+    explicit texture_object(unsigned int id);
+    texture_object(const texture_object &) = delete;
+    texture_object &operator=(const texture_object &) = delete;
+    texture_object(texture_object &&other) noexcept;
+    texture_object &operator=(texture_object &&other) noexcept;
+    ~texture_object();
+
+    /**
+     * @brief Get the OpenGL name of the texture
+     * @return The name, 0 if empty
+     */
+    unsigned int get() const;
+    /**
+     * @brief Give up ownership without deleting the texture
+     * @return The name of the texture
+     */
+    unsigned int release();
+
+  private:
+    unsigned int id = 0;
+};
+
+} // namespace types
+
 /**
  * @brief Texture class
  *
@@ -48,6 +131,9 @@ class texture
      * library. The texture is loaded with the specified wrapping
      * and filtering modes. The texture can also have mipmaps.
      *
+     * The texture is shared through the texture_cache: loading the
+     * same file with the same settings twice returns the same ID.
+     *
      * @param path Path to the texture file
      * @param wrapping Wrapping mode of the texture
      * @param filtering_min Filtering mode of the texture
@@ -66,6 +152,64 @@ class texture
                                      GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
                                      GLint mipmap_mag = GL_LINEAR,
                                      bool flip = true);
+    /**
+     * @brief Decode an image from a file
+     *
+     * This method only decodes the image in memory and does not
+     * touch OpenGL, so It can be called from any thread. The
+     * pixels are empty if the image could not be decoded.
+     *
+     * DDS and KTX2 files are loaded as block compressed images. If a
+     * .ktx2 or .dds file with the same name as a PNG/JPG image exists,
+     * It is loaded instead of the original.
+     *
+     * @param path Path to the image file
+     * @param flip If the image should be flipped vertically
+     * @return The decoded image
+     */
+    static types::image decode_image(std::string path, bool flip = true);
+    /**
+     * @brief Decode an image already in memory
+     *
+     * Like decode_image, but the file has already been read, for
+     * example with vfs::read_batch. No other file is looked for.
+     *
+     * @param encoded Contents of the file
+     * @param path Path to the file, its extension picks the decoder
+     * @param flip If the image should be flipped vertically
+     * @return The decoded image
+     */
+    static types::image decode_image(const types::asset &encoded,
+                                     const std::string &path,
+                                     bool flip = true);
+    /**
+     * @brief Find the file decode_image reads for an image
+     *
+     * @param path Path to the image file
+     * @return The path of a baked .ktx2 or .dds version of a PNG/JPG
+     * image if It exists, path otherwise
+     */
+    static std::string find_image(const std::string &path);
+    /**
+     * @brief Upload a decoded image to a new texture
+     *
+     * Must be called from the thread that owns the OpenGL context.
+     *
+     * @param image The decoded image
+     * @return The texture ID
+     */
+    static unsigned int upload_image(const types::image &image);
+    /**
+     * @brief Check if a texture has been uploaded
+     *
+     * Textures loaded while the texture_streamer is enabled are
+     * uploaded a few frames later, until then they contain a single
+     * placeholder pixel.
+     *
+     * @param texture The texture ID
+     * @return true if no upload is pending for the texture
+     */
+    static bool is_resident(unsigned int texture);
     /**
      * @brief Activate a texture unit
      *
@@ -76,7 +220,8 @@ class texture
      * @brief Bind a texture
      *
      * This method binds a texture to a target. The texture
-     * is bound with the specified wrapping and filtering modes.
+     * is sampled with the specified wrapping and filtering modes,
+     * through a sampler object bound to the same unit.
      *
      * You need to bind the texture before using it in the shader.
      */
@@ -89,11 +234,9 @@ class texture
                              GLint mipmap_mag = GL_LINEAR);
 
   private:
-    static void set_texture_wrapping(GLint wrapping);
-    static void set_texture_filtering(GLint filtering_min, GLint filtering_mag);
-    static void set_mipmap(GLboolean has_mipmap, GLint mipmap_min,
-                           GLint mipmap_mag);
-    static void read_image(const char *path, bool flip);
+    friend class texture_streamer;
+
+    static void upload_pixels(const types::image &image, const void *pixels);
 };
 
 } // namespace brenta
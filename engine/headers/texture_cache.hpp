@@ -0,0 +1,192 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace brenta
+{
+
+/**
+ * @brief Process wide cache of loaded textures
+ *
+ * Textures are keyed by a hash of their canonical path, of the flip
+ * flag and of the sampler settings they are loaded with, so a texture
+ * shared by many models (an atlas, a common material) is decoded and
+ * uploaded once.
+ *
+ * Every load takes a reference that must be given back with release.
+ * A texture whose references have all been released stays on the GPU
+ * until evict or clear is called, so that a model loaded again right
+ * after being destroyed does not need to upload It again.
+ *
+ * Loading and releasing must happen on the thread that owns the
+ * OpenGL context, contains can be called from any thread.
+ */
+class texture_cache
+{
+  public:
+    /**
+     * @brief A counted reference to a cached texture
+     *
+     * Copying a reference takes a new reference, destroying It
+     * releases one.
+     */
+    class reference
+    {
+      public:
+        reference()
+        {
+        }
+        /**
+         * @brief Take ownership of a reference returned by load
+         */
+        explicit reference(unsigned int id);
+        reference(const reference &other);
+        reference(reference &&other) noexcept;
+        reference &operator=(reference other) noexcept;
+        ~reference();
+
+        /**
+         * @brief Get the texture ID
+         * @return The OpenGL texture, 0 if empty
+         */
+        unsigned int get() const
+        {
+            return this->id;
+        }
+
+      private:
+        unsigned int id = 0;
+    };
+
+    texture_cache() = delete;
+
+    /**
+     * @brief Compute the key of a texture
+     *
+     * @param path Path to the texture file
+     * @param wrapping Wrapping mode of the texture
+     * @param filtering_min Filtering mode of the texture
+     * @param filtering_mag Filtering mode of the texture
+     * @param has_mipmap If the texture has mipmaps
+     * @param mipmap_min Mipmap filtering mode of the texture
+     * @param mipmap_mag Mipmap filtering mode of the texture
+     * @param flip If the texture should be flipped
+     * @return The key
+     */
+    static std::uint64_t get_key(const std::string &path, GLint wrapping,
+                                 GLint filtering_min, GLint filtering_mag,
+                                 GLboolean has_mipmap, GLint mipmap_min,
+                                 GLint mipmap_mag, bool flip);
+    /**
+     * @brief Check if a texture is in the cache
+     *
+     * @param key The key returned by get_key
+     * @return true if the texture is loaded
+     */
+    static bool contains(std::uint64_t key);
+    /**
+     * @brief Load a texture, or take a reference to the cached one
+     *
+     * Parameters are the same as texture::load_texture.
+     *
+     * @return The texture ID, with a new reference taken
+     */
+    static unsigned int load(const std::string &path,
+                             GLint wrapping = GL_REPEAT,
+                             GLint filtering_min = GL_NEAREST,
+                             GLint filtering_mag = GL_NEAREST,
+                             GLboolean has_mipmap = GL_TRUE,
+                             GLint mipmap_min = GL_LINEAR_MIPMAP_LINEAR,
+                             GLint mipmap_mag = GL_LINEAR, bool flip = true);
+    /**
+     * @brief Load an already decoded texture
+     *
+     * Same as load, on a cache miss the decoded image is uploaded
+     * instead of reading the file again. If the image is empty the
+     * file is read.
+     *
+     * @return The texture ID, with a new reference taken
+     */
+    static unsigned int load(const std::string &path,
+                             const types::image &decoded, GLint wrapping,
+                             GLint filtering_min, GLint filtering_mag,
+                             GLboolean has_mipmap, GLint mipmap_min,
+                             GLint mipmap_mag, bool flip);
+    /**
+     * @brief Take a new reference to a cached texture
+     * @param id The texture ID
+     */
+    static void retain(unsigned int id);
+    /**
+     * @brief Release a reference to a cached texture
+     * @param id The texture ID
+     */
+    static void release(unsigned int id);
+    /**
+     * @brief Delete every texture that is not referenced
+     * @return Number of textures deleted
+     */
+    static std::size_t evict();
+    /**
+     * @brief Delete every texture
+     *
+     * IDs returned before are no longer valid.
+     */
+    static void clear();
+    /**
+     * @brief Get the number of cached textures
+     * @return Number of textures on the GPU
+     */
+    static std::size_t size();
+
+  private:
+    struct entry
+    {
+        types::texture_object texture;
+        unsigned int references;
+        std::string path;
+    };
+
+    static std::unordered_map<std::uint64_t, entry> textures;
+    static std::unordered_map<unsigned int, std::uint64_t> keys;
+    static std::mutex mutex;
+
+    static unsigned int insert(std::uint64_t key, const std::string &path,
+                               unsigned int id);
+    static unsigned int find(std::uint64_t key);
+};
+
+} // namespace brenta
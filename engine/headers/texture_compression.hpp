@@ -0,0 +1,183 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "asset_pack.hpp"
+#include "texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <string>
+
+/* Block compressed formats, not part of the core profile loaded by glad */
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+namespace brenta
+{
+
+namespace enums
+{
+
+/**
+ * @brief Block compression formats
+ *
+ * - BC1: RGB with 1 bit alpha, 8 bytes per block
+ * - BC3: RGBA, 16 bytes per block
+ * - BC4: single channel, 8 bytes per block
+ * - BC5: two channels (normal maps), 16 bytes per block
+ * - BC7: high quality RGBA, 16 bytes per block
+ */
+enum block_format
+{
+    BC1,
+    BC3,
+    BC4,
+    BC5,
+    BC7
+};
+
+} // namespace enums
+
+/**
+ * @brief Block compressed textures
+ *
+ * This class loads DDS and KTX2 containers holding BC1, BC3, BC4, BC5
+ * or BC7 textures with their precomputed mipmap chain, and encodes
+ * decoded images to those formats on the CPU so that they can be
+ * baked offline with write_dds.
+ *
+ * Compressed images are stored top to bottom like in the files, when
+ * a flipped image is requested the blocks are flipped on load. BC7
+ * blocks can be flipped only if they use mode 6, which is the only
+ * mode written by the encoder.
+ *
+ * The result is a types::image with a compressed_format, that
+ * texture::upload_image and the texture_streamer upload with one
+ * glCompressedTexImage2D per level.
+ */
+class texture_compression
+{
+  public:
+    texture_compression() = delete;
+
+    /**
+     * @brief Load a DDS file
+     *
+     * @param path Path to the file
+     * @param flip If the image should be flipped vertically
+     * @return The compressed image, empty on failure
+     */
+    static types::image load_dds(const std::string &path, bool flip = true);
+    /**
+     * @brief Load a DDS file already in memory
+     *
+     * @param file Contents of the file
+     * @param path Path to the file, used in the error messages
+     * @param flip If the image should be flipped vertically
+     * @return The compressed image, empty on failure
+     */
+    static types::image load_dds(const types::asset &file,
+                                 const std::string &path, bool flip = true);
+    /**
+     * @brief Load a KTX2 file
+     *
+     * Supercompressed files are not supported.
+     *
+     * @param path Path to the file
+     * @param flip If the image should be flipped vertically
+     * @return The compressed image, empty on failure
+     */
+    static types::image load_ktx2(const std::string &path, bool flip = true);
+    /**
+     * @brief Load a KTX2 file already in memory
+     *
+     * @param file Contents of the file
+     * @param path Path to the file, used in the error messages
+     * @param flip If the image should be flipped vertically
+     * @return The compressed image, empty on failure
+     */
+    static types::image load_ktx2(const types::asset &file,
+                                  const std::string &path, bool flip = true);
+    /**
+     * @brief Write a compressed image to a DDS file
+     *
+     * @param path Path to the file
+     * @param image The compressed image
+     * @return true on success
+     */
+    static bool write_dds(const std::string &path, const types::image &image);
+    /**
+     * @brief Encode an image
+     *
+     * @param image An uncompressed image with 1 to 4 channels
+     * @param format The block format
+     * @param mipmaps If the whole mipmap chain should be generated
+     * @return The compressed image, empty on failure
+     */
+    static types::image encode(const types::image &image,
+                               enums::block_format format,
+                               bool mipmaps = true);
+    /**
+     * @brief Get the OpenGL internal format of a block format
+     */
+    static GLenum get_gl_format(enums::block_format format);
+    /**
+     * @brief Get the size of a 4x4 block in bytes
+     */
+    static std::size_t get_block_size(enums::block_format format);
+
+  private:
+    static bool from_gl_format(GLenum gl_format, enums::block_format &format);
+    static void flip_levels(types::image &image, enums::block_format format);
+    static void encode_bc1(const unsigned char *rgba, unsigned char *out);
+    static void encode_bc4(const unsigned char *rgba, int channel,
+                           unsigned char *out);
+    static void encode_bc7(const unsigned char *rgba, unsigned char *out);
+};
+
+} // namespace brenta
@@ -0,0 +1,153 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "texture.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <glad/glad.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace brenta
+{
+
+/**
+ * @brief Background texture streaming
+ *
+ * Uploading a big texture with glTexImage2D stalls the frame while
+ * the driver copies the pixels. When the streamer is enabled, textures
+ * are created right away with a single placeholder pixel and their
+ * pixels are decoded on the thread_pool. Every frame, update copies
+ * the decoded images into a ring of pixel buffer objects and starts
+ * the transfers from there, without uploading more than a fixed
+ * number of bytes per frame. A buffer is reused only after the fence
+ * placed after its last transfer has been signaled.
+ *
+ * The texture_cache uses the streamer automatically when It is
+ * enabled, so texture::load_texture, models and the particle atlas
+ * are all streamed. Use texture::is_resident to check if the real
+ * pixels have been uploaded.
+ *
+ * The engine initializes the streamer if you set use_texture_streaming
+ * in the engine builder, you need to call update once per frame.
+ */
+class texture_streamer
+{
+  public:
+    /**
+     * @brief Number of pixel buffer objects in the ring
+     */
+    static constexpr unsigned int num_buffers = 3;
+
+    texture_streamer() = delete;
+
+    /**
+     * @brief Enable the streamer
+     *
+     * Must be called after the OpenGL context has been created.
+     *
+     * @param frame_budget Maximum number of bytes uploaded per frame,
+     * a texture bigger than that is uploaded alone in its frame
+     */
+    static void init(std::size_t frame_budget = 8 * 1024 * 1024);
+    /**
+     * @brief Disable the streamer
+     *
+     * Pending textures keep their placeholder pixel.
+     */
+    static void destroy();
+    /**
+     * @brief Check if the streamer is enabled
+     * @return true if init has been called
+     */
+    static bool is_enabled();
+
+    /**
+     * @brief Stream a texture from a file
+     *
+     * @param path Path to the texture file
+     * @param flip If the texture should be flipped
+     * @return The texture ID, usable right away
+     */
+    static unsigned int stream(const std::string &path, bool flip = true);
+    /**
+     * @brief Stream an already decoded texture
+     *
+     * @param image The decoded image
+     * @return The texture ID, usable right away
+     */
+    static unsigned int stream(const types::image &image);
+    /**
+     * @brief Upload the textures that are ready
+     *
+     * Call this once per frame from the thread that owns the OpenGL
+     * context.
+     */
+    static void update();
+    /**
+     * @brief Check if a texture has been uploaded
+     *
+     * @param texture The texture ID
+     * @return true if no upload is pending for the texture
+     */
+    static bool is_resident(unsigned int texture);
+    /**
+     * @brief Get the number of textures waiting to be uploaded
+     * @return Number of pending textures
+     */
+    static std::size_t get_num_pending();
+
+  private:
+    struct upload
+    {
+        unsigned int texture;
+        std::future<types::image> decoding;
+        types::image image;
+    };
+    struct pixel_buffer
+    {
+        unsigned int id = 0;
+        GLsync fence = nullptr;
+    };
+
+    static bool enabled;
+    static std::size_t frame_budget;
+    static std::deque<upload> uploads;
+    static std::unordered_set<unsigned int> pending;
+    static std::vector<pixel_buffer> buffers;
+    static unsigned int next_buffer;
+
+    static unsigned int create_placeholder();
+    static pixel_buffer *acquire_buffer();
+    static void transfer(pixel_buffer &buffer, const upload &up);
+};
+
+} // namespace brenta
@@ -0,0 +1,124 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace brenta
+{
+
+/**
+ * @brief Worker thread pool
+ *
+ * This class manages a set of worker threads shared by the whole
+ * engine, used to move CPU heavy work (model import, image decoding...)
+ * out of the main thread. Jobs must not touch the OpenGL context,
+ * which is owned by the main thread.
+ *
+ * The pool is started lazily the first time a job is submitted, you
+ * can call init to choose the number of workers. The engine stops the
+ * workers when It is destroyed, and they are stopped at exit in the
+ * programs that never create an engine, like tools and tests.
+ */
+class thread_pool
+{
+  public:
+    thread_pool() = delete;
+
+    /**
+     * @brief Start the worker threads
+     *
+     * @param num_threads Number of workers, 0 means one less than the
+     * number of hardware threads
+     */
+    static void init(unsigned int num_threads = 0);
+    /**
+     * @brief Stop the worker threads
+     *
+     * Waits for the queued jobs to complete.
+     */
+    static void destroy();
+    /**
+     * @brief Get the number of workers
+     * @return Number of worker threads
+     */
+    static unsigned int get_num_threads();
+
+    /**
+     * @brief Submit a job
+     *
+     * @param job Callable object to run on a worker
+     * @return A future holding the result of the job
+     */
+    template <typename F> static auto submit(F &&job)
+    {
+        using result_t = std::invoke_result_t<std::decay_t<F>>;
+        auto task = std::make_shared<std::packaged_task<result_t()>>(
+            std::forward<F>(job));
+        std::future<result_t> future = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    /**
+     * @brief Run a function for every index in parallel
+     *
+     * The calling thread takes part in the work, so It is safe to call
+     * this from inside a job without risking a deadlock. Returns when
+     * every index has been processed.
+     *
+     * If fn throws, the indices not started yet are skipped and the
+     * first exception is rethrown once the running calls are over.
+     *
+     * @param count Number of indices
+     * @param fn Function called with each index in [0, count)
+     */
+    static void parallel_for(std::size_t count,
+                             const std::function<void(std::size_t)> &fn);
+
+  private:
+    static std::vector<std::thread> workers;
+    static std::queue<std::function<void()>> jobs;
+    static std::mutex mutex;
+    static std::condition_variable condition;
+    static bool stopping;
+
+    static void enqueue(std::function<void()> job);
+    static void worker_loop();
+};
+
+} // namespace brenta
@@ -0,0 +1,222 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "buffer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace brenta
+{
+
+namespace types
+{
+
+/*
+ * The blocks mirror the std140 layout of the uniform blocks in the
+ * shaders: vec3 members are followed by a float or by padding, so that
+ * every member starts where std140 puts It.
+ */
+
+/**
+ * @brief Camera uniform block, written once per frame
+ */
+struct camera_block
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    float padding = 0.0f;
+};
+
+struct directional_light_block
+{
+    glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+    float strength = 0.0f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float padding0 = 0.0f;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    float padding1 = 0.0f;
+    glm::vec3 specular = glm::vec3(0.0f);
+    float padding2 = 0.0f;
+};
+
+struct point_light_block
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float strength = 0.0f;
+    glm::vec3 ambient = glm::vec3(0.0f);
+    float constant = 1.0f;
+    glm::vec3 diffuse = glm::vec3(0.0f);
+    float linear = 0.0f;
+    glm::vec3 specular = glm::vec3(0.0f);
+    float quadratic = 0.0f;
+};
+
+/**
+ * @brief Lights uniform block, written once per frame
+ */
+struct lights_block
+{
+    static constexpr unsigned int max_point_lights = 4;
+
+    directional_light_block directional;
+    point_light_block point_lights[max_point_lights];
+    std::int32_t point_light_count = 0;
+    /* A GLSL bool takes four bytes */
+    std::uint32_t use_directional = 0;
+    std::int32_t padding[2] = {0, 0};
+};
+
+/**
+ * @brief Object uniform block, written before every draw
+ *
+ * The normal matrix is computed once on the CPU instead of for every
+ * vertex.
+ */
+struct object_block
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat4 normal_matrix = glm::mat4(1.0f);
+    std::int32_t atlas_size = 1;
+    std::int32_t atlas_index = 0;
+    std::int32_t padding[2] = {0, 0};
+};
+
+} // namespace types
+
+/**
+ * @brief Uniform buffers shared by every shader
+ *
+ * The camera, the lights and the transform of the object being drawn
+ * live in three uniform buffers, bound to fixed binding points. A
+ * shader reads them by declaring the matching std140 blocks:
+ *
+ * layout (std140) uniform Camera { mat4 view; mat4 projection;
+ *                                  vec3 viewPos; };
+ *
+ * The blocks of every program are attached to their binding points
+ * when It is linked. The camera and the lights are written once per
+ * frame instead of once per shader and per object, and a write that
+ * does not change the block is skipped.
+ *
+ * The buffers are created on the first write and released by the
+ * engine before the OpenGL context is destroyed.
+ */
+class uniform_buffers
+{
+  public:
+    uniform_buffers() = delete;
+
+    /**
+     * @brief Binding point of the Camera block
+     */
+    static constexpr unsigned int camera_binding = 0;
+    /**
+     * @brief Binding point of the Lights block
+     */
+    static constexpr unsigned int lights_binding = 1;
+    /**
+     * @brief Binding point of the Object block
+     */
+    static constexpr unsigned int object_binding = 2;
+
+    /**
+     * @brief Set the camera of the frame
+     *
+     * @param view View matrix
+     * @param projection Projection matrix
+     * @param position Position of the camera in world space
+     */
+    static void set_camera(const glm::mat4 &view,
+                           const glm::mat4 &projection,
+                           const glm::vec3 &position);
+    /**
+     * @brief Set the directional light of the frame
+     *
+     * @param light The light, nullptr if there is none
+     */
+    static void
+    set_directional_light(const types::directional_light_block *light);
+    /**
+     * @brief Set the point lights of the frame
+     *
+     * @param lights The lights, only the first
+     * types::lights_block::max_point_lights are used
+     */
+    static void
+    set_point_lights(std::span<const types::point_light_block> lights);
+    /**
+     * @brief Set the object drawn next
+     *
+     * @param model Model matrix
+     * @param atlas_size Number of frames in the texture atlas
+     * @param atlas_index Frame of the atlas to draw
+     */
+    static void set_object(const glm::mat4 &model, int atlas_size = 1,
+                           int atlas_index = 0);
+
+    /**
+     * @brief Get the last values written
+     */
+    static const types::camera_block &get_camera();
+    static const types::lights_block &get_lights();
+    static const types::object_block &get_object();
+
+    /**
+     * @brief Attach the blocks of a program to their binding points
+     *
+     * Called by shader when a program is linked, blocks the program
+     * does not declare are skipped.
+     *
+     * @param program The program
+     */
+    static void bind_blocks(unsigned int program);
+    /**
+     * @brief Release the buffers
+     *
+     * Called by the engine before the OpenGL context is destroyed.
+     */
+    static void destroy();
+
+  private:
+    static types::camera_block camera;
+    static types::lights_block lights;
+    static types::object_block object;
+    static types::buffer camera_buffer;
+    static types::buffer lights_buffer;
+    static types::buffer object_buffer;
+
+    static void upload(types::buffer &buffer, unsigned int binding,
+                       const void *data, std::size_t size);
+};
+
+} // namespace brenta
@@ -39,7 +39,9 @@ namespace types
 /**
  * @brief Vertex Array Object (VAO)
  *
- * Wrapper for OpenGL Vertex Array Objects
+ * Wrapper for OpenGL Vertex Array Objects. A vao owns its OpenGL
+ * object: It can be moved but not copied, and the object is deleted
+ * when the vao is destroyed.
  */
 class vao
 {
@@ -47,7 +49,7 @@ class vao
     /**
      * @brief Vertex Array Object (VAO)
      */
-    unsigned int vao_id;
+    unsigned int vao_id = 0;
 
     /**
      * @brief Empty Constructor
@@ -57,6 +59,14 @@ class vao
     vao()
     {
     }
+    vao(const vao &) = delete;
+    vao &operator=(const vao &) = delete;
+    vao(vao &&other) noexcept;
+    vao &operator=(vao &&other) noexcept;
+    /**
+     * @brief Delete the VAO, if any
+     */
+    ~vao();
     /**
      * @brief Init Constructor
      *
@@ -68,15 +78,15 @@ class vao
      * @brief Get the VAO
      * @return The VAO
      */
-    unsigned int get_vao();
+    unsigned int get_vao() const;
     /**
      * @brief Bind the VAO
      */
-    void bind();
+    void bind() const;
     /**
      * @brief Unbind the VAO
      */
-    void unbind();
+    void unbind() const;
     /**
      * @brief Delete the VAO
      */
@@ -94,7 +104,7 @@ class vao
      * @param pointer The offset of the first component of the first generic
      * vertex attribute in the array
      */
-    void set_vertex_data(buffer buffer, unsigned int index, GLint size,
+    void set_vertex_data(const buffer &buffer, unsigned int index, GLint size,
                          GLenum type, GLboolean is_normalized, GLsizei stride,
                          const void *pointer);
 };
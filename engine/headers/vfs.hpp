@@ -0,0 +1,165 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "asset_pack.hpp"
+
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace brenta
+{
+
+/**
+ * @brief Virtual file system
+ *
+ * Every loader of the engine reads its files through this class and
+ * receives the contents in a types::asset, never a path to open.
+ *
+ * A path is looked up first in the mounted asset packs, then in the
+ * embedded_assets compiled into the binary, and then on the file
+ * system after applying the mount points: mounting the
+ * directory "/data/game" on the prefix "assets" makes
+ * "assets/models/a.obj" read "/data/game/models/a.obj". Paths are
+ * matched like asset_pack keys, relative to the working directory,
+ * so absolute paths inside It work too.
+ *
+ * read_batch puts many reads in flight at once. By default the files
+ * are memory mapped on the thread_pool, which copies nothing and is
+ * the fastest when the files are in the page cache. When the reads
+ * reach the disk, set_io_uring submits them together to an io_uring
+ * on Linux instead, falling back to the thread_pool if the kernel
+ * does not support It or forbids It.
+ */
+class vfs
+{
+  public:
+    /**
+     * @brief Maximum number of reads in flight in an io_uring
+     */
+    static constexpr unsigned int queue_depth = 64;
+
+    vfs() = delete;
+
+    /**
+     * @brief Mount a directory on a prefix
+     *
+     * Mount points with a longer prefix take precedence.
+     *
+     * @param prefix Virtual path, like "assets"
+     * @param directory Directory on the file system
+     */
+    static void mount(const std::string &prefix,
+                      const std::string &directory);
+    /**
+     * @brief Remove every mount point
+     */
+    static void unmount_all();
+    /**
+     * @brief Get the path on the file system of a virtual path
+     *
+     * @param path Virtual path
+     * @return The path after applying the mount points, or path
+     * itself if no mount point matches
+     */
+    static std::string resolve(const std::string &path);
+    /**
+     * @brief Check if a file is in a pack, embedded or on the file
+     * system
+     */
+    static bool exists(const std::string &path);
+    /**
+     * @brief Read a file
+     *
+     * Safe to call from any thread.
+     *
+     * @param path Virtual path
+     * @return The contents, not valid if the file was not found
+     */
+    static types::asset read(const std::string &path);
+    /**
+     * @brief Read many files at once
+     *
+     * Returns when every read is done. Safe to call from any thread.
+     *
+     * @param paths Virtual paths
+     * @return The contents in the same order, not valid for the
+     * files that were not found
+     */
+    static std::vector<types::asset>
+    read_batch(std::span<const std::string> paths);
+    /**
+     * @brief Read many files at once on the thread_pool
+     *
+     * @param paths Virtual paths
+     * @return A future holding the result of read_batch
+     */
+    static std::future<std::vector<types::asset>>
+    read_async(std::vector<std::string> paths);
+    /**
+     * @brief Allow or forbid the io_uring backend
+     *
+     * It is forbidden by default. The io_uring reads copy the files
+     * in memory, so they only pay off on cold storage.
+     */
+    static void set_io_uring(bool enabled);
+    /**
+     * @brief Check if read_batch uses io_uring
+     * @return true if It is allowed and the kernel supports It
+     */
+    static bool uses_io_uring();
+    /**
+     * @brief Get a temporary path to write a file before renaming It
+     *
+     * The path is unique to the caller, so that writers of the same
+     * file, in this process or in others, never share It.
+     *
+     * @param path Path of the file once written
+     */
+    static std::string get_temp_path(const std::string &path);
+
+  private:
+    struct mount_point
+    {
+        std::string prefix;
+        std::string directory;
+    };
+
+    static std::vector<mount_point> mount_points;
+    static std::mutex mutex;
+    static bool io_uring_enabled;
+
+    static types::asset read_file(const std::string &path);
+    static bool read_io_uring(const std::vector<std::string> &files,
+                              std::vector<types::asset> &assets);
+};
+
+} // namespace brenta
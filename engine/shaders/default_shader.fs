@@ -9,32 +9,41 @@ struct Material {
 };
 uniform Material material;
 
+// The members are ordered to pack into std140 without holes, see
+// types::directional_light_block and types::point_light_block
 struct DirLight {
     vec3 direction;
+    float dir_strength;
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-    float dir_strength;
 };
-uniform DirLight dirLight;
-uniform bool useDirLight = false; // Set this to true to enable directional light
 
 struct PointLight {
     vec3 position;
     float point_strength;
-
     vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    // Light attenuation
     float constant;
+    vec3 diffuse;
     float linear;
+    vec3 specular;
     float quadratic;
 };
 #define NR_POINT_LIGHTS 4
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform int nPointLights = 0; // Set this to the number of point lights you have
+
+// Written once per frame by brenta::uniform_buffers
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    int nPointLights;
+    bool useDirLight;
+};
+
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
 
 uniform float transparency = 1.0;
 
@@ -43,9 +52,6 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 
-// Uniforms
-uniform vec3 viewPos;
-
 // Outputs
 out vec4 FragColor; 
 
@@ -2,25 +2,74 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec4 aJoints;
+layout (location = 4) in vec4 aWeights;
   
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Written once per frame by brenta::uniform_buffers, see
+// types::camera_block and types::object_block for the layouts
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
 
-uniform int atlasSize = 4;
-uniform int atlasIndex = 0;
+layout (std140) uniform Object {
+    mat4 model;
+    mat4 normalMatrix;
+    int atlasSize;
+    int atlasIndex;
+};
+
+// Decoding of the packed vertex format, the defaults leave float
+// vertices untouched
+uniform vec3 posScale = vec3(1.0);
+uniform vec3 posOffset = vec3(0.0);
+uniform bool octNormals = false;
+
+// Skinning, the palette holds a matrix of four texels per joint
+uniform bool skinned = false;
+uniform samplerBuffer jointPalette;
 
 out vec3 Normal;
 out vec3 FragPos; // position of the fragment in world space
 out vec2 TexCoords;
 
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0,
+                                         n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
+mat4 jointMatrix(float joint)
+{
+    int base = int(joint) * 4;
+    return mat4(texelFetch(jointPalette, base),
+                texelFetch(jointPalette, base + 1),
+                texelFetch(jointPalette, base + 2),
+                texelFetch(jointPalette, base + 3));
+}
+
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    // Use this the normal matrix (tranpose of the inverse of the model)
-    // when we have non-uniform scaling
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 position = aPos * posScale + posOffset;
+    vec3 normal = octNormals ? decodeOctahedral(aNormal.xy) : aNormal;
+    if (skinned)
+    {
+        mat4 skin = aWeights.x * jointMatrix(aJoints.x)
+                  + aWeights.y * jointMatrix(aJoints.y)
+                  + aWeights.z * jointMatrix(aJoints.z)
+                  + aWeights.w * jointMatrix(aJoints.w);
+        position = vec3(skin * vec4(position, 1.0));
+        normal = normalize(mat3(skin) * normal);
+    }
+
+    gl_Position = projection * view * model * vec4(position, 1.0);
+    // The normal matrix is computed once per object on the CPU
+    Normal = mat3(normalMatrix) * normal;
+    FragPos = vec3(model * vec4(position, 1.0));
 
     // Atlas offset
     vec2 offset = vec2((1.0 / atlasSize) * (atlasIndex % atlasSize), 0.0);
@@ -3,9 +3,12 @@
 layout (location = 0) in vec3 inPosition;
 layout (location = 1) in float inTTL;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Written once per frame by brenta::uniform_buffers
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec3 viewPos;
+};
 
 out float drawOrDie;
 
@@ -18,6 +21,6 @@ void main() {
         drawOrDie = 1.0;
     }
 
-    gl_Position = projection * view * model * vec4(inPosition, 1.0);
+    gl_Position = projection * view * vec4(inPosition, 1.0);
     gl_PointSize = 10.0;
 }
@@ -0,0 +1,222 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "animation.hpp"
+
+#include "animation_compression.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace brenta;
+
+int types::skeleton::find(const std::string &name) const
+{
+    for (std::size_t i = 0; i < this->joints.size(); i++)
+    {
+        if (this->joints[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+namespace
+{
+
+template <typename T, typename F>
+T sample_keys(const std::vector<types::keyframe<T>> &keys, float time,
+              T fallback, F mix)
+{
+    if (keys.empty())
+        return fallback;
+    if (time <= keys.front().time)
+        return keys.front().value;
+    if (time >= keys.back().time)
+        return keys.back().value;
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+                                 [](float t, const types::keyframe<T> &key)
+                                 { return t < key.time; });
+    auto prev = next - 1;
+    float span = next->time - prev->time;
+    float t = span > 0.0f ? (time - prev->time) / span : 0.0f;
+    return mix(prev->value, next->value, t);
+}
+
+glm::vec3 lerp(glm::vec3 a, glm::vec3 b, float t)
+{
+    return a + (b - a) * t;
+}
+
+/* Cheaper than a slerp and close enough between nearby keyframes */
+glm::quat nlerp(glm::quat a, glm::quat b, float t)
+{
+    if (glm::dot(a, b) < 0.0f)
+        b = -b;
+    return glm::normalize(a * (1.0f - t) + b * t);
+}
+
+} // namespace
+
+void animator::sample(const types::animation_clip &clip,
+                      const types::skeleton &skeleton, float time,
+                      std::span<types::joint_pose> pose)
+{
+    std::size_t count = std::min(pose.size(), skeleton.joints.size());
+    for (std::size_t i = 0; i < count; i++)
+        pose[i] = skeleton.joints[i].bind_pose;
+
+    for (const auto &track : clip.tracks)
+    {
+        if (track.joint >= count)
+            continue;
+
+        types::joint_pose &joint = pose[track.joint];
+        joint.translation =
+            sample_keys(track.translations, time, joint.translation, lerp);
+        joint.rotation =
+            sample_keys(track.rotations, time, joint.rotation, nlerp);
+        joint.scale = sample_keys(track.scales, time, joint.scale, lerp);
+    }
+}
+
+void animator::compute_palette(const types::skeleton &skeleton,
+                               std::span<const types::joint_pose> pose,
+                               std::span<glm::mat4> palette)
+{
+    std::size_t count =
+        std::min({pose.size(), palette.size(), skeleton.joints.size()});
+
+    /* Model space transforms first, parents come before children so
+     * their transform is always ready */
+    for (std::size_t i = 0; i < count; i++)
+    {
+        glm::mat4 local = animator::compose(pose[i]);
+        int parent = skeleton.joints[i].parent;
+        if (parent < 0 || (std::size_t) parent >= i)
+            palette[i] = local;
+        else
+            palette[i] = animator::multiply(palette[parent], local);
+    }
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        palette[i] =
+            animator::multiply(palette[i], skeleton.joints[i].inverse_bind);
+    }
+}
+
+void animator::update(types::animation_state &state, float delta)
+{
+    if (state.skeleton == nullptr)
+        return;
+
+    std::size_t count = state.skeleton->joints.size();
+    state.pose.resize(count);
+    state.palette.resize(count);
+
+    if (state.clip == nullptr)
+    {
+        for (std::size_t i = 0; i < count; i++)
+            state.pose[i] = state.skeleton->joints[i].bind_pose;
+    }
+    else
+    {
+        float duration = state.clip->duration;
+        state.time += delta * state.speed;
+        if (state.loop && duration > 0.0f)
+        {
+            state.time = std::fmod(state.time, duration);
+            if (state.time < 0.0f)
+                state.time += duration;
+        }
+        else
+            state.time = std::clamp(state.time, 0.0f, duration);
+
+        animation_compression::sample(*state.clip, *state.skeleton,
+                                      state.time, state.pose);
+    }
+
+    animator::compute_palette(*state.skeleton, state.pose, state.palette);
+}
+
+void animator::evaluate(std::span<types::animation_state *const> states,
+                        float delta)
+{
+    std::size_t batches = (states.size() + batch_size - 1) / batch_size;
+    thread_pool::parallel_for(
+        batches,
+        [&](std::size_t batch)
+        {
+            std::size_t first = batch * batch_size;
+            std::size_t last = std::min(first + batch_size, states.size());
+            for (std::size_t i = first; i < last; i++)
+            {
+                if (states[i] != nullptr)
+                    animator::update(*states[i], delta);
+            }
+        });
+}
+
+glm::mat4 animator::compose(const types::joint_pose &pose)
+{
+    glm::mat4 m = glm::mat4_cast(pose.rotation);
+    m[0] *= pose.scale.x;
+    m[1] *= pose.scale.y;
+    m[2] *= pose.scale.z;
+    m[3] = glm::vec4(pose.translation, 1.0f);
+    return m;
+}
+
+glm::mat4 animator::multiply(const glm::mat4 &a, const glm::mat4 &b)
+{
+#if defined(__SSE2__)
+    /* Every column of the result is a combination of the columns of a
+     * weighted by a column of b */
+    __m128 a0 = _mm_loadu_ps(&a[0][0]);
+    __m128 a1 = _mm_loadu_ps(&a[1][0]);
+    __m128 a2 = _mm_loadu_ps(&a[2][0]);
+    __m128 a3 = _mm_loadu_ps(&a[3][0]);
+
+    glm::mat4 result;
+    for (int j = 0; j < 4; j++)
+    {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[j][0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[j][1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[j][2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[j][3])));
+        _mm_storeu_ps(&result[j][0], r);
+    }
+    return result;
+#else
+    return a * b;
+#endif
+}
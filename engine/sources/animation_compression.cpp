@@ -0,0 +1,473 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "animation_compression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <type_traits>
+#include <vector>
+
+using namespace brenta;
+
+namespace
+{
+
+/* Rotations are stored as (x, y, z, w), vectors leave w at zero */
+struct curve_key
+{
+    float time;
+    glm::vec4 value;
+};
+
+struct curve
+{
+    std::uint16_t joint;
+    enums::animation_property property;
+    std::vector<curve_key> keys;
+};
+
+glm::vec4 mix_value(enums::animation_property property, glm::vec4 a,
+                    glm::vec4 b, float t)
+{
+    if (property != enums::ROTATION)
+        return a + (b - a) * t;
+
+    /* Same normalized lerp as the sampler */
+    if (glm::dot(a, b) < 0.0f)
+        b = -b;
+    return glm::normalize(a * (1.0f - t) + b * t);
+}
+
+float distance(enums::animation_property property, glm::vec4 a, glm::vec4 b)
+{
+    if (property != enums::ROTATION)
+        return glm::length(glm::vec3(a - b));
+
+    float d = std::min(1.0f, std::abs(glm::dot(a, b)));
+    return 2.0f * std::acos(d);
+}
+
+glm::vec4 evaluate(const curve &c, float time)
+{
+    const auto &keys = c.keys;
+    if (time <= keys.front().time)
+        return keys.front().value;
+    if (time >= keys.back().time)
+        return keys.back().value;
+
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+                                 [](float t, const curve_key &key)
+                                 { return t < key.time; });
+    auto prev = next - 1;
+    float span = next->time - prev->time;
+    float t = span > 0.0f ? (time - prev->time) / span : 0.0f;
+    return mix_value(c.property, prev->value, next->value, t);
+}
+
+/* Can the keys between first and last be dropped? */
+bool fits(const std::vector<curve_key> &keys, std::size_t first,
+          std::size_t last, enums::animation_property property,
+          float tolerance)
+{
+    float span = keys[last].time - keys[first].time;
+    for (std::size_t k = first + 1; k < last; k++)
+    {
+        float t = span > 0.0f ? (keys[k].time - keys[first].time) / span
+                              : 0.0f;
+        glm::vec4 value =
+            mix_value(property, keys[first].value, keys[last].value, t);
+        if (distance(property, value, keys[k].value) > tolerance)
+            return false;
+    }
+    return true;
+}
+
+/* Greedy key reduction, every kept key extends its segment as far as
+ * the error allows */
+std::vector<curve_key> reduce(const std::vector<curve_key> &keys,
+                              enums::animation_property property,
+                              float tolerance)
+{
+    if (keys.size() <= 2)
+        return keys;
+
+    std::vector<curve_key> kept = {keys.front()};
+    std::size_t first = 0;
+    while (first + 1 < keys.size())
+    {
+        std::size_t last = first + 1;
+        while (last + 1 < keys.size()
+               && fits(keys, first, last + 1, property, tolerance))
+            last++;
+        kept.push_back(keys[last]);
+        first = last;
+    }
+    return kept;
+}
+
+std::uint16_t quantize(float value, float min, float extent)
+{
+    if (extent <= 0.0f)
+        return 0;
+    float unit = std::clamp((value - min) / extent, 0.0f, 1.0f);
+    return static_cast<std::uint16_t>(std::lround(unit * 65535.0f));
+}
+
+void encode(const types::compressed_channel &channel, glm::vec4 value,
+            std::uint16_t out[3])
+{
+    if (channel.property == enums::ROTATION)
+    {
+        animation_compression::encode_rotation(
+            glm::quat(value.w, value.x, value.y, value.z), out);
+        return;
+    }
+    for (int i = 0; i < 3; i++)
+        out[i] = quantize(value[i], channel.min[i], channel.extent[i]);
+}
+
+glm::vec3 decode_vector(const types::compressed_channel &channel,
+                        const std::uint16_t in[3])
+{
+    return channel.min
+           + channel.extent
+                 * (glm::vec3(in[0], in[1], in[2]) * (1.0f / 65535.0f));
+}
+
+glm::vec4 bind_value(const types::joint_pose &pose,
+                     enums::animation_property property)
+{
+    switch (property)
+    {
+    case enums::TRANSLATION:
+        return glm::vec4(pose.translation, 0.0f);
+    case enums::ROTATION:
+        return glm::vec4(pose.rotation.x, pose.rotation.y, pose.rotation.z,
+                         pose.rotation.w);
+    default:
+        return glm::vec4(pose.scale, 0.0f);
+    }
+}
+
+template <typename T>
+std::vector<curve_key> make_keys(const std::vector<types::keyframe<T>> &keys)
+{
+    std::vector<curve_key> out;
+    out.reserve(keys.size());
+    for (const auto &key : keys)
+    {
+        if constexpr (std::is_same_v<T, glm::quat>)
+        {
+            glm::vec4 value(key.value.x, key.value.y, key.value.z,
+                            key.value.w);
+            value = glm::normalize(value);
+            /* Keep consecutive keys in the same hemisphere */
+            if (!out.empty() && glm::dot(out.back().value, value) < 0.0f)
+                value = -value;
+            out.push_back({key.time, value});
+        }
+        else
+            out.push_back({key.time, glm::vec4(key.value, 0.0f)});
+    }
+    return out;
+}
+
+} // namespace
+
+types::compressed_clip
+animation_compression::compress(const types::animation_clip &clip,
+                                const types::skeleton &skeleton,
+                                float tolerance, float segment_duration)
+{
+    types::compressed_clip out;
+    out.name = clip.name;
+    out.duration = std::max(clip.duration, 0.0f);
+    if (out.duration > 0.0f && segment_duration > 0.0f)
+    {
+        out.segment_duration = segment_duration;
+        out.segment_count =
+            std::max(1.0f, std::ceil(out.duration / segment_duration));
+    }
+    else
+        out.segment_count = 1;
+
+    /* Reduce every channel on its own */
+    std::vector<curve> curves;
+    for (const auto &track : clip.tracks)
+    {
+        if (track.joint >= skeleton.joints.size())
+            continue;
+
+        const types::joint_pose &bind = skeleton.joints[track.joint].bind_pose;
+        curve channels[3] = {
+            {(std::uint16_t) track.joint, enums::TRANSLATION,
+             make_keys(track.translations)},
+            {(std::uint16_t) track.joint, enums::ROTATION,
+             make_keys(track.rotations)},
+            {(std::uint16_t) track.joint, enums::SCALE,
+             make_keys(track.scales)}};
+        for (auto &c : channels)
+        {
+            if (c.keys.empty())
+                continue;
+
+            glm::vec4 first = c.keys.front().value;
+            bool constant = std::all_of(
+                c.keys.begin(), c.keys.end(),
+                [&](const curve_key &key) {
+                    return distance(c.property, key.value, first)
+                           <= tolerance;
+                });
+            if (constant)
+            {
+                if (distance(c.property, first, bind_value(bind, c.property))
+                    <= tolerance)
+                    continue;
+                c.keys.resize(1);
+            }
+            else
+                c.keys = reduce(c.keys, c.property, tolerance);
+            curves.push_back(std::move(c));
+        }
+    }
+
+    for (const auto &c : curves)
+    {
+        types::compressed_channel channel = {};
+        channel.joint = c.joint;
+        channel.property = c.property;
+        channel.is_constant = c.keys.size() == 1;
+        if (c.property != enums::ROTATION)
+        {
+            glm::vec3 min = glm::vec3(c.keys.front().value);
+            glm::vec3 max = min;
+            for (const auto &key : c.keys)
+            {
+                min = glm::min(min, glm::vec3(key.value));
+                max = glm::max(max, glm::vec3(key.value));
+            }
+            channel.min = min;
+            channel.extent = max - min;
+        }
+        if (channel.is_constant)
+            encode(channel, c.keys.front().value, channel.constant);
+        out.channels.push_back(channel);
+    }
+
+    /* Every segment gets a key of each channel at both ends, the keys
+     * in between are the reduced ones */
+    std::uint16_t encoded[3];
+    auto emit = [&](const types::compressed_channel &channel,
+                    glm::vec4 value, float time)
+    {
+        out.times.push_back(
+            static_cast<std::uint16_t>(std::lround(time * 65535.0f)));
+        encode(channel, value, encoded);
+        out.values.insert(out.values.end(), encoded, encoded + 3);
+    };
+    for (std::uint32_t s = 0; s < out.segment_count; s++)
+    {
+        float start = s * out.segment_duration;
+        float end = std::min(start + out.segment_duration, out.duration);
+        for (std::size_t c = 0; c < curves.size(); c++)
+        {
+            out.key_offsets.push_back(out.times.size());
+            if (out.channels[c].is_constant)
+                continue;
+
+            const auto &channel = out.channels[c];
+            auto fraction = [&](float time)
+            {
+                return out.segment_duration > 0.0f
+                           ? (time - start) / out.segment_duration
+                           : 0.0f;
+            };
+            emit(channel, evaluate(curves[c], start), 0.0f);
+            for (const auto &key : curves[c].keys)
+            {
+                if (key.time > start && key.time < end)
+                    emit(channel, key.value, fraction(key.time));
+            }
+            if (end > start)
+                emit(channel, evaluate(curves[c], end), fraction(end));
+        }
+    }
+    out.key_offsets.push_back(out.times.size());
+
+    return out;
+}
+
+void animation_compression::sample(const types::compressed_clip &clip,
+                                   const types::skeleton &skeleton,
+                                   float time,
+                                   std::span<types::joint_pose> pose)
+{
+    std::size_t count = std::min(pose.size(), skeleton.joints.size());
+    for (std::size_t i = 0; i < count; i++)
+        pose[i] = skeleton.joints[i].bind_pose;
+    if (clip.channels.empty())
+        return;
+
+    /* Find the segment, then the keys inside It */
+    time = std::clamp(time, 0.0f, clip.duration);
+    std::uint32_t segment = 0;
+    float fraction = 0.0f;
+    if (clip.segment_duration > 0.0f)
+    {
+        segment = std::min<std::uint32_t>(time / clip.segment_duration,
+                                          clip.segment_count - 1);
+        fraction = (time - segment * clip.segment_duration)
+                   / clip.segment_duration;
+    }
+    float local = std::clamp(fraction, 0.0f, 1.0f) * 65535.0f;
+
+    std::size_t channels = clip.channels.size();
+    const std::uint32_t *offsets = &clip.key_offsets[segment * channels];
+    for (std::size_t c = 0; c < channels; c++)
+    {
+        const types::compressed_channel &channel = clip.channels[c];
+        if (channel.joint >= count)
+            continue;
+
+        const std::uint16_t *a = channel.constant;
+        const std::uint16_t *b = channel.constant;
+        float t = 0.0f;
+        if (!channel.is_constant)
+        {
+            std::uint32_t first = offsets[c];
+            std::uint32_t last = offsets[c + 1];
+            if (first == last)
+                continue;
+
+            /* A segment holds a handful of keys per channel */
+            std::uint32_t next = first;
+            while (next < last && clip.times[next] < local)
+                next++;
+            std::uint32_t prev = next == first ? first : next - 1;
+            next = std::min(next, last - 1);
+            a = &clip.values[prev * 3];
+            b = &clip.values[next * 3];
+            float span = (float) clip.times[next] - clip.times[prev];
+            if (span > 0.0f)
+                t = (local - clip.times[prev]) / span;
+        }
+
+        types::joint_pose &joint = pose[channel.joint];
+        switch (channel.property)
+        {
+        case enums::TRANSLATION:
+            joint.translation = glm::mix(decode_vector(channel, a),
+                                         decode_vector(channel, b), t);
+            break;
+        case enums::SCALE:
+            joint.scale = glm::mix(decode_vector(channel, a),
+                                   decode_vector(channel, b), t);
+            break;
+        case enums::ROTATION:
+        {
+            glm::quat qa = decode_rotation(a);
+            glm::quat qb = decode_rotation(b);
+            if (glm::dot(qa, qb) < 0.0f)
+                qb = -qb;
+            joint.rotation = glm::normalize(qa * (1.0f - t) + qb * t);
+            break;
+        }
+        }
+    }
+}
+
+std::size_t
+animation_compression::get_size(const types::compressed_clip &clip)
+{
+    return sizeof(clip) + clip.name.size()
+           + clip.channels.size() * sizeof(types::compressed_channel)
+           + clip.key_offsets.size() * sizeof(std::uint32_t)
+           + clip.times.size() * sizeof(std::uint16_t)
+           + clip.values.size() * sizeof(std::uint16_t);
+}
+
+std::size_t animation_compression::get_size(const types::animation_clip &clip)
+{
+    std::size_t size = sizeof(clip) + clip.name.size();
+    for (const auto &track : clip.tracks)
+    {
+        size += sizeof(track)
+                + track.translations.size()
+                      * sizeof(types::keyframe<glm::vec3>)
+                + track.rotations.size() * sizeof(types::keyframe<glm::quat>)
+                + track.scales.size() * sizeof(types::keyframe<glm::vec3>);
+    }
+    return size;
+}
+
+void animation_compression::encode_rotation(glm::quat rotation,
+                                            std::uint16_t out[3])
+{
+    rotation = glm::normalize(rotation);
+    float c[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+    int largest = 0;
+    for (int i = 1; i < 4; i++)
+    {
+        if (std::abs(c[i]) > std::abs(c[largest]))
+            largest = i;
+    }
+
+    /* q and -q are the same rotation, the dropped component is made
+     * positive and the others are in [-1/sqrt(2), 1/sqrt(2)] */
+    float sign = c[largest] < 0.0f ? -1.0f : 1.0f;
+    int k = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        float v = std::clamp(c[i] * sign * glm::root_two<float>(), -1.0f,
+                             1.0f);
+        out[k++] =
+            static_cast<std::uint16_t>(std::lround((v * 0.5f + 0.5f) * 32766));
+    }
+    out[0] |= (largest & 1) << 15;
+    out[1] |= (largest >> 1) << 15;
+}
+
+glm::quat animation_compression::decode_rotation(const std::uint16_t in[3])
+{
+    int largest = (in[0] >> 15) | ((in[1] >> 15) << 1);
+    float c[4];
+    float sum = 0.0f;
+    int k = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (i == largest)
+            continue;
+        float v = (in[k++] & 0x7fff) * (2.0f / 32766.0f) - 1.0f;
+        c[i] = v * (1.0f / glm::root_two<float>());
+        sum += c[i] * c[i];
+    }
+    c[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+    return glm::quat(c[3], c[0], c[1], c[2]);
+}
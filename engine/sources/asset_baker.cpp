@@ -0,0 +1,483 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "asset_baker.hpp"
+
+#include "engine_hash.hpp"
+#include "engine_logger.hpp"
+#include "mapped_file.hpp"
+#include "mesh_cache.hpp"
+#include "model.hpp"
+#include "text.hpp"
+#include "texture.hpp"
+#include "texture_compression.hpp"
+#include "thread_pool.hpp"
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stb_image.h>
+
+using namespace brenta;
+
+namespace
+{
+
+constexpr const char *manifest_magic = "brenta-bake";
+
+std::string to_lower(std::string str)
+{
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+}
+
+std::string normalize(const std::filesystem::path &path)
+{
+    return path.lexically_normal().generic_string();
+}
+
+/* Missing and empty files must hash differently from each other */
+std::uint64_t hash_file(const std::string &path)
+{
+    types::mapped_file file;
+    if (!file.open(path))
+    {
+        std::error_code ec;
+        return hash::combine(hash::fnv1a_basis,
+                             std::filesystem::exists(path, ec));
+    }
+    return hash::combine(hash::fnv1a(file.data(), file.size()), file.size());
+}
+
+const types::bake_node *find_node(const std::vector<types::bake_node> &nodes,
+                                  const std::string &input)
+{
+    auto it = std::lower_bound(nodes.begin(), nodes.end(), input,
+                               [](const types::bake_node &node,
+                                  const std::string &key)
+                               { return node.input < key; });
+    if (it == nodes.end() || it->input != input)
+        return nullptr;
+    return &*it;
+}
+
+bool is_opaque(const types::image &image)
+{
+    if (image.channels != 4)
+        return true;
+    const unsigned char *pixels = image.pixels.get();
+    for (std::size_t i = 3; i < image.size; i += 4)
+        if (pixels[i] != 255)
+            return false;
+    return true;
+}
+
+} // namespace
+
+bool asset_baker::classify(const std::string &path, enums::asset_kind &kind)
+{
+    std::string extension =
+        to_lower(std::filesystem::path(path).extension().string());
+
+    if (extension == ".png" || extension == ".jpg" || extension == ".jpeg"
+        || extension == ".tga" || extension == ".bmp")
+        kind = enums::TEXTURE;
+    else if (extension == ".obj" || extension == ".fbx" || extension == ".dae"
+             || extension == ".gltf" || extension == ".glb"
+             || extension == ".3ds" || extension == ".blend")
+        kind = enums::MODEL;
+    else if (extension == ".ttf" || extension == ".otf")
+        kind = enums::FONT;
+    else if (extension == ".vs" || extension == ".fs" || extension == ".gs"
+             || extension == ".vert" || extension == ".frag"
+             || extension == ".glsl")
+        kind = enums::SHADER;
+    else
+        return false;
+    return true;
+}
+
+std::vector<std::string>
+asset_baker::find_dependencies(const std::string &path,
+                               enums::asset_kind kind)
+{
+    std::vector<std::string> dependencies;
+    if (kind != enums::MODEL
+        || to_lower(std::filesystem::path(path).extension().string())
+               != ".obj")
+        return dependencies;
+
+    std::ifstream file(path);
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string keyword, library;
+        if (!(stream >> keyword) || keyword != "mtllib")
+            continue;
+        while (stream >> library)
+            dependencies.push_back(normalize(directory / library));
+    }
+    return dependencies;
+}
+
+std::vector<types::bake_node>
+asset_baker::scan(const std::vector<std::string> &roots)
+{
+    std::vector<types::bake_node> nodes;
+    for (const auto &root : roots)
+    {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(root, ec))
+        {
+            WARN("Skipping missing asset directory: {}", root);
+            continue;
+        }
+        for (const auto &entry :
+             std::filesystem::recursive_directory_iterator(root, ec))
+        {
+            if (!entry.is_regular_file())
+                continue;
+            types::bake_node node;
+            node.input = normalize(entry.path());
+            if (classify(node.input, node.kind))
+                nodes.push_back(std::move(node));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(),
+              [](const types::bake_node &a, const types::bake_node &b)
+              { return a.input < b.input; });
+    nodes.erase(std::unique(nodes.begin(), nodes.end(),
+                            [](const types::bake_node &a,
+                               const types::bake_node &b)
+                            { return a.input == b.input; }),
+                nodes.end());
+
+    thread_pool::parallel_for(nodes.size(),
+                              [&nodes](std::size_t i)
+                              {
+                                  nodes[i].dependencies = find_dependencies(
+                                      nodes[i].input, nodes[i].kind);
+                                  nodes[i].hash = hash_node(nodes[i]);
+                              });
+    return nodes;
+}
+
+std::uint64_t asset_baker::hash_node(const types::bake_node &node)
+{
+    std::uint64_t h = hash::combine(hash_file(node.input), version);
+    h = hash::combine(h, (std::uint32_t) node.kind);
+    for (const auto &dependency : node.dependencies)
+        h = hash::combine(hash::fnv1a(dependency, h), hash_file(dependency));
+
+    /* The settings of the converters are part of the output too */
+    switch (node.kind)
+    {
+    case enums::MODEL:
+        h = hash::combine(h, model::get_cache_flags());
+        h = hash::combine(h, mesh_cache::version);
+        break;
+    case enums::FONT:
+        h = hash::combine(h, text::baked_version);
+        h = hash::combine(h, text::glyph_pixel_size);
+        break;
+    default:
+        break;
+    }
+    return h;
+}
+
+bool asset_baker::is_dirty(const types::bake_node &node,
+                           const std::vector<types::bake_node> &previous)
+{
+    const types::bake_node *last = find_node(previous, node.input);
+    if (!last || last->hash != node.hash)
+        return true;
+    for (const auto &output : last->outputs)
+    {
+        std::error_code ec;
+        if (!std::filesystem::exists(output, ec))
+            return true;
+    }
+    return false;
+}
+
+bool asset_baker::bake_node(types::bake_node &node)
+{
+    node.outputs.clear();
+    switch (node.kind)
+    {
+    case enums::TEXTURE:
+        return bake_texture(node);
+    case enums::MODEL:
+        return bake_model(node);
+    case enums::FONT:
+        return bake_font(node);
+    case enums::SHADER:
+        /* Nothing to convert, the node only tracks changes */
+        return true;
+    }
+    return false;
+}
+
+bool asset_baker::bake_texture(types::bake_node &node)
+{
+    types::mapped_file file;
+    if (!file.open(node.input))
+    {
+        ERROR("Could not read texture: {}", node.input);
+        return false;
+    }
+
+    types::image image;
+    /* Baked files are stored top to bottom, the loader flips them */
+    stbi_set_flip_vertically_on_load_thread(false);
+    unsigned char *data =
+        stbi_load_from_memory(file.data(), file.size(), &image.width,
+                              &image.height, &image.channels, 0);
+    if (!data)
+    {
+        ERROR("Could not decode texture: {}", node.input);
+        return false;
+    }
+    image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+    image.size = (std::size_t) image.width * image.height * image.channels;
+
+    enums::block_format format = is_opaque(image) ? enums::BC1 : enums::BC7;
+    types::image compressed = texture_compression::encode(image, format);
+    if (!compressed.pixels)
+    {
+        ERROR("Could not compress texture: {}", node.input);
+        return false;
+    }
+
+    std::string output =
+        normalize(std::filesystem::path(node.input).replace_extension(".dds"));
+    if (!texture_compression::write_dds(output, compressed))
+        return false;
+    node.outputs.push_back(output);
+    return true;
+}
+
+bool asset_baker::bake_model(types::bake_node &node)
+{
+    if (!mesh_cache::is_enabled())
+    {
+        ERROR("Models can not be baked without the mesh cache: {}",
+              node.input);
+        return false;
+    }
+
+    types::model_data data = model::import_model(node.input);
+    if (data.meshes.empty())
+        return false;
+
+    /* Skinned models are not cached yet, they have no output */
+    std::string output =
+        mesh_cache::get_cache_path(node.input, model::get_cache_flags());
+    std::error_code ec;
+    if (std::filesystem::exists(output, ec))
+        node.outputs.push_back(output);
+    return true;
+}
+
+bool asset_baker::bake_font(types::bake_node &node)
+{
+    std::string output = text::get_baked_path(node.input);
+    if (!text::bake(node.input, output))
+        return false;
+    node.outputs.push_back(output);
+    return true;
+}
+
+types::bake_report asset_baker::bake(const std::vector<std::string> &roots,
+                                     const std::string &manifest_path,
+                                     bool force)
+{
+    types::bake_report report;
+    std::vector<types::bake_node> previous;
+    read_manifest(manifest_path, previous);
+    std::vector<types::bake_node> nodes = scan(roots);
+    report.total = nodes.size();
+
+    /* Outputs of removed inputs would be picked up by the runtime */
+    for (const auto &last : previous)
+    {
+        if (find_node(nodes, last.input))
+            continue;
+        for (const auto &output : last.outputs)
+        {
+            std::error_code ec;
+            if (std::filesystem::remove(output, ec))
+                INFO("Removed stale output: {}", output);
+        }
+    }
+
+    /* Models go last, so that importing them finds the baked textures
+     * instead of decoding the sources again */
+    std::vector<std::size_t> assets, models;
+    for (std::size_t i = 0; i < nodes.size(); i++)
+    {
+        if (force || is_dirty(nodes[i], previous))
+        {
+            (nodes[i].kind == enums::MODEL ? models : assets).push_back(i);
+            continue;
+        }
+        nodes[i].outputs = find_node(previous, nodes[i].input)->outputs;
+        report.up_to_date++;
+    }
+
+    std::atomic<std::size_t> baked{0};
+    std::atomic<std::size_t> failed{0};
+    auto run = [&](const std::vector<std::size_t> &batch)
+    {
+        thread_pool::parallel_for(
+            batch.size(),
+            [&](std::size_t i)
+            {
+                types::bake_node &node = nodes[batch[i]];
+                if (bake_node(node))
+                {
+                    INFO("Baked {}", node.input);
+                    baked++;
+                    return;
+                }
+                /* A zero hash never matches, the node is retried on
+                 * the next run */
+                ERROR("Failed to bake {}", node.input);
+                node.hash = 0;
+                failed++;
+            });
+    };
+    run(assets);
+    run(models);
+    report.baked = baked;
+    report.failed = failed;
+
+    write_manifest(manifest_path, nodes);
+    return report;
+}
+
+bool asset_baker::read_manifest(const std::string &path,
+                                std::vector<types::bake_node> &nodes)
+{
+    nodes.clear();
+    std::ifstream file(path);
+    std::string magic;
+    std::uint32_t file_version = 0;
+    if (!(file >> magic >> file_version) || magic != manifest_magic
+        || file_version != version)
+        return false;
+
+    /* Paths are the rest of the line, so they may contain spaces */
+    auto read_path = [](std::istringstream &stream)
+    {
+        std::string path;
+        stream >> std::ws;
+        std::getline(stream, path);
+        return path;
+    };
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string keyword;
+        if (!(stream >> keyword))
+            continue;
+        if (keyword == "node")
+        {
+            types::bake_node node;
+            unsigned int kind;
+            if (!(stream >> kind >> std::hex >> node.hash))
+                return false;
+            node.kind = static_cast<enums::asset_kind>(kind);
+            node.input = read_path(stream);
+            nodes.push_back(std::move(node));
+        }
+        else if (keyword == "dep" && !nodes.empty())
+            nodes.back().dependencies.push_back(read_path(stream));
+        else if (keyword == "out" && !nodes.empty())
+            nodes.back().outputs.push_back(read_path(stream));
+        else
+            return false;
+    }
+
+    std::sort(nodes.begin(), nodes.end(),
+              [](const types::bake_node &a, const types::bake_node &b)
+              { return a.input < b.input; });
+    return true;
+}
+
+bool asset_baker::write_manifest(const std::string &path,
+                                 const std::vector<types::bake_node> &nodes)
+{
+    std::error_code ec;
+    auto directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty())
+        std::filesystem::create_directories(directory, ec);
+
+    std::string tmp_path = vfs::get_temp_path(path);
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        if (!out)
+        {
+            ERROR("Could not write bake manifest: {}", tmp_path);
+            return false;
+        }
+        out << manifest_magic << " " << version << "\n";
+        for (const auto &node : nodes)
+        {
+            out << "node " << (unsigned int) node.kind << " " << std::hex
+                << node.hash << std::dec << " " << node.input << "\n";
+            for (const auto &dependency : node.dependencies)
+                out << "dep " << dependency << "\n";
+            for (const auto &output : node.outputs)
+                out << "out " << output << "\n";
+        }
+        out.close();
+        if (!out)
+        {
+            ERROR("Could not write bake manifest: {}", tmp_path);
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        ERROR("Could not write bake manifest: {}", path);
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
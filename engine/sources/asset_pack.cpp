@@ -0,0 +1,544 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "asset_pack.hpp"
+
+#include "engine_hash.hpp"
+#include "engine_logger.hpp"
+#include "lz4.hpp"
+#include "thread_pool.hpp"
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace brenta;
+
+namespace
+{
+
+/*
+ * Layout of a pack file:
+ *
+ * pack_header
+ * blobs, each aligned to blob_alignment
+ * toc_entry[entry_count], sorted by hash
+ * chunk_entry[chunk_count]
+ * names, the paths of the assets one after the other
+ *
+ * Uncompressed assets are a single blob. Compressed assets are a
+ * sequence of chunks, each one LZ4 compressed on its own or stored
+ * as is when It does not shrink. All offsets are from the start of
+ * the file.
+ */
+
+constexpr char pack_magic[4] = {'B', 'R', 'P', 'K'};
+constexpr std::uint64_t blob_alignment = 16;
+
+struct pack_header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t entry_count;
+    std::uint32_t chunk_count;
+    std::uint64_t toc_offset;
+    std::uint64_t chunk_offset;
+    std::uint64_t names_offset;
+    std::uint64_t names_size;
+};
+
+struct toc_entry
+{
+    std::uint64_t hash;
+    std::uint64_t offset;
+    std::uint64_t stored_size;
+    std::uint64_t raw_size;
+    /* No chunks if the asset is not compressed */
+    std::uint32_t first_chunk;
+    std::uint32_t chunk_count;
+    std::uint32_t name_offset;
+    std::uint32_t name_size;
+};
+
+struct chunk_entry
+{
+    std::uint64_t offset;
+    std::uint32_t stored_size;
+    std::uint32_t raw_size;
+};
+
+std::uint64_t align_up(std::uint64_t value)
+{
+    return (value + blob_alignment - 1) & ~(blob_alignment - 1);
+}
+
+} // namespace
+
+struct asset_pack::pack
+{
+    types::mapped_file file;
+    std::span<const toc_entry> entries;
+    std::span<const chunk_entry> chunks;
+    std::string_view names;
+};
+
+std::vector<std::shared_ptr<const asset_pack::pack>> asset_pack::packs;
+std::mutex asset_pack::mutex;
+
+types::asset::asset(std::span<const unsigned char> bytes,
+                    std::shared_ptr<const void> owner)
+    : bytes(bytes), owner(std::move(owner))
+{
+}
+
+bool types::asset::is_valid() const
+{
+    return this->owner != nullptr;
+}
+
+const unsigned char *types::asset::data() const
+{
+    return this->bytes.data();
+}
+
+std::size_t types::asset::size() const
+{
+    return this->bytes.size();
+}
+
+std::string_view types::asset::str() const
+{
+    return std::string_view((const char *) this->bytes.data(),
+                            this->bytes.size());
+}
+
+types::asset types::asset::slice(std::size_t offset, std::size_t size) const
+{
+    if (!is_valid() || offset > this->bytes.size())
+        return asset();
+    return asset(this->bytes.subspan(
+                     offset, std::min(size, this->bytes.size() - offset)),
+                 this->owner);
+}
+
+bool asset_pack::mount(const std::string &path)
+{
+    auto p = std::make_shared<pack>();
+    if (!p->file.open(path))
+    {
+        ERROR("Could not open asset pack: {}", path);
+        return false;
+    }
+
+    pack_header header;
+    const unsigned char *data = p->file.data();
+    std::size_t size = p->file.size();
+    if (size < sizeof(header))
+    {
+        ERROR("Asset pack too small: {}", path);
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, pack_magic, sizeof(pack_magic)) != 0
+        || header.version != version)
+    {
+        ERROR("Not an asset pack or wrong version: {}", path);
+        return false;
+    }
+
+    /* Written so that crafted offsets cannot wrap around */
+    if (header.toc_offset % alignof(toc_entry) != 0
+        || header.chunk_offset % alignof(chunk_entry) != 0
+        || header.toc_offset > size
+        || header.entry_count > (size - header.toc_offset) / sizeof(toc_entry)
+        || header.chunk_offset > size
+        || header.chunk_count
+               > (size - header.chunk_offset) / sizeof(chunk_entry)
+        || header.names_offset > size
+        || header.names_size > size - header.names_offset)
+    {
+        ERROR("Corrupted asset pack: {}", path);
+        return false;
+    }
+
+    p->entries = std::span<const toc_entry>(
+        (const toc_entry *) (data + header.toc_offset), header.entry_count);
+    p->chunks = std::span<const chunk_entry>(
+        (const chunk_entry *) (data + header.chunk_offset), header.chunk_count);
+    p->names = std::string_view((const char *) data + header.names_offset,
+                                header.names_size);
+
+    std::lock_guard<std::mutex> lock(asset_pack::mutex);
+    asset_pack::packs.push_back(std::move(p));
+    INFO("Mounted asset pack {} with {} assets", path, header.entry_count);
+    return true;
+}
+
+void asset_pack::unmount_all()
+{
+    std::lock_guard<std::mutex> lock(asset_pack::mutex);
+    asset_pack::packs.clear();
+}
+
+bool asset_pack::is_mounted()
+{
+    std::lock_guard<std::mutex> lock(asset_pack::mutex);
+    return !asset_pack::packs.empty();
+}
+
+std::string asset_pack::get_key(const std::string &path)
+{
+    std::filesystem::path p(path);
+    if (p.is_absolute())
+    {
+        std::error_code ec;
+        auto relative = p.lexically_relative(std::filesystem::current_path(ec));
+        if (!ec && !relative.empty())
+            p = relative;
+    }
+    return p.lexically_normal().generic_string();
+}
+
+bool asset_pack::contains(const std::string &path)
+{
+    if (!is_mounted())
+        return false;
+    std::shared_ptr<const pack> found;
+    std::size_t index;
+    return find(get_key(path), found, index);
+}
+
+bool asset_pack::exists(const std::string &path)
+{
+    std::error_code ec;
+    return contains(path) || std::filesystem::exists(path, ec);
+}
+
+types::asset asset_pack::load(const std::string &path)
+{
+    if (is_mounted())
+    {
+        types::asset found = load_from_pack(get_key(path));
+        if (found.is_valid())
+            return found;
+    }
+
+    auto file = std::make_shared<types::mapped_file>(path);
+    if (!file->is_open())
+        return types::asset();
+    std::span<const unsigned char> bytes(file->data(), file->size());
+    return types::asset(bytes, std::move(file));
+}
+
+bool asset_pack::find(const std::string &key,
+                      std::shared_ptr<const pack> &found, std::size_t &index)
+{
+    std::vector<std::shared_ptr<const pack>> mounted;
+    {
+        std::lock_guard<std::mutex> lock(asset_pack::mutex);
+        mounted = asset_pack::packs;
+    }
+
+    std::uint64_t hash = hash::fnv1a(key);
+    for (auto it = mounted.rbegin(); it != mounted.rend(); ++it)
+    {
+        const pack &p = **it;
+        auto entry = std::lower_bound(
+            p.entries.begin(), p.entries.end(), hash,
+            [](const toc_entry &e, std::uint64_t h) { return e.hash < h; });
+        /* Different paths may share a hash, compare the names */
+        for (; entry != p.entries.end() && entry->hash == hash; ++entry)
+        {
+            if (entry->name_offset <= p.names.size()
+                && entry->name_size <= p.names.size() - entry->name_offset
+                && p.names.substr(entry->name_offset, entry->name_size) == key)
+            {
+                found = *it;
+                index = entry - p.entries.begin();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+types::asset asset_pack::load_from_pack(const std::string &key)
+{
+    std::shared_ptr<const pack> found;
+    std::size_t index;
+    if (!find(key, found, index))
+        return types::asset();
+
+    const pack &p = *found;
+    const toc_entry *entry = &p.entries[index];
+    std::size_t size = p.file.size();
+    if (entry->offset > size || entry->stored_size > size - entry->offset
+        || (std::uint64_t) entry->first_chunk + entry->chunk_count
+               > p.chunks.size())
+    {
+        ERROR("Corrupted asset in pack: {}", key);
+        return types::asset();
+    }
+
+    const unsigned char *data = p.file.data();
+    if (entry->chunk_count == 0)
+    {
+        std::span<const unsigned char> bytes(data + entry->offset,
+                                             entry->stored_size);
+        return types::asset(bytes, std::move(found));
+    }
+
+    /* The chunks must cover the asset exactly before anything is
+     * allocated, every one but the last holds chunk_size bytes */
+    auto chunks = p.chunks.subspan(entry->first_chunk, entry->chunk_count);
+    std::uint64_t covered = 0;
+    for (const chunk_entry &c : chunks)
+    {
+        if (c.offset > size || c.stored_size > size - c.offset
+            || covered >= entry->raw_size
+            || c.raw_size != std::min<std::uint64_t>(
+                   chunk_size, entry->raw_size - covered))
+        {
+            ERROR("Corrupted asset in pack: {}", key);
+            return types::asset();
+        }
+        covered += c.raw_size;
+    }
+    if (covered != entry->raw_size)
+    {
+        ERROR("Corrupted asset in pack: {}", key);
+        return types::asset();
+    }
+
+    auto storage =
+        std::make_shared<std::vector<unsigned char>>(entry->raw_size);
+    std::atomic<bool> failed = false;
+    thread_pool::parallel_for(
+        chunks.size(),
+        [&](std::size_t i)
+        {
+            const chunk_entry &c = chunks[i];
+            std::uint64_t raw_offset = i * chunk_size;
+            std::span<const unsigned char> in(data + c.offset, c.stored_size);
+            std::span<unsigned char> out(storage->data() + raw_offset,
+                                         c.raw_size);
+            if (c.stored_size == c.raw_size)
+                std::memcpy(out.data(), in.data(), c.raw_size);
+            else if (!lz4::decompress(in, out))
+                failed = true;
+        });
+    if (failed)
+    {
+        ERROR("Corrupted asset in pack: {}", key);
+        return types::asset();
+    }
+
+    std::span<const unsigned char> bytes(storage->data(), storage->size());
+    return types::asset(bytes, std::move(storage));
+}
+
+asset_pack::writer &asset_pack::writer::add(const std::string &name,
+                                            std::span<const unsigned char> data,
+                                            bool compress)
+{
+    std::string key = asset_pack::get_key(name);
+    auto it = std::find_if(this->entries.begin(), this->entries.end(),
+                           [&](const entry &e) { return e.name == key; });
+    if (it == this->entries.end())
+        it = this->entries.insert(this->entries.end(), entry());
+    it->name = key;
+    it->data.assign(data.begin(), data.end());
+    it->compress = compress;
+    return *this;
+}
+
+bool asset_pack::writer::add_file(const std::string &path, bool compress)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        ERROR("Could not read asset: {}", path);
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(in)),
+                                    std::istreambuf_iterator<char>());
+    add(path, data, compress);
+    return true;
+}
+
+bool asset_pack::writer::write(const std::string &path) const
+{
+    /* Compress every chunk of every compressed asset in parallel */
+    struct chunk_job
+    {
+        std::size_t entry;
+        std::size_t offset;
+        std::size_t size;
+        std::vector<unsigned char> compressed;
+    };
+    std::vector<chunk_job> jobs;
+    std::vector<std::size_t> first_job(this->entries.size(), 0);
+    for (std::size_t i = 0; i < this->entries.size(); i++)
+    {
+        first_job[i] = jobs.size();
+        if (!this->entries[i].compress)
+            continue;
+        std::size_t size = this->entries[i].data.size();
+        for (std::size_t offset = 0; offset < size; offset += chunk_size)
+        {
+            std::size_t length = std::min(chunk_size, size - offset);
+            jobs.push_back({i, offset, length, {}});
+        }
+    }
+    thread_pool::parallel_for(
+        jobs.size(),
+        [&](std::size_t j)
+        {
+            auto &job = jobs[j];
+            std::span<const unsigned char> raw(
+                this->entries[job.entry].data.data() + job.offset, job.size);
+            lz4::compress(raw, job.compressed);
+            /* Chunks that do not shrink are stored as they are */
+            if (job.compressed.size() >= job.size)
+                job.compressed.assign(raw.begin(), raw.end());
+        });
+
+    pack_header header = {};
+    std::memcpy(header.magic, pack_magic, sizeof(pack_magic));
+    header.version = version;
+    header.entry_count = this->entries.size();
+    header.chunk_count = jobs.size();
+
+    std::vector<toc_entry> toc(this->entries.size());
+    std::vector<chunk_entry> chunks(jobs.size());
+    std::string names;
+    std::uint64_t offset = sizeof(pack_header);
+    for (std::size_t i = 0; i < this->entries.size(); i++)
+    {
+        const entry &e = this->entries[i];
+        toc_entry &t = toc[i];
+        t.hash = hash::fnv1a(e.name);
+        t.offset = align_up(offset);
+        t.raw_size = e.data.size();
+        t.name_offset = names.size();
+        t.name_size = e.name.size();
+        names += e.name;
+
+        offset = t.offset;
+        if (!e.compress)
+        {
+            t.stored_size = e.data.size();
+            offset += t.stored_size;
+            continue;
+        }
+        t.first_chunk = first_job[i];
+        std::size_t last_job =
+            i + 1 < first_job.size() ? first_job[i + 1] : jobs.size();
+        t.chunk_count = last_job - first_job[i];
+        for (std::size_t j = t.first_chunk; j < last_job; j++)
+        {
+            chunks[j].offset = offset;
+            chunks[j].stored_size = jobs[j].compressed.size();
+            chunks[j].raw_size = jobs[j].size;
+            offset += jobs[j].compressed.size();
+        }
+        t.stored_size = offset - t.offset;
+    }
+    header.toc_offset = align_up(offset);
+    header.chunk_offset = header.toc_offset + toc.size() * sizeof(toc_entry);
+    header.names_offset =
+        header.chunk_offset + chunks.size() * sizeof(chunk_entry);
+    header.names_size = names.size();
+
+    /* The chunk table is in asset order, only the toc is sorted */
+    std::vector<std::size_t> order(toc.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+              { return toc[a].hash < toc[b].hash; });
+    std::vector<toc_entry> sorted_toc(toc.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        sorted_toc[i] = toc[order[i]];
+
+    std::string tmp_path = vfs::get_temp_path(path);
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        ERROR("Could not write asset pack: {}", tmp_path);
+        return false;
+    }
+
+    auto pad_to = [&out](std::uint64_t target)
+    {
+        static const char zeros[blob_alignment] = {};
+        std::uint64_t pos = out.tellp();
+        if (target > pos)
+            out.write(zeros, target - pos);
+    };
+
+    out.write((const char *) &header, sizeof(header));
+    for (std::size_t i = 0; i < this->entries.size(); i++)
+    {
+        pad_to(toc[i].offset);
+        if (toc[i].chunk_count == 0)
+        {
+            out.write((const char *) this->entries[i].data.data(),
+                      this->entries[i].data.size());
+            continue;
+        }
+        for (std::size_t j = toc[i].first_chunk;
+             j < toc[i].first_chunk + toc[i].chunk_count; j++)
+            out.write((const char *) jobs[j].compressed.data(),
+                      jobs[j].compressed.size());
+    }
+    pad_to(header.toc_offset);
+    out.write((const char *) sorted_toc.data(),
+              sorted_toc.size() * sizeof(toc_entry));
+    out.write((const char *) chunks.data(),
+              chunks.size() * sizeof(chunk_entry));
+    out.write(names.data(), names.size());
+    out.close();
+    if (!out)
+    {
+        ERROR("Could not write asset pack: {}", tmp_path);
+        std::filesystem::remove(tmp_path);
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec)
+    {
+        ERROR("Could not write asset pack: {}", path);
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    INFO("Wrote asset pack {} with {} assets", path, this->entries.size());
+    return true;
+}
@@ -27,6 +27,7 @@
 #include "buffer.hpp"
 
 #include "engine_logger.hpp"
+#include "gl_helper.hpp"
 
 using namespace brenta;
 using namespace brenta::types;
@@ -38,6 +39,36 @@ buffer::buffer(GLenum input_target)
     bind();
 }
 
+buffer::buffer(buffer &&other) noexcept : id(other.id), target(other.target)
+{
+    other.id = 0;
+}
+
+buffer &buffer::operator=(buffer &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (this->id != 0)
+        {
+            gl::forget_buffer(this->id);
+            glDeleteBuffers(1, &this->id);
+        }
+        this->id = other.id;
+        this->target = other.target;
+        other.id = 0;
+    }
+    return *this;
+}
+
+buffer::~buffer()
+{
+    if (this->id != 0)
+    {
+        gl::forget_buffer(this->id);
+        glDeleteBuffers(1, &this->id);
+    }
+}
+
 void buffer::copy_data(GLsizeiptr size, const void *data, GLenum usage)
 {
     glBufferData(this->target, size, data, usage);
@@ -59,19 +90,26 @@ void buffer::copy_vertices(GLsizeiptr size, const void *data, GLenum usage)
     glBufferData(this->target, size, data, usage);
 }
 
-void buffer::bind()
+void buffer::copy_sub_data(GLintptr offset, GLsizeiptr size,
+                           const void *data)
+{
+    bind();
+    glBufferSubData(this->target, offset, size, data);
+}
+
+void buffer::bind() const
 {
     if (this->id == 0)
     {
         ERROR("Buffer not initialized");
         return;
     }
-    glBindBuffer(this->target, this->id);
+    gl::bind_buffer(this->target, this->id);
 }
 
-void buffer::unbind()
+void buffer::unbind() const
 {
-    glBindBuffer(this->target, 0);
+    gl::bind_buffer(this->target, 0);
 }
 
 void buffer::destroy()
@@ -81,7 +119,9 @@ void buffer::destroy()
         ERROR("Buffer not initialized");
         return;
     }
+    gl::forget_buffer(this->id);
     glDeleteBuffers(1, &this->id);
+    this->id = 0;
 }
 
 int buffer::get_id()
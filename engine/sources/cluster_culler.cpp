@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "cluster_culler.hpp"
+
+#include <cmath>
+
+using namespace brenta;
+
+bool cluster_culler::enabled = false;
+types::cluster_stats cluster_culler::current;
+types::cluster_stats cluster_culler::last;
+
+void cluster_culler::set_enabled(bool enabled)
+{
+    cluster_culler::enabled = enabled;
+}
+
+bool cluster_culler::is_enabled()
+{
+    return enabled;
+}
+
+types::cluster_frustum
+cluster_culler::make_frustum(const glm::mat4 &model, const glm::mat4 &view,
+                             const glm::mat4 &projection)
+{
+    types::cluster_frustum frustum;
+
+    /* Gribb and Hartmann: the planes are sums of the rows of the
+     * clip matrix, here in model space */
+    glm::mat4 m = projection * view * model;
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    frustum.planes[0] = row[3] + row[0];
+    frustum.planes[1] = row[3] - row[0];
+    frustum.planes[2] = row[3] + row[1];
+    frustum.planes[3] = row[3] - row[1];
+    frustum.planes[4] = row[3] + row[2];
+    frustum.planes[5] = row[3] - row[2];
+    for (auto &plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+
+    /* Facing is preserved by affine transforms, so the test works in
+     * model space even with non uniform scaling */
+    glm::mat4 model_view = view * model;
+    frustum.camera = glm::vec3(glm::inverse(model_view)[3]);
+    frustum.backface = glm::determinant(glm::mat3(model_view)) > 0.0f;
+    return frustum;
+}
+
+bool cluster_culler::in_frustum(const types::meshlet &meshlet,
+                                const types::cluster_frustum &frustum)
+{
+    for (auto &plane : frustum.planes)
+    {
+        if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w
+            < -meshlet.radius)
+            return false;
+    }
+    return true;
+}
+
+bool cluster_culler::is_backfacing(const types::meshlet &meshlet,
+                                   const types::cluster_frustum &frustum)
+{
+    if (!frustum.backface || meshlet.cone_cutoff >= 1.0f)
+        return false;
+
+    glm::vec3 direction = meshlet.center - frustum.camera;
+    return glm::dot(direction, meshlet.cone_axis)
+           >= meshlet.cone_cutoff * glm::length(direction) + meshlet.radius;
+}
+
+void cluster_culler::cull(const std::vector<types::meshlet> &meshlets,
+                          const types::cluster_frustum &frustum,
+                          std::vector<types::index_range> &ranges)
+{
+    ranges.clear();
+    for (auto &meshlet : meshlets)
+    {
+        current.tested++;
+        if (!in_frustum(meshlet, frustum))
+        {
+            current.frustum_culled++;
+            continue;
+        }
+        if (is_backfacing(meshlet, frustum))
+        {
+            current.backface_culled++;
+            continue;
+        }
+
+        current.triangles_drawn += meshlet.index_count / 3;
+        if (!ranges.empty()
+            && ranges.back().offset + ranges.back().count
+                   == meshlet.index_offset)
+            ranges.back().count += meshlet.index_count;
+        else
+            ranges.push_back({meshlet.index_offset, meshlet.index_count});
+    }
+}
+
+void cluster_culler::new_frame()
+{
+    last = current;
+    current = types::cluster_stats();
+}
+
+types::cluster_stats cluster_culler::get_stats()
+{
+    return last;
+}
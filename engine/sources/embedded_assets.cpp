@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "embedded_assets.hpp"
+
+#include "embedded_resources.hpp" /* Generated by the build */
+
+#include <algorithm>
+#include <memory>
+#include <span>
+
+using namespace brenta;
+
+namespace
+{
+
+/* The generator sorts the table by name */
+const embedded::resource *find_resource(const std::string &path)
+{
+    std::span<const embedded::resource> table(embedded::resources,
+                                               embedded::resource_count);
+    std::string key = asset_pack::get_key(path);
+    auto it = std::lower_bound(table.begin(), table.end(), key,
+                               [](const embedded::resource &r,
+                                  const std::string &k) { return r.name < k; });
+    if (it == table.end() || it->name != key)
+        return nullptr;
+    return &*it;
+}
+
+} // namespace
+
+bool embedded_assets::contains(const std::string &path)
+{
+    return find_resource(path) != nullptr;
+}
+
+types::asset embedded_assets::load(const std::string &path)
+{
+    const embedded::resource *found = find_resource(path);
+    if (found == nullptr)
+        return types::asset();
+
+    /* The data lives as long as the program, the owner frees nothing */
+    std::shared_ptr<const void> owner(found->data, [](const void *) {});
+    return types::asset({found->data, found->size}, std::move(owner));
+}
+
+std::string_view embedded_assets::get_text(const std::string &path)
+{
+    const embedded::resource *found = find_resource(path);
+    if (found == nullptr)
+        return {};
+    return {(const char *) found->data, found->size};
+}
+
+std::size_t embedded_assets::get_count()
+{
+    return embedded::resource_count;
+}
@@ -18,7 +18,16 @@ engine::engine(bool uses_screen, bool uses_audio, bool uses_input,
                bool screen_msaa, bool screen_vsync, const char *screen_title,
                oak::level log_level, std::string log_file,
                std::string text_font, int text_size, bool gl_blending,
-               bool gl_cull_face, bool gl_multisample, bool gl_depth_test)
+               bool gl_cull_face, bool gl_multisample, bool gl_depth_test,
+               bool uses_mesh_cache, std::string mesh_cache_directory,
+               bool uses_texture_streaming, std::size_t texture_upload_budget,
+               bool uses_mesh_optimizer, bool uses_packed_vertices,
+               bool uses_lods, unsigned int lod_levels, float lod_threshold,
+               bool uses_meshlets, bool keeps_cpu_data,
+               bool uses_geometry_arena, std::size_t geometry_page_size,
+               std::string asset_pack_path, bool uses_gpu_skinning,
+               std::vector<std::pair<std::string, std::string>> mount_points,
+               bool uses_io_uring, bool uses_native_obj)
 {
     this->uses_screen = uses_screen;
     this->uses_audio = uses_audio;
@@ -39,6 +48,24 @@ engine::engine(bool uses_screen, bool uses_audio, bool uses_input,
     this->gl_cull_face = gl_cull_face;
     this->gl_multisample = gl_multisample;
     this->gl_depth_test = gl_depth_test;
+    this->uses_mesh_cache = uses_mesh_cache;
+    this->mesh_cache_directory = mesh_cache_directory;
+    this->uses_texture_streaming = uses_texture_streaming;
+    this->texture_upload_budget = texture_upload_budget;
+    this->uses_mesh_optimizer = uses_mesh_optimizer;
+    this->uses_packed_vertices = uses_packed_vertices;
+    this->uses_lods = uses_lods;
+    this->lod_levels = lod_levels;
+    this->lod_threshold = lod_threshold;
+    this->uses_meshlets = uses_meshlets;
+    this->keeps_cpu_data = keeps_cpu_data;
+    this->uses_geometry_arena = uses_geometry_arena;
+    this->geometry_page_size = geometry_page_size;
+    this->asset_pack_path = asset_pack_path;
+    this->uses_gpu_skinning = uses_gpu_skinning;
+    this->mount_points = mount_points;
+    this->uses_io_uring = uses_io_uring;
+    this->uses_native_obj = uses_native_obj;
 
     if (uses_logger)
     {
@@ -55,6 +82,17 @@ engine::engine(bool uses_screen, bool uses_audio, bool uses_input,
         }
     }
 
+    /* Mounted first, everything below may load assets */
+    if (!asset_pack_path.empty())
+    {
+        asset_pack::mount(asset_pack_path);
+    }
+    for (const auto &[prefix, directory] : mount_points)
+    {
+        vfs::mount(prefix, directory);
+    }
+    vfs::set_io_uring(uses_io_uring);
+
     if (uses_screen)
     {
         screen::init(screen_width, screen_height, screen_is_mouse_captured,
@@ -78,6 +116,32 @@ engine::engine(bool uses_screen, bool uses_audio, bool uses_input,
         text::init();
         text::load(text_font, text_size);
     }
+
+    if (uses_mesh_cache)
+    {
+        mesh_cache::init(mesh_cache_directory);
+    }
+
+    if (uses_texture_streaming)
+    {
+        texture_streamer::init(texture_upload_budget);
+    }
+
+    if (uses_geometry_arena)
+    {
+        geometry_arena::init(geometry_page_size);
+    }
+
+    mesh_optimizer::set_enabled(uses_mesh_optimizer);
+    mesh::set_packed_vertices(uses_packed_vertices);
+    mesh_simplifier::set_enabled(uses_lods);
+    mesh_simplifier::set_levels(lod_levels);
+    lod_selector::set_threshold(lod_threshold);
+    meshlet_builder::set_enabled(uses_meshlets);
+    obj_parser::set_enabled(uses_native_obj);
+    cluster_culler::set_enabled(uses_meshlets);
+    mesh::set_keep_cpu_data(keeps_cpu_data);
+    skinning::set_gpu_skinning(uses_gpu_skinning);
 #ifdef USE_ECS
     world::init();
 #endif
@@ -88,6 +152,9 @@ engine::engine(bool uses_screen, bool uses_audio, bool uses_input,
 
 engine::~engine()
 {
+    /* Wait for pending loads before tearing down what they use */
+    thread_pool::destroy();
+
 #ifdef USE_IMGUI
     gui::destroy();
 #endif
@@ -95,16 +162,38 @@ engine::~engine()
     world::destroy();
 #endif
 
+    render_queue::clear();
+    model_registry::clear();
+    if (this->uses_texture_streaming)
+    {
+        texture_streamer::destroy();
+    }
+    texture_cache::clear();
+    geometry_arena::destroy();
+    skinning::destroy();
+    uniform_buffers::destroy();
+    gl::destroy();
+
+    if (this->uses_mesh_cache)
+    {
+        mesh_cache::destroy();
+    }
+
     if (this->uses_audio)
     {
         audio::destroy();
     }
 
+    text::destroy();
+
     if (this->uses_screen)
     {
         screen::terminate();
     }
 
+    asset_pack::unmount_all();
+    vfs::unmount_all();
+
     if (this->uses_logger)
     {
         oak::stop_writer();
@@ -226,11 +315,132 @@ engine::builder &engine::builder::set_gl_depth_test(bool gl_depth_test)
     return *this;
 }
 
+engine::builder &engine::builder::use_mesh_cache(bool uses_mesh_cache)
+{
+    this->uses_mesh_cache = uses_mesh_cache;
+    return *this;
+}
+
+engine::builder &
+engine::builder::set_mesh_cache_directory(std::string mesh_cache_directory)
+{
+    this->mesh_cache_directory = mesh_cache_directory;
+    return *this;
+}
+
+engine::builder &
+engine::builder::use_texture_streaming(bool uses_texture_streaming)
+{
+    this->uses_texture_streaming = uses_texture_streaming;
+    return *this;
+}
+
+engine::builder &
+engine::builder::set_texture_upload_budget(std::size_t texture_upload_budget)
+{
+    this->texture_upload_budget = texture_upload_budget;
+    return *this;
+}
+
+engine::builder &engine::builder::use_mesh_optimizer(bool uses_mesh_optimizer)
+{
+    this->uses_mesh_optimizer = uses_mesh_optimizer;
+    return *this;
+}
+
+engine::builder &
+engine::builder::use_packed_vertices(bool uses_packed_vertices)
+{
+    this->uses_packed_vertices = uses_packed_vertices;
+    return *this;
+}
+
+engine::builder &engine::builder::use_lods(bool uses_lods)
+{
+    this->uses_lods = uses_lods;
+    return *this;
+}
+
+engine::builder &engine::builder::set_lod_levels(unsigned int lod_levels)
+{
+    this->lod_levels = lod_levels;
+    return *this;
+}
+
+engine::builder &engine::builder::set_lod_threshold(float lod_threshold)
+{
+    this->lod_threshold = lod_threshold;
+    return *this;
+}
+
+engine::builder &engine::builder::use_meshlets(bool uses_meshlets)
+{
+    this->uses_meshlets = uses_meshlets;
+    return *this;
+}
+
+engine::builder &engine::builder::set_keep_cpu_data(bool keeps_cpu_data)
+{
+    this->keeps_cpu_data = keeps_cpu_data;
+    return *this;
+}
+
+engine::builder &
+engine::builder::use_geometry_arena(bool uses_geometry_arena)
+{
+    this->uses_geometry_arena = uses_geometry_arena;
+    return *this;
+}
+
+engine::builder &
+engine::builder::set_geometry_page_size(std::size_t geometry_page_size)
+{
+    this->geometry_page_size = geometry_page_size;
+    return *this;
+}
+
+engine::builder &engine::builder::set_asset_pack(std::string asset_pack_path)
+{
+    this->asset_pack_path = asset_pack_path;
+    return *this;
+}
+
+engine::builder &engine::builder::use_gpu_skinning(bool uses_gpu_skinning)
+{
+    this->uses_gpu_skinning = uses_gpu_skinning;
+    return *this;
+}
+
+engine::builder &engine::builder::mount_directory(std::string prefix,
+                                                  std::string directory)
+{
+    this->mount_points.push_back({prefix, directory});
+    return *this;
+}
+
+engine::builder &engine::builder::use_io_uring(bool uses_io_uring)
+{
+    this->uses_io_uring = uses_io_uring;
+    return *this;
+}
+
+engine::builder &engine::builder::use_native_obj(bool uses_native_obj)
+{
+    this->uses_native_obj = uses_native_obj;
+    return *this;
+}
+
 engine engine::builder::build()
 {
     return engine(uses_screen, uses_audio, uses_input, uses_logger, uses_text,
                   screen_width, screen_height, screen_is_mouse_captured,
                   screen_msaa, screen_vsync, screen_title, log_level, log_file,
                   text_font, text_size, gl_blending, gl_cull_face,
-                  gl_multisample, gl_depth_test);
+                  gl_multisample, gl_depth_test, uses_mesh_cache,
+                  mesh_cache_directory, uses_texture_streaming,
+                  texture_upload_budget, uses_mesh_optimizer,
+                  uses_packed_vertices, uses_lods, lod_levels, lod_threshold,
+                  uses_meshlets, keeps_cpu_data, uses_geometry_arena,
+                  geometry_page_size, asset_pack_path, uses_gpu_skinning,
+                  mount_points, uses_io_uring, uses_native_obj);
 }
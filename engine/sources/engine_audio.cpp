@@ -28,6 +28,7 @@
 
 #include "SDL3/SDL_init.h"
 #include "engine_logger.hpp"
+#include "vfs.hpp"
 
 #include <string>
 
@@ -68,8 +69,15 @@ void audio::load_audio(types::audio_name_t name, std::string path)
     types::audio_file_t audiofile;
     audiofile.path = path;
 
-    if (SDL_LoadWAV(path.c_str(), &audiofile.spec, &audiofile.audio_buf,
-                    &audiofile.audio_len))
+    types::asset file = vfs::read(path);
+    if (!file.is_valid())
+    {
+        ERROR("Could not open audio file: {}", path);
+        return;
+    }
+    SDL_IOStream *stream = SDL_IOFromConstMem(file.data(), file.size());
+    if (SDL_LoadWAV_IO(stream, SDL_TRUE, &audiofile.spec,
+                       &audiofile.audio_buf, &audiofile.audio_len))
     {
         auto error = SDL_GetError();
         ERROR("SDL Audio failed to load WAV file: {}", error);
@@ -43,7 +43,7 @@ framebuffer::framebuffer(int width, int height, GLenum format)
         ERROR("Error creating framebuffer!");
         exit(1);
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, this->id);
+    gl::bind_framebuffer(this->id);
     check_error();
 
     glGenTextures(1, &this->texture_id);
@@ -52,7 +52,7 @@ framebuffer::framebuffer(int width, int height, GLenum format)
         ERROR("Error creating texture!");
         exit(1);
     }
-    glBindTexture(GL_TEXTURE_2D, this->texture_id);
+    gl::bind_texture(GL_TEXTURE_2D, this->texture_id);
     check_error();
 
     glTexImage2D(GL_TEXTURE_2D, 0, this->format, width, height, 0, GL_RGB,
@@ -75,45 +75,49 @@ framebuffer::framebuffer(int width, int height, GLenum format)
         exit(1);
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gl::bind_framebuffer(0);
+    gl::bind_texture(GL_TEXTURE_2D, 0);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
 framebuffer::~framebuffer()
 {
+    gl::forget_framebuffer(this->id);
+    gl::forget_texture(this->texture_id);
     glDeleteFramebuffers(1, &this->id);
     glDeleteTextures(1, &this->texture_id);
 }
 
 void framebuffer::bind()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->id);
+    gl::bind_framebuffer(this->id);
     check_error();
 }
 
 void framebuffer::unbind()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl::bind_framebuffer(0);
     check_error();
 }
 
 void framebuffer::destroy()
 {
+    gl::forget_framebuffer(this->id);
+    gl::forget_texture(this->texture_id);
     glDeleteFramebuffers(1, &this->id);
     glDeleteTextures(1, &this->texture_id);
 }
 
 void framebuffer::rescale(int width, int height)
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, this->id);
+    gl::bind_framebuffer(this->id);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
     {
         ERROR("Framebuffer is not complete!");
         return;
     }
 
-    glBindTexture(GL_TEXTURE_2D, this->texture_id);
+    gl::bind_texture(GL_TEXTURE_2D, this->texture_id);
     check_error();
 
     glTexImage2D(GL_TEXTURE_2D, 0, this->format, width, height, 0, GL_RGBA,
@@ -122,7 +126,7 @@ void framebuffer::rescale(int width, int height)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
                            this->texture_id, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gl::bind_texture(GL_TEXTURE_2D, 0);
     check_error();
 
     glBindRenderbuffer(GL_RENDERBUFFER, this->render_buffer_id);
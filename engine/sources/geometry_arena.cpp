@@ -0,0 +1,286 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "geometry_arena.hpp"
+
+#include "engine_logger.hpp"
+#include "gl_helper.hpp"
+#include "mesh.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+using namespace brenta;
+using namespace brenta::types;
+
+/* Indices of both types start on a 4 byte boundary */
+static constexpr std::size_t index_alignment = sizeof(std::uint32_t);
+
+bool geometry_arena::enabled = false;
+std::size_t geometry_arena::page_size = 0;
+std::vector<geometry_arena::page> geometry_arena::pages;
+
+range_allocator::range_allocator(std::size_t capacity)
+    : capacity(capacity), free_units(capacity)
+{
+    if (capacity > 0)
+        this->free_ranges[0] = capacity;
+}
+
+bool range_allocator::allocate(std::size_t size, std::size_t alignment,
+                               std::size_t &offset)
+{
+    if (size == 0)
+    {
+        offset = 0;
+        return true;
+    }
+    alignment = std::max<std::size_t>(alignment, 1);
+
+    for (auto it = this->free_ranges.begin(); it != this->free_ranges.end();
+         ++it)
+    {
+        std::size_t start = it->first;
+        std::size_t length = it->second;
+        std::size_t aligned = (start + alignment - 1) / alignment * alignment;
+        std::size_t padding = aligned - start;
+        if (length < padding + size)
+            continue;
+
+        this->free_ranges.erase(it);
+        if (padding > 0)
+            this->free_ranges[start] = padding;
+        if (length > padding + size)
+            this->free_ranges[aligned + size] = length - padding - size;
+        this->free_units -= size;
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+void range_allocator::free(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+        return;
+    this->free_units += size;
+
+    auto next = this->free_ranges.lower_bound(offset);
+    if (next != this->free_ranges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            offset = prev->first;
+            size += prev->second;
+            this->free_ranges.erase(prev);
+        }
+    }
+    if (next != this->free_ranges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        this->free_ranges.erase(next);
+    }
+    this->free_ranges[offset] = size;
+}
+
+std::size_t range_allocator::get_capacity() const
+{
+    return this->capacity;
+}
+
+std::size_t range_allocator::get_free() const
+{
+    return this->free_units;
+}
+
+geometry_range::geometry_range(geometry_range &&other) noexcept
+    : page(other.page), base_vertex(other.base_vertex),
+      vertex_count(other.vertex_count), index_offset(other.index_offset),
+      index_size(other.index_size)
+{
+    other.page = no_page;
+}
+
+geometry_range &geometry_range::operator=(geometry_range &&other) noexcept
+{
+    if (this != &other)
+    {
+        geometry_arena::free(*this);
+        this->page = other.page;
+        this->base_vertex = other.base_vertex;
+        this->vertex_count = other.vertex_count;
+        this->index_offset = other.index_offset;
+        this->index_size = other.index_size;
+        other.page = no_page;
+    }
+    return *this;
+}
+
+geometry_range::~geometry_range()
+{
+    geometry_arena::free(*this);
+}
+
+bool geometry_range::is_valid() const
+{
+    return this->page != no_page;
+}
+
+void geometry_arena::init(std::size_t page_size)
+{
+    geometry_arena::page_size = page_size;
+    geometry_arena::enabled = true;
+    INFO("Geometry arena initialized with pages of {} bytes", page_size);
+}
+
+void geometry_arena::destroy()
+{
+    geometry_arena::pages.clear();
+    geometry_arena::enabled = false;
+}
+
+bool geometry_arena::is_enabled()
+{
+    return geometry_arena::enabled;
+}
+
+std::size_t geometry_arena::add_page(bool packed, std::size_t vertex_size,
+                                     std::size_t index_size)
+{
+    std::size_t stride =
+        packed ? sizeof(types::packed_vertex) : sizeof(types::vertex);
+    std::size_t vertex_bytes = std::max(geometry_arena::page_size, vertex_size);
+    std::size_t index_bytes = std::max(geometry_arena::page_size, index_size);
+
+    page p;
+    p.packed = packed;
+    p.vao.init();
+    p.vbo = types::buffer(GL_ARRAY_BUFFER);
+    p.vbo.copy_vertices(vertex_bytes, nullptr, GL_STATIC_DRAW);
+    p.ebo = types::buffer(GL_ELEMENT_ARRAY_BUFFER);
+    p.ebo.copy_indices(index_bytes, nullptr, GL_STATIC_DRAW);
+    mesh::set_vertex_format(p.vao, p.vbo, packed);
+    p.vertices = types::range_allocator(vertex_bytes / stride);
+    p.indices = types::range_allocator(index_bytes);
+    geometry_arena::pages.push_back(std::move(p));
+
+    DEBUG("Geometry arena page {} created", geometry_arena::pages.size() - 1);
+    return geometry_arena::pages.size() - 1;
+}
+
+types::geometry_range
+geometry_arena::allocate(std::span<const std::byte> vertices,
+                         std::size_t vertex_count, bool packed,
+                         std::span<const std::byte> indices)
+{
+    types::geometry_range range;
+    if (!geometry_arena::enabled || vertex_count == 0)
+        return range;
+
+    std::size_t first_vertex = 0;
+    std::size_t index_offset = 0;
+    std::size_t p = 0;
+    for (; p < geometry_arena::pages.size(); p++)
+    {
+        auto &candidate = geometry_arena::pages[p];
+        if (candidate.packed != packed)
+            continue;
+        if (!candidate.vertices.allocate(vertex_count, 1, first_vertex))
+            continue;
+        if (candidate.indices.allocate(indices.size(), index_alignment,
+                                       index_offset))
+            break;
+        candidate.vertices.free(first_vertex, vertex_count);
+    }
+
+    if (p == geometry_arena::pages.size())
+    {
+        p = add_page(packed, vertices.size(), indices.size());
+        geometry_arena::pages[p].vertices.allocate(vertex_count, 1,
+                                                   first_vertex);
+        geometry_arena::pages[p].indices.allocate(
+            indices.size(), index_alignment, index_offset);
+    }
+
+    /* The element buffer binding is part of the VAO state, bind the
+     * VAO of the page before touching the index buffer */
+    auto &target = geometry_arena::pages[p];
+    gl::bind_vertex_array(target.vao.get_vao());
+    target.vbo.copy_sub_data(first_vertex * (vertices.size() / vertex_count),
+                             vertices.size(), vertices.data());
+    target.ebo.copy_sub_data(index_offset, indices.size(), indices.data());
+
+    range.page = p;
+    range.base_vertex = first_vertex;
+    range.vertex_count = vertex_count;
+    range.index_offset = index_offset;
+    range.index_size = indices.size();
+    return range;
+}
+
+void geometry_arena::free(types::geometry_range &range)
+{
+    if (range.page >= geometry_arena::pages.size())
+        return;
+    auto &p = geometry_arena::pages[range.page];
+    p.vertices.free(range.base_vertex, range.vertex_count);
+    p.indices.free(range.index_offset, range.index_size);
+    range.page = types::geometry_range::no_page;
+}
+
+void geometry_arena::bind(const types::geometry_range &range)
+{
+    if (range.page >= geometry_arena::pages.size())
+        return;
+    gl::bind_vertex_array(geometry_arena::pages[range.page].vao.get_vao());
+}
+
+unsigned int
+geometry_arena::get_vertex_array(const types::geometry_range &range)
+{
+    if (range.page >= geometry_arena::pages.size())
+        return 0;
+    return geometry_arena::pages[range.page].vao.get_vao();
+}
+
+std::size_t geometry_arena::get_page_count()
+{
+    return geometry_arena::pages.size();
+}
+
+std::size_t geometry_arena::get_used_bytes()
+{
+    std::size_t used = 0;
+    for (auto &p : geometry_arena::pages)
+    {
+        std::size_t stride =
+            p.packed ? sizeof(types::packed_vertex) : sizeof(types::vertex);
+        used += (p.vertices.get_capacity() - p.vertices.get_free()) * stride;
+        used += p.indices.get_capacity() - p.indices.get_free();
+    }
+    return used;
+}
@@ -30,10 +30,142 @@
 #include "screen.hpp"
 #include "text.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 using namespace brenta;
 
+unsigned int gl::vertex_array = 0;
+unsigned int gl::program = 0;
+unsigned int gl::framebuffer = 0;
+std::array<unsigned int, 8> gl::buffers = {};
+unsigned int gl::active_unit = 0;
+std::array<gl::texture_unit, gl::max_texture_units> gl::texture_units;
+std::array<unsigned int, 3> gl::capabilities = {};
+unsigned int gl::depth_mask = 1;
+std::vector<gl::sampler> gl::samplers;
+types::gl_state_stats gl::current;
+types::gl_state_stats gl::last;
+
+namespace
+{
+
+/* Index of a buffer target in gl::buffers, -1 if It is not
+ * remembered */
+int buffer_slot(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:
+        return 0;
+    case GL_UNIFORM_BUFFER:
+        return 1;
+    case GL_TEXTURE_BUFFER:
+        return 2;
+    case GL_PIXEL_UNPACK_BUFFER:
+        return 3;
+    case GL_PIXEL_PACK_BUFFER:
+        return 4;
+    case GL_TRANSFORM_FEEDBACK_BUFFER:
+        return 5;
+    case GL_COPY_READ_BUFFER:
+        return 6;
+    case GL_COPY_WRITE_BUFFER:
+        return 7;
+    default:
+        return -1;
+    }
+}
+
+int capability_slot(GLenum capability)
+{
+    switch (capability)
+    {
+    case GL_BLEND:
+        return 0;
+    case GL_CULL_FACE:
+        return 1;
+    case GL_DEPTH_TEST:
+        return 2;
+    default:
+        return -1;
+    }
+}
+
+} // namespace
+
+#ifdef BRENTA_GL_DEBUG
+
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#define GL_DEBUG_OUTPUT 0x92E0
+
+namespace
+{
+
+typedef void(APIENTRY *debug_proc)(GLenum source, GLenum type, GLuint id,
+                                   GLenum severity, GLsizei length,
+                                   const GLchar *message,
+                                   const void *user_param);
+typedef void(APIENTRY *debug_message_callback_proc)(debug_proc callback,
+                                                    const void *user_param);
+typedef void(APIENTRY *object_label_proc)(GLenum identifier, GLuint name,
+                                          GLsizei length,
+                                          const GLchar *label);
+
+debug_message_callback_proc debug_message_callback = nullptr;
+object_label_proc object_label = nullptr;
+bool debug_output = false;
+
+/* Last check_error passed: the callback runs inside the call that
+ * failed, which comes after It */
+const char *checkpoint_file = "load_opengl";
+int checkpoint_line = 0;
+GLenum pending_error = GL_NO_ERROR;
+
+void APIENTRY debug_callback(GLenum source, GLenum type, GLuint id,
+                             GLenum severity, GLsizei length,
+                             const GLchar *message, const void *user_param)
+{
+    if (severity == GL_DEBUG_SEVERITY_NOTIFICATION)
+        return;
+
+    if (type == GL_DEBUG_TYPE_ERROR)
+    {
+        /* Most drivers use the error code as the message id */
+        pending_error = id >= GL_INVALID_ENUM
+                                && id <= GL_INVALID_FRAMEBUFFER_OPERATION
+                            ? id
+                            : GL_INVALID_OPERATION;
+        ERROR("OpenGL: {} | after {} ({})", message, checkpoint_file,
+              checkpoint_line);
+    }
+    else
+    {
+        WARN("OpenGL: {} | after {} ({})", message, checkpoint_file,
+             checkpoint_line);
+    }
+}
+
+bool has_khr_debug()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *name = (const char *) glGetStringi(GL_EXTENSIONS, i);
+        if (name != nullptr && std::strcmp(name, "GL_KHR_debug") == 0)
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+#endif
+
 void gl::load_opengl(bool gl_blending, bool gl_cull_face, bool gl_multisample,
                      bool gl_depth_test)
 {
@@ -44,17 +176,22 @@ void gl::load_opengl(bool gl_blending, bool gl_cull_face, bool gl_multisample,
         exit(-1);
     }
 
+#ifdef BRENTA_GL_DEBUG
+    if (gl::set_debug_output(true))
+        INFO("Enabled GL_KHR_debug error reporting");
+#endif
+
     int SCR_WIDTH = screen::get_width();
     int SCR_HEIGHT = screen::get_height();
 
     glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT); /* Set viewport */
-    glEnable(GL_DEPTH_TEST);                 /* Enable depth testing */
+    gl::set_capability(GL_DEPTH_TEST, true); /* Enable depth testing */
     INFO("Enabled GL_DEPTH_TEST");
 
     /* Enable blending for transparency */
     if (gl_blending)
     {
-        glEnable(GL_BLEND);
+        gl::set_capability(GL_BLEND, true);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         INFO("Enabled GL_BLEND (transparency)");
     }
@@ -63,7 +200,7 @@ void gl::load_opengl(bool gl_blending, bool gl_cull_face, bool gl_multisample,
      * based on their orientation (defined clockwise or counterclockwise) */
     if (gl_cull_face)
     {
-        glEnable(GL_CULL_FACE);
+        gl::set_capability(GL_CULL_FACE, true);
         INFO("Enabled GL_CULL_FACE (draw only visible triangles)");
     }
 
@@ -114,6 +251,28 @@ void gl::draw_elements(GLenum mode, int count, GLenum type, const void *indices)
     glDrawElements(mode, count, type, indices);
 }
 
+void gl::multi_draw_elements(GLenum mode, const GLsizei *counts, GLenum type,
+                             const void *const *indices, GLsizei drawcount)
+{
+    glMultiDrawElements(mode, counts, type, indices, drawcount);
+}
+
+void gl::draw_elements_base_vertex(GLenum mode, int count, GLenum type,
+                                   const void *indices, GLint base_vertex)
+{
+    glDrawElementsBaseVertex(mode, count, type, indices, base_vertex);
+}
+
+void gl::multi_draw_elements_base_vertex(GLenum mode, const GLsizei *counts,
+                                         GLenum type,
+                                         const void *const *indices,
+                                         GLsizei drawcount,
+                                         const GLint *base_vertices)
+{
+    glMultiDrawElementsBaseVertex(mode, counts, type, indices, drawcount,
+                                  base_vertices);
+}
+
 void gl::clear()
 {
     /* Clear color and depth buffer */
@@ -122,11 +281,243 @@ void gl::clear()
 
 void gl::bind_vertex_array(unsigned int n)
 {
-    glBindVertexArray(n);
+    if (gl::changes(gl::vertex_array, n))
+        glBindVertexArray(n);
+}
+
+unsigned int gl::get_vertex_array()
+{
+    return gl::vertex_array;
+}
+
+void gl::forget_vertex_array(unsigned int n)
+{
+    if (n == gl::vertex_array)
+        gl::vertex_array = 0;
+}
+
+bool gl::changes(unsigned int &state, unsigned int value)
+{
+    if (state == value)
+    {
+        gl::current.filtered++;
+        return false;
+    }
+    gl::current.issued++;
+    state = value;
+    return true;
+}
+
+void gl::use_program(unsigned int program)
+{
+    if (gl::changes(gl::program, program))
+        glUseProgram(program);
+}
+
+unsigned int gl::get_program()
+{
+    return gl::program;
+}
+
+void gl::bind_buffer(GLenum target, unsigned int buffer)
+{
+    int slot = buffer_slot(target);
+    if (slot < 0)
+        glBindBuffer(target, buffer);
+    else if (gl::changes(gl::buffers[slot], buffer))
+        glBindBuffer(target, buffer);
+}
+
+void gl::bind_buffer_base(GLenum target, unsigned int index,
+                          unsigned int buffer)
+{
+    glBindBufferBase(target, index, buffer);
+    gl::current.issued++;
+    int slot = buffer_slot(target);
+    if (slot >= 0)
+        gl::buffers[slot] = buffer;
+}
+
+void gl::forget_buffer(unsigned int buffer)
+{
+    for (auto &b : gl::buffers)
+    {
+        if (b == buffer)
+            b = 0;
+    }
+}
+
+void gl::active_texture(GLenum unit)
+{
+    if (gl::changes(gl::active_unit, unit - GL_TEXTURE0))
+        glActiveTexture(unit);
+}
+
+GLenum gl::get_active_texture()
+{
+    return GL_TEXTURE0 + gl::active_unit;
+}
+
+void gl::bind_texture(GLenum target, unsigned int texture)
+{
+    unsigned int *state = nullptr;
+    if (gl::active_unit < max_texture_units)
+    {
+        auto &unit = gl::texture_units[gl::active_unit];
+        if (target == GL_TEXTURE_2D)
+            state = &unit.texture_2d;
+        else if (target == GL_TEXTURE_BUFFER)
+            state = &unit.texture_buffer;
+    }
+    if (state == nullptr || gl::changes(*state, texture))
+        glBindTexture(target, texture);
+}
+
+void gl::forget_texture(unsigned int texture)
+{
+    for (auto &unit : gl::texture_units)
+    {
+        if (unit.texture_2d == texture)
+            unit.texture_2d = 0;
+        if (unit.texture_buffer == texture)
+            unit.texture_buffer = 0;
+    }
+}
+
+void gl::bind_sampler(unsigned int unit, unsigned int sampler)
+{
+    if (unit >= max_texture_units
+        || gl::changes(gl::texture_units[unit].sampler, sampler))
+        glBindSampler(unit, sampler);
+}
+
+unsigned int gl::get_sampler(GLint wrapping, GLint filtering_min,
+                             GLint filtering_mag)
+{
+    for (const auto &s : gl::samplers)
+    {
+        if (s.wrapping == wrapping && s.filtering_min == filtering_min
+            && s.filtering_mag == filtering_mag)
+            return s.id;
+    }
+
+    unsigned int id;
+    glGenSamplers(1, &id);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_S, wrapping);
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_T, wrapping);
+    glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, filtering_min);
+    glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, filtering_mag);
+    check_error();
+    gl::samplers.push_back({wrapping, filtering_min, filtering_mag, id});
+    return id;
+}
+
+void gl::bind_framebuffer(unsigned int framebuffer)
+{
+    if (gl::changes(gl::framebuffer, framebuffer))
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void gl::forget_framebuffer(unsigned int framebuffer)
+{
+    if (framebuffer == gl::framebuffer)
+        gl::framebuffer = 0;
+}
+
+void gl::set_capability(GLenum capability, bool enabled)
+{
+    int slot = capability_slot(capability);
+    if (slot >= 0 && !gl::changes(gl::capabilities[slot], enabled))
+        return;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void gl::set_depth_mask(bool enabled)
+{
+    if (gl::changes(gl::depth_mask, enabled))
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+}
+
+void gl::invalidate_state()
+{
+    gl::vertex_array = unknown;
+    gl::program = unknown;
+    gl::framebuffer = unknown;
+    gl::buffers.fill(unknown);
+    gl::active_unit = unknown;
+    gl::texture_units.fill({unknown, unknown, unknown});
+    gl::capabilities.fill(unknown);
+    gl::depth_mask = unknown;
+}
+
+void gl::new_frame()
+{
+    gl::last = gl::current;
+    gl::current = types::gl_state_stats();
+}
+
+types::gl_state_stats gl::get_stats()
+{
+    return gl::last;
+}
+
+void gl::destroy()
+{
+    for (const auto &s : gl::samplers)
+        glDeleteSamplers(1, &s.id);
+    gl::samplers.clear();
+    gl::invalidate_state();
+}
+
+#ifdef BRENTA_GL_DEBUG
+
+bool gl::set_debug_output(bool enabled)
+{
+    if (debug_message_callback == nullptr)
+    {
+        if (!has_khr_debug())
+            return false;
+
+        GLADloadproc load = (GLADloadproc) screen::get_proc_address();
+        debug_message_callback = (debug_message_callback_proc) load(
+            "glDebugMessageCallback");
+        object_label = (object_label_proc) load("glObjectLabel");
+        if (debug_message_callback == nullptr)
+            return false;
+        debug_message_callback(debug_callback, nullptr);
+        /* Called inside the failing call, not later on another thread */
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+
+    if (enabled)
+        glEnable(GL_DEBUG_OUTPUT);
+    else
+        glDisable(GL_DEBUG_OUTPUT);
+    debug_output = enabled;
+    return true;
+}
+
+void gl::set_label(GLenum identifier, unsigned int name,
+                   std::string_view label)
+{
+    if (object_label != nullptr && name != 0)
+        object_label(identifier, name, label.size(), label.data());
 }
 
 GLenum gl::check_error_(const char *file, int line)
 {
+    if (debug_output)
+    {
+        checkpoint_file = file;
+        checkpoint_line = line;
+        GLenum error = pending_error;
+        pending_error = GL_NO_ERROR;
+        return error;
+    }
+
     GLenum errorCode;
     while ((errorCode = glGetError()) != GL_NO_ERROR)
     {
@@ -164,3 +555,5 @@ GLenum gl::check_error_(const char *file, int line)
     }
     return errorCode;
 }
+
+#endif
@@ -0,0 +1,951 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "gltf.hpp"
+
+#include "engine_logger.hpp"
+#include "vfs.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+using namespace brenta;
+
+namespace
+{
+
+bool in_range(int index, std::size_t size)
+{
+    return index >= 0 && static_cast<std::size_t>(index) < size;
+}
+
+/* Optional references are -1 when missing */
+bool optional_in_range(int index, std::size_t size)
+{
+    return index == -1 || in_range(index, size);
+}
+
+int get_index(const types::json &value)
+{
+    return value.is_number() ? static_cast<int>(value.as_int(-1)) : -1;
+}
+
+std::uint32_t read_u32(const unsigned char *bytes)
+{
+    std::uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+/* URIs of external files may escape spaces and other characters */
+std::string decode_uri(const std::string &uri)
+{
+    std::string out;
+    out.reserve(uri.size());
+    for (std::size_t i = 0; i < uri.size(); i++)
+    {
+        if (uri[i] == '%' && i + 2 < uri.size()
+            && std::isxdigit(static_cast<unsigned char>(uri[i + 1]))
+            && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+        {
+            out += static_cast<char>(
+                std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else
+            out += uri[i];
+    }
+    return out;
+}
+
+/* Matrices of nodes are translation, rotation and scale by the
+ * specification, so they can be split without shear */
+types::joint_pose decompose(const glm::mat4 &m)
+{
+    types::joint_pose pose;
+    pose.translation = glm::vec3(m[3]);
+    pose.scale = glm::vec3(glm::length(glm::vec3(m[0])),
+                           glm::length(glm::vec3(m[1])),
+                           glm::length(glm::vec3(m[2])));
+    glm::mat3 rotation(glm::vec3(m[0]) / pose.scale.x,
+                       glm::vec3(m[1]) / pose.scale.y,
+                       glm::vec3(m[2]) / pose.scale.z);
+    pose.rotation = glm::normalize(glm::quat_cast(rotation));
+    return pose;
+}
+
+template <typename T> T read_component(const unsigned char *bytes)
+{
+    T value;
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+} // namespace
+
+bool gltf::can_load(const std::string &path)
+{
+    std::size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos)
+        return false;
+
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == "gltf" || extension == "glb";
+}
+
+bool gltf::load(const std::string &path, types::gltf_data &data)
+{
+    types::asset file = vfs::read(path);
+    if (!file.is_valid())
+    {
+        ERROR("Could not read glTF file: {}", path);
+        return false;
+    }
+
+    data.path = path;
+    data.directory = path.substr(0, path.find_last_of('/'));
+    if (!parse(file, data))
+    {
+        ERROR("Malformed glTF file: {}", path);
+        return false;
+    }
+    return true;
+}
+
+bool gltf::parse(const types::asset &file, types::gltf_data &data)
+{
+    std::string_view text = file.str();
+    types::asset glb_buffer;
+
+    if (file.size() >= 12 && read_u32(file.data()) == glb_magic)
+    {
+        /* Header, then a JSON chunk and an optional binary chunk, every
+         * chunk starting with its length and type */
+        std::uint32_t version = read_u32(file.data() + 4);
+        std::size_t length =
+            std::min<std::size_t>(read_u32(file.data() + 8), file.size());
+        if (version != 2)
+        {
+            ERROR("Unsupported GLB version {}", version);
+            return false;
+        }
+
+        std::size_t offset = 12;
+        text = {};
+        while (offset + 8 <= length)
+        {
+            std::size_t chunk_length = read_u32(file.data() + offset);
+            std::uint32_t type = read_u32(file.data() + offset + 4);
+            offset += 8;
+            if (chunk_length > length - offset)
+                return false;
+
+            if (type == json_chunk && text.empty())
+                text = file.str().substr(offset, chunk_length);
+            else if (type == bin_chunk && !glb_buffer.is_valid())
+                glb_buffer = file.slice(offset, chunk_length);
+            offset += (chunk_length + 3) & ~std::size_t(3);
+        }
+        if (text.empty())
+            return false;
+    }
+
+    types::json doc;
+    if (!types::json::parse(text, doc))
+        return false;
+
+    const std::string &version = doc["asset"]["version"].as_string();
+    if (version.empty() || version[0] != '2')
+    {
+        ERROR("Unsupported glTF version {}", version);
+        return false;
+    }
+    for (const auto &extension : doc["extensionsRequired"].get_elements())
+    {
+        ERROR("Unsupported glTF extension {}", extension.as_string());
+        return false;
+    }
+
+    if (!load_buffers(doc, glb_buffer, data) || !parse_json(doc, data)
+        || !validate(data))
+        return false;
+
+    compute_world(data);
+    return true;
+}
+
+bool gltf::load_buffers(const types::json &doc,
+                        const types::asset &glb_buffer,
+                        types::gltf_data &data)
+{
+    const auto &buffers = doc["buffers"].get_elements();
+    data.buffers.assign(buffers.size(), types::asset());
+
+    /* External files are read in one batch */
+    std::vector<std::string> files;
+    std::vector<std::size_t> file_buffers;
+    for (std::size_t i = 0; i < buffers.size(); i++)
+    {
+        const std::string &uri = buffers[i]["uri"].as_string();
+        if (uri.empty())
+        {
+            /* Only the first buffer may refer to the binary chunk */
+            if (i != 0 || !glb_buffer.is_valid())
+                return false;
+            data.buffers[i] = glb_buffer;
+        }
+        else if (uri.starts_with("data:"))
+        {
+            std::size_t comma = uri.find(',');
+            if (comma == std::string::npos
+                || uri.substr(0, comma).find(";base64") == std::string::npos)
+                return false;
+
+            auto bytes = std::make_shared<std::vector<unsigned char>>();
+            if (!decode_base64(std::string_view(uri).substr(comma + 1),
+                               *bytes))
+                return false;
+            data.buffers[i] = types::asset(*bytes, bytes);
+        }
+        else
+        {
+            files.push_back(data.directory + "/" + decode_uri(uri));
+            file_buffers.push_back(i);
+        }
+    }
+
+    std::vector<types::asset> read = vfs::read_batch(files);
+    for (std::size_t i = 0; i < read.size(); i++)
+    {
+        if (!read[i].is_valid())
+        {
+            ERROR("Could not read glTF buffer: {}", files[i]);
+            return false;
+        }
+        data.buffers[file_buffers[i]] = std::move(read[i]);
+    }
+
+    for (std::size_t i = 0; i < buffers.size(); i++)
+    {
+        auto length =
+            static_cast<std::size_t>(buffers[i]["byteLength"].as_int());
+        if (data.buffers[i].size() < length)
+            return false;
+    }
+    return true;
+}
+
+bool gltf::parse_json(const types::json &doc, types::gltf_data &data)
+{
+    for (const auto &v : doc["bufferViews"].get_elements())
+    {
+        types::gltf_buffer_view view;
+        view.buffer = static_cast<unsigned int>(v["buffer"].as_int(-1));
+        view.offset = static_cast<std::size_t>(v["byteOffset"].as_int());
+        view.length = static_cast<std::size_t>(v["byteLength"].as_int());
+        view.stride = static_cast<unsigned int>(v["byteStride"].as_int());
+        data.buffer_views.push_back(view);
+    }
+
+    for (const auto &a : doc["accessors"].get_elements())
+    {
+        static const std::pair<const char *, unsigned int> types[] = {
+            {"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4},
+            {"MAT2", 4},   {"MAT3", 9}, {"MAT4", 16}};
+
+        types::gltf_accessor accessor;
+        accessor.buffer_view = get_index(a["bufferView"]);
+        accessor.offset = static_cast<std::size_t>(a["byteOffset"].as_int());
+        accessor.component_type =
+            static_cast<GLenum>(a["componentType"].as_int());
+        if (a["count"].as_int() < 0)
+            return false;
+        accessor.count = static_cast<std::size_t>(a["count"].as_int());
+        accessor.normalized = a["normalized"].as_bool();
+        accessor.components = 0;
+        for (const auto &[name, components] : types)
+        {
+            if (a["type"].as_string() == name)
+                accessor.components = components;
+        }
+        if (accessor.components == 0)
+            return false;
+        if (a.contains("sparse"))
+            WARN("Sparse glTF accessors are not supported");
+        data.accessors.push_back(accessor);
+    }
+
+    for (const auto &m : doc["meshes"].get_elements())
+    {
+        static const char *attributes[types::GLTF_ATTRIBUTE_COUNT] = {
+            "POSITION", "NORMAL", "TEXCOORD_0", "JOINTS_0", "WEIGHTS_0"};
+
+        types::gltf_mesh mesh;
+        mesh.name = m["name"].as_string();
+        for (const auto &p : m["primitives"].get_elements())
+        {
+            types::gltf_primitive primitive;
+            for (int i = 0; i < types::GLTF_ATTRIBUTE_COUNT; i++)
+                primitive.attributes[i] =
+                    get_index(p["attributes"][attributes[i]]);
+            primitive.indices = get_index(p["indices"]);
+            primitive.material = get_index(p["material"]);
+            primitive.mode =
+                static_cast<GLenum>(p["mode"].as_int(GL_TRIANGLES));
+            mesh.primitives.push_back(primitive);
+        }
+        data.meshes.push_back(std::move(mesh));
+    }
+
+    for (const auto &n : doc["nodes"].get_elements())
+    {
+        types::gltf_node node;
+        node.name = n["name"].as_string();
+        node.mesh = get_index(n["mesh"]);
+        node.skin = get_index(n["skin"]);
+        for (const auto &child : n["children"].get_elements())
+            node.children.push_back(get_index(child));
+
+        const auto &matrix = n["matrix"];
+        if (matrix.size() == 16)
+        {
+            for (int i = 0; i < 16; i++)
+                glm::value_ptr(node.local)[i] =
+                    static_cast<float>(matrix[i].as_number());
+            node.pose = decompose(node.local);
+        }
+        else
+        {
+            const auto &t = n["translation"];
+            const auto &r = n["rotation"];
+            const auto &s = n["scale"];
+            if (t.size() == 3)
+                node.pose.translation =
+                    glm::vec3(t[0].as_number(), t[1].as_number(),
+                              t[2].as_number());
+            /* glTF stores quaternions as x, y, z, w */
+            if (r.size() == 4)
+                node.pose.rotation =
+                    glm::quat(r[3].as_number(), r[0].as_number(),
+                              r[1].as_number(), r[2].as_number());
+            if (s.size() == 3)
+                node.pose.scale = glm::vec3(
+                    s[0].as_number(), s[1].as_number(), s[2].as_number());
+            node.local = animator::compose(node.pose);
+        }
+        data.nodes.push_back(std::move(node));
+    }
+
+    for (std::size_t i = 0; i < data.nodes.size(); i++)
+    {
+        for (int child : data.nodes[i].children)
+        {
+            /* A node has one parent at most, which also rules out
+             * cycles reachable from a root */
+            if (!in_range(child, data.nodes.size())
+                || data.nodes[child].parent != -1)
+                return false;
+            data.nodes[child].parent = static_cast<int>(i);
+        }
+    }
+
+    const auto &scenes = doc["scenes"];
+    if (scenes.size() > 0)
+    {
+        const auto &scene = scenes[static_cast<std::size_t>(
+            std::max(0LL, doc["scene"].as_int()))];
+        for (const auto &node : scene["nodes"].get_elements())
+            data.scene.push_back(get_index(node));
+    }
+    else
+    {
+        for (std::size_t i = 0; i < data.nodes.size(); i++)
+        {
+            if (data.nodes[i].parent == -1)
+                data.scene.push_back(static_cast<int>(i));
+        }
+    }
+
+    for (const auto &m : doc["materials"].get_elements())
+    {
+        const auto &pbr = m["pbrMetallicRoughness"];
+        types::gltf_material material;
+        material.name = m["name"].as_string();
+        const auto &factor = pbr["baseColorFactor"];
+        if (factor.size() == 4)
+            material.base_color =
+                glm::vec4(factor[0].as_number(), factor[1].as_number(),
+                          factor[2].as_number(), factor[3].as_number());
+        material.base_color_texture =
+            get_index(pbr["baseColorTexture"]["index"]);
+        material.metallic_roughness_texture =
+            get_index(pbr["metallicRoughnessTexture"]["index"]);
+        material.normal_texture = get_index(m["normalTexture"]["index"]);
+        data.materials.push_back(std::move(material));
+    }
+
+    for (const auto &t : doc["textures"].get_elements())
+        data.textures.push_back(get_index(t["source"]));
+
+    for (const auto &i : doc["images"].get_elements())
+    {
+        types::gltf_image image;
+        image.buffer_view = get_index(i["bufferView"]);
+        image.mime_type = i["mimeType"].as_string();
+
+        const std::string &uri = i["uri"].as_string();
+        if (uri.starts_with("data:"))
+        {
+            /* Decoded in a buffer of its own, then handled like the
+             * images in buffer views */
+            std::size_t comma = uri.find(',');
+            auto bytes = std::make_shared<std::vector<unsigned char>>();
+            if (comma == std::string::npos
+                || !decode_base64(std::string_view(uri).substr(comma + 1),
+                                  *bytes))
+                return false;
+
+            std::size_t semicolon = uri.find(';');
+            image.mime_type = uri.substr(5, std::min(comma, semicolon) - 5);
+            image.buffer_view = static_cast<int>(data.buffer_views.size());
+            data.buffer_views.push_back(
+                {static_cast<unsigned int>(data.buffers.size()), 0,
+                 bytes->size(), 0});
+            data.buffers.emplace_back(*bytes, bytes);
+        }
+        else
+            image.uri = decode_uri(uri);
+        data.images.push_back(std::move(image));
+    }
+
+    for (const auto &s : doc["skins"].get_elements())
+    {
+        types::gltf_skin skin;
+        skin.name = s["name"].as_string();
+        skin.inverse_bind_matrices = get_index(s["inverseBindMatrices"]);
+        for (const auto &joint : s["joints"].get_elements())
+            skin.joints.push_back(get_index(joint));
+        data.skins.push_back(std::move(skin));
+    }
+
+    for (const auto &a : doc["animations"].get_elements())
+    {
+        types::gltf_animation animation;
+        animation.name = a["name"].as_string();
+        const auto &samplers = a["samplers"];
+        for (const auto &c : a["channels"].get_elements())
+        {
+            const auto &sampler =
+                samplers[static_cast<std::size_t>(c["sampler"].as_int(-1))];
+            const std::string &path = c["target"]["path"].as_string();
+            const std::string &interpolation =
+                sampler["interpolation"].as_string();
+
+            types::gltf_channel channel;
+            channel.node = get_index(c["target"]["node"]);
+            channel.input = get_index(sampler["input"]);
+            channel.output = get_index(sampler["output"]);
+            if (path == "translation")
+                channel.property = enums::TRANSLATION;
+            else if (path == "rotation")
+                channel.property = enums::ROTATION;
+            else if (path == "scale")
+                channel.property = enums::SCALE;
+            else
+                continue; // morph target weights
+            if (interpolation == "STEP")
+                channel.interpolation = enums::GLTF_STEP;
+            else if (interpolation == "CUBICSPLINE")
+                channel.interpolation = enums::GLTF_CUBICSPLINE;
+            animation.channels.push_back(channel);
+        }
+        data.animations.push_back(std::move(animation));
+    }
+
+    return true;
+}
+
+bool gltf::validate(const types::gltf_data &data)
+{
+    /* Every reference is checked once here, so that the accessors can
+     * be read without bounds checks afterwards */
+    for (const auto &view : data.buffer_views)
+    {
+        if (view.buffer >= data.buffers.size()
+            || view.offset > data.buffers[view.buffer].size()
+            || view.length > data.buffers[view.buffer].size() - view.offset)
+            return false;
+    }
+
+    for (const auto &accessor : data.accessors)
+    {
+        switch (accessor.component_type)
+        {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            break;
+        default:
+            return false;
+        }
+        if (accessor.buffer_view == -1 || accessor.count == 0)
+            continue;
+        if (!in_range(accessor.buffer_view, data.buffer_views.size()))
+            return false;
+
+        const auto &view = data.buffer_views[accessor.buffer_view];
+        std::size_t stride = get_stride(data, accessor);
+        std::size_t element = get_element_size(accessor);
+        /* Divided rather than multiplied, a huge count can not wrap */
+        if (accessor.offset > view.length
+            || element > view.length - accessor.offset
+            || accessor.count - 1
+                   > (view.length - accessor.offset - element) / stride)
+            return false;
+    }
+
+    for (const auto &mesh : data.meshes)
+    {
+        for (const auto &primitive : mesh.primitives)
+        {
+            for (int attribute : primitive.attributes)
+            {
+                if (!optional_in_range(attribute, data.accessors.size()))
+                    return false;
+            }
+            if (!optional_in_range(primitive.indices, data.accessors.size())
+                || !optional_in_range(primitive.material,
+                                      data.materials.size())
+                || primitive.mode > GL_TRIANGLE_FAN)
+                return false;
+        }
+    }
+
+    for (const auto &node : data.nodes)
+    {
+        if (!optional_in_range(node.mesh, data.meshes.size())
+            || !optional_in_range(node.skin, data.skins.size()))
+            return false;
+    }
+    for (int node : data.scene)
+    {
+        if (!in_range(node, data.nodes.size()))
+            return false;
+    }
+
+    for (const auto &material : data.materials)
+    {
+        if (!optional_in_range(material.base_color_texture,
+                               data.textures.size())
+            || !optional_in_range(material.metallic_roughness_texture,
+                                  data.textures.size())
+            || !optional_in_range(material.normal_texture,
+                                  data.textures.size()))
+            return false;
+    }
+    for (int image : data.textures)
+    {
+        if (!optional_in_range(image, data.images.size()))
+            return false;
+    }
+    for (const auto &image : data.images)
+    {
+        if (!optional_in_range(image.buffer_view, data.buffer_views.size()))
+            return false;
+    }
+
+    for (const auto &skin : data.skins)
+    {
+        for (int joint : skin.joints)
+        {
+            if (!in_range(joint, data.nodes.size()))
+                return false;
+        }
+        if (!optional_in_range(skin.inverse_bind_matrices,
+                               data.accessors.size())
+            || skin.joints.size() > UINT16_MAX)
+            return false;
+    }
+
+    for (const auto &animation : data.animations)
+    {
+        for (const auto &channel : animation.channels)
+        {
+            if (!in_range(channel.node, data.nodes.size())
+                || !in_range(channel.input, data.accessors.size())
+                || !in_range(channel.output, data.accessors.size()))
+                return false;
+        }
+    }
+    return true;
+}
+
+void gltf::compute_world(types::gltf_data &data)
+{
+    std::vector<int> stack;
+    for (std::size_t i = 0; i < data.nodes.size(); i++)
+    {
+        if (data.nodes[i].parent == -1)
+            stack.push_back(static_cast<int>(i));
+    }
+
+    /* Parents are visited before their children */
+    while (!stack.empty())
+    {
+        auto &node = data.nodes[stack.back()];
+        stack.pop_back();
+
+        node.world = node.parent == -1
+                         ? node.local
+                         : data.nodes[node.parent].world * node.local;
+        stack.insert(stack.end(), node.children.begin(),
+                     node.children.end());
+    }
+}
+
+bool gltf::decode_base64(std::string_view text,
+                         std::vector<unsigned char> &out)
+{
+    static constexpr auto table = []()
+    {
+        std::array<signed char, 256> t{};
+        t.fill(-1);
+        const char *alphabet =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int i = 0; i < 64; i++)
+            t[static_cast<unsigned char>(alphabet[i])] =
+                static_cast<signed char>(i);
+        return t;
+    }();
+
+    out.clear();
+    out.reserve(text.size() / 4 * 3);
+    std::uint32_t bits = 0;
+    int count = 0;
+    for (char c : text)
+    {
+        if (c == '=')
+            break;
+        int value = table[static_cast<unsigned char>(c)];
+        if (value < 0)
+            return false;
+
+        bits = (bits << 6) | static_cast<std::uint32_t>(value);
+        count += 6;
+        if (count >= 8)
+        {
+            count -= 8;
+            out.push_back(static_cast<unsigned char>(bits >> count));
+        }
+    }
+    return true;
+}
+
+std::size_t gltf::get_element_size(const types::gltf_accessor &accessor)
+{
+    std::size_t component = 4;
+    switch (accessor.component_type)
+    {
+    case GL_BYTE:
+    case GL_UNSIGNED_BYTE:
+        component = 1;
+        break;
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+        component = 2;
+        break;
+    default:
+        break;
+    }
+    return component * accessor.components;
+}
+
+std::size_t gltf::get_stride(const types::gltf_data &data,
+                             const types::gltf_accessor &accessor)
+{
+    if (in_range(accessor.buffer_view, data.buffer_views.size())
+        && data.buffer_views[accessor.buffer_view].stride != 0)
+        return data.buffer_views[accessor.buffer_view].stride;
+    return get_element_size(accessor);
+}
+
+const unsigned char *gltf::get_pointer(const types::gltf_data &data,
+                                       const types::gltf_accessor &a)
+{
+    if (a.buffer_view == -1)
+        return nullptr;
+
+    const auto &view = data.buffer_views[a.buffer_view];
+    return data.buffers[view.buffer].data() + view.offset + a.offset;
+}
+
+std::vector<float> gltf::read_floats(const types::gltf_data &data,
+                                     int accessor)
+{
+    const auto &a = data.accessors[accessor];
+    std::vector<float> out(a.count * a.components, 0.0f);
+    const unsigned char *bytes = get_pointer(data, a);
+    if (bytes == nullptr)
+        return out;
+
+    std::size_t stride = get_stride(data, a);
+    std::size_t size = get_element_size(a) / a.components;
+    bool norm = a.normalized;
+    for (std::size_t i = 0; i < a.count; i++)
+    {
+        const unsigned char *element = bytes + i * stride;
+        for (unsigned int c = 0; c < a.components; c++)
+        {
+            const unsigned char *p = element + c * size;
+            float v;
+            switch (a.component_type)
+            {
+            case GL_BYTE:
+                v = read_component<std::int8_t>(p);
+                v = norm ? std::max(v / 127.0f, -1.0f) : v;
+                break;
+            case GL_UNSIGNED_BYTE:
+                v = read_component<std::uint8_t>(p);
+                v = norm ? v / 255.0f : v;
+                break;
+            case GL_SHORT:
+                v = read_component<std::int16_t>(p);
+                v = norm ? std::max(v / 32767.0f, -1.0f) : v;
+                break;
+            case GL_UNSIGNED_SHORT:
+                v = read_component<std::uint16_t>(p);
+                v = norm ? v / 65535.0f : v;
+                break;
+            case GL_UNSIGNED_INT:
+                v = static_cast<float>(read_component<std::uint32_t>(p));
+                break;
+            default:
+                v = read_component<float>(p);
+                break;
+            }
+            out[i * a.components + c] = v;
+        }
+    }
+    return out;
+}
+
+std::vector<std::uint32_t> gltf::read_integers(const types::gltf_data &data,
+                                               int accessor)
+{
+    const auto &a = data.accessors[accessor];
+    std::vector<std::uint32_t> out(a.count * a.components, 0);
+    const unsigned char *bytes = get_pointer(data, a);
+    if (bytes == nullptr)
+        return out;
+
+    std::size_t stride = get_stride(data, a);
+    std::size_t size = get_element_size(a) / a.components;
+    for (std::size_t i = 0; i < a.count; i++)
+    {
+        const unsigned char *element = bytes + i * stride;
+        for (unsigned int c = 0; c < a.components; c++)
+        {
+            const unsigned char *p = element + c * size;
+            std::uint32_t v;
+            if (size == 1)
+                v = read_component<std::uint8_t>(p);
+            else if (size == 2)
+                v = read_component<std::uint16_t>(p);
+            else
+                v = read_component<std::uint32_t>(p);
+            out[i * a.components + c] = v;
+        }
+    }
+    return out;
+}
+
+std::string gltf::get_image_key(const types::gltf_data &data, int image)
+{
+    const auto &i = data.images[image];
+    if (!i.uri.empty())
+        return data.directory + "/" + i.uri;
+    return data.path + "#" + std::to_string(image);
+}
+
+types::skeleton gltf::build_skeleton(const types::gltf_data &data,
+                                     int skin,
+                                     std::vector<std::uint16_t> &remap)
+{
+    const auto &s = data.skins[skin];
+    std::size_t count = s.joints.size();
+
+    std::unordered_map<int, int> joint_of;
+    for (std::size_t i = 0; i < count; i++)
+        joint_of.emplace(s.joints[i], static_cast<int>(i));
+
+    /* Closest ancestor that is a joint, and how many joints are
+     * above: sorting by depth puts the parents first */
+    std::vector<int> parent(count, -1);
+    std::vector<unsigned int> depth(count, 0);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        int node = data.nodes[s.joints[i]].parent;
+        for (std::size_t steps = 0; node != -1 && steps < data.nodes.size();
+             steps++)
+        {
+            auto it = joint_of.find(node);
+            if (it != joint_of.end())
+            {
+                if (parent[i] == -1)
+                    parent[i] = it->second;
+                depth[i]++;
+            }
+            node = data.nodes[node].parent;
+        }
+    }
+
+    std::vector<std::uint16_t> order(count);
+    for (std::size_t i = 0; i < count; i++)
+        order[i] = static_cast<std::uint16_t>(i);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::uint16_t a, std::uint16_t b)
+                     { return depth[a] < depth[b]; });
+
+    remap.assign(count, 0);
+    bool identity = true;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        remap[order[i]] = static_cast<std::uint16_t>(i);
+        identity = identity && order[i] == i;
+    }
+
+    std::vector<float> inverse_binds;
+    if (s.inverse_bind_matrices != -1)
+        inverse_binds = read_floats(data, s.inverse_bind_matrices);
+
+    types::skeleton skeleton;
+    skeleton.joints.resize(count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+        std::uint16_t j = order[i];
+        const auto &node = data.nodes[s.joints[j]];
+        auto &joint = skeleton.joints[i];
+        joint.name = node.name.empty() ? "joint_" + std::to_string(j)
+                                       : node.name;
+        joint.parent = parent[j] == -1 ? -1 : remap[parent[j]];
+        joint.bind_pose = node.pose;
+        if ((j + 1) * std::size_t(16) <= inverse_binds.size())
+            joint.inverse_bind = glm::make_mat4(&inverse_binds[j * 16]);
+    }
+
+    if (identity)
+        remap.clear();
+    return skeleton;
+}
+
+std::vector<types::animation_clip>
+gltf::build_animations(const types::gltf_data &data, int skin,
+                       const std::vector<std::uint16_t> &remap)
+{
+    const auto &s = data.skins[skin];
+    std::unordered_map<int, std::uint32_t> joint_of;
+    for (std::size_t i = 0; i < s.joints.size(); i++)
+        joint_of.emplace(s.joints[i], remap.empty() ? i : remap[i]);
+
+    std::vector<types::animation_clip> clips;
+    for (std::size_t a = 0; a < data.animations.size(); a++)
+    {
+        const auto &animation = data.animations[a];
+        types::animation_clip clip;
+        clip.name = animation.name.empty()
+                        ? "animation_" + std::to_string(a)
+                        : animation.name;
+
+        std::unordered_map<std::uint32_t, std::size_t> track_of;
+        for (const auto &channel : animation.channels)
+        {
+            auto joint = joint_of.find(channel.node);
+            if (joint == joint_of.end())
+                continue;
+
+            std::vector<float> times = read_floats(data, channel.input);
+            std::vector<float> values = read_floats(data, channel.output);
+            std::size_t components =
+                channel.property == enums::ROTATION ? 4 : 3;
+            bool cubic = channel.interpolation == enums::GLTF_CUBICSPLINE;
+            /* Cubic spline keys are in tangent, value, out tangent */
+            std::size_t stride = cubic ? components * 3 : components;
+            std::size_t first = cubic ? components : 0;
+            if (times.empty() || values.size() < times.size() * stride)
+            {
+                WARN("Malformed glTF animation channel in {}", clip.name);
+                continue;
+            }
+
+            auto [it, inserted] =
+                track_of.try_emplace(joint->second, clip.tracks.size());
+            if (inserted)
+                clip.tracks.push_back({joint->second, {}, {}, {}});
+            auto &track = clip.tracks[it->second];
+
+            for (std::size_t k = 0; k < times.size(); k++)
+            {
+                const float *v = &values[k * stride + first];
+                /* A step is held until just before the next key */
+                bool hold = channel.interpolation == enums::GLTF_STEP
+                            && k + 1 < times.size();
+                float end = hold ? std::nextafter(times[k + 1], times[k])
+                                 : times[k];
+                int keys = hold && end > times[k] ? 2 : 1;
+                for (int key = 0; key < keys; key++)
+                {
+                    float time = key == 0 ? times[k] : end;
+                    if (channel.property == enums::TRANSLATION)
+                        track.translations.push_back(
+                            {time, glm::vec3(v[0], v[1], v[2])});
+                    else if (channel.property == enums::SCALE)
+                        track.scales.push_back(
+                            {time, glm::vec3(v[0], v[1], v[2])});
+                    else
+                        track.rotations.push_back(
+                            {time, glm::normalize(
+                                       glm::quat(v[3], v[0], v[1], v[2]))});
+                }
+            }
+            clip.duration = std::max(clip.duration, times.back());
+        }
+        clips.push_back(std::move(clip));
+    }
+    return clips;
+}
@@ -0,0 +1,422 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "gltf_model.hpp"
+
+#include "engine_logger.hpp"
+#include "gl_helper.hpp"
+#include "mesh.hpp"
+#include "skinning.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
+#include "uniform_buffers.hpp"
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+using namespace brenta;
+
+gltf_model::gltf_model(const std::string &path, GLint wrapping,
+                       GLint filtering_min, GLint filtering_mag,
+                       GLboolean has_mipmap, GLint mipmap_min,
+                       GLint mipmap_mag)
+    : gltf_model(import_model(path, wrapping, filtering_min, filtering_mag,
+                              has_mipmap, mipmap_min, mipmap_mag),
+                 wrapping, filtering_min, filtering_mag, has_mipmap,
+                 mipmap_min, mipmap_mag)
+{
+}
+
+gltf_model::gltf_model(types::gltf_data &&data, GLint wrapping,
+                       GLint filtering_min, GLint filtering_mag,
+                       GLboolean has_mipmap, GLint mipmap_min,
+                       GLint mipmap_mag)
+{
+    this->wrapping = wrapping;
+    this->filtering_min = filtering_min;
+    this->filtering_mag = filtering_mag;
+    this->has_mipmap = has_mipmap;
+    this->mipmap_min = mipmap_min;
+    this->mipmap_mag = mipmap_mag;
+    upload(data);
+}
+
+types::gltf_data gltf_model::import_model(const std::string &path,
+                                          GLint wrapping, GLint filtering_min,
+                                          GLint filtering_mag,
+                                          GLboolean has_mipmap,
+                                          GLint mipmap_min, GLint mipmap_mag)
+{
+    types::gltf_data data;
+    if (!gltf::load(path, data))
+        return types::gltf_data();
+
+    /* Decode in parallel every base color texture that is not on the
+     * GPU yet, textures are in glTF orientation already */
+    std::vector<int> images;
+    std::unordered_set<int> seen;
+    for (const auto &material : data.materials)
+    {
+        if (material.base_color_texture == -1)
+            continue;
+        int image = data.textures[material.base_color_texture];
+        if (image == -1 || !seen.insert(image).second)
+            continue;
+
+        std::uint64_t key = texture_cache::get_key(
+            gltf::get_image_key(data, image), wrapping, filtering_min,
+            filtering_mag, has_mipmap, mipmap_min, mipmap_mag, false);
+        if (!texture_cache::contains(key))
+            images.push_back(image);
+    }
+
+    /* External images are read in one batch, embedded ones are already
+     * in the buffers */
+    std::vector<std::string> files(images.size());
+    std::vector<std::string> external;
+    for (std::size_t i = 0; i < images.size(); i++)
+    {
+        const auto &image = data.images[images[i]];
+        if (!image.uri.empty())
+        {
+            files[i] =
+                texture::find_image(gltf::get_image_key(data, images[i]));
+            external.push_back(files[i]);
+        }
+        else
+            files[i] = image.mime_type == "image/jpeg" ? "embedded.jpg"
+                                                       : "embedded.png";
+    }
+    std::vector<types::asset> read = vfs::read_batch(external);
+
+    std::vector<types::asset> encoded(images.size());
+    for (std::size_t i = 0, next = 0; i < images.size(); i++)
+    {
+        const auto &image = data.images[images[i]];
+        if (!image.uri.empty())
+            encoded[i] = std::move(read[next++]);
+        else if (image.buffer_view != -1)
+        {
+            const auto &view = data.buffer_views[image.buffer_view];
+            encoded[i] = data.buffers[view.buffer].slice(view.offset,
+                                                         view.length);
+        }
+    }
+
+    thread_pool::parallel_for(images.size(),
+                              [&](std::size_t i)
+                              {
+                                  data.images[images[i]].decoded =
+                                      texture::decode_image(encoded[i],
+                                                            files[i], false);
+                              });
+    return data;
+}
+
+void gltf_model::upload(types::gltf_data &data)
+{
+    if (data.nodes.empty())
+        return;
+
+    /* Buffer views are bound as vertex or index buffers, never both */
+    std::vector<GLenum> targets(data.buffer_views.size(), 0);
+    for (const auto &mesh : data.meshes)
+    {
+        for (const auto &primitive : mesh.primitives)
+        {
+            for (int attribute : primitive.attributes)
+            {
+                int view = attribute == -1
+                               ? -1
+                               : data.accessors[attribute].buffer_view;
+                if (view != -1 && targets[view] == 0)
+                    targets[view] = GL_ARRAY_BUFFER;
+            }
+            if (primitive.indices != -1
+                && data.accessors[primitive.indices].buffer_view != -1)
+                targets[data.accessors[primitive.indices].buffer_view] =
+                    GL_ELEMENT_ARRAY_BUFFER;
+        }
+    }
+
+    /* Uploaded straight from the file, the element buffers must not
+     * be captured by a vertex array */
+    gl::bind_vertex_array(0);
+    std::vector<int> buffer_of(data.buffer_views.size(), -1);
+    for (std::size_t i = 0; i < data.buffer_views.size(); i++)
+    {
+        if (targets[i] == 0)
+            continue;
+
+        const auto &view = data.buffer_views[i];
+        types::buffer buffer(targets[i]);
+        buffer.copy_data(view.length,
+                         data.buffers[view.buffer].data() + view.offset,
+                         GL_STATIC_DRAW);
+        buffer.unbind();
+        buffer_of[i] = static_cast<int>(this->buffers.size());
+        this->buffers.push_back(std::move(buffer));
+    }
+
+    std::vector<std::uint16_t> remap;
+    if (!data.skins.empty())
+    {
+        if (data.skins.size() > 1)
+            WARN("glTF file {} has {} skins, only the first is used",
+                 data.path, data.skins.size());
+
+        this->skeleton = gltf::build_skeleton(data, 0, remap);
+        for (const auto &clip : gltf::build_animations(data, 0, remap))
+            this->animations.push_back(
+                animation_compression::compress(clip, this->skeleton));
+
+        /* The joints are relative to the parent of the root joint */
+        for (std::size_t i = 0; i < this->skeleton.joints.size(); i++)
+        {
+            if (this->skeleton.joints[i].parent != -1)
+                continue;
+            std::size_t joint = i;
+            if (!remap.empty())
+                joint = std::find(remap.begin(), remap.end(), i)
+                        - remap.begin();
+            int parent = data.nodes[data.skins[0].joints[joint]].parent;
+            if (parent != -1)
+                this->skeleton_transform = data.nodes[parent].world;
+            break;
+        }
+    }
+
+    /* Draws of every mesh */
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    for (const auto &mesh : data.meshes)
+    {
+        std::size_t first = this->draws.size();
+        for (const auto &primitive : mesh.primitives)
+        {
+            int position = primitive.attributes[types::GLTF_POSITION];
+            if (position == -1)
+                continue;
+
+            types::gltf_draw draw;
+            draw.mode = primitive.mode;
+            draw.count = data.accessors[position].count;
+            draw.skinned = !this->skeleton.joints.empty()
+                           && primitive.attributes[types::GLTF_JOINTS] != -1
+                           && primitive.attributes[types::GLTF_WEIGHTS] != -1;
+            draw.vertex_array.init();
+
+            for (unsigned int location = 0;
+                 location < types::GLTF_ATTRIBUTE_COUNT; location++)
+            {
+                int index = primitive.attributes[location];
+                if (index == -1 || data.accessors[index].buffer_view == -1)
+                    continue;
+
+                const auto &accessor = data.accessors[index];
+                if (location == types::GLTF_JOINTS && !remap.empty())
+                {
+                    /* The skeleton was reordered, so the joint indices
+                     * are the one attribute rewritten on the CPU */
+                    std::vector<std::uint32_t> joints =
+                        gltf::read_integers(data, index);
+                    std::vector<std::uint16_t> remapped(joints.size());
+                    for (std::size_t j = 0; j < joints.size(); j++)
+                        remapped[j] = joints[j] < remap.size()
+                                          ? remap[joints[j]]
+                                          : 0;
+
+                    types::buffer buffer(GL_ARRAY_BUFFER);
+                    buffer.copy_data(
+                        remapped.size() * sizeof(std::uint16_t),
+                        remapped.data(), GL_STATIC_DRAW);
+                    draw.vertex_array.set_vertex_data(
+                        buffer, location, accessor.components,
+                        GL_UNSIGNED_SHORT, GL_FALSE, 0, (void *) 0);
+                    this->buffers.push_back(std::move(buffer));
+                    continue;
+                }
+
+                int buffer = buffer_of[accessor.buffer_view];
+                if (targets[accessor.buffer_view] != GL_ARRAY_BUFFER)
+                {
+                    WARN("glTF buffer view {} holds vertices and indices",
+                         accessor.buffer_view);
+                    continue;
+                }
+                draw.vertex_array.set_vertex_data(
+                    this->buffers[buffer], location, accessor.components,
+                    accessor.component_type,
+                    accessor.normalized ? GL_TRUE : GL_FALSE,
+                    data.buffer_views[accessor.buffer_view].stride,
+                    (void *) accessor.offset);
+            }
+
+            if (primitive.indices != -1)
+            {
+                const auto &accessor = data.accessors[primitive.indices];
+                if (accessor.buffer_view == -1)
+                    continue;
+
+                draw.count = accessor.count;
+                draw.index_type = accessor.component_type;
+                draw.index_offset = accessor.offset;
+                draw.vertex_array.bind();
+                this->buffers[buffer_of[accessor.buffer_view]].bind();
+                draw.vertex_array.unbind();
+            }
+
+            draw.texture = load_texture(data, primitive.material);
+            this->draws.push_back(std::move(draw));
+        }
+        ranges.emplace_back(first, this->draws.size() - first);
+    }
+
+    for (const auto &node : data.nodes)
+    {
+        if (node.mesh == -1 || ranges[node.mesh].second == 0)
+            continue;
+        this->instances.push_back(
+            {node.world, ranges[node.mesh].first, ranges[node.mesh].second});
+    }
+    gl::bind_vertex_array(0);
+}
+
+unsigned int gltf_model::load_texture(types::gltf_data &data, int material)
+{
+    if (material == -1 || data.materials[material].base_color_texture == -1)
+        return 0;
+    int image = data.textures[data.materials[material].base_color_texture];
+    if (image == -1)
+        return 0;
+
+    /* Shared textures are decoded and uploaded once by the cache */
+    unsigned int id = texture_cache::load(
+        gltf::get_image_key(data, image), data.images[image].decoded,
+        this->wrapping, this->filtering_min, this->filtering_mag,
+        this->has_mipmap, this->mipmap_min, this->mipmap_mag, false);
+    this->textures_loaded.emplace_back(id);
+    return id;
+}
+
+void gltf_model::draw(types::shader_name_t shader,
+                      const glm::mat4 &model_matrix,
+                      std::span<const glm::mat4> palette)
+{
+    if (!palette.empty() && palette.size() < this->skeleton.joints.size())
+    {
+        ERROR("Palette has {} matrices, the skeleton has {} joints",
+              palette.size(), this->skeleton.joints.size());
+        palette = {};
+    }
+
+    bool bound = !palette.empty() && !this->skeleton.joints.empty()
+                 && skinning::uses_gpu_skinning();
+    if (bound)
+        skinning::bind_palette(shader, palette);
+
+    this->resolve_uniforms(shader);
+    // A packed mesh drawn before with the same shader may have left
+    // the decoding uniforms behind
+    if (mesh::uses_packed_vertices())
+    {
+        shader::set(this->pos_scale, glm::vec3(1.0f));
+        shader::set(this->pos_offset, glm::vec3(0.0f));
+        shader::set(this->oct_normals, false);
+    }
+
+    glm::mat4 skinned_matrix = model_matrix * this->skeleton_transform;
+    for (const auto &instance : this->instances)
+    {
+        glm::mat4 node_matrix = model_matrix * instance.transform;
+        for (std::size_t i = instance.first;
+             i < instance.first + instance.count; i++)
+        {
+            const auto &draw = this->draws[i];
+            uniform_buffers::set_object(draw.skinned ? skinned_matrix
+                                                     : node_matrix);
+            if (draw.texture != 0)
+            {
+                texture::active_texture(GL_TEXTURE0);
+                shader::set(this->diffuse_sampler, 0);
+                texture::bind_texture(GL_TEXTURE_2D, draw.texture,
+                                      this->wrapping, this->filtering_min,
+                                      this->filtering_mag, this->has_mipmap,
+                                      this->mipmap_min, this->mipmap_mag);
+            }
+
+            draw.vertex_array.bind();
+            if (draw.index_type != 0)
+                gl::draw_elements(draw.mode, draw.count, draw.index_type,
+                                  (const void *) draw.index_offset);
+            else
+                gl::draw_arrays(draw.mode, 0, draw.count);
+        }
+    }
+    gl::bind_vertex_array(0);
+
+    if (bound)
+        skinning::unbind_palette(shader);
+}
+
+void gltf_model::resolve_uniforms(const types::shader_name_t &shader)
+{
+    if (shader == this->uniforms_shader)
+        return;
+
+    this->uniforms_shader = shader;
+    this->diffuse_sampler =
+        shader::get_uniform<int>(shader, "material.texture_diffuse1");
+    this->pos_scale = shader::get_uniform<glm::vec3>(shader, "posScale");
+    this->pos_offset = shader::get_uniform<glm::vec3>(shader, "posOffset");
+    this->oct_normals = shader::get_uniform<bool>(shader, "octNormals");
+}
+
+bool gltf_model::has_skeleton() const
+{
+    return !this->skeleton.joints.empty();
+}
+
+const types::skeleton &gltf_model::get_skeleton() const
+{
+    return this->skeleton;
+}
+
+const std::vector<types::compressed_clip> &gltf_model::get_animations() const
+{
+    return this->animations;
+}
+
+const types::compressed_clip *
+gltf_model::find_animation(const std::string &name) const
+{
+    for (const auto &clip : this->animations)
+    {
+        if (clip.name == name)
+            return &clip;
+    }
+    return nullptr;
+}
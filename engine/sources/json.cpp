@@ -0,0 +1,366 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "json.hpp"
+
+#include <charconv>
+#include <cstdint>
+
+using namespace brenta;
+using namespace brenta::types;
+
+namespace
+{
+
+const json null_value;
+const std::string empty_string;
+
+void skip_whitespace(const char *&p, const char *end)
+{
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        p++;
+}
+
+bool parse_hex(const char *&p, const char *end, std::uint32_t &out)
+{
+    if (end - p < 4)
+        return false;
+    auto result = std::from_chars(p, p + 4, out, 16);
+    if (result.ptr != p + 4)
+        return false;
+    p += 4;
+    return true;
+}
+
+void append_utf8(std::string &out, std::uint32_t code)
+{
+    if (code < 0x80)
+        out += (char) code;
+    else if (code < 0x800)
+    {
+        out += (char) (0xC0 | (code >> 6));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+        out += (char) (0xE0 | (code >> 12));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+    else
+    {
+        out += (char) (0xF0 | (code >> 18));
+        out += (char) (0x80 | ((code >> 12) & 0x3F));
+        out += (char) (0x80 | ((code >> 6) & 0x3F));
+        out += (char) (0x80 | (code & 0x3F));
+    }
+}
+
+bool match(const char *&p, const char *end, std::string_view word)
+{
+    if ((std::size_t) (end - p) < word.size()
+        || std::string_view(p, word.size()) != word)
+        return false;
+    p += word.size();
+    return true;
+}
+
+} // namespace
+
+bool json::parse(std::string_view text, json &out)
+{
+    const char *p = text.data();
+    const char *end = p + text.size();
+    out = json();
+    skip_whitespace(p, end);
+    if (!parse_value(p, end, out, 0))
+        return false;
+    skip_whitespace(p, end);
+    return p == end;
+}
+
+bool json::parse_value(const char *&p, const char *end, json &out,
+                       unsigned int depth)
+{
+    if (p == end || depth > max_depth)
+        return false;
+
+    switch (*p)
+    {
+    case '{':
+    {
+        out.type = enums::JSON_OBJECT;
+        p++;
+        skip_whitespace(p, end);
+        if (p != end && *p == '}')
+        {
+            p++;
+            return true;
+        }
+        while (true)
+        {
+            skip_whitespace(p, end);
+            std::pair<std::string, json> member;
+            if (!parse_string(p, end, member.first))
+                return false;
+            skip_whitespace(p, end);
+            if (p == end || *p++ != ':')
+                return false;
+            skip_whitespace(p, end);
+            if (!parse_value(p, end, member.second, depth + 1))
+                return false;
+            out.members.push_back(std::move(member));
+            skip_whitespace(p, end);
+            if (p == end)
+                return false;
+            if (*p == '}')
+            {
+                p++;
+                return true;
+            }
+            if (*p++ != ',')
+                return false;
+        }
+    }
+    case '[':
+    {
+        out.type = enums::JSON_ARRAY;
+        p++;
+        skip_whitespace(p, end);
+        if (p != end && *p == ']')
+        {
+            p++;
+            return true;
+        }
+        while (true)
+        {
+            skip_whitespace(p, end);
+            out.elements.emplace_back();
+            if (!parse_value(p, end, out.elements.back(), depth + 1))
+                return false;
+            skip_whitespace(p, end);
+            if (p == end)
+                return false;
+            if (*p == ']')
+            {
+                p++;
+                return true;
+            }
+            if (*p++ != ',')
+                return false;
+        }
+    }
+    case '"':
+        out.type = enums::JSON_STRING;
+        return parse_string(p, end, out.string);
+    case 't':
+        out.type = enums::JSON_BOOLEAN;
+        out.boolean = true;
+        return match(p, end, "true");
+    case 'f':
+        out.type = enums::JSON_BOOLEAN;
+        out.boolean = false;
+        return match(p, end, "false");
+    case 'n':
+        out.type = enums::JSON_NULL;
+        return match(p, end, "null");
+    default:
+    {
+        /* from_chars is laxer than JSON about the form of numbers,
+         * which does no harm when reading */
+        auto result = std::from_chars(p, end, out.number);
+        if (result.ec != std::errc() || result.ptr == p)
+            return false;
+        out.type = enums::JSON_NUMBER;
+        p = result.ptr;
+        return true;
+    }
+    }
+}
+
+bool json::parse_string(const char *&p, const char *end, std::string &out)
+{
+    if (p == end || *p != '"')
+        return false;
+    p++;
+    while (p != end && *p != '"')
+    {
+        if ((unsigned char) *p < 0x20)
+            return false;
+        if (*p != '\\')
+        {
+            out += *p++;
+            continue;
+        }
+
+        if (++p == end)
+            return false;
+        char escape = *p++;
+        switch (escape)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            out += escape;
+            break;
+        case 'b':
+            out += '\b';
+            break;
+        case 'f':
+            out += '\f';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 'r':
+            out += '\r';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'u':
+        {
+            std::uint32_t code;
+            if (!parse_hex(p, end, code))
+                return false;
+            /* Characters outside the BMP come as a surrogate pair */
+            if (code >= 0xD800 && code < 0xDC00)
+            {
+                std::uint32_t low;
+                if (!match(p, end, "\\u") || !parse_hex(p, end, low)
+                    || low < 0xDC00 || low >= 0xE000)
+                    return false;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            append_utf8(out, code);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    if (p == end)
+        return false;
+    p++;
+    return true;
+}
+
+enums::json_type json::get_type() const
+{
+    return this->type;
+}
+
+bool json::is_null() const
+{
+    return this->type == enums::JSON_NULL;
+}
+
+bool json::is_number() const
+{
+    return this->type == enums::JSON_NUMBER;
+}
+
+bool json::is_string() const
+{
+    return this->type == enums::JSON_STRING;
+}
+
+bool json::is_array() const
+{
+    return this->type == enums::JSON_ARRAY;
+}
+
+bool json::is_object() const
+{
+    return this->type == enums::JSON_OBJECT;
+}
+
+bool json::contains(std::string_view key) const
+{
+    for (const auto &member : this->members)
+    {
+        if (member.first == key)
+            return true;
+    }
+    return false;
+}
+
+const json &json::operator[](std::string_view key) const
+{
+    for (const auto &member : this->members)
+    {
+        if (member.first == key)
+            return member.second;
+    }
+    return null_value;
+}
+
+const json &json::operator[](std::size_t index) const
+{
+    if (index >= this->elements.size())
+        return null_value;
+    return this->elements[index];
+}
+
+std::size_t json::size() const
+{
+    return this->type == enums::JSON_OBJECT ? this->members.size()
+                                            : this->elements.size();
+}
+
+bool json::as_bool(bool fallback) const
+{
+    return this->type == enums::JSON_BOOLEAN ? this->boolean : fallback;
+}
+
+double json::as_number(double fallback) const
+{
+    return this->type == enums::JSON_NUMBER ? this->number : fallback;
+}
+
+long long json::as_int(long long fallback) const
+{
+    /* The comparisons are false for NaN too */
+    if (this->type != enums::JSON_NUMBER || !(this->number >= -9.0e18)
+        || !(this->number <= 9.0e18))
+        return fallback;
+    return (long long) this->number;
+}
+
+const std::string &json::as_string() const
+{
+    return this->type == enums::JSON_STRING ? this->string : empty_string;
+}
+
+const std::vector<json> &json::get_elements() const
+{
+    return this->elements;
+}
+
+const std::vector<std::pair<std::string, json>> &json::get_members() const
+{
+    return this->members;
+}
@@ -0,0 +1,98 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "lod_selector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace brenta;
+
+float lod_selector::threshold = 1.0f;
+float lod_selector::hysteresis = 0.25f;
+
+void lod_selector::set_threshold(float pixels)
+{
+    lod_selector::threshold = std::max(pixels, 0.0f);
+}
+
+float lod_selector::get_threshold()
+{
+    return threshold;
+}
+
+void lod_selector::set_hysteresis(float hysteresis)
+{
+    lod_selector::hysteresis = std::clamp(hysteresis, 0.0f, 0.9f);
+}
+
+float lod_selector::get_hysteresis()
+{
+    return hysteresis;
+}
+
+float lod_selector::pixels_per_unit(const glm::mat4 &model,
+                                    const glm::mat4 &view,
+                                    const glm::mat4 &projection,
+                                    glm::vec3 center, float radius,
+                                    float viewport_height)
+{
+    /* The largest axis scale bounds how much the model is stretched */
+    float scale = std::max(glm::length(glm::vec3(model[0])),
+                           std::max(glm::length(glm::vec3(model[1])),
+                                    glm::length(glm::vec3(model[2]))));
+    float focal = projection[1][1] * viewport_height * 0.5f * scale;
+
+    /* Orthographic projections do not depend on the distance */
+    if (projection[3][3] == 1.0f)
+        return focal;
+
+    glm::vec3 eye = glm::vec3(view * model * glm::vec4(center, 1.0f));
+    float distance = glm::length(eye) - radius * scale;
+    if (distance <= 0.0f)
+        return INFINITY;
+    /* The camera looks down -z */
+    if (eye.z > radius * scale)
+        return 0.0f;
+    return focal / distance;
+}
+
+unsigned int lod_selector::select(std::span<const float> errors,
+                                  float pixels_per_unit, unsigned int current)
+{
+    if (errors.empty())
+        return 0;
+    current = std::min<unsigned int>(current, errors.size() - 1);
+
+    float coarser = threshold * (1.0f - hysteresis);
+    float finer = threshold * (1.0f + hysteresis);
+    while (current + 1 < errors.size()
+           && errors[current + 1] * pixels_per_unit < coarser)
+        current++;
+    while (current > 0 && errors[current] * pixels_per_unit > finer)
+        current--;
+    return current;
+}
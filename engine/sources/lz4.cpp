@@ -0,0 +1,196 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "lz4.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+using namespace brenta;
+
+namespace
+{
+
+constexpr std::size_t min_match = 4;
+/* The last match must start this many bytes before the end */
+constexpr std::size_t match_limit = 12;
+/* The last bytes of a block are always literals */
+constexpr std::size_t last_literals = 5;
+constexpr std::size_t max_offset = 65535;
+constexpr unsigned int hash_bits = 16;
+
+std::uint32_t read32(const unsigned char *p)
+{
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::uint32_t hash_sequence(std::uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - hash_bits);
+}
+
+void write_length(std::vector<unsigned char> &out, std::size_t length)
+{
+    while (length >= 255)
+    {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<unsigned char>(length));
+}
+
+void write_sequence(std::vector<unsigned char> &out, const unsigned char *src,
+                    std::size_t literals, std::size_t offset,
+                    std::size_t match_length)
+{
+    std::size_t match_code = match_length - min_match;
+    unsigned char token =
+        static_cast<unsigned char>((literals < 15 ? literals : 15) << 4);
+    if (match_length > 0)
+        token |= static_cast<unsigned char>(match_code < 15 ? match_code : 15);
+    out.push_back(token);
+    if (literals >= 15)
+        write_length(out, literals - 15);
+    out.insert(out.end(), src, src + literals);
+
+    if (match_length == 0)
+        return;
+    out.push_back(static_cast<unsigned char>(offset & 0xff));
+    out.push_back(static_cast<unsigned char>(offset >> 8));
+    if (match_code >= 15)
+        write_length(out, match_code - 15);
+}
+
+bool read_length(std::span<const unsigned char> in, std::size_t &ip,
+                 std::size_t &length)
+{
+    unsigned char byte;
+    do
+    {
+        if (ip >= in.size())
+            return false;
+        byte = in[ip++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+} // namespace
+
+std::size_t lz4::max_compressed_size(std::size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+void lz4::compress(std::span<const unsigned char> input,
+                   std::vector<unsigned char> &output)
+{
+    output.clear();
+    output.reserve(max_compressed_size(input.size()));
+
+    const unsigned char *src = input.data();
+    std::size_t size = input.size();
+    std::size_t anchor = 0;
+
+    if (size > match_limit)
+    {
+        /* Positions plus one, so that zero means empty */
+        std::vector<std::uint32_t> table(1u << hash_bits, 0);
+        std::size_t ip = 0;
+        while (ip < size - match_limit)
+        {
+            std::uint32_t sequence = read32(src + ip);
+            std::uint32_t &slot = table[hash_sequence(sequence)];
+            std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(ip + 1);
+
+            if (candidate == 0 || ip - (candidate - 1) > max_offset
+                || read32(src + candidate - 1) != sequence)
+            {
+                ip++;
+                continue;
+            }
+
+            std::size_t ref = candidate - 1;
+            std::size_t length = min_match;
+            while (ip + length < size - last_literals
+                   && src[ref + length] == src[ip + length])
+                length++;
+
+            write_sequence(output, src + anchor, ip - anchor, ip - ref,
+                           length);
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    write_sequence(output, src + anchor, size - anchor, 0, 0);
+}
+
+bool lz4::decompress(std::span<const unsigned char> input,
+                     std::span<unsigned char> output)
+{
+    std::size_t ip = 0;
+    std::size_t op = 0;
+    while (ip < input.size())
+    {
+        unsigned char token = input[ip++];
+
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !read_length(input, ip, literals))
+            return false;
+        if (literals > input.size() - ip || literals > output.size() - op)
+            return false;
+        std::memcpy(output.data() + op, input.data() + ip, literals);
+        ip += literals;
+        op += literals;
+
+        /* The last sequence has no match */
+        if (ip == input.size())
+            break;
+
+        if (input.size() - ip < 2)
+            return false;
+        std::size_t offset = input[ip] | (input[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return false;
+
+        std::size_t length = token & 15;
+        if (length == 15 && !read_length(input, ip, length))
+            return false;
+        length += min_match;
+        if (length > output.size() - op)
+            return false;
+
+        /* Matches may overlap their own output */
+        for (std::size_t i = 0; i < length; i++, op++)
+            output[op] = output[op - offset];
+    }
+    return op == output.size();
+}
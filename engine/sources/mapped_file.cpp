@@ -0,0 +1,122 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mapped_file.hpp"
+
+#include "engine_logger.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace brenta::types;
+
+mapped_file::mapped_file(const std::string &path)
+{
+    open(path);
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+mapped_file::mapped_file(mapped_file &&other) noexcept
+{
+    this->ptr = other.ptr;
+    this->length = other.length;
+    other.ptr = nullptr;
+    other.length = 0;
+}
+
+mapped_file &mapped_file::operator=(mapped_file &&other) noexcept
+{
+    if (this != &other)
+    {
+        close();
+        this->ptr = other.ptr;
+        this->length = other.length;
+        other.ptr = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+bool mapped_file::open(const std::string &path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr =
+        mmap(nullptr, (std::size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* The mapping stays valid after the descriptor is closed */
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        ERROR("Could not map file: {}", path);
+        return false;
+    }
+
+    this->ptr = static_cast<const unsigned char *>(addr);
+    this->length = (std::size_t) st.st_size;
+    return true;
+}
+
+void mapped_file::close()
+{
+    if (this->ptr != nullptr)
+    {
+        munmap((void *) this->ptr, this->length);
+    }
+    this->ptr = nullptr;
+    this->length = 0;
+}
+
+bool mapped_file::is_open() const
+{
+    return this->ptr != nullptr;
+}
+
+const unsigned char *mapped_file::data() const
+{
+    return this->ptr;
+}
+
+std::size_t mapped_file::size() const
+{
+    return this->length;
+}
@@ -26,24 +26,52 @@
 
 #include "mesh.hpp"
 
+#include "cluster_culler.hpp"
 #include "engine_logger.hpp"
+#include "skinning.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
 #include <iostream>
+#include <limits>
 
 using namespace brenta;
 
+bool mesh::packed_vertices = false;
+bool mesh::keep_cpu_data = true;
+
 mesh::mesh(std::vector<types::vertex> vertices,
            std::vector<unsigned int> indices,
            std::vector<types::texture> textures, GLint wrapping,
            GLint filtering_min, GLint filtering_mag, GLboolean has_mipmap,
            GLint mipmap_min, GLint mipmap_max)
 {
-    this->vao.init();
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
-    this->vbo = types::buffer(GL_ARRAY_BUFFER);
-    this->ebo = types::buffer(GL_ELEMENT_ARRAY_BUFFER);
+    this->textures = std::move(textures);
+    this->wrapping = wrapping;
+    this->filtering_min = filtering_min;
+    this->filtering_mag = filtering_mag;
+    this->has_mipmap = has_mipmap;
+    this->mipmap_min = mipmap_min;
+    this->mipmap_mag = mipmap_max;
+
+    setup_mesh(vertices, indices);
+
+    if (mesh::keep_cpu_data)
+    {
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+    }
+}
+
+mesh::mesh(std::span<const types::vertex> vertices,
+           std::span<const unsigned int> indices,
+           std::vector<types::texture> textures, GLint wrapping,
+           GLint filtering_min, GLint filtering_mag, GLboolean has_mipmap,
+           GLint mipmap_min, GLint mipmap_max,
+           std::span<const types::vertex_skin> skin)
+{
+    this->textures = std::move(textures);
     this->wrapping = wrapping;
     this->filtering_min = filtering_min;
     this->filtering_mag = filtering_mag;
@@ -51,29 +79,47 @@ mesh::mesh(std::vector<types::vertex> vertices,
     this->mipmap_min = mipmap_min;
     this->mipmap_mag = mipmap_max;
 
-    setup_mesh();
+    setup_mesh(vertices, indices, skin);
 }
 
-void mesh::draw(types::shader_name_t shader_name)
+void mesh::draw(types::shader_name_t shader_name, unsigned int lod,
+                const types::cluster_frustum *frustum,
+                std::span<const glm::mat4> palette)
 {
-    if (this->vao.get_vao() == 0)
+    bool in_arena = this->range.is_valid();
+    if (!in_arena && this->vao.vao_id == 0)
     {
         ERROR("Mesh not initialized");
         return;
     }
 
-    unsigned int diffuseNr = 1;
-    unsigned int specularNr = 1;
+    unsigned int first = 0;
+    unsigned int count = this->num_indices;
+    if (!this->lods.empty())
+    {
+        lod = std::min<std::size_t>(lod, lods.size() - 1);
+        first = this->lods[lod].index_offset;
+        count = this->lods[lod].index_count;
+    }
+    else
+        lod = 0;
+
+    /* The meshlets cover the finest level only */
+    static std::vector<types::index_range> ranges;
+    bool culled = frustum != nullptr && lod == 0 && !this->meshlets.empty()
+                  && cluster_culler::is_enabled();
+    if (culled)
+    {
+        cluster_culler::cull(this->meshlets, *frustum, ranges);
+        if (ranges.empty())
+            return;
+    }
+
+    const auto &uniforms = this->resolve_uniforms(shader_name);
     for (unsigned int i = 0; i < this->textures.size(); i++)
     {
         texture::active_texture(GL_TEXTURE0 + i);
-        std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
-            number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
-            number = std::to_string(specularNr++);
-        shader::set_int(shader_name, ("material." + name + number).c_str(), i);
+        shader::set(uniforms.samplers[i], static_cast<int>(i));
         texture::bind_texture(GL_TEXTURE_2D, textures[i].id, this->wrapping,
                               this->filtering_min, this->filtering_mag,
                               this->has_mipmap, this->mipmap_min,
@@ -81,47 +127,375 @@ void mesh::draw(types::shader_name_t shader_name)
     }
     texture::active_texture(GL_TEXTURE0);
 
-    // draw mesh
-    this->vao.bind();
-    gl::draw_elements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0);
-    this->vao.unbind();
+    // Float meshes reset the decoding uniforms that a packed mesh
+    // drawn before with the same shader may have left behind
+    if (this->packed || mesh::packed_vertices)
+    {
+        shader::set(uniforms.pos_scale, this->pos_scale);
+        shader::set(uniforms.pos_offset, this->pos_offset);
+        shader::set(uniforms.oct_normals, this->packed);
+    }
+
+    std::size_t index_size = this->index_type == GL_UNSIGNED_SHORT
+                                 ? sizeof(std::uint16_t)
+                                 : sizeof(std::uint32_t);
+
+    // draw mesh, meshes in the arena leave their page bound for the
+    // next ones
+    std::size_t index_start = 0;
+    GLint base_vertex = 0;
+    if (in_arena)
+    {
+        geometry_arena::bind(this->range);
+        index_start = this->range.index_offset;
+        base_vertex = this->range.base_vertex;
+    }
+    else
+        this->vao.bind();
+
+    /* CPU skinning, without a palette the bind pose stays uploaded */
+    if (!this->bind_vertices.empty() && !palette.empty())
+    {
+        skinning::skin_vertices(this->bind_vertices, this->skin, palette,
+                                this->skinned_vertices);
+        this->vbo.copy_sub_data(
+            0, this->skinned_vertices.size() * sizeof(types::vertex),
+            this->skinned_vertices.data());
+    }
+
+    if (culled)
+    {
+        static std::vector<GLsizei> counts;
+        static std::vector<const void *> offsets;
+        static std::vector<GLint> base_vertices;
+        counts.clear();
+        offsets.clear();
+        for (auto &range : ranges)
+        {
+            counts.push_back(range.count);
+            offsets.push_back(
+                (const void *) (index_start + range.offset * index_size));
+        }
+        if (in_arena)
+        {
+            base_vertices.assign(counts.size(), base_vertex);
+            gl::multi_draw_elements_base_vertex(
+                GL_TRIANGLES, counts.data(), this->index_type, offsets.data(),
+                counts.size(), base_vertices.data());
+        }
+        else
+            gl::multi_draw_elements(GL_TRIANGLES, counts.data(),
+                                    this->index_type, offsets.data(),
+                                    counts.size());
+    }
+    else if (in_arena)
+    {
+        gl::draw_elements_base_vertex(
+            GL_TRIANGLES, count, this->index_type,
+            (void *) (index_start + first * index_size), base_vertex);
+    }
+    else
+    {
+        gl::draw_elements(GL_TRIANGLES, count, this->index_type,
+                          (void *) (first * index_size));
+    }
 
     texture::active_texture(GL_TEXTURE0);
 }
 
-void mesh::setup_mesh()
+const types::mesh_uniforms &
+mesh::resolve_uniforms(const types::shader_name_t &shader_name)
+{
+    auto &u = this->uniforms;
+    if (u.shader == shader_name && u.samplers.size() == this->textures.size())
+        return u;
+
+    u.shader = shader_name;
+    u.samplers.clear();
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    for (const auto &texture : this->textures)
+    {
+        std::string number;
+        if (texture.type == "texture_diffuse")
+            number = std::to_string(diffuseNr++);
+        else if (texture.type == "texture_specular")
+            number = std::to_string(specularNr++);
+        u.samplers.push_back(shader::get_uniform<int>(
+            shader_name, "material." + texture.type + number));
+    }
+    u.pos_scale = shader::get_uniform<glm::vec3>(shader_name, "posScale");
+    u.pos_offset = shader::get_uniform<glm::vec3>(shader_name, "posOffset");
+    u.oct_normals = shader::get_uniform<bool>(shader_name, "octNormals");
+    return u;
+}
+
+void mesh::setup_mesh(std::span<const types::vertex> vertices,
+                      std::span<const unsigned int> indices,
+                      std::span<const types::vertex_skin> skin)
 {
-    this->vbo.copy_vertices(this->vertices.size() * sizeof(types::vertex),
-                            &this->vertices[0], GL_STATIC_DRAW);
-    this->ebo.copy_indices(this->indices.size() * sizeof(unsigned int),
-                           &this->indices[0], GL_STATIC_DRAW);
-    this->vao.set_vertex_data(this->vbo, 0, 3, GL_FLOAT, GL_FALSE,
-                              sizeof(types::vertex), (void *) 0);
-    this->vao.set_vertex_data(this->vbo, 1, 3, GL_FLOAT, GL_FALSE,
-                              sizeof(types::vertex),
-                              (void *) offsetof(types::vertex, normal));
-    this->vao.set_vertex_data(this->vbo, 2, 2, GL_FLOAT, GL_FALSE,
-                              sizeof(types::vertex),
-                              (void *) offsetof(types::vertex, tex_coords));
+    this->num_indices = indices.size();
+    this->skinned = !skin.empty() && skin.size() == vertices.size();
+    bool cpu_skinned = this->skinned && !skinning::uses_gpu_skinning();
 
+    // 16 bit indices are enough to address every vertex
+    std::vector<std::uint16_t> short_indices;
+    std::span<const std::byte> index_data = std::as_bytes(indices);
+    if (vertices.size() <= std::numeric_limits<std::uint16_t>::max() + 1)
+    {
+        short_indices.assign(indices.begin(), indices.end());
+        this->index_type = GL_UNSIGNED_SHORT;
+        index_data = std::as_bytes(std::span(short_indices));
+    }
+    else
+    {
+        this->index_type = GL_UNSIGNED_INT;
+    }
+
+    std::vector<types::packed_vertex> compact;
+    std::span<const std::byte> vertex_data = std::as_bytes(vertices);
+    // CPU skinned vertices are rewritten every frame, so they stay
+    // in the float format
+    this->packed = mesh::packed_vertices && !vertices.empty() && !cpu_skinned;
+    if (this->packed)
+    {
+        glm::vec3 min = vertices[0].position;
+        glm::vec3 max = vertices[0].position;
+        for (const auto &vertex : vertices)
+        {
+            min = glm::min(min, vertex.position);
+            max = glm::max(max, vertex.position);
+        }
+        glm::vec3 scale = max - min;
+        for (int i = 0; i < 3; i++)
+        {
+            if (scale[i] <= 0.0f)
+                scale[i] = 1.0f;
+        }
+        this->pos_scale = scale;
+        this->pos_offset = min;
+
+        compact.resize(vertices.size());
+        std::transform(vertices.begin(), vertices.end(), compact.begin(),
+                       [&](const types::vertex &vertex)
+                       { return mesh::pack_vertex(vertex, scale, min); });
+        vertex_data = std::as_bytes(std::span(compact));
+    }
+
+    if (geometry_arena::is_enabled() && !this->skinned)
+    {
+        this->range = geometry_arena::allocate(vertex_data, vertices.size(),
+                                               this->packed, index_data);
+        if (this->range.is_valid())
+            return;
+    }
+
+    this->vao.init();
+    this->vbo = types::buffer(GL_ARRAY_BUFFER);
+    this->ebo = types::buffer(GL_ELEMENT_ARRAY_BUFFER);
+    this->ebo.copy_indices(index_data.size(), index_data.data(),
+                           GL_STATIC_DRAW);
+    this->vbo.copy_vertices(vertex_data.size(), vertex_data.data(),
+                            cpu_skinned ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    mesh::set_vertex_format(this->vao, this->vbo, this->packed);
+
+    if (cpu_skinned)
+    {
+        this->bind_vertices.assign(vertices.begin(), vertices.end());
+        this->skin.assign(skin.begin(), skin.end());
+        this->skinned_vertices.resize(vertices.size());
+    }
+    else if (this->skinned)
+    {
+        this->skin_vbo = types::buffer(GL_ARRAY_BUFFER);
+        this->skin_vbo.copy_vertices(skin.size_bytes(), skin.data(),
+                                     GL_STATIC_DRAW);
+        this->vao.set_vertex_data(
+            this->skin_vbo, 3, 4, GL_UNSIGNED_SHORT, GL_FALSE,
+            sizeof(types::vertex_skin),
+            (void *) offsetof(types::vertex_skin, joints));
+        this->vao.set_vertex_data(
+            this->skin_vbo, 4, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+            sizeof(types::vertex_skin),
+            (void *) offsetof(types::vertex_skin, weights));
+    }
     gl::bind_vertex_array(0);
 }
 
+void mesh::set_vertex_format(types::vao &vao, const types::buffer &vbo,
+                             bool packed)
+{
+    if (!packed)
+    {
+        vao.set_vertex_data(vbo, 0, 3, GL_FLOAT, GL_FALSE,
+                            sizeof(types::vertex), (void *) 0);
+        vao.set_vertex_data(vbo, 1, 3, GL_FLOAT, GL_FALSE,
+                            sizeof(types::vertex),
+                            (void *) offsetof(types::vertex, normal));
+        vao.set_vertex_data(vbo, 2, 2, GL_FLOAT, GL_FALSE,
+                            sizeof(types::vertex),
+                            (void *) offsetof(types::vertex, tex_coords));
+        return;
+    }
+
+    vao.set_vertex_data(vbo, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE,
+                        sizeof(types::packed_vertex),
+                        (void *) offsetof(types::packed_vertex, position));
+    vao.set_vertex_data(vbo, 1, 2, GL_SHORT, GL_TRUE,
+                        sizeof(types::packed_vertex),
+                        (void *) offsetof(types::packed_vertex, normal));
+    vao.set_vertex_data(vbo, 2, 2, GL_HALF_FLOAT, GL_FALSE,
+                        sizeof(types::packed_vertex),
+                        (void *) offsetof(types::packed_vertex, tex_coords));
+}
+
+void mesh::set_lods(std::vector<types::mesh_lod> lods)
+{
+    this->lods = std::move(lods);
+}
+
+const std::vector<types::mesh_lod> &mesh::get_lods() const
+{
+    return this->lods;
+}
+
+void mesh::set_meshlets(std::vector<types::meshlet> meshlets)
+{
+    this->meshlets = std::move(meshlets);
+}
+
+const std::vector<types::meshlet> &mesh::get_meshlets() const
+{
+    return this->meshlets;
+}
+
+bool mesh::is_skinned() const
+{
+    return this->skinned;
+}
+
+unsigned int mesh::get_vertex_array() const
+{
+    if (this->range.is_valid())
+        return geometry_arena::get_vertex_array(this->range);
+    return this->vao.get_vao();
+}
+
+void mesh::set_packed_vertices(bool enabled)
+{
+    mesh::packed_vertices = enabled;
+}
+
+bool mesh::uses_packed_vertices()
+{
+    return mesh::packed_vertices;
+}
+
+void mesh::set_keep_cpu_data(bool keep)
+{
+    mesh::keep_cpu_data = keep;
+}
+
+bool mesh::keeps_cpu_data()
+{
+    return mesh::keep_cpu_data;
+}
+
+static glm::vec2 sign_not_zero(glm::vec2 v)
+{
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+glm::vec2 mesh::encode_octahedral(glm::vec3 normal)
+{
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 <= 0.0f)
+        return glm::vec2(0.0f);
+
+    glm::vec2 p = glm::vec2(normal.x, normal.y) / l1;
+    if (normal.z < 0.0f)
+    {
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * sign_not_zero(p);
+    }
+    return p;
+}
+
+glm::vec3 mesh::decode_octahedral(glm::vec2 encoded)
+{
+    glm::vec3 n = glm::vec3(encoded.x, encoded.y,
+                            1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+    if (n.z < 0.0f)
+    {
+        glm::vec2 xy = (1.0f - glm::abs(glm::vec2(n.y, n.x)))
+                       * sign_not_zero(glm::vec2(n.x, n.y));
+        n.x = xy.x;
+        n.y = xy.y;
+    }
+    return glm::normalize(n);
+}
+
+types::packed_vertex mesh::pack_vertex(const types::vertex &vertex,
+                                       glm::vec3 scale, glm::vec3 offset)
+{
+    types::packed_vertex packed = {};
+
+    glm::vec3 position =
+        glm::clamp((vertex.position - offset) / scale, 0.0f, 1.0f);
+    for (int i = 0; i < 3; i++)
+    {
+        packed.position[i] =
+            static_cast<std::uint16_t>(std::lround(position[i] * 65535.0f));
+    }
+
+    glm::vec2 normal = mesh::encode_octahedral(vertex.normal);
+    for (int i = 0; i < 2; i++)
+    {
+        packed.normal[i] = static_cast<std::int16_t>(
+            std::lround(glm::clamp(normal[i], -1.0f, 1.0f) * 32767.0f));
+    }
+
+    packed.tex_coords[0] = glm::packHalf1x16(vertex.tex_coords.x);
+    packed.tex_coords[1] = glm::packHalf1x16(vertex.tex_coords.y);
+
+    return packed;
+}
+
 mesh::builder &mesh::builder::set_vertices(std::vector<types::vertex> vertices)
 {
-    this->vertices = vertices;
+    this->vertices = std::move(vertices);
     return *this;
 }
 
 mesh::builder &mesh::builder::set_indices(std::vector<unsigned int> indices)
 {
-    this->indices = indices;
+    this->indices = std::move(indices);
+    return *this;
+}
+
+mesh::builder &
+mesh::builder::set_vertex_span(std::span<const types::vertex> vertices)
+{
+    this->vertex_span = vertices;
+    return *this;
+}
+
+mesh::builder &
+mesh::builder::set_index_span(std::span<const unsigned int> indices)
+{
+    this->index_span = indices;
+    return *this;
+}
+
+mesh::builder &
+mesh::builder::set_skin_span(std::span<const types::vertex_skin> skin)
+{
+    this->skin_span = skin;
     return *this;
 }
 
 mesh::builder &mesh::builder::set_textures(std::vector<types::texture> textures)
 {
-    this->textures = textures;
+    this->textures = std::move(textures);
     return *this;
 }
 
@@ -155,9 +529,28 @@ mesh::builder &mesh::builder::set_mipmap_min(GLint mipmap_min)
     return *this;
 }
 
+mesh::builder &mesh::builder::set_mipmap_mag(GLint mipmap_mag)
+{
+    this->mipmap_mag = mipmap_mag;
+    return *this;
+}
+
 mesh mesh::builder::build()
 {
-    return mesh(this->vertices, this->indices, this->textures, this->wrapping,
-                this->filtering_min, this->filtering_mag, this->has_mipmap,
-                this->mipmap_min, this->mipmap_mag);
+    if (!this->vertex_span.empty() || !this->index_span.empty()
+        || !this->skin_span.empty())
+    {
+        std::span<const types::vertex> vertices =
+            this->vertex_span.empty() ? this->vertices : this->vertex_span;
+        std::span<const unsigned int> indices =
+            this->index_span.empty() ? this->indices : this->index_span;
+        return mesh(vertices, indices, std::move(this->textures),
+                    this->wrapping, this->filtering_min, this->filtering_mag,
+                    this->has_mipmap, this->mipmap_min, this->mipmap_mag,
+                    this->skin_span);
+    }
+    return mesh(std::move(this->vertices), std::move(this->indices),
+                std::move(this->textures), this->wrapping, this->filtering_min,
+                this->filtering_mag, this->has_mipmap, this->mipmap_min,
+                this->mipmap_mag);
 }
@@ -0,0 +1,396 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh_cache.hpp"
+
+#include "engine_hash.hpp"
+#include "engine_logger.hpp"
+#include "vfs.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace brenta;
+
+bool mesh_cache::enabled = false;
+std::string mesh_cache::directory;
+
+namespace
+{
+
+/*
+ * Layout of a cache file:
+ *
+ * file_header
+ * mesh_entry[mesh_count]
+ * for each mesh, aligned to blob_alignment:
+ *     vertex blob, index blob, lod table, meshlet table, texture table
+ *
+ * The lod and meshlet tables are arrays of types::mesh_lod and
+ * types::meshlet. The texture table is a
+ * sequence of (u32 type length, u32 path length, type chars, path
+ * chars). All offsets are from the start of the file.
+ */
+
+constexpr char cache_magic[4] = {'B', 'R', 'M', 'C'};
+constexpr std::uint64_t blob_alignment = 16;
+
+struct file_header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t import_flags;
+    std::uint32_t vertex_size;
+    std::uint32_t mesh_count;
+    std::uint64_t path_hash;
+    std::int64_t source_mtime;
+    std::uint64_t source_size;
+};
+
+struct mesh_entry
+{
+    std::uint64_t vertex_offset;
+    std::uint64_t index_offset;
+    std::uint64_t lod_offset;
+    std::uint64_t meshlet_offset;
+    std::uint64_t texture_offset;
+    std::uint32_t vertex_count;
+    std::uint32_t index_count;
+    std::uint32_t lod_count;
+    std::uint32_t meshlet_count;
+    std::uint32_t texture_count;
+    std::uint32_t texture_bytes;
+};
+
+/* Whether count elements starting at offset are inside the file,
+ * written so that crafted offsets cannot wrap around */
+bool in_file(std::uint64_t offset, std::uint64_t count,
+             std::uint64_t element_size, std::uint64_t file_size)
+{
+    return offset <= file_size
+           && count <= (file_size - offset) / element_size;
+}
+
+std::uint64_t align_up(std::uint64_t value)
+{
+    return (value + blob_alignment - 1) & ~(blob_alignment - 1);
+}
+
+bool source_info(const std::string &source, std::int64_t &mtime,
+                 std::uint64_t &size)
+{
+    /* The file behind the mount points is the one that changes */
+    std::string file = vfs::resolve(source);
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(file, ec);
+    if (ec)
+        return false;
+    size = std::filesystem::file_size(file, ec);
+    if (ec)
+        return false;
+    mtime = time.time_since_epoch().count();
+    return true;
+}
+
+std::uint64_t source_hash(const std::string &source)
+{
+    std::error_code ec;
+    auto canonical = std::filesystem::weakly_canonical(source, ec);
+    return hash::fnv1a(ec ? source : canonical.string());
+}
+
+} // namespace
+
+void mesh_cache::init(std::string directory)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        ERROR("Could not create mesh cache directory: {}", directory);
+        return;
+    }
+    mesh_cache::directory = directory;
+    mesh_cache::enabled = true;
+    INFO("Mesh cache initialized in {}", directory);
+}
+
+void mesh_cache::destroy()
+{
+    mesh_cache::enabled = false;
+}
+
+bool mesh_cache::is_enabled()
+{
+    return mesh_cache::enabled;
+}
+
+std::string mesh_cache::get_cache_path(const std::string &source,
+                                       std::uint64_t import_flags)
+{
+    std::uint64_t key = hash::combine(source_hash(source), import_flags);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.brmesh",
+                  (unsigned long long) key);
+    return (std::filesystem::path(mesh_cache::directory) / name).string();
+}
+
+bool mesh_cache::load(const std::string &source, std::uint64_t import_flags,
+                      types::mapped_file &file,
+                      std::vector<types::cached_mesh> &meshes)
+{
+    if (!mesh_cache::enabled)
+        return false;
+
+    std::int64_t mtime;
+    std::uint64_t size;
+    if (!source_info(source, mtime, size))
+        return false;
+
+    std::string cache_path = get_cache_path(source, import_flags);
+    if (!file.open(cache_path))
+        return false;
+
+    const unsigned char *data = file.data();
+    const std::uint64_t file_size = file.size();
+    if (file_size < sizeof(file_header))
+        return false;
+
+    file_header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0
+        || header.version != mesh_cache::version
+        || header.import_flags != import_flags
+        || header.vertex_size != sizeof(types::vertex)
+        || header.path_hash != source_hash(source)
+        || header.source_mtime != mtime || header.source_size != size)
+    {
+        INFO("Mesh cache is stale for {}", source);
+        file.close();
+        return false;
+    }
+
+    std::uint64_t entries_end =
+        sizeof(file_header) + header.mesh_count * sizeof(mesh_entry);
+    if (entries_end > file_size)
+    {
+        file.close();
+        return false;
+    }
+
+    std::vector<types::cached_mesh> result(header.mesh_count);
+    for (std::uint32_t i = 0; i < header.mesh_count; i++)
+    {
+        mesh_entry entry;
+        std::memcpy(&entry, data + sizeof(file_header) + i * sizeof(mesh_entry),
+                    sizeof(entry));
+
+        if (!in_file(entry.vertex_offset, entry.vertex_count,
+                     sizeof(types::vertex), file_size)
+            || !in_file(entry.index_offset, entry.index_count,
+                        sizeof(unsigned int), file_size)
+            || !in_file(entry.lod_offset, entry.lod_count,
+                        sizeof(types::mesh_lod), file_size)
+            || !in_file(entry.meshlet_offset, entry.meshlet_count,
+                        sizeof(types::meshlet), file_size)
+            || !in_file(entry.texture_offset, entry.texture_bytes, 1,
+                        file_size))
+        {
+            ERROR("Mesh cache is corrupted: {}", cache_path);
+            file.close();
+            return false;
+        }
+        std::uint64_t texture_end = entry.texture_offset + entry.texture_bytes;
+
+        result[i].vertices = std::span<const types::vertex>(
+            reinterpret_cast<const types::vertex *>(data + entry.vertex_offset),
+            entry.vertex_count);
+        result[i].indices = std::span<const unsigned int>(
+            reinterpret_cast<const unsigned int *>(data + entry.index_offset),
+            entry.index_count);
+        result[i].lods.resize(entry.lod_count);
+        std::memcpy(result[i].lods.data(), data + entry.lod_offset,
+                    entry.lod_count * sizeof(types::mesh_lod));
+        result[i].meshlets.resize(entry.meshlet_count);
+        std::memcpy(result[i].meshlets.data(), data + entry.meshlet_offset,
+                    entry.meshlet_count * sizeof(types::meshlet));
+
+        bool ranges_valid = true;
+        for (auto &lod : result[i].lods)
+            ranges_valid &= (std::uint64_t) lod.index_offset + lod.index_count
+                            <= entry.index_count;
+        for (auto &meshlet : result[i].meshlets)
+            ranges_valid &= (std::uint64_t) meshlet.index_offset
+                                + meshlet.index_count
+                            <= entry.index_count;
+        if (!ranges_valid)
+        {
+            ERROR("Mesh cache is corrupted: {}", cache_path);
+            file.close();
+            return false;
+        }
+
+        std::uint64_t offset = entry.texture_offset;
+        for (std::uint32_t t = 0; t < entry.texture_count; t++)
+        {
+            std::uint32_t lengths[2];
+            if (offset + sizeof(lengths) > texture_end)
+            {
+                file.close();
+                return false;
+            }
+            std::memcpy(lengths, data + offset, sizeof(lengths));
+            offset += sizeof(lengths);
+            if (offset + lengths[0] + lengths[1] > texture_end)
+            {
+                file.close();
+                return false;
+            }
+            types::texture_ref ref;
+            ref.type.assign((const char *) data + offset, lengths[0]);
+            offset += lengths[0];
+            ref.path.assign((const char *) data + offset, lengths[1]);
+            offset += lengths[1];
+            result[i].textures.push_back(ref);
+        }
+    }
+
+    meshes = std::move(result);
+    return true;
+}
+
+bool mesh_cache::store(const std::string &source, std::uint64_t import_flags,
+                       const std::vector<types::cached_mesh> &meshes)
+{
+    if (!mesh_cache::enabled)
+        return false;
+
+    file_header header = {};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = mesh_cache::version;
+    header.import_flags = import_flags;
+    header.vertex_size = sizeof(types::vertex);
+    header.path_hash = source_hash(source);
+    header.mesh_count = meshes.size();
+    if (!source_info(source, header.source_mtime, header.source_size))
+        return false;
+
+    /* Compute the layout */
+    std::vector<mesh_entry> entries(meshes.size());
+    std::uint64_t offset =
+        sizeof(file_header) + meshes.size() * sizeof(mesh_entry);
+    for (std::size_t i = 0; i < meshes.size(); i++)
+    {
+        auto &entry = entries[i];
+        entry.vertex_offset = align_up(offset);
+        entry.vertex_count = meshes[i].vertices.size();
+        offset = entry.vertex_offset + meshes[i].vertices.size_bytes();
+
+        entry.index_offset = align_up(offset);
+        entry.index_count = meshes[i].indices.size();
+        offset = entry.index_offset + meshes[i].indices.size_bytes();
+
+        entry.lod_offset = offset;
+        entry.lod_count = meshes[i].lods.size();
+        offset += entry.lod_count * sizeof(types::mesh_lod);
+
+        entry.meshlet_offset = offset;
+        entry.meshlet_count = meshes[i].meshlets.size();
+        offset += entry.meshlet_count * sizeof(types::meshlet);
+
+        entry.texture_offset = offset;
+        entry.texture_count = meshes[i].textures.size();
+        entry.texture_bytes = 0;
+        for (auto &ref : meshes[i].textures)
+            entry.texture_bytes +=
+                2 * sizeof(std::uint32_t) + ref.type.size() + ref.path.size();
+        offset += entry.texture_bytes;
+    }
+
+    /* Write to a temporary file and rename it, so that a crash
+     * never leaves a truncated cache behind */
+    std::string cache_path = get_cache_path(source, import_flags);
+    std::string tmp_path = vfs::get_temp_path(cache_path);
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        ERROR("Could not write mesh cache: {}", tmp_path);
+        return false;
+    }
+
+    auto pad_to = [&out](std::uint64_t target)
+    {
+        static const char zeros[blob_alignment] = {};
+        std::uint64_t pos = out.tellp();
+        if (target > pos)
+            out.write(zeros, target - pos);
+    };
+
+    out.write((const char *) &header, sizeof(header));
+    out.write((const char *) entries.data(),
+              entries.size() * sizeof(mesh_entry));
+    for (std::size_t i = 0; i < meshes.size(); i++)
+    {
+        pad_to(entries[i].vertex_offset);
+        out.write((const char *) meshes[i].vertices.data(),
+                  meshes[i].vertices.size_bytes());
+        pad_to(entries[i].index_offset);
+        out.write((const char *) meshes[i].indices.data(),
+                  meshes[i].indices.size_bytes());
+        out.write((const char *) meshes[i].lods.data(),
+                  meshes[i].lods.size() * sizeof(types::mesh_lod));
+        out.write((const char *) meshes[i].meshlets.data(),
+                  meshes[i].meshlets.size() * sizeof(types::meshlet));
+        for (auto &ref : meshes[i].textures)
+        {
+            std::uint32_t lengths[2] = {(std::uint32_t) ref.type.size(),
+                                        (std::uint32_t) ref.path.size()};
+            out.write((const char *) lengths, sizeof(lengths));
+            out.write(ref.type.data(), ref.type.size());
+            out.write(ref.path.data(), ref.path.size());
+        }
+    }
+    out.close();
+    if (!out)
+    {
+        ERROR("Could not write mesh cache: {}", tmp_path);
+        std::filesystem::remove(tmp_path);
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, cache_path, ec);
+    if (ec)
+    {
+        ERROR("Could not write mesh cache: {}", cache_path);
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    INFO("Stored mesh cache for {}", source);
+    return true;
+}
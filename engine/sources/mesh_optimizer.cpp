@@ -0,0 +1,369 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh_optimizer.hpp"
+
+#include "engine_hash.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numeric>
+#include <unordered_map>
+
+using namespace brenta;
+
+bool mesh_optimizer::enabled = false;
+
+namespace
+{
+
+/* Forsyth scoring, see "Linear-Speed Vertex Cache Optimisation" */
+constexpr int forsyth_cache_size = 32;
+constexpr float forsyth_last_triangle_score = 0.75f;
+constexpr float forsyth_cache_decay_power = 1.5f;
+constexpr float forsyth_valence_boost_scale = 2.0f;
+constexpr float forsyth_valence_boost_power = 0.5f;
+
+float forsyth_score(int cache_position, unsigned int remaining)
+{
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position < 0)
+        score = 0.0f;
+    else if (cache_position < 3)
+        score = forsyth_last_triangle_score;
+    else
+    {
+        float scaler = 1.0f / (forsyth_cache_size - 3);
+        score = std::pow(1.0f - (cache_position - 3) * scaler,
+                         forsyth_cache_decay_power);
+    }
+
+    score += forsyth_valence_boost_scale
+             * std::pow((float) remaining, -forsyth_valence_boost_power);
+    return score;
+}
+
+struct vertex_hash
+{
+    std::size_t operator()(const types::vertex &v) const
+    {
+        return hash::fnv1a(&v, sizeof(v));
+    }
+};
+
+struct vertex_equal
+{
+    bool operator()(const types::vertex &a, const types::vertex &b) const
+    {
+        return std::memcmp(&a, &b, sizeof(types::vertex)) == 0;
+    }
+};
+
+} // namespace
+
+void mesh_optimizer::set_enabled(bool enabled)
+{
+    mesh_optimizer::enabled = enabled;
+}
+
+bool mesh_optimizer::is_enabled()
+{
+    return enabled;
+}
+
+void mesh_optimizer::optimize(std::vector<types::vertex> &vertices,
+                              std::vector<unsigned int> &indices)
+{
+    weld(vertices, indices);
+    optimize_vertex_cache(indices, vertices.size());
+    optimize_overdraw(indices, vertices);
+    optimize_vertex_fetch(vertices, indices);
+}
+
+void mesh_optimizer::weld(std::vector<types::vertex> &vertices,
+                          std::vector<unsigned int> &indices)
+{
+    std::unordered_map<types::vertex, unsigned int, vertex_hash, vertex_equal>
+        unique;
+    unique.reserve(vertices.size());
+
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<types::vertex> welded;
+    welded.reserve(vertices.size());
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        auto [it, inserted] = unique.try_emplace(vertices[i], welded.size());
+        if (inserted)
+            welded.push_back(vertices[i]);
+        remap[i] = it->second;
+    }
+
+    for (auto &index : indices)
+        index = remap[index];
+    vertices = std::move(welded);
+}
+
+void mesh_optimizer::optimize_vertex_cache(std::vector<unsigned int> &indices,
+                                           std::size_t vertex_count)
+{
+    std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return;
+
+    /* Triangles adjacent to each vertex */
+    std::vector<unsigned int> remaining(vertex_count, 0);
+    for (auto index : indices)
+        remaining[index]++;
+    std::vector<unsigned int> offsets(vertex_count + 1, 0);
+    for (std::size_t v = 0; v < vertex_count; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; v++)
+        vertex_score[v] = forsyth_score(-1, remaining[v]);
+
+    std::vector<float> triangle_score(triangle_count);
+    std::vector<bool> emitted(triangle_count, false);
+    for (std::size_t t = 0; t < triangle_count; t++)
+        triangle_score[t] = vertex_score[indices[t * 3]]
+                            + vertex_score[indices[t * 3 + 1]]
+                            + vertex_score[indices[t * 3 + 2]];
+
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> new_cache;
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    std::size_t scan = 0;
+    long best = -1;
+    for (std::size_t n = 0; n < triangle_count; n++)
+    {
+        /* No candidate from the cache, take the next unused triangle */
+        if (best < 0)
+        {
+            while (emitted[scan])
+                scan++;
+            best = scan;
+        }
+
+        unsigned int tri[3] = {indices[best * 3], indices[best * 3 + 1],
+                               indices[best * 3 + 2]};
+        emitted[best] = true;
+        result.insert(result.end(), tri, tri + 3);
+
+        /* Remove the triangle from the adjacency of its vertices */
+        for (auto v : tri)
+        {
+            unsigned int *begin = adjacency.data() + offsets[v];
+            unsigned int *end = begin + remaining[v];
+            std::iter_swap(std::find(begin, end, (unsigned int) best),
+                           end - 1);
+            remaining[v]--;
+        }
+
+        /* Move the vertices at the front of the LRU cache */
+        new_cache.assign(tri, tri + 3);
+        for (auto v : cache)
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                new_cache.push_back(v);
+        for (std::size_t i = forsyth_cache_size; i < new_cache.size(); i++)
+            cache_position[new_cache[i]] = -1;
+        if (new_cache.size() > forsyth_cache_size)
+            new_cache.resize(forsyth_cache_size);
+        std::swap(cache, new_cache);
+
+        for (std::size_t i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            cache_position[v] = i;
+            vertex_score[v] = forsyth_score(i, remaining[v]);
+        }
+
+        /* Rescore the triangles touched by the cache, pick the best */
+        best = -1;
+        float best_score = -1.0f;
+        for (auto v : cache)
+        {
+            for (unsigned int i = 0; i < remaining[v]; i++)
+            {
+                unsigned int t = adjacency[offsets[v] + i];
+                float score = vertex_score[indices[t * 3]]
+                              + vertex_score[indices[t * 3 + 1]]
+                              + vertex_score[indices[t * 3 + 2]];
+                triangle_score[t] = score;
+                if (score > best_score)
+                {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices = std::move(result);
+}
+
+void mesh_optimizer::optimize_overdraw(
+    std::vector<unsigned int> &indices,
+    const std::vector<types::vertex> &vertices, float threshold)
+{
+    std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count < 2)
+        return;
+
+    /* Split in clusters where the cache behaviour allows It: a cluster
+     * can end when its own miss ratio is within the threshold */
+    float target = analyze(indices, vertices.size()).acmr * threshold;
+    std::vector<unsigned int> clusters = {0};
+    std::vector<unsigned int> timestamp(vertices.size(), 0);
+    unsigned int time = analyze_cache_size + 1;
+    unsigned int misses = 0;
+    for (std::size_t t = 0; t < triangle_count; t++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[t * 3 + k];
+            if (time - timestamp[v] > analyze_cache_size)
+            {
+                timestamp[v] = time++;
+                misses++;
+            }
+        }
+
+        std::size_t cluster_size = t + 1 - clusters.back();
+        if (t + 1 < triangle_count
+            && (float) misses / cluster_size <= target)
+        {
+            clusters.push_back(t + 1);
+            /* A new cluster starts with a cold cache */
+            time += analyze_cache_size + 1;
+            misses = 0;
+        }
+    }
+
+    glm::vec3 mesh_centroid(0.0f);
+    for (auto &v : vertices)
+        mesh_centroid += v.position;
+    mesh_centroid /= (float) std::max<std::size_t>(vertices.size(), 1);
+
+    /* Clusters facing away from the center are drawn first */
+    std::vector<float> sort_key(clusters.size());
+    for (std::size_t c = 0; c < clusters.size(); c++)
+    {
+        std::size_t end =
+            c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (std::size_t t = clusters[c]; t < end; t++)
+        {
+            glm::vec3 p0 = vertices[indices[t * 3]].position;
+            glm::vec3 p1 = vertices[indices[t * 3 + 1]].position;
+            glm::vec3 p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float length = glm::length(normal);
+        if (length > 0.0f)
+            normal /= length;
+        sort_key[c] = glm::dot(centroid - mesh_centroid, normal);
+    }
+
+    std::vector<unsigned int> order(clusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b)
+                     { return sort_key[a] > sort_key[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (auto c : order)
+    {
+        std::size_t end =
+            c + 1 < clusters.size() ? clusters[c + 1] : triangle_count;
+        result.insert(result.end(), indices.begin() + clusters[c] * 3,
+                      indices.begin() + end * 3);
+    }
+    indices = std::move(result);
+}
+
+void mesh_optimizer::optimize_vertex_fetch(
+    std::vector<types::vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    constexpr unsigned int unused = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), unused);
+    std::vector<types::vertex> ordered;
+    ordered.reserve(vertices.size());
+
+    for (auto &index : indices)
+    {
+        if (remap[index] == unused)
+        {
+            remap[index] = ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(ordered);
+}
+
+types::vertex_cache_stats
+mesh_optimizer::analyze(const std::vector<unsigned int> &indices,
+                        std::size_t vertex_count, unsigned int cache_size)
+{
+    types::vertex_cache_stats stats;
+    if (indices.empty() || vertex_count == 0)
+        return stats;
+
+    std::vector<unsigned int> timestamp(vertex_count, 0);
+    unsigned int time = cache_size + 1;
+    unsigned int misses = 0;
+    for (auto v : indices)
+    {
+        if (time - timestamp[v] > cache_size)
+        {
+            timestamp[v] = time++;
+            misses++;
+        }
+    }
+
+    stats.acmr = (float) misses / (indices.size() / 3);
+    stats.atvr = (float) misses / vertex_count;
+    return stats;
+}
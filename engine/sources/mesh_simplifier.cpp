@@ -0,0 +1,459 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh_simplifier.hpp"
+
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <numeric>
+#include <unordered_set>
+
+using namespace brenta;
+
+bool mesh_simplifier::enabled = false;
+unsigned int mesh_simplifier::levels = 4;
+
+namespace
+{
+
+/* Open borders weigh more than faces, so they stay in place */
+constexpr double border_weight = 10.0;
+/* Largest error accepted for a level of detail, relative to the mesh */
+constexpr float max_lod_error = 0.25f;
+/* A level that removes less than this fraction of triangles is dropped */
+constexpr float min_lod_reduction = 0.1f;
+constexpr unsigned int no_collapse = ~0u;
+
+/* Symmetric 4x4 matrix of the plane equations, with the total weight
+ * of the planes so that the error is an average squared distance */
+struct quadric
+{
+    double a2 = 0, b2 = 0, c2 = 0, ab = 0, ac = 0, bc = 0;
+    double ad = 0, bd = 0, cd = 0, d2 = 0, w = 0;
+
+    void add_plane(glm::dvec3 n, double d, double weight)
+    {
+        a2 += weight * n.x * n.x;
+        b2 += weight * n.y * n.y;
+        c2 += weight * n.z * n.z;
+        ab += weight * n.x * n.y;
+        ac += weight * n.x * n.z;
+        bc += weight * n.y * n.z;
+        ad += weight * n.x * d;
+        bd += weight * n.y * d;
+        cd += weight * n.z * d;
+        d2 += weight * d * d;
+        w += weight;
+    }
+
+    quadric &operator+=(const quadric &q)
+    {
+        a2 += q.a2;
+        b2 += q.b2;
+        c2 += q.c2;
+        ab += q.ab;
+        ac += q.ac;
+        bc += q.bc;
+        ad += q.ad;
+        bd += q.bd;
+        cd += q.cd;
+        d2 += q.d2;
+        w += q.w;
+        return *this;
+    }
+
+    double error(glm::dvec3 p) const
+    {
+        if (w <= 0.0)
+            return 0.0;
+        double e = a2 * p.x * p.x + b2 * p.y * p.y + c2 * p.z * p.z
+                   + 2.0 * (ab * p.x * p.y + ac * p.x * p.z + bc * p.y * p.z)
+                   + 2.0 * (ad * p.x + bd * p.y + cd * p.z) + d2;
+        return std::max(e, 0.0) / w;
+    }
+};
+
+struct collapse
+{
+    double cost;
+    unsigned int from;
+    unsigned int to;
+};
+
+std::uint64_t edge_key(unsigned int a, unsigned int b)
+{
+    return ((std::uint64_t) a << 32) | b;
+}
+
+bool position_less(const types::vertex &a, const types::vertex &b)
+{
+    if (a.position.x != b.position.x)
+        return a.position.x < b.position.x;
+    if (a.position.y != b.position.y)
+        return a.position.y < b.position.y;
+    return a.position.z < b.position.z;
+}
+
+float mesh_extent(const std::vector<types::vertex> &vertices)
+{
+    if (vertices.empty())
+        return 0.0f;
+    glm::vec3 min = vertices[0].position, max = vertices[0].position;
+    for (auto &v : vertices)
+    {
+        min = glm::min(min, v.position);
+        max = glm::max(max, v.position);
+    }
+    glm::vec3 size = max - min;
+    return std::max(size.x, std::max(size.y, size.z));
+}
+
+} // namespace
+
+void mesh_simplifier::set_enabled(bool enabled)
+{
+    mesh_simplifier::enabled = enabled;
+}
+
+bool mesh_simplifier::is_enabled()
+{
+    return enabled;
+}
+
+void mesh_simplifier::set_levels(unsigned int levels)
+{
+    mesh_simplifier::levels = std::clamp(levels, 1u, max_levels);
+}
+
+unsigned int mesh_simplifier::get_levels()
+{
+    return levels;
+}
+
+std::vector<unsigned int>
+mesh_simplifier::simplify(const std::vector<types::vertex> &vertices,
+                          const std::vector<unsigned int> &indices,
+                          std::size_t target_index_count, float target_error,
+                          float *result_error)
+{
+    std::vector<unsigned int> result = indices;
+    if (result_error)
+        *result_error = 0.0f;
+    if (vertices.empty() || result.size() <= target_index_count)
+        return result;
+
+    /* Work in a unit box, so that the error is relative to the mesh */
+    float extent = mesh_extent(vertices);
+    double scale = extent > 0.0f ? 1.0 / extent : 1.0;
+    glm::vec3 origin = vertices[0].position;
+    std::vector<glm::dvec3> position(vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); i++)
+        position[i] = glm::dvec3(vertices[i].position - origin) * scale;
+
+    /* Vertices sharing a position form a group represented by the
+     * first of them, a group with different attributes is a seam */
+    std::vector<unsigned int> order(vertices.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](unsigned int a, unsigned int b)
+                     { return position_less(vertices[a], vertices[b]); });
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<bool> seam(vertices.size(), false);
+    for (std::size_t i = 0; i < order.size();)
+    {
+        std::size_t end = i + 1;
+        while (end < order.size()
+               && vertices[order[end]].position == vertices[order[i]].position)
+            end++;
+        unsigned int first = *std::min_element(order.begin() + i,
+                                               order.begin() + end);
+        for (std::size_t j = i; j < end; j++)
+        {
+            remap[order[j]] = first;
+            if (std::memcmp(&vertices[order[j]], &vertices[first],
+                            sizeof(types::vertex))
+                != 0)
+                seam[first] = true;
+        }
+        i = end;
+    }
+
+    for (auto &index : result)
+        index = remap[index];
+    std::vector<unsigned int> wedge = indices;
+
+    /* Plane quadrics of the faces, plus planes perpendicular to the
+     * open borders */
+    std::vector<quadric> quadrics(vertices.size());
+    std::unordered_set<std::uint64_t> edges;
+    for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+        for (int k = 0; k < 3; k++)
+            edges.insert(edge_key(result[t + k], result[t + (k + 1) % 3]));
+
+    for (std::size_t t = 0; t + 2 < result.size(); t += 3)
+    {
+        unsigned int c[3] = {result[t], result[t + 1], result[t + 2]};
+        glm::dvec3 n = glm::cross(position[c[1]] - position[c[0]],
+                                  position[c[2]] - position[c[0]]);
+        double length = glm::length(n);
+        if (length <= 0.0)
+            continue;
+        n /= length;
+        double d = -glm::dot(n, position[c[0]]);
+        for (auto v : c)
+            quadrics[v].add_plane(n, d, length * 0.5);
+
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = c[k], b = c[(k + 1) % 3];
+            if (edges.count(edge_key(b, a)))
+                continue;
+            glm::dvec3 e = position[b] - position[a];
+            glm::dvec3 bn = glm::cross(e, n);
+            double bl = glm::length(bn);
+            if (bl <= 0.0)
+                continue;
+            bn /= bl;
+            double bd = -glm::dot(bn, position[a]);
+            double weight = glm::dot(e, e) * border_weight;
+            quadrics[a].add_plane(bn, bd, weight);
+            quadrics[b].add_plane(bn, bd, weight);
+        }
+    }
+
+    double max_cost = (double) target_error * target_error;
+    double error = 0.0;
+    std::vector<unsigned int> collapse_to(vertices.size(), no_collapse);
+    std::vector<unsigned int> collapse_wedge(vertices.size());
+    std::vector<bool> dirty(vertices.size());
+    std::vector<bool> border(vertices.size());
+    std::vector<unsigned int> offsets(vertices.size() + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<std::uint64_t> candidates;
+    std::vector<collapse> collapses;
+
+    /* Every pass collapses a set of independent edges, cheapest first */
+    while (result.size() > target_index_count)
+    {
+        edges.clear();
+        for (std::size_t t = 0; t < result.size(); t += 3)
+            for (int k = 0; k < 3; k++)
+                edges.insert(
+                    edge_key(result[t + k], result[t + (k + 1) % 3]));
+        auto is_border_edge = [&](unsigned int a, unsigned int b)
+        {
+            return !edges.count(edge_key(a, b))
+                   || !edges.count(edge_key(b, a));
+        };
+
+        std::fill(border.begin(), border.end(), false);
+        std::fill(offsets.begin(), offsets.end(), 0);
+        candidates.clear();
+        for (std::size_t t = 0; t < result.size(); t += 3)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = result[t + k], b = result[t + (k + 1) % 3];
+                offsets[a + 1]++;
+                if (!edges.count(edge_key(b, a)))
+                    border[a] = border[b] = true;
+                candidates.push_back(edge_key(std::min(a, b), std::max(a, b)));
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+
+        /* Triangles around every vertex */
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        adjacency.resize(result.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < result.size(); i++)
+            adjacency[fill[result[i]]++] = i / 3;
+
+        collapses.clear();
+        for (auto key : candidates)
+        {
+            unsigned int a = key >> 32, b = key & 0xffffffffu;
+            if (a == b)
+                continue;
+            bool edge_border = is_border_edge(a, b);
+            collapse best = {-1.0, 0, 0};
+            for (auto [u, v] : {std::pair(a, b), std::pair(b, a)})
+            {
+                if (seam[u] || (border[u] && !edge_border))
+                    continue;
+                quadric q = quadrics[u];
+                q += quadrics[v];
+                double cost = q.error(position[v]);
+                if (best.cost < 0.0 || cost < best.cost)
+                    best = {cost, u, v};
+            }
+            if (best.cost >= 0.0 && best.cost <= max_cost)
+                collapses.push_back(best);
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const collapse &a, const collapse &b)
+                  { return a.cost < b.cost; });
+
+        /* Each collapse removes about two triangles */
+        std::size_t triangles = result.size() / 3;
+        std::size_t target_triangles = target_index_count / 3;
+        std::size_t budget = std::max<std::size_t>(
+            (triangles - target_triangles + 1) / 2, 1);
+
+        std::fill(dirty.begin(), dirty.end(), false);
+        std::size_t accepted = 0;
+        for (auto &c : collapses)
+        {
+            if (accepted >= budget)
+                break;
+            if (dirty[c.from] || dirty[c.to])
+                continue;
+
+            /* Reject collapses that flip a triangle around from */
+            bool flips = false;
+            unsigned int target_wedge = no_collapse;
+            for (auto i = offsets[c.from]; i < offsets[c.from + 1]; i++)
+            {
+                std::size_t t = adjacency[i] * 3;
+                unsigned int tri[3] = {result[t], result[t + 1],
+                                       result[t + 2]};
+                if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+                {
+                    for (int k = 0; k < 3; k++)
+                        if (tri[k] == c.to)
+                            target_wedge = wedge[t + k];
+                    continue;
+                }
+                glm::dvec3 p[3], q[3];
+                for (int k = 0; k < 3; k++)
+                {
+                    p[k] = position[tri[k]];
+                    q[k] = tri[k] == c.from ? position[c.to] : p[k];
+                }
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                if (glm::dot(before, after) <= 0.0)
+                {
+                    flips = true;
+                    break;
+                }
+            }
+            if (flips || target_wedge == no_collapse)
+                continue;
+
+            collapse_to[c.from] = c.to;
+            collapse_wedge[c.from] = target_wedge;
+            quadrics[c.to] += quadrics[c.from];
+            error = std::max(error, c.cost);
+            for (auto i = offsets[c.from]; i < offsets[c.from + 1]; i++)
+            {
+                std::size_t t = adjacency[i] * 3;
+                dirty[result[t]] = dirty[result[t + 1]] =
+                    dirty[result[t + 2]] = true;
+            }
+            accepted++;
+        }
+        if (accepted == 0)
+            break;
+
+        /* Apply the collapses and drop the degenerate triangles */
+        std::size_t out = 0;
+        for (std::size_t t = 0; t < result.size(); t += 3)
+        {
+            unsigned int tri[3], w[3];
+            for (int k = 0; k < 3; k++)
+            {
+                tri[k] = result[t + k];
+                w[k] = wedge[t + k];
+                if (collapse_to[tri[k]] != no_collapse)
+                {
+                    w[k] = collapse_wedge[tri[k]];
+                    tri[k] = collapse_to[tri[k]];
+                }
+            }
+            if (tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+                continue;
+            for (int k = 0; k < 3; k++)
+            {
+                result[out + k] = tri[k];
+                wedge[out + k] = w[k];
+            }
+            out += 3;
+        }
+        result.resize(out);
+        wedge.resize(out);
+        for (auto &c : collapses)
+            collapse_to[c.from] = no_collapse;
+    }
+
+    if (result_error)
+        *result_error = (float) std::sqrt(error);
+    return wedge;
+}
+
+std::vector<types::mesh_lod>
+mesh_simplifier::generate_lods(const std::vector<types::vertex> &vertices,
+                               std::vector<unsigned int> &indices,
+                               unsigned int levels, float ratio)
+{
+    std::vector<types::mesh_lod> lods;
+    lods.push_back({0, (std::uint32_t) indices.size(), 0.0f});
+
+    levels = std::clamp(levels, 1u, max_levels);
+    float extent = mesh_extent(vertices);
+    const std::vector<unsigned int> source = indices;
+    std::size_t target = source.size();
+    for (unsigned int level = 1; level < levels; level++)
+    {
+        target = (std::size_t) (target * ratio) / 3 * 3;
+        if (target < 3)
+            break;
+
+        /* Every level starts from the full mesh, so that the error
+         * does not pile up along the chain */
+        float error = 0.0f;
+        std::vector<unsigned int> simplified =
+            simplify(vertices, source, target, max_lod_error, &error);
+        if (simplified.size()
+            > lods.back().index_count * (1.0f - min_lod_reduction))
+            break;
+
+        if (mesh_optimizer::is_enabled())
+            mesh_optimizer::optimize_vertex_cache(simplified, vertices.size());
+
+        lods.push_back({(std::uint32_t) indices.size(),
+                        (std::uint32_t) simplified.size(),
+                        std::max(error * extent, lods.back().error)});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+    }
+    return lods;
+}
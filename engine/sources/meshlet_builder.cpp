@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace brenta;
+
+bool meshlet_builder::enabled = false;
+
+namespace
+{
+
+/* Below this the normals spread too much for the cone to ever cull */
+constexpr float min_cone_dot = 0.1f;
+
+} // namespace
+
+void meshlet_builder::set_enabled(bool enabled)
+{
+    meshlet_builder::enabled = enabled;
+}
+
+bool meshlet_builder::is_enabled()
+{
+    return enabled;
+}
+
+std::vector<types::meshlet>
+meshlet_builder::build(const std::vector<types::vertex> &vertices,
+                       std::vector<unsigned int> &indices,
+                       unsigned int max_vertices, unsigned int max_triangles)
+{
+    std::vector<types::meshlet> meshlets;
+    std::size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0)
+        return meshlets;
+    max_vertices = std::max(max_vertices, 3u);
+    max_triangles = std::max(max_triangles, 1u);
+
+    /* Triangles adjacent to each vertex */
+    std::vector<unsigned int> offsets(vertices.size() + 1, 0);
+    for (std::size_t i = 0; i < triangle_count * 3; i++)
+        offsets[indices[i] + 1]++;
+    for (std::size_t v = 0; v < vertices.size(); v++)
+        offsets[v + 1] += offsets[v];
+    std::vector<unsigned int> adjacency(triangle_count * 3);
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t i = 0; i < triangle_count * 3; i++)
+        adjacency[fill[indices[i]]++] = i / 3;
+
+    std::vector<bool> emitted(triangle_count, false);
+    /* Meshlet that last used each vertex */
+    std::vector<unsigned int> owner(vertices.size(), ~0u);
+    std::vector<unsigned int> local_vertices;
+    glm::vec3 local_sum(0.0f);
+    unsigned int local_triangles = 0;
+    unsigned int id = 0;
+
+    std::vector<unsigned int> result;
+    result.reserve(triangle_count * 3);
+
+    auto new_vertices = [&](std::size_t t)
+    {
+        unsigned int a = indices[t * 3], b = indices[t * 3 + 1],
+                     c = indices[t * 3 + 2];
+        unsigned int count = (owner[a] != id) + (owner[b] != id && b != a)
+                             + (owner[c] != id && c != a && c != b);
+        return count;
+    };
+
+    auto flush = [&]()
+    {
+        if (local_triangles == 0)
+            return;
+        std::size_t offset = result.size() - local_triangles * 3;
+        types::meshlet m = compute_bounds(
+            vertices, std::span<const unsigned int>(result.data() + offset,
+                                                    local_triangles * 3));
+        m.index_offset = offset;
+        m.index_count = local_triangles * 3;
+        meshlets.push_back(m);
+        local_vertices.clear();
+        local_sum = glm::vec3(0.0f);
+        local_triangles = 0;
+        id++;
+    };
+
+    std::size_t scan = 0;
+    for (std::size_t n = 0; n < triangle_count; n++)
+    {
+        /* Grow through the neighbour that adds the fewest vertices,
+         * the closest to the center of the meshlet on a tie, so that
+         * meshlets stay round instead of growing in strips */
+        long best = -1;
+        unsigned int best_new = 4;
+        float best_distance = 0.0f;
+        glm::vec3 centroid =
+            local_sum / (float) std::max<std::size_t>(local_vertices.size(), 1);
+        for (auto v : local_vertices)
+        {
+            for (unsigned int i = offsets[v]; i < offsets[v + 1]; i++)
+            {
+                unsigned int t = adjacency[i];
+                if (emitted[t])
+                    continue;
+                unsigned int count = new_vertices(t);
+                if (count > best_new)
+                    continue;
+                glm::vec3 d = (vertices[indices[t * 3]].position
+                               + vertices[indices[t * 3 + 1]].position
+                               + vertices[indices[t * 3 + 2]].position)
+                                  / 3.0f
+                              - centroid;
+                float distance = glm::dot(d, d);
+                if (count < best_new || distance < best_distance)
+                {
+                    best = t;
+                    best_new = count;
+                    best_distance = distance;
+                }
+            }
+        }
+
+        bool fits = best >= 0
+                    && local_vertices.size() + best_new <= max_vertices
+                    && local_triangles < max_triangles;
+        if (!fits)
+        {
+            /* The neighbour, if any, seeds the next meshlet */
+            flush();
+            if (best < 0)
+            {
+                while (emitted[scan])
+                    scan++;
+                best = scan;
+            }
+        }
+
+        emitted[best] = true;
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int v = indices[best * 3 + k];
+            result.push_back(v);
+            if (owner[v] != id)
+            {
+                owner[v] = id;
+                local_vertices.push_back(v);
+                local_sum += vertices[v].position;
+            }
+        }
+        local_triangles++;
+    }
+    flush();
+
+    std::copy(result.begin(), result.end(), indices.begin());
+    return meshlets;
+}
+
+types::meshlet
+meshlet_builder::compute_bounds(const std::vector<types::vertex> &vertices,
+                                std::span<const unsigned int> indices)
+{
+    types::meshlet m = {};
+    m.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    m.cone_cutoff = 1.0f;
+    if (indices.empty())
+        return m;
+
+    glm::vec3 min = vertices[indices[0]].position;
+    glm::vec3 max = min;
+    for (auto index : indices)
+    {
+        min = glm::min(min, vertices[index].position);
+        max = glm::max(max, vertices[index].position);
+    }
+    m.center = (min + max) * 0.5f;
+    for (auto index : indices)
+        m.radius = std::max(
+            m.radius, glm::length(vertices[index].position - m.center));
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(indices.size() / 3);
+    glm::vec3 axis(0.0f);
+    for (std::size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        glm::vec3 p0 = vertices[indices[t]].position;
+        glm::vec3 p1 = vertices[indices[t + 1]].position;
+        glm::vec3 p2 = vertices[indices[t + 2]].position;
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(n);
+        if (length <= 0.0f)
+            continue;
+        normals.push_back(n / length);
+        axis += n / length;
+    }
+
+    float length = glm::length(axis);
+    if (length <= 0.0f)
+        return m;
+    axis /= length;
+
+    float min_dot = 1.0f;
+    for (auto &n : normals)
+        min_dot = std::min(min_dot, glm::dot(axis, n));
+
+    m.cone_axis = axis;
+    if (min_dot > min_cone_dot)
+        m.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    return m;
+}
@@ -27,11 +27,63 @@
 #include "model.hpp"
 
 #include "engine_logger.hpp"
+#include "lod_selector.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "obj_parser.hpp"
+#include "thread_pool.hpp"
+#include "vfs.hpp"
 
+#include <assimp/DefaultIOSystem.h>
+#include <assimp/MemoryIOWrapper.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 
 using namespace brenta;
 
+namespace
+{
+
+/* Lets Assimp read a model and the files It references (materials,
+ * embedded buffers) through the vfs, from packs or mount points */
+class vfs_io_system : public Assimp::DefaultIOSystem
+{
+  public:
+    bool Exists(const char *file) const override
+    {
+        return vfs::exists(file);
+    }
+
+    Assimp::IOStream *Open(const char *file, const char *mode) override
+    {
+        if (std::strchr(mode, 'w') != nullptr)
+            return DefaultIOSystem::Open(vfs::resolve(file).c_str(), mode);
+
+        types::asset asset = vfs::read(file);
+        if (!asset.is_valid())
+            return nullptr;
+        /* The streams do not own their memory, keep It alive for the
+         * whole import */
+        this->opened.push_back(std::move(asset));
+        auto &opened = this->opened.back();
+        return new Assimp::MemoryIOStream(opened.data(), opened.size());
+    }
+
+  private:
+    std::vector<types::asset> opened;
+};
+
+glm::mat4 to_glm(const aiMatrix4x4 &m)
+{
+    /* Assimp matrices are row major */
+    return glm::transpose(glm::make_mat4(&m.a1));
+}
+
+} // namespace
+
 model::model(std::string const &path, GLint wrapping, GLint filtering_min,
              GLint filtering_mag, GLboolean has_mipmap, GLint mipmap_min,
              GLint mipmap_mag, bool flip)
@@ -43,55 +95,438 @@ model::model(std::string const &path, GLint wrapping, GLint filtering_min,
     this->mipmap_min = mipmap_min;
     this->mipmap_mag = mipmap_mag;
     this->flip = flip;
-    load_model(path);
+
+    types::model_data data =
+        import_model(path, wrapping, filtering_min, filtering_mag, has_mipmap,
+                     mipmap_min, mipmap_mag, flip);
+    upload(data);
 }
 
-void model::draw(types::shader_name_t shader)
+model::model(types::model_data &&data, GLint wrapping, GLint filtering_min,
+             GLint filtering_mag, GLboolean has_mipmap, GLint mipmap_min,
+             GLint mipmap_mag)
 {
+    this->wrapping = wrapping;
+    this->filtering_min = filtering_min;
+    this->filtering_mag = filtering_mag;
+    this->has_mipmap = has_mipmap;
+    this->mipmap_min = mipmap_min;
+    this->mipmap_mag = mipmap_mag;
+    this->flip = data.flip;
+    upload(data);
+}
+
+void model::draw(types::shader_name_t shader, unsigned int lod,
+                 const types::cluster_frustum *frustum,
+                 std::span<const glm::mat4> palette)
+{
+    if (!palette.empty() && palette.size() < this->skeleton.joints.size())
+    {
+        ERROR("Palette has {} matrices, the skeleton has {} joints",
+              palette.size(), this->skeleton.joints.size());
+        palette = {};
+    }
+    if (this->skeleton.joints.empty())
+        palette = {};
+
+    /* One upload for all the meshes of the instance */
+    bool bound = this->gpu_skinned && !palette.empty();
+    if (bound)
+        skinning::bind_palette(shader, palette);
+
     for (unsigned int i = 0; i < meshes.size(); i++)
     {
-        meshes[i].draw(shader);
+        meshes[i].draw(shader, lod, frustum, palette);
     }
+
+    if (bound)
+        skinning::unbind_palette(shader);
+}
+
+unsigned int model::select_lod(const glm::mat4 &model_matrix,
+                               const glm::mat4 &view,
+                               const glm::mat4 &projection,
+                               float viewport_height,
+                               unsigned int current) const
+{
+    if (this->lod_errors.size() < 2)
+        return 0;
+
+    float pixels = lod_selector::pixels_per_unit(
+        model_matrix, view, projection, this->bounds_center,
+        this->bounds_radius, viewport_height);
+    return lod_selector::select(this->lod_errors, pixels, current);
+}
+
+unsigned int model::get_lod_count() const
+{
+    return this->lod_errors.size();
+}
+
+bool model::has_skeleton() const
+{
+    return !this->skeleton.joints.empty();
+}
+
+unsigned int model::get_material_id() const
+{
+    if (this->meshes.empty() || this->meshes[0].textures.empty())
+        return 0;
+    return this->meshes[0].textures[0].id;
+}
+
+unsigned int model::get_vertex_array() const
+{
+    if (this->meshes.empty())
+        return 0;
+    return this->meshes[0].get_vertex_array();
+}
+
+const types::skeleton &model::get_skeleton() const
+{
+    return this->skeleton;
+}
+
+const std::vector<types::compressed_clip> &model::get_animations() const
+{
+    return this->animations;
 }
 
-void model::load_model(std::string path)
+const types::compressed_clip *
+model::find_animation(const std::string &name) const
+{
+    for (const auto &clip : this->animations)
+    {
+        if (clip.name == name)
+            return &clip;
+    }
+    return nullptr;
+}
+
+types::model_data model::import_model(std::string path, GLint wrapping,
+                                      GLint filtering_min, GLint filtering_mag,
+                                      GLboolean has_mipmap, GLint mipmap_min,
+                                      GLint mipmap_mag, bool flip)
+{
+    types::model_data data;
+    data.directory = path.substr(0, path.find_last_of('/'));
+    data.flip = flip;
+
+    /* Warm start, read the geometry straight from the baked cache */
+    if (load_cached_model(path, data))
+    {
+        INFO("Loaded model from mesh cache: {}", path);
+    }
+    else
+    {
+        bool imported = obj_parser::is_enabled() && obj_parser::can_load(path)
+                            ? import_obj(path, data)
+                            : import_assimp(path, data);
+        if (!imported)
+            return data;
+
+        process_meshes(path, data);
+        store_cached_model(path, data);
+    }
+
+    /* Decode in parallel every texture that is not on the GPU yet */
+    std::vector<std::string> paths;
+    for (auto &m : data.meshes)
+    {
+        for (auto &ref : m.textures)
+        {
+            if (!data.images.try_emplace(ref.path).second)
+                continue;
+
+            std::uint64_t key = texture_cache::get_key(
+                data.directory + "/" + ref.path, wrapping, filtering_min,
+                filtering_mag, has_mipmap, mipmap_min, mipmap_mag, flip);
+            if (!texture_cache::contains(key))
+                paths.push_back(ref.path);
+        }
+    }
+
+    /* Every read is in flight at once, then the decoding runs on the
+     * workers */
+    std::vector<std::string> files(paths.size());
+    for (unsigned int i = 0; i < paths.size(); i++)
+        files[i] = texture::find_image(data.directory + "/" + paths[i]);
+    std::vector<types::asset> encoded = vfs::read_batch(files);
+
+    std::vector<types::image> images(paths.size());
+    thread_pool::parallel_for(paths.size(),
+                              [&](std::size_t i)
+                              {
+                                  images[i] = texture::decode_image(
+                                      encoded[i], files[i], flip);
+                              });
+    for (unsigned int i = 0; i < paths.size(); i++)
+        data.images[paths[i]] = std::move(images[i]);
+
+    return data;
+}
+
+model_handle model::load_async(std::string path, GLint wrapping,
+                               GLint filtering_min, GLint filtering_mag,
+                               GLboolean has_mipmap, GLint mipmap_min,
+                               GLint mipmap_mag, bool flip)
+{
+    model_handle handle;
+    handle.shared_state = std::make_shared<model_handle::state>();
+    handle.shared_state->pending = thread_pool::submit(
+        [=]()
+        {
+            return model::import_model(path, wrapping, filtering_min,
+                                       filtering_mag, has_mipmap, mipmap_min,
+                                       mipmap_mag, flip);
+        });
+    handle.shared_state->finish = [=](types::model_data &&data)
+    {
+        return std::make_shared<model>(std::move(data), wrapping,
+                                       filtering_min, filtering_mag,
+                                       has_mipmap, mipmap_min, mipmap_mag);
+    };
+    return handle;
+}
+
+void model::upload(types::model_data &data)
+{
+    this->directory = data.directory;
+    this->skeleton = std::move(data.skeleton);
+    this->animations = std::move(data.animations);
+    this->gpu_skinned =
+        !this->skeleton.joints.empty() && skinning::uses_gpu_skinning();
+
+    glm::vec3 min(INFINITY), max(-INFINITY);
+    for (auto &m : data.meshes)
+    {
+        for (auto &v : m.vertices)
+        {
+            min = glm::min(min, v.position);
+            max = glm::max(max, v.position);
+        }
+    }
+    if (min.x <= max.x)
+    {
+        this->bounds_center = (min + max) * 0.5f;
+        this->bounds_radius = glm::length(max - min) * 0.5f;
+    }
+
+    for (std::size_t i = 0; i < data.meshes.size(); i++)
+    {
+        auto &m = data.meshes[i];
+        std::vector<types::texture> textures;
+        for (auto &ref : m.textures)
+            textures.push_back(load_texture_ref(ref, data));
+
+        std::span<const types::vertex_skin> skin;
+        if (i < data.skins.size())
+            skin = data.skins[i];
+
+        meshes.emplace_back(m.vertices, m.indices, std::move(textures),
+                            this->wrapping, this->filtering_min,
+                            this->filtering_mag, this->has_mipmap,
+                            this->mipmap_min, this->mipmap_mag, skin);
+        meshes.back().set_meshlets(m.meshlets);
+
+        /* A model has as many levels as its most detailed mesh, the
+         * others repeat their coarsest level */
+        if (m.lods.empty())
+            continue;
+        meshes.back().set_lods(m.lods);
+        if (this->lod_errors.size() < m.lods.size())
+            this->lod_errors.resize(m.lods.size(), this->lod_errors.back());
+        for (std::size_t l = 0; l < this->lod_errors.size(); l++)
+        {
+            auto &lod = m.lods[std::min(l, m.lods.size() - 1)];
+            this->lod_errors[l] = std::max(this->lod_errors[l], lod.error);
+        }
+    }
+}
+
+bool model::import_assimp(const std::string &path, types::model_data &data)
 {
-    /* Load with assimp */
     Assimp::Importer importer;
-    const aiScene *scene =
-        importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    importer.SetIOHandler(new vfs_io_system());
+    const aiScene *scene = importer.ReadFile(path, import_flags);
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE
         || !scene->mRootNode)
     {
         ERROR("Could not load model with assimp: {}",
               importer.GetErrorString());
+        return false;
+    }
+
+    std::vector<aiMesh *> ai_meshes;
+    collect_meshes(scene->mRootNode, scene, ai_meshes);
+    process_skeleton(scene, data.skeleton);
+    process_animations(scene, data.skeleton, data.animations);
+
+    /* The storage is sized up front so that every mesh can be
+     * processed on its own thread */
+    data.meshes.resize(ai_meshes.size());
+    data.vertices.resize(ai_meshes.size());
+    data.indices.resize(ai_meshes.size());
+    data.skins.resize(ai_meshes.size());
+    thread_pool::parallel_for(
+        ai_meshes.size(),
+        [&](std::size_t i)
+        {
+            process_mesh(ai_meshes[i], scene, data.vertices[i],
+                         data.indices[i], data.meshes[i].textures);
+            process_skin(ai_meshes[i], data.skeleton, data.skins[i]);
+        });
+    return true;
+}
+
+bool model::import_obj(const std::string &path, types::model_data &data)
+{
+    types::obj_data obj;
+    if (!obj_parser::load(path, obj))
+        return false;
+
+    data.meshes.resize(obj.meshes.size());
+    data.vertices.resize(obj.meshes.size());
+    data.indices.resize(obj.meshes.size());
+    data.skins.resize(obj.meshes.size());
+    for (std::size_t i = 0; i < obj.meshes.size(); i++)
+    {
+        data.vertices[i] = std::move(obj.meshes[i].vertices);
+        data.indices[i] = std::move(obj.meshes[i].indices);
+        data.meshes[i].textures = std::move(obj.meshes[i].textures);
+    }
+    return true;
+}
+
+void model::process_meshes(const std::string &path, types::model_data &data)
+{
+    bool optimize = mesh_optimizer::is_enabled();
+    bool simplify = mesh_simplifier::is_enabled();
+    bool clusters = meshlet_builder::is_enabled();
+    unsigned int levels = mesh_simplifier::get_levels();
+    std::vector<types::vertex_cache_stats> before(data.meshes.size());
+    std::vector<types::vertex_cache_stats> after(data.meshes.size());
+    thread_pool::parallel_for(
+        data.meshes.size(),
+        [&](std::size_t i)
+        {
+            /* The optimizer reorders the vertices and the meshlets
+             * bounds move with the joints, skinned meshes only get
+             * the levels of detail */
+            bool skinned = !data.skins[i].empty();
+            if (optimize && !skinned)
+            {
+                before[i] = mesh_optimizer::analyze(data.indices[i],
+                                                    data.vertices[i].size());
+                mesh_optimizer::optimize(data.vertices[i], data.indices[i]);
+                after[i] = mesh_optimizer::analyze(data.indices[i],
+                                                   data.vertices[i].size());
+            }
+            /* The meshlets reorder the finest level only, so they
+             * are built before the coarser levels are appended */
+            if (clusters && !skinned)
+            {
+                data.meshes[i].meshlets =
+                    meshlet_builder::build(data.vertices[i], data.indices[i]);
+            }
+            if (simplify)
+            {
+                data.meshes[i].lods = mesh_simplifier::generate_lods(
+                    data.vertices[i], data.indices[i], levels);
+            }
+            data.meshes[i].vertices = data.vertices[i];
+            data.meshes[i].indices = data.indices[i];
+        });
+
+    if (optimize)
+        log_optimization(path, data, before, after);
+}
+
+bool model::load_cached_model(std::string path, types::model_data &data)
+{
+    if (!mesh_cache::is_enabled())
+        return false;
+
+    /* The mapping is owned by data and released after the meshes
+     * have been uploaded to the GPU */
+    return mesh_cache::load(path, get_cache_flags(), data.file, data.meshes);
+}
+
+void model::store_cached_model(std::string path,
+                               const types::model_data &data)
+{
+    /* The cache does not hold skeletons and clips yet, skinned models
+     * are imported with Assimp every time */
+    if (!mesh_cache::is_enabled() || !data.skeleton.joints.empty())
         return;
+
+    mesh_cache::store(path, get_cache_flags(), data.meshes);
+}
+
+std::uint64_t model::get_cache_flags()
+{
+    std::uint64_t flags = import_flags;
+    if (mesh_optimizer::is_enabled())
+        flags |= mesh_optimizer::import_flag;
+    if (meshlet_builder::is_enabled())
+        flags |= meshlet_builder::import_flag;
+    /* The native parser welds the vertices, Assimp does not */
+    if (obj_parser::is_enabled())
+        flags |= obj_parser::import_flag;
+    /* The number of levels changes the content of the cache too */
+    if (mesh_simplifier::is_enabled())
+        flags |= mesh_simplifier::import_flag
+                 | ((std::uint64_t) mesh_simplifier::get_levels() << 40);
+    return flags;
+}
+
+void model::log_optimization(
+    const std::string &path, const types::model_data &data,
+    const std::vector<types::vertex_cache_stats> &before,
+    const std::vector<types::vertex_cache_stats> &after)
+{
+    /* Average over the whole model, weighted by triangles and vertices */
+    float triangles = 0.0f, vertices = 0.0f;
+    types::vertex_cache_stats total_before, total_after;
+    for (unsigned int i = 0; i < data.meshes.size(); i++)
+    {
+        float t = data.indices[i].size() / 3.0f;
+        float v = data.vertices[i].size();
+        total_before.acmr += before[i].acmr * t;
+        total_after.acmr += after[i].acmr * t;
+        total_before.atvr += before[i].atvr * v;
+        total_after.atvr += after[i].atvr * v;
+        triangles += t;
+        vertices += v;
     }
-    directory = path.substr(0, path.find_last_of('/'));
+    if (triangles == 0.0f || vertices == 0.0f)
+        return;
 
-    process_node(scene->mRootNode, scene);
+    INFO("Optimized {}: ACMR {} -> {}, ATVR {} -> {}", path,
+         total_before.acmr / triangles, total_after.acmr / triangles,
+         total_before.atvr / vertices, total_after.atvr / vertices);
 }
 
-void model::process_node(aiNode *node, const aiScene *scene)
+void model::collect_meshes(aiNode *node, const aiScene *scene,
+                           std::vector<aiMesh *> &out)
 {
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
-        aiMesh *m = scene->mMeshes[node->mMeshes[i]];
-        meshes.push_back(process_mesh(m, scene));
+        out.push_back(scene->mMeshes[node->mMeshes[i]]);
     }
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        process_node(node->mChildren[i], scene);
+        collect_meshes(node->mChildren[i], scene, out);
     }
 }
 
-mesh model::process_mesh(aiMesh *m, const aiScene *scene)
+void model::process_mesh(aiMesh *m, const aiScene *scene,
+                         std::vector<types::vertex> &vertices,
+                         std::vector<unsigned int> &indices,
+                         std::vector<types::texture_ref> &textures)
 {
-    std::vector<types::vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<types::texture> textures;
-
+    vertices.reserve(m->mNumVertices);
     for (unsigned int i = 0; i < m->mNumVertices; i++)
     {
         types::vertex vertex;
@@ -119,6 +554,7 @@ mesh model::process_mesh(aiMesh *m, const aiScene *scene)
         vertices.push_back(vertex);
     }
 
+    indices.reserve(m->mNumFaces * 3);
     for (unsigned int i = 0; i < m->mNumFaces; i++)
     {
         aiFace face = m->mFaces[i];
@@ -129,56 +565,242 @@ mesh model::process_mesh(aiMesh *m, const aiScene *scene)
     if (m->mMaterialIndex >= 0)
     {
         aiMaterial *material = scene->mMaterials[m->mMaterialIndex];
-        std::vector<types::texture> diffuseMaps = load_material_textures(
+        std::vector<types::texture_ref> diffuseMaps = load_material_textures(
             material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        std::vector<types::texture> specularMaps = load_material_textures(
+        std::vector<types::texture_ref> specularMaps = load_material_textures(
             material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(),
                         specularMaps.end());
     }
+}
+
+void model::process_skin(aiMesh *m, const types::skeleton &skeleton,
+                         std::vector<types::vertex_skin> &skin)
+{
+    if (!m->HasBones() || skeleton.joints.empty())
+        return;
+
+    struct influence
+    {
+        unsigned int vertex;
+        std::uint32_t joint;
+        float weight;
+    };
+    std::vector<influence> influences;
+    for (unsigned int b = 0; b < m->mNumBones; b++)
+    {
+        const aiBone *bone = m->mBones[b];
+        int joint = skeleton.find(bone->mName.C_Str());
+        if (joint < 0)
+            continue;
+        for (unsigned int w = 0; w < bone->mNumWeights; w++)
+        {
+            const aiVertexWeight &weight = bone->mWeights[w];
+            if (weight.mVertexId < m->mNumVertices)
+                influences.push_back({weight.mVertexId, (std::uint32_t) joint,
+                                      weight.mWeight});
+        }
+    }
+
+    std::sort(influences.begin(), influences.end(),
+              [](const influence &a, const influence &b)
+              { return a.vertex < b.vertex; });
 
-    return mesh(vertices, indices, textures, this->wrapping,
-                this->filtering_min, this->filtering_mag, this->has_mipmap,
-                this->mipmap_min, this->mipmap_mag);
+    skin.assign(m->mNumVertices, types::vertex_skin{});
+    std::vector<std::uint32_t> joints;
+    std::vector<float> weights;
+    for (std::size_t i = 0; i < influences.size();)
+    {
+        unsigned int vertex = influences[i].vertex;
+        joints.clear();
+        weights.clear();
+        for (; i < influences.size() && influences[i].vertex == vertex; i++)
+        {
+            joints.push_back(influences[i].joint);
+            weights.push_back(influences[i].weight);
+        }
+        skin[vertex] = skinning::pack_influences(joints, weights);
+    }
 }
 
-std::vector<types::texture> model::load_material_textures(aiMaterial *mat,
-                                                          aiTextureType type,
-                                                          std::string typeName)
+void model::process_skeleton(const aiScene *scene, types::skeleton &skeleton)
 {
-    std::vector<types::texture> textures;
-    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    std::unordered_map<std::string, glm::mat4> offsets;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++)
     {
-        aiString str;
-        mat->GetTexture(type, i, &str);
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
+        const aiMesh *m = scene->mMeshes[i];
+        for (unsigned int b = 0; b < m->mNumBones; b++)
         {
-            if (std::strcmp(textures_loaded[j].path.c_str(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
+            offsets.try_emplace(m->mBones[b]->mName.C_Str(),
+                                to_glm(m->mBones[b]->mOffsetMatrix));
         }
-        if (!skip)
+    }
+    if (offsets.empty())
+        return;
+
+    collect_joints(scene->mRootNode, -1, offsets, skeleton);
+}
+
+void model::collect_joints(
+    const aiNode *node, int parent,
+    const std::unordered_map<std::string, glm::mat4> &offsets,
+    types::skeleton &skeleton)
+{
+    std::size_t index = skeleton.joints.size();
+
+    types::joint joint;
+    joint.name = node->mName.C_Str();
+    joint.parent = parent;
+    auto offset = offsets.find(joint.name);
+    bool is_bone = offset != offsets.end();
+    if (is_bone)
+        joint.inverse_bind = offset->second;
+
+    aiVector3D scaling, position;
+    aiQuaternion rotation;
+    node->mTransformation.Decompose(scaling, rotation, position);
+    joint.bind_pose.translation = glm::vec3(position.x, position.y, position.z);
+    joint.bind_pose.rotation =
+        glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+    joint.bind_pose.scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+    skeleton.joints.push_back(std::move(joint));
+
+    for (unsigned int i = 0; i < node->mNumChildren; i++)
+        collect_joints(node->mChildren[i], index, offsets, skeleton);
+
+    /* The nodes above the bones are kept since they move the whole
+     * skeleton, the other branches are dropped */
+    if (!is_bone && skeleton.joints.size() == index + 1)
+        skeleton.joints.pop_back();
+}
+
+void model::process_animations(const aiScene *scene,
+                               const types::skeleton &skeleton,
+                               std::vector<types::compressed_clip> &clips)
+{
+    if (skeleton.joints.empty())
+        return;
+
+    for (unsigned int a = 0; a < scene->mNumAnimations; a++)
+    {
+        const aiAnimation *animation = scene->mAnimations[a];
+        double ticks = animation->mTicksPerSecond > 0.0
+                           ? animation->mTicksPerSecond
+                           : 25.0;
+
+        types::animation_clip clip;
+        clip.name = animation->mName.C_Str();
+        clip.duration = animation->mDuration / ticks;
+        for (unsigned int c = 0; c < animation->mNumChannels; c++)
         {
-            types::texture texture;
-            std::string path = directory + "/" + std::string(str.C_Str());
-            texture.id = texture::load_texture(
-                path, this->wrapping, this->filtering_min, this->filtering_mag,
-                this->has_mipmap, this->mipmap_min, this->mipmap_mag,
-                this->flip);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture);
+            const aiNodeAnim *channel = animation->mChannels[c];
+            int joint = skeleton.find(channel->mNodeName.C_Str());
+            if (joint < 0)
+                continue;
+
+            types::animation_track track;
+            track.joint = joint;
+            for (unsigned int k = 0; k < channel->mNumPositionKeys; k++)
+            {
+                const aiVectorKey &key = channel->mPositionKeys[k];
+                track.translations.push_back(
+                    {(float) (key.mTime / ticks),
+                     glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            for (unsigned int k = 0; k < channel->mNumRotationKeys; k++)
+            {
+                const aiQuatKey &key = channel->mRotationKeys[k];
+                track.rotations.push_back(
+                    {(float) (key.mTime / ticks),
+                     glm::quat(key.mValue.w, key.mValue.x, key.mValue.y,
+                               key.mValue.z)});
+            }
+            for (unsigned int k = 0; k < channel->mNumScalingKeys; k++)
+            {
+                const aiVectorKey &key = channel->mScalingKeys[k];
+                track.scales.push_back(
+                    {(float) (key.mTime / ticks),
+                     glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            clip.tracks.push_back(std::move(track));
         }
+
+        /* The raw tracks are dropped as soon as they are compressed */
+        clips.push_back(animation_compression::compress(clip, skeleton));
+        DEBUG("Compressed clip {}: {} -> {} bytes", clip.name,
+              animation_compression::get_size(clip),
+              animation_compression::get_size(clips.back()));
+    }
+}
+
+std::vector<types::texture_ref>
+model::load_material_textures(aiMaterial *mat, aiTextureType type,
+                              std::string typeName)
+{
+    std::vector<types::texture_ref> textures;
+    for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+    {
+        aiString str;
+        mat->GetTexture(type, i, &str);
+        textures.push_back({typeName, str.C_Str()});
     }
     return textures;
 }
 
+types::texture model::load_texture_ref(const types::texture_ref &ref,
+                                       types::model_data &data)
+{
+    /* Shared textures are decoded and uploaded once by the cache */
+    unsigned int id = texture_cache::load(
+        directory + "/" + ref.path, data.images[ref.path], this->wrapping,
+        this->filtering_min, this->filtering_mag, this->has_mipmap,
+        this->mipmap_min, this->mipmap_mag, this->flip);
+    textures_loaded.emplace_back(id);
+
+    types::texture texture;
+    texture.id = id;
+    texture.type = ref.type;
+    texture.path = ref.path;
+    return texture;
+}
+
+model_handle::model_handle(std::shared_ptr<model> resident)
+{
+    this->shared_state = std::make_shared<state>();
+    this->shared_state->resident = resident;
+}
+
+bool model_handle::is_valid() const
+{
+    return this->shared_state != nullptr;
+}
+
+bool model_handle::is_resident()
+{
+    if (!this->shared_state)
+        return false;
+    if (this->shared_state->resident)
+        return true;
+
+    auto &pending = this->shared_state->pending;
+    if (!pending.valid()
+        || pending.wait_for(std::chrono::seconds(0))
+               != std::future_status::ready)
+        return false;
+
+    this->shared_state->resident = this->shared_state->finish(pending.get());
+    this->shared_state->finish = nullptr;
+    return true;
+}
+
+std::shared_ptr<model> model_handle::get() const
+{
+    if (!this->shared_state)
+        return nullptr;
+    return this->shared_state->resident;
+}
+
 model::builder &model::builder::set_path(std::string path)
 {
     this->path = path;
@@ -0,0 +1,105 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "model_registry.hpp"
+
+#include "engine_hash.hpp"
+#include "engine_logger.hpp"
+
+#include <filesystem>
+
+using namespace brenta;
+
+std::unordered_map<std::uint64_t, model_registry::entry>
+    model_registry::models;
+std::mutex model_registry::mutex;
+
+model_handle model_registry::load(std::string path, GLint wrapping,
+                                  GLint filtering_min, GLint filtering_mag,
+                                  GLboolean has_mipmap, GLint mipmap_min,
+                                  GLint mipmap_mag, bool flip)
+{
+    /* The same file reached through different paths is the same model */
+    std::error_code ec;
+    std::string canonical =
+        std::filesystem::weakly_canonical(path, ec).string();
+    if (ec)
+        canonical = path;
+
+    std::uint64_t key = hash::fnv1a(canonical);
+    key = hash::combine(key, wrapping);
+    key = hash::combine(key, filtering_min);
+    key = hash::combine(key, filtering_mag);
+    key = hash::combine(key, has_mipmap);
+    key = hash::combine(key, mipmap_min);
+    key = hash::combine(key, mipmap_mag);
+    key = hash::combine(key, flip);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = models.find(key);
+    if (it != models.end() && it->second.path == canonical)
+    {
+        if (auto state = it->second.state.lock())
+        {
+            model_handle handle;
+            handle.shared_state = state;
+            return handle;
+        }
+    }
+
+    collect();
+    model_handle handle =
+        model::load_async(canonical, wrapping, filtering_min, filtering_mag,
+                          has_mipmap, mipmap_min, mipmap_mag, flip);
+    models[key] = {canonical, handle.shared_state};
+    DEBUG("Model registered: {}", canonical);
+    return handle;
+}
+
+std::size_t model_registry::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    collect();
+    return models.size();
+}
+
+void model_registry::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    models.clear();
+}
+
+void model_registry::collect()
+{
+    for (auto it = models.begin(); it != models.end();)
+    {
+        if (it->second.state.expired())
+            it = models.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,741 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "obj_parser.hpp"
+
+#include "engine_logger.hpp"
+#include "thread_pool.hpp"
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <span>
+
+using namespace brenta;
+
+bool obj_parser::enabled = false;
+
+namespace
+{
+
+/* Component of a face corner that is not in the file */
+constexpr std::int32_t missing = INT32_MIN;
+
+/* A corner of a triangle, indices of the position, the texture
+ * coordinates and the normal. Negative OBJ indices are relative to
+ * the elements read so far: a chunk only knows its own, so they are
+ * stored as indices local to the chunk, marked in relative, and
+ * moved when the chunks are merged */
+struct corner
+{
+    std::int32_t index[3];
+    std::uint8_t relative;
+};
+
+/* An "o", "g" or "usemtl" line, applies from the corner It is at */
+struct group_event
+{
+    bool is_material;
+    std::string name;
+    std::size_t corner;
+};
+
+struct chunk
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> tex_coords;
+    std::vector<glm::vec3> normals;
+    std::vector<corner> corners;
+    std::vector<group_event> events;
+    std::vector<std::string> libraries;
+    bool valid = true;
+};
+
+/* A run of corners with the same object and material */
+struct segment
+{
+    std::string name;
+    std::string material;
+    std::size_t begin;
+    std::size_t end;
+};
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char *skip_spaces(const char *p, const char *end)
+{
+    while (p != end && is_space(*p))
+        p++;
+    return p;
+}
+
+std::string_view trim(const char *p, const char *end)
+{
+    p = skip_spaces(p, end);
+    while (end != p && is_space(end[-1]))
+        end--;
+    return std::string_view(p, end - p);
+}
+
+/* Indices too large for 32 bits are read whole and saturate above
+ * INT32_MAX, resolve_index rejects them */
+const char *parse_index(const char *p, const char *end, std::int64_t &value)
+{
+    bool negative = p != end && *p == '-';
+    const char *digits = negative ? p + 1 : p;
+    std::int64_t result = 0;
+    const char *q = digits;
+    for (; q != end && (unsigned char) (*q - '0') < 10; q++)
+    {
+        if (result <= INT32_MAX)
+            result = result * 10 + (*q - '0');
+    }
+    if (q == digits)
+        return p;
+    value = negative ? -result : result;
+    return q;
+}
+
+/* SWAR digit conversion, see "Number Parsing at a Gigabyte per
+ * Second" by Daniel Lemire. Only valid on little endian machines */
+bool is_eight_digits(std::uint64_t v)
+{
+    return ((v & 0xF0F0F0F0F0F0F0F0)
+            | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+           == 0x3333333333333333;
+}
+
+std::uint32_t parse_eight_digits(std::uint64_t v)
+{
+    constexpr std::uint64_t mask = 0x000000FF000000FF;
+    constexpr std::uint64_t mul1 = 100 + (1000000ULL << 32);
+    constexpr std::uint64_t mul2 = 1 + (10000ULL << 32);
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return (std::uint32_t) v;
+}
+
+bool is_four_digits(std::uint32_t v)
+{
+    return ((v & 0xF0F0F0F0) | (((v + 0x06060606) & 0xF0F0F0F0) >> 4))
+           == 0x33333333;
+}
+
+std::uint32_t parse_four_digits(std::uint32_t v)
+{
+    v -= 0x30303030;
+    v = (v * 10) + (v >> 8);
+    return (v & 0xFF) * 100 + ((v >> 16) & 0xFF);
+}
+
+/* Accumulates the digits at p in mantissa, up to 19 of them. The
+ * integer digits that do not fit are counted in exponent */
+const char *read_digits(const char *p, const char *last,
+                        std::uint64_t &mantissa, int &digits, int &exponent,
+                        bool &truncated)
+{
+    if constexpr (std::endian::native == std::endian::little)
+    {
+        while (last - p >= 8 && digits <= 11)
+        {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            if (!is_eight_digits(v))
+                break;
+            mantissa = mantissa * 100000000 + parse_eight_digits(v);
+            digits += 8;
+            p += 8;
+        }
+        if (last - p >= 4 && digits <= 15)
+        {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            if (is_four_digits(v))
+            {
+                mantissa = mantissa * 10000 + parse_four_digits(v);
+                digits += 4;
+                p += 4;
+            }
+        }
+    }
+    while (p != last && (unsigned char) (*p - '0') < 10)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits++;
+        }
+        else
+        {
+            truncated = true;
+            exponent++;
+        }
+        p++;
+    }
+    return p;
+}
+
+/* Out of range indices are rejected, so that no index can be mistaken
+ * for missing */
+bool resolve_index(std::int64_t value, std::size_t count, std::int32_t &out,
+                   std::uint8_t &relative, int component)
+{
+    if (value > 0 && value <= INT32_MAX)
+        out = (std::int32_t) (value - 1);
+    else if (value < 0 && value > INT32_MIN && count <= INT32_MAX)
+    {
+        /* May point before the chunk, the merge adds its offset */
+        out = (std::int32_t) ((std::int64_t) count + value);
+        relative |= 1 << component;
+    }
+    else
+        return false;
+    return true;
+}
+
+const char *parse_vector(const char *p, const char *end, float *out,
+                         int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        p = skip_spaces(p, end);
+        out[i] = 0.0f;
+        p = obj_parser::parse_float(p, end, out[i]);
+    }
+    return p;
+}
+
+void parse_face(const char *p, const char *end, chunk &out,
+                std::vector<corner> &polygon)
+{
+    polygon.clear();
+    while (true)
+    {
+        p = skip_spaces(p, end);
+        corner c = {{missing, missing, missing}, 0};
+        std::int64_t value;
+        const char *q = parse_index(p, end, value);
+        if (q == p)
+            break;
+        p = q;
+        if (!resolve_index(value, out.positions.size(), c.index[0],
+                           c.relative, 0))
+            out.valid = false;
+        if (p != end && *p == '/')
+        {
+            p++;
+            q = parse_index(p, end, value);
+            if (q != p
+                && !resolve_index(value, out.tex_coords.size(), c.index[1],
+                                  c.relative, 1))
+                out.valid = false;
+            p = q;
+            if (p != end && *p == '/')
+            {
+                p++;
+                q = parse_index(p, end, value);
+                if (q != p
+                    && !resolve_index(value, out.normals.size(),
+                                      c.index[2], c.relative, 2))
+                    out.valid = false;
+                p = q;
+            }
+        }
+        polygon.push_back(c);
+    }
+
+    /* Triangulate as a fan, like Assimp does for convex polygons */
+    for (std::size_t i = 2; i < polygon.size(); i++)
+    {
+        out.corners.push_back(polygon[0]);
+        out.corners.push_back(polygon[i - 1]);
+        out.corners.push_back(polygon[i]);
+    }
+}
+
+void parse_chunk(const char *p, const char *end, chunk &out)
+{
+    std::vector<corner> polygon;
+    while (p < end)
+    {
+        const char *line_end =
+            (const char *) std::memchr(p, '\n', end - p);
+        if (line_end == nullptr)
+            line_end = end;
+
+        const char *key = skip_spaces(p, line_end);
+        const char *key_end = key;
+        while (key_end != line_end && !is_space(*key_end))
+            key_end++;
+        std::string_view keyword(key, key_end - key);
+
+        if (keyword == "v")
+        {
+            glm::vec3 v;
+            parse_vector(key_end, line_end, &v.x, 3);
+            out.positions.push_back(v);
+        }
+        else if (keyword == "vt")
+        {
+            glm::vec2 v;
+            parse_vector(key_end, line_end, &v.x, 2);
+            out.tex_coords.push_back(v);
+        }
+        else if (keyword == "vn")
+        {
+            glm::vec3 v;
+            parse_vector(key_end, line_end, &v.x, 3);
+            out.normals.push_back(v);
+        }
+        else if (keyword == "f")
+            parse_face(key_end, line_end, out, polygon);
+        else if (keyword == "o" || keyword == "g")
+        {
+            out.events.push_back({false,
+                                  std::string(trim(key_end, line_end)),
+                                  out.corners.size()});
+        }
+        else if (keyword == "usemtl")
+        {
+            out.events.push_back({true, std::string(trim(key_end, line_end)),
+                                  out.corners.size()});
+        }
+        else if (keyword == "mtllib")
+            out.libraries.emplace_back(trim(key_end, line_end));
+
+        p = line_end == end ? end : line_end + 1;
+    }
+}
+
+std::uint64_t hash_corner(const corner &c)
+{
+    std::uint64_t h = (std::uint32_t) c.index[0] * 0x9E3779B97F4A7C15ULL;
+    h ^= (std::uint32_t) c.index[1] * 0xC2B2AE3D27D4EB4FULL;
+    h ^= (std::uint32_t) c.index[2] * 0x165667B19E3779F9ULL;
+    return h ^ (h >> 29);
+}
+
+/* Welds the corners of a segment in a hash table and emits the
+ * vertices in the order they are first used */
+void emit_mesh(std::span<const corner> corners,
+               const std::vector<glm::vec3> &positions,
+               const std::vector<glm::vec2> &tex_coords,
+               const std::vector<glm::vec3> &normals, types::obj_mesh &mesh)
+{
+    constexpr std::uint32_t empty = UINT32_MAX;
+    std::size_t capacity = std::bit_ceil(corners.size() * 2);
+    std::vector<std::uint32_t> table(capacity, empty);
+    std::vector<const corner *> unique;
+
+    mesh.indices.reserve(corners.size());
+    for (const corner &c : corners)
+    {
+        std::size_t slot = hash_corner(c) & (capacity - 1);
+        while (table[slot] != empty)
+        {
+            const corner *other = unique[table[slot]];
+            if (std::memcmp(other->index, c.index, sizeof(c.index)) == 0)
+                break;
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] == empty)
+        {
+            table[slot] = unique.size();
+            unique.push_back(&c);
+        }
+        mesh.indices.push_back(table[slot]);
+    }
+
+    bool smooth = false;
+    mesh.vertices.resize(unique.size());
+    for (std::size_t i = 0; i < unique.size(); i++)
+    {
+        const corner &c = *unique[i];
+        types::vertex &v = mesh.vertices[i];
+        v.position = positions[c.index[0]];
+        v.tex_coords = glm::vec2(0.0f);
+        if (c.index[1] != missing)
+        {
+            /* Flipped like aiProcess_FlipUVs does */
+            v.tex_coords = glm::vec2(tex_coords[c.index[1]].x,
+                                     1.0f - tex_coords[c.index[1]].y);
+        }
+        v.normal = glm::vec3(0.0f);
+        if (c.index[2] != missing)
+            v.normal = normals[c.index[2]];
+        else
+            smooth = true;
+    }
+    if (!smooth)
+        return;
+
+    /* Area weighted average of the faces around the vertices that
+     * have no normal in the file */
+    for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        unsigned int a = mesh.indices[i], b = mesh.indices[i + 1],
+                     c = mesh.indices[i + 2];
+        glm::vec3 normal = glm::cross(
+            mesh.vertices[b].position - mesh.vertices[a].position,
+            mesh.vertices[c].position - mesh.vertices[a].position);
+        for (unsigned int v : {a, b, c})
+        {
+            if (unique[v]->index[2] == missing)
+                mesh.vertices[v].normal += normal;
+        }
+    }
+    for (std::size_t i = 0; i < unique.size(); i++)
+    {
+        glm::vec3 &normal = mesh.vertices[i].normal;
+        if (unique[i]->index[2] == missing && glm::length(normal) > 0.0f)
+            normal = glm::normalize(normal);
+    }
+}
+
+} // namespace
+
+void obj_parser::set_enabled(bool enabled)
+{
+    obj_parser::enabled = enabled;
+}
+
+bool obj_parser::is_enabled()
+{
+    return obj_parser::enabled;
+}
+
+bool obj_parser::can_load(const std::string &path)
+{
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == ".obj";
+}
+
+bool obj_parser::load(const std::string &path, types::obj_data &data)
+{
+    types::asset file = vfs::read(path);
+    if (!file.is_valid())
+    {
+        ERROR("Could not read OBJ file: {}", path);
+        return false;
+    }
+    if (!parse(file.str(), data))
+    {
+        ERROR("Malformed OBJ file: {}", path);
+        return false;
+    }
+
+    /* Material libraries are relative to the model */
+    std::size_t slash = path.find_last_of('/');
+    std::string directory =
+        slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    std::vector<std::string> paths;
+    for (const auto &library : data.libraries)
+        paths.push_back(directory + library);
+
+    std::unordered_map<std::string, std::vector<types::texture_ref>>
+        materials;
+    std::vector<types::asset> libraries = vfs::read_batch(paths);
+    for (std::size_t i = 0; i < libraries.size(); i++)
+    {
+        if (!libraries[i].is_valid())
+        {
+            WARN("Could not read material library: {}", paths[i]);
+            continue;
+        }
+        for (auto &[name, textures] : parse_materials(libraries[i].str()))
+            materials.insert_or_assign(name, std::move(textures));
+    }
+
+    for (auto &mesh : data.meshes)
+    {
+        auto it = materials.find(mesh.material);
+        if (it != materials.end())
+            mesh.textures = it->second;
+    }
+    return true;
+}
+
+bool obj_parser::parse(std::string_view source, types::obj_data &data)
+{
+    /* Split at line boundaries, every chunk is parsed on its own */
+    std::vector<std::pair<const char *, const char *>> ranges;
+    const char *p = source.data();
+    const char *end = p + source.size();
+    while (p < end)
+    {
+        const char *split =
+            (std::size_t) (end - p) > chunk_size ? p + chunk_size : end;
+        if (split != end)
+        {
+            const char *newline =
+                (const char *) std::memchr(split, '\n', end - split);
+            split = newline == nullptr ? end : newline + 1;
+        }
+        ranges.push_back({p, split});
+        p = split;
+    }
+
+    std::vector<chunk> chunks(ranges.size());
+    thread_pool::parallel_for(
+        ranges.size(), [&](std::size_t i)
+        { parse_chunk(ranges[i].first, ranges[i].second, chunks[i]); });
+
+    /* Offsets of every chunk in the merged arrays */
+    std::size_t count[3] = {0, 0, 0};
+    std::size_t corner_count = 0;
+    std::vector<std::array<std::size_t, 4>> offsets(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); i++)
+    {
+        if (!chunks[i].valid)
+            return false;
+        offsets[i] = {count[0], count[1], count[2], corner_count};
+        count[0] += chunks[i].positions.size();
+        count[1] += chunks[i].tex_coords.size();
+        count[2] += chunks[i].normals.size();
+        corner_count += chunks[i].corners.size();
+    }
+
+    std::vector<glm::vec3> positions(count[0]);
+    std::vector<glm::vec2> tex_coords(count[1]);
+    std::vector<glm::vec3> normals(count[2]);
+    std::vector<corner> corners(corner_count);
+    std::atomic<bool> valid = true;
+    thread_pool::parallel_for(
+        chunks.size(),
+        [&](std::size_t i)
+        {
+            chunk &c = chunks[i];
+            std::copy(c.positions.begin(), c.positions.end(),
+                      positions.begin() + offsets[i][0]);
+            std::copy(c.tex_coords.begin(), c.tex_coords.end(),
+                      tex_coords.begin() + offsets[i][1]);
+            std::copy(c.normals.begin(), c.normals.end(),
+                      normals.begin() + offsets[i][2]);
+
+            corner *out = corners.data() + offsets[i][3];
+            for (std::size_t j = 0; j < c.corners.size(); j++)
+            {
+                corner resolved = c.corners[j];
+                for (int k = 0; k < 3; k++)
+                {
+                    std::int64_t index = resolved.index[k];
+                    if (index == missing)
+                        continue;
+                    if (resolved.relative & (1 << k))
+                        index += offsets[i][k];
+                    if (index < 0 || (std::size_t) index >= count[k])
+                        valid = false;
+                    resolved.index[k] = (std::int32_t) index;
+                }
+                resolved.relative = 0;
+                out[j] = resolved;
+            }
+        });
+    if (!valid)
+        return false;
+
+    /* Objects, groups and materials split the corners in meshes */
+    std::vector<segment> segments;
+    segment current = {"", "", 0, 0};
+    for (std::size_t i = 0; i < chunks.size(); i++)
+    {
+        for (auto &library : chunks[i].libraries)
+            data.libraries.push_back(std::move(library));
+        for (auto &event : chunks[i].events)
+        {
+            std::size_t at = offsets[i][3] + event.corner;
+            if (at > current.begin)
+            {
+                current.end = at;
+                segments.push_back(current);
+                current.begin = at;
+            }
+            if (event.is_material)
+                current.material = std::move(event.name);
+            else
+                current.name = std::move(event.name);
+        }
+    }
+    if (corner_count > current.begin)
+    {
+        current.end = corner_count;
+        segments.push_back(current);
+    }
+
+    std::size_t first = data.meshes.size();
+    data.meshes.resize(first + segments.size());
+    thread_pool::parallel_for(
+        segments.size(),
+        [&](std::size_t i)
+        {
+            types::obj_mesh &mesh = data.meshes[first + i];
+            mesh.name = segments[i].name;
+            mesh.material = segments[i].material;
+            std::span<const corner> range(
+                corners.data() + segments[i].begin,
+                segments[i].end - segments[i].begin);
+            emit_mesh(range, positions, tex_coords, normals, mesh);
+        });
+    return true;
+}
+
+std::unordered_map<std::string, std::vector<types::texture_ref>>
+obj_parser::parse_materials(std::string_view source)
+{
+    std::unordered_map<std::string, std::vector<types::texture_ref>>
+        materials;
+    std::vector<types::texture_ref> *current = nullptr;
+
+    const char *p = source.data();
+    const char *end = p + source.size();
+    while (p < end)
+    {
+        const char *line_end =
+            (const char *) std::memchr(p, '\n', end - p);
+        if (line_end == nullptr)
+            line_end = end;
+
+        const char *key = skip_spaces(p, line_end);
+        const char *key_end = key;
+        while (key_end != line_end && !is_space(*key_end))
+            key_end++;
+        std::string_view keyword(key, key_end - key);
+        std::string_view value = trim(key_end, line_end);
+
+        /* Map options like "-s 1 1 1" come before the file name */
+        if ((keyword == "map_Kd" || keyword == "map_Ks") && !value.empty()
+            && value[0] == '-')
+        {
+            std::size_t space = value.find_last_of(" \t");
+            if (space != std::string_view::npos)
+                value = value.substr(space + 1);
+        }
+
+        if (keyword == "newmtl")
+            current = &materials[std::string(value)];
+        else if (keyword == "map_Kd" && current != nullptr)
+            current->push_back({"texture_diffuse", std::string(value)});
+        else if (keyword == "map_Ks" && current != nullptr)
+            current->push_back({"texture_specular", std::string(value)});
+
+        p = line_end == end ? end : line_end + 1;
+    }
+    return materials;
+}
+
+const char *obj_parser::parse_float(const char *first, const char *last,
+                                    float &value)
+{
+    const char *p = first;
+    bool negative = false;
+    if (p != last && (*p == '-' || *p == '+'))
+    {
+        negative = *p == '-';
+        p++;
+    }
+
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    const char *integer = p;
+    p = read_digits(p, last, mantissa, digits, exponent, truncated);
+    bool any = p != integer;
+    if (p != last && *p == '.')
+    {
+        const char *fraction = ++p;
+        int integer_digits = digits;
+        int integer_exponent = exponent;
+        p = read_digits(p, last, mantissa, digits, exponent, truncated);
+        /* The fraction digits that fit scale the mantissa down, the
+         * others are dropped */
+        exponent = integer_exponent - (digits - integer_digits);
+        any = any || p != fraction;
+    }
+    /* from_chars does not accept a plus sign */
+    const char *start = first != last && *first == '+' ? first + 1 : first;
+    if (!any)
+    {
+        /* Not a decimal number, maybe "inf" or "nan" */
+        auto result = std::from_chars(start, last, value);
+        return result.ec == std::errc() ? result.ptr : first;
+    }
+
+    if (p != last && (*p == 'e' || *p == 'E'))
+    {
+        const char *q = p + 1;
+        bool negative_exponent = q != last && *q == '-';
+        if (q != last && (*q == '-' || *q == '+'))
+            q++;
+        if (q != last && (unsigned char) (*q - '0') < 10)
+        {
+            int e = 0;
+            while (q != last && (unsigned char) (*q - '0') < 10)
+            {
+                if (e < 10000)
+                    e = e * 10 + (*q - '0');
+                q++;
+            }
+            exponent += negative_exponent ? -e : e;
+            p = q;
+        }
+    }
+
+    /* Both the mantissa and the power of ten are exact doubles, so
+     * the result is correctly rounded */
+    static constexpr double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (!truncated && mantissa <= (1ULL << 53) && exponent >= -22
+        && exponent <= 22)
+    {
+        double result = (double) mantissa;
+        result = exponent < 0 ? result / powers[-exponent]
+                              : result * powers[exponent];
+        value = (float) (negative ? -result : result);
+        return p;
+    }
+
+    auto result = std::from_chars(start, p, value);
+    if (result.ec == std::errc::result_out_of_range)
+        value = exponent < 0 ? 0.0f : (negative ? -INFINITY : INFINITY);
+    return p;
+}
@@ -27,11 +27,13 @@
 #include "particles.hpp"
 
 #include "camera.hpp"
+#include "embedded_assets.hpp"
+#include "gl_helper.hpp"
+#include "screen.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
-#include "translation.hpp"
+#include "uniform_buffers.hpp"
 
-#include <filesystem>
 #include <iostream>
 #include <time.h>
 
@@ -82,43 +84,45 @@ particle_emitter::particle_emitter(
     // Create shaders
     const GLchar *varyings[] = {"outPosition", "outVelocity", "outTTL"};
     shader::create(
-        varyings, 3, "particle_update", GL_VERTEX_SHADER,
-        std::filesystem::absolute("engine/shaders/particle_update.vs"));
+        "particle_update",
+        {{GL_VERTEX_SHADER,
+          embedded_assets::get_text("engine/shaders/particle_update.vs")}},
+        varyings, 3);
     shader::create(
-        "particle_render", GL_VERTEX_SHADER,
-        std::filesystem::absolute("engine/shaders/particle_render.vs").string(),
-        GL_GEOMETRY_SHADER,
-        std::filesystem::absolute("engine/shaders/particle_render.gs").string(),
-        GL_FRAGMENT_SHADER,
-        std::filesystem::absolute("engine/shaders/particle_render.fs")
-            .string());
+        "particle_render",
+        {{GL_VERTEX_SHADER,
+          embedded_assets::get_text("engine/shaders/particle_render.vs")},
+         {GL_GEOMETRY_SHADER,
+          embedded_assets::get_text("engine/shaders/particle_render.gs")},
+         {GL_FRAGMENT_SHADER,
+          embedded_assets::get_text("engine/shaders/particle_render.fs")}});
 
     // This is needed to render points
     glEnable(GL_PROGRAM_POINT_SIZE);
 
     this->vao.init();
     this->vao.bind();
-    check_opengl_error("vao bind");
+    check_error();
 
     // Create fbos
     this->fbo[0] = types::buffer(GL_TRANSFORM_FEEDBACK_BUFFER);
     this->fbo[1] = types::buffer(GL_TRANSFORM_FEEDBACK_BUFFER);
 
-    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, this->fbo[0].id);
+    gl::bind_buffer(GL_TRANSFORM_FEEDBACK_BUFFER, this->fbo[0].id);
     glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER,
                  this->num_particles * 2 * sizeof(glm::vec3)
                      + this->num_particles * sizeof(float),
                  NULL, GL_DYNAMIC_COPY);
-    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, this->fbo[1].id);
+    gl::bind_buffer(GL_TRANSFORM_FEEDBACK_BUFFER, this->fbo[1].id);
     glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER,
                  this->num_particles * 2 * sizeof(glm::vec3)
                      + this->num_particles * sizeof(float),
                  NULL, GL_DYNAMIC_COPY);
-    check_opengl_error("glBindBufferBase A");
+    check_error();
 
     // Unbind buffers
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl::bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl::bind_vertex_array(0);
     this->vao.unbind();
 }
 
@@ -141,14 +145,14 @@ void particle_emitter::update_particles(float delta_time)
     shader::set_vec3("particle_update", "emitterVel", this->starting_velocity);
     shader::set_float("particle_update", "emitterTTL",
                       this->starting_time_to_live);
-    check_opengl_error("settin update shader");
+    check_error();
 
     this->vao.bind();
 
-    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, fbo[current].id);
-    check_opengl_error("glBindBufferBase B");
+    gl::bind_buffer_base(GL_TRANSFORM_FEEDBACK_BUFFER, 0, fbo[current].id);
+    check_error();
 
-    glBindBuffer(GL_ARRAY_BUFFER, fbo[!current].id);
+    gl::bind_buffer(GL_ARRAY_BUFFER, fbo[!current].id);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
                           2 * sizeof(glm::vec3) + sizeof(float), (void *) 0);
     glEnableVertexAttribArray(0);
@@ -164,17 +168,17 @@ void particle_emitter::update_particles(float delta_time)
     // Start transform feedback
     glEnable(GL_RASTERIZER_DISCARD);     // Disable rasterization
     glBeginTransformFeedback(GL_POINTS); // Enter transform feedback mode
-    check_opengl_error("glBeginTransformFeedback");
+    check_error();
 
     glDrawArrays(GL_POINTS, 0, num_particles);
-    check_opengl_error("glDrawTransformFeedback");
+    check_error();
 
     glEndTransformFeedback();         // Exit transform feedback mode
     glDisable(GL_RASTERIZER_DISCARD); // Enable rasterization
     // Unbind buffers
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    gl::bind_vertex_array(0);
+    gl::bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl::bind_buffer_base(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
     this->vao.unbind();
     current = !current; // Swap buffers
 }
@@ -192,22 +196,20 @@ void particle_emitter::render_particles()
 
     this->vao.bind();
 
-    glBindBuffer(GL_ARRAY_BUFFER, fbo[current].id);
+    gl::bind_buffer(GL_ARRAY_BUFFER, fbo[current].id);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
                           2 * sizeof(glm::vec3) + sizeof(float), (void *) 0);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE,
                           2 * sizeof(glm::vec3) + sizeof(float),
                           (void *) (2 * sizeof(glm::vec3)));
-    check_opengl_error("glVertexAttribPointer");
+    check_error();
     glEnableVertexAttribArray(1);
 
     // Set uniforms
-    types::translation t = types::translation();
-    t.set_view(this->cam->get_view_matrix());
-    t.set_projection(this->cam->get_projection_matrix());
-    t.set_model(glm::mat4(1.0f));
-    t.set_shader("particle_render");
+    uniform_buffers::set_camera(this->cam->get_view_matrix(),
+                                this->cam->get_projection_matrix(),
+                                this->cam->get_position());
     shader::set_int("particle_render", "atlas_width", this->atlas_width);
     shader::set_int("particle_render", "atlas_height", this->atlas_height);
     shader::set_int("particle_render", "atlas_index", this->atlas_index);
@@ -223,23 +225,13 @@ void particle_emitter::render_particles()
                           GL_NEAREST);
 
     glDrawArrays(GL_POINTS, 0, num_particles);
-    check_opengl_error("glDrawArrays");
+    check_error();
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    gl::bind_buffer(GL_ARRAY_BUFFER, 0);
+    gl::bind_vertex_array(0);
     vao.unbind();
 }
 
-void particle_emitter::check_opengl_error(const std::string &function_name)
-{
-    GLenum error;
-    while ((error = glGetError()) != GL_NO_ERROR)
-    {
-        std::cerr << "OpenGL Error after " << function_name << ": " << error
-                  << std::endl;
-    }
-}
-
 particle_emitter::builder &
 particle_emitter::builder::set_starting_position(glm::vec3 starting_position)
 {
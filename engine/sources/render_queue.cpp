@@ -0,0 +1,172 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "render_queue.hpp"
+
+#include "gl_helper.hpp"
+#include "model.hpp"
+#include "uniform_buffers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+using namespace brenta;
+
+std::vector<types::draw_packet> render_queue::packets;
+std::vector<types::sort_entry> render_queue::entries;
+std::vector<types::sort_entry> render_queue::scratch;
+
+static_assert(render_queue::pass_bits + 1 + render_queue::depth_bits
+                  + render_queue::program_bits + render_queue::material_bits
+                  + render_queue::mesh_bits
+              == 64);
+
+std::uint64_t render_queue::make_key(unsigned int pass, bool translucent,
+                                     float depth, unsigned int program,
+                                     unsigned int material,
+                                     unsigned int mesh)
+{
+    constexpr std::uint64_t depth_mask = (1ull << depth_bits) - 1;
+
+    /* The bits of a positive float grow with its value, the exponent
+     * and the first bits of the mantissa give a logarithmic depth
+     * that needs no far plane */
+    if (!(depth > 0.0f))
+        depth = 0.0f;
+    std::uint64_t d = std::bit_cast<std::uint32_t>(depth) >> (31 - depth_bits);
+    if (translucent)
+        d = depth_mask - d;
+    else
+        d &= ~((1ull << (depth_bits - opaque_depth_bits)) - 1);
+
+    std::uint64_t key = pass & ((1ull << pass_bits) - 1);
+    key = (key << 1) | (translucent ? 1 : 0);
+    key = (key << depth_bits) | d;
+    key = (key << program_bits) | (program & ((1ull << program_bits) - 1));
+    key = (key << material_bits) | (material & ((1ull << material_bits) - 1));
+    key = (key << mesh_bits) | (mesh & ((1ull << mesh_bits) - 1));
+    return key;
+}
+
+void render_queue::sort(std::vector<types::sort_entry> &entries,
+                        std::vector<types::sort_entry> &scratch)
+{
+    std::size_t n = entries.size();
+    if (n < 2)
+        return;
+
+    /* The histograms of all the digits in one pass */
+    std::array<std::array<std::size_t, 256>, 8> counts = {};
+    for (const auto &e : entries)
+    {
+        for (unsigned int digit = 0; digit < 8; digit++)
+            counts[digit][(e.key >> (digit * 8)) & 0xff]++;
+    }
+
+    scratch.resize(n);
+    for (unsigned int digit = 0; digit < 8; digit++)
+    {
+        auto &count = counts[digit];
+        if (count[(entries[0].key >> (digit * 8)) & 0xff] == n)
+            continue;
+
+        std::size_t offset = 0;
+        for (auto &c : count)
+        {
+            std::size_t size = c;
+            c = offset;
+            offset += size;
+        }
+        for (const auto &e : entries)
+            scratch[count[(e.key >> (digit * 8)) & 0xff]++] = e;
+        entries.swap(scratch);
+    }
+}
+
+void render_queue::submit(types::draw_packet packet)
+{
+    render_queue::packets.push_back(std::move(packet));
+}
+
+void render_queue::flush()
+{
+    auto &packets = render_queue::packets;
+    auto &entries = render_queue::entries;
+    if (packets.empty())
+        return;
+
+    entries.resize(packets.size());
+    for (std::size_t i = 0; i < packets.size(); i++)
+        entries[i] = {packets[i].key, (std::uint32_t) i};
+    render_queue::sort(entries, render_queue::scratch);
+
+    /* Translucent packets are tested against the depth buffer but do
+     * not write It, so the ones behind still blend */
+    bool depth_writes = true;
+    const types::shader_name_t *current = nullptr;
+    types::uniform<float> shininess;
+    for (const auto &e : entries)
+    {
+        const auto &p = packets[e.index];
+        if (p.target == nullptr)
+            continue;
+
+        if (p.translucent == depth_writes)
+        {
+            depth_writes = !p.translucent;
+            gl::set_depth_mask(depth_writes);
+        }
+        if (current == nullptr || *current != p.shader)
+        {
+            shader::use(p.shader);
+            current = &p.shader;
+            shininess =
+                shader::get_uniform<float>(p.shader, "material.shininess");
+        }
+
+        uniform_buffers::set_object(p.model_matrix, p.atlas_size,
+                                    p.atlas_index);
+        shader::set(shininess, p.shininess);
+        p.target->draw(p.shader, p.lod, p.culled ? &p.frustum : nullptr,
+                       p.palette);
+    }
+    if (!depth_writes)
+        gl::set_depth_mask(true);
+
+    packets.clear();
+}
+
+void render_queue::clear()
+{
+    render_queue::packets.clear();
+}
+
+std::size_t render_queue::get_size()
+{
+    return render_queue::packets.size();
+}
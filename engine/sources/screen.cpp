@@ -53,6 +53,12 @@ void screen::init(int SCR_WIDTH, int SCR_HEIGHT, bool is_mouse_captured,
     set_context_version(3, 3); /* OpenGL 3.3 */
     use_core_profile();
 
+#ifdef BRENTA_GL_DEBUG
+    /* Some drivers report errors through GL_KHR_debug only to debug
+     * contexts */
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
+
     if (msaa)
     {
         glfwWindowHint(GLFW_SAMPLES, 4); /* MSAA */
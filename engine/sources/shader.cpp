@@ -26,9 +26,19 @@
 
 #include "shader.hpp"
 
+#include "gl_helper.hpp"
+#include "skinning.hpp"
+#include "uniform_buffers.hpp"
+
+#include <cstring>
+
 using namespace brenta;
 
 std::unordered_map<types::shader_name_t, unsigned int> shader::shaders;
+std::vector<types::shader_program> shader::programs;
+std::unordered_map<types::shader_name_t, int, types::string_hash,
+                   std::equal_to<>>
+    shader::program_of;
 
 unsigned int shader::get_id(types::shader_name_t shader_name)
 {
@@ -42,89 +52,211 @@ unsigned int shader::get_id(types::shader_name_t shader_name)
 /* Use/activate the shader */
 void shader::use(types::shader_name_t shader_name)
 {
-    glUseProgram(shader::get_id(shader_name));
-    GLenum err;
-    if ((err = glGetError()) != GL_NO_ERROR)
-    {
-        ERROR("Error using shader: {}", shader_name);
-        std::cout << err << std::endl;
-    }
+    gl::use_program(shader::get_id(shader_name));
+    check_error();
 }
 
 /* Utility uniform functions */
 void shader::set_bool(types::shader_name_t shader_name, const std::string &name,
                       bool value)
 {
-    glUniform1i(glGetUniformLocation(shader::get_id(shader_name), name.c_str()),
-                (int) value);
-    if (glGetError() != GL_NO_ERROR)
-    {
-        ERROR("Error setting bool value for shader: {} and name: {}",
-              shader_name, name);
-    }
+    types::uniform_slot *slot = shader::find_slot(shader_name, name);
+    if (slot != nullptr)
+        shader::upload(*slot, value);
 }
 
 void shader::set_int(types::shader_name_t shader_name, const std::string &name,
                      int value)
 {
-    glUniform1i(glGetUniformLocation(shader::get_id(shader_name), name.c_str()),
-                value);
-    if (glGetError() != GL_NO_ERROR)
-    {
-        ERROR("Error setting int value for shader: {} and name: {}",
-              shader_name, name);
-    }
+    types::uniform_slot *slot = shader::find_slot(shader_name, name);
+    if (slot != nullptr)
+        shader::upload(*slot, value);
 }
 
 void shader::set_float(types::shader_name_t shader_name,
                        const std::string &name, float value)
 {
-    glUniform1f(glGetUniformLocation(shader::get_id(shader_name), name.c_str()),
-                value);
-    if (glGetError() != GL_NO_ERROR)
-    {
-        ERROR("Error setting float value for shader: {} and name: {}",
-              shader_name, name);
-    }
+    types::uniform_slot *slot = shader::find_slot(shader_name, name);
+    if (slot != nullptr)
+        shader::upload(*slot, value);
 }
 
 void shader::set_mat4(types::shader_name_t shader_name, const GLchar *name,
                       glm::mat4 value)
 {
-    unsigned int matLoc =
-        glGetUniformLocation(shader::get_id(shader_name), name);
-    glUniformMatrix4fv(matLoc, 1, GL_FALSE, glm::value_ptr(value));
-    if (glGetError() != GL_NO_ERROR)
-    {
-        ERROR("Error setting mat4 value for shader: {} and name: {}",
-              shader_name, name);
-    }
+    types::uniform_slot *slot = shader::find_slot(shader_name, name);
+    if (slot != nullptr)
+        shader::upload(*slot, value);
 }
 
 void shader::set_vec3(types::shader_name_t shader_name, const GLchar *name,
                       float x, float y, float z)
 {
-    unsigned int vecLoc =
-        glGetUniformLocation(shader::get_id(shader_name), name);
-    glUniform3f(vecLoc, x, y, z);
-    if (glGetError() != GL_NO_ERROR)
-    {
-        ERROR("Error setting vec3 value for shader: {} and name: {}",
-              shader_name, name);
-    }
+    shader::set_vec3(shader_name, name, glm::vec3(x, y, z));
 }
 
 void shader::set_vec3(types::shader_name_t shader_name, const GLchar *name,
                       glm::vec3 value)
 {
-    unsigned int vecLoc =
-        glGetUniformLocation(shader::get_id(shader_name), name);
-    glUniform3f(vecLoc, value.x, value.y, value.z);
-    if (glGetError() != GL_NO_ERROR)
+    types::uniform_slot *slot = shader::find_slot(shader_name, name);
+    if (slot != nullptr)
+        shader::upload(*slot, value);
+}
+
+types::uniform_slot *shader::find_slot(std::string_view shader_name,
+                                       std::string_view name)
+{
+    int program, slot;
+    shader::find_uniform(shader_name, name, program, slot);
+    if (slot < 0)
+        return nullptr;
+    return &shader::programs[program].uniforms[slot];
+}
+
+GLenum shader::find_uniform(std::string_view shader_name,
+                            std::string_view name, int &program, int &slot)
+{
+    program = -1;
+    slot = -1;
+    auto p = shader::program_of.find(shader_name);
+    if (p == shader::program_of.end())
+        return 0;
+
+    auto &uniforms = shader::programs[p->second];
+    auto s = uniforms.slots.find(name);
+    if (s == uniforms.slots.end())
+        return 0;
+
+    program = p->second;
+    slot = s->second;
+    return uniforms.uniforms[slot].type;
+}
+
+namespace
+{
+
+/* Remembers the value, false if It was already uploaded */
+template <typename T> bool changed(types::uniform_slot &slot, const T &value)
+{
+    static_assert(sizeof(T) <= sizeof(slot.value));
+    /* The value would land in another program, or in an unknown one
+     * after gl::invalidate_state, so It is not remembered */
+    if (gl::get_program() != slot.program)
     {
-        ERROR("Error setting vec3 value for shader: {} and name: {}",
-              shader_name, name);
+#ifdef BRENTA_GL_DEBUG
+        if (gl::get_program() != gl::unknown)
+            ERROR("Uniform {} set while its program is not in use",
+                  slot.name);
+#endif
+        return true;
     }
+
+    if (slot.uploaded
+        && std::memcmp(slot.value.data(), &value, sizeof(T)) == 0)
+        return false;
+
+    std::memcpy(slot.value.data(), &value, sizeof(T));
+    slot.uploaded = true;
+    return true;
+}
+
+} // namespace
+
+void shader::upload(types::uniform_slot &slot, bool value)
+{
+    /* Same bytes as an int, booleans and integers share the setter */
+    shader::upload(slot, (int) value);
+}
+
+void shader::upload(types::uniform_slot &slot, int value)
+{
+    if (changed(slot, value))
+        glUniform1i(slot.location, value);
+}
+
+void shader::upload(types::uniform_slot &slot, float value)
+{
+    if (changed(slot, value))
+        glUniform1f(slot.location, value);
+}
+
+void shader::upload(types::uniform_slot &slot, const glm::vec2 &value)
+{
+    if (changed(slot, value))
+        glUniform2f(slot.location, value.x, value.y);
+}
+
+void shader::upload(types::uniform_slot &slot, const glm::vec3 &value)
+{
+    if (changed(slot, value))
+        glUniform3f(slot.location, value.x, value.y, value.z);
+}
+
+void shader::upload(types::uniform_slot &slot, const glm::vec4 &value)
+{
+    if (changed(slot, value))
+        glUniform4f(slot.location, value.x, value.y, value.z, value.w);
+}
+
+void shader::upload(types::uniform_slot &slot, const glm::mat4 &value)
+{
+    if (changed(slot, value))
+        glUniformMatrix4fv(slot.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void shader::create(std::string shader_name,
+                    const std::vector<types::shader_source> &sources,
+                    const GLchar **feedback_varyings, int num_varyings)
+{
+    std::vector<unsigned int> compiled_shaders = {};
+    for (const auto &source : sources)
+        compiled_shaders.push_back(compile_source(source.type, source.code));
+    shader::link_program(shader_name, compiled_shaders, feedback_varyings,
+                         num_varyings);
+}
+
+unsigned int shader::compile_source(GLenum type, std::string_view code)
+{
+    const char *shader_code = code.data();
+    GLint length = code.size();
+    unsigned int shader = glCreateShader(type);
+    glShaderSource(shader, 1, &shader_code, &length);
+    glCompileShader(shader);
+    shader::check_compile_errors(shader, "SHADER");
+    return shader;
+}
+
+void shader::link_program(const types::shader_name_t &shader_name,
+                          const std::vector<unsigned int> &compiled,
+                          const GLchar **feedback_varyings, int num_varyings)
+{
+    /* shader Program */
+    unsigned int ID = glCreateProgram();
+    std::for_each(compiled.begin(), compiled.end(),
+                  [&ID](auto shader) { glAttachShader(ID, shader); });
+
+    if (feedback_varyings != nullptr)
+    {
+        glTransformFeedbackVaryings(ID, num_varyings, feedback_varyings,
+                                    GL_INTERLEAVED_ATTRIBS);
+    }
+
+    glLinkProgram(ID);
+    shader::check_compile_errors(ID, "PROGRAM");
+    shader::set_reserved_samplers(ID);
+    uniform_buffers::bind_blocks(ID);
+    gl::set_label(GL_PROGRAM, ID, shader_name);
+
+    if (shader::shaders.insert({shader_name, ID}).second)
+    {
+        types::shader_program program;
+        program.id = ID;
+        shader::reflect_uniforms(program);
+        shader::program_of.emplace(shader_name, shader::programs.size());
+        shader::programs.push_back(std::move(program));
+    }
+    std::for_each(compiled.begin(), compiled.end(),
+                  [](auto shader) { glDeleteShader(shader); });
 }
 
 /* utility function for checking shader
@@ -156,3 +288,57 @@ void shader::check_compile_errors(unsigned int shader, std::string type)
         }
     }
 }
+
+void shader::set_reserved_samplers(unsigned int program)
+{
+    GLint location = glGetUniformLocation(program, "jointPalette");
+    if (location < 0)
+        return;
+
+    /* Samplers default to unit 0, where a 2D texture is bound: the
+     * draw would fail even if the palette is never read */
+    GLint current;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+    gl::use_program(program);
+    glUniform1i(location, skinning::palette_unit);
+    gl::use_program(current);
+}
+
+void shader::reflect_uniforms(types::shader_program &program)
+{
+    GLint count = 0;
+    GLint max_length = 0;
+    glGetProgramiv(program.id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program.id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<GLchar> buffer(std::max(max_length, 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program.id, i, buffer.size(), &length, &size,
+                           &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        /* Arrays of plain types are listed once, by their first
+         * element, which also answers to the name of the array */
+        bool array = name.ends_with("[0]");
+        std::string base = array ? name.substr(0, name.size() - 3) : name;
+        for (GLint e = 0; e < size; e++)
+        {
+            std::string element =
+                array ? base + "[" + std::to_string(e) + "]" : name;
+            /* Members of uniform blocks have no location */
+            GLint location = glGetUniformLocation(program.id, element.c_str());
+            if (location < 0)
+                continue;
+
+            int slot = program.uniforms.size();
+            program.slots.emplace(element, slot);
+            if (array && e == 0)
+                program.slots.emplace(base, slot);
+            program.uniforms.push_back({element, type, location, program.id});
+        }
+    }
+}
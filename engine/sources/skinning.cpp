@@ -0,0 +1,230 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "skinning.hpp"
+
+#include "engine_logger.hpp"
+#include "gl_helper.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace brenta;
+
+bool skinning::gpu_skinning = true;
+types::buffer skinning::palette_buffer;
+types::texture_object skinning::palette_texture;
+types::shader_name_t skinning::skinned_shader;
+types::uniform<bool> skinning::skinned;
+
+void skinning::set_gpu_skinning(bool enabled)
+{
+    skinning::gpu_skinning = enabled;
+}
+
+bool skinning::uses_gpu_skinning()
+{
+    return skinning::gpu_skinning;
+}
+
+types::vertex_skin
+skinning::pack_influences(std::span<const std::uint32_t> joints,
+                          std::span<const float> weights)
+{
+    types::vertex_skin skin = {};
+    std::size_t count = std::min(joints.size(), weights.size());
+
+    /* Heaviest joints first */
+    std::array<std::size_t, max_influences> best;
+    std::size_t kept = 0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (!(weights[i] > 0.0f))
+            continue;
+
+        std::size_t slot = kept;
+        if (kept < max_influences)
+            kept++;
+        else if (weights[i] <= weights[best[max_influences - 1]])
+            continue;
+        else
+            slot = max_influences - 1;
+
+        while (slot > 0 && weights[best[slot - 1]] < weights[i])
+        {
+            best[slot] = best[slot - 1];
+            slot--;
+        }
+        best[slot] = i;
+    }
+
+    float total = 0.0f;
+    for (std::size_t k = 0; k < kept; k++)
+        total += weights[best[k]];
+    if (kept == 0 || total <= 0.0f)
+        return skin;
+
+    /* The rounding error goes to the heaviest joint, so that the
+     * weights always sum to one on the GPU */
+    int sum = 0;
+    for (std::size_t k = 0; k < kept; k++)
+    {
+        skin.joints[k] = joints[best[k]];
+        skin.weights[k] = static_cast<std::uint8_t>(
+            std::lround(weights[best[k]] / total * 255.0f));
+        sum += skin.weights[k];
+    }
+    skin.weights[0] += 255 - sum;
+
+    return skin;
+}
+
+void skinning::skin_vertices(std::span<const types::vertex> vertices,
+                             std::span<const types::vertex_skin> skin,
+                             std::span<const glm::mat4> palette,
+                             std::span<types::vertex> out)
+{
+    std::size_t count = std::min({vertices.size(), skin.size(), out.size()});
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const types::vertex &in = vertices[i];
+        const types::vertex_skin &s = skin[i];
+        out[i] = in;
+
+#if defined(__SSE2__)
+        /* Blend the joint matrices column by column */
+        __m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps();
+        __m128 c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+        bool weighted = false;
+        for (unsigned int k = 0; k < max_influences; k++)
+        {
+            if (s.weights[k] == 0 || s.joints[k] >= palette.size())
+                continue;
+
+            const glm::mat4 &m = palette[s.joints[k]];
+            __m128 w = _mm_set1_ps(s.weights[k] * (1.0f / 255.0f));
+            c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(&m[0][0]), w));
+            c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(&m[1][0]), w));
+            c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(&m[2][0]), w));
+            c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(&m[3][0]), w));
+            weighted = true;
+        }
+        if (!weighted)
+            continue;
+
+        __m128 p = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in.position.x)),
+                       _mm_mul_ps(c1, _mm_set1_ps(in.position.y))),
+            _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(in.position.z)), c3));
+        __m128 n = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in.normal.x)),
+                       _mm_mul_ps(c1, _mm_set1_ps(in.normal.y))),
+            _mm_mul_ps(c2, _mm_set1_ps(in.normal.z)));
+
+        alignas(16) float position[4], normal[4];
+        _mm_store_ps(position, p);
+        _mm_store_ps(normal, n);
+        out[i].position = glm::vec3(position[0], position[1], position[2]);
+        glm::vec3 deformed = glm::vec3(normal[0], normal[1], normal[2]);
+#else
+        glm::mat4 m(0.0f);
+        bool weighted = false;
+        for (unsigned int k = 0; k < max_influences; k++)
+        {
+            if (s.weights[k] == 0 || s.joints[k] >= palette.size())
+                continue;
+            m += palette[s.joints[k]] * (s.weights[k] * (1.0f / 255.0f));
+            weighted = true;
+        }
+        if (!weighted)
+            continue;
+
+        out[i].position = glm::vec3(m * glm::vec4(in.position, 1.0f));
+        glm::vec3 deformed = glm::mat3(m) * in.normal;
+#endif
+        float length = glm::length(deformed);
+        if (length > 0.0f)
+            out[i].normal = deformed / length;
+    }
+}
+
+void skinning::bind_palette(types::shader_name_t shader,
+                            std::span<const glm::mat4> palette)
+{
+    if (skinning::palette_texture.get() == 0)
+    {
+        skinning::palette_buffer = types::buffer(GL_TEXTURE_BUFFER);
+        unsigned int id;
+        glGenTextures(1, &id);
+        skinning::palette_texture = types::texture_object(id);
+
+        /* The texture follows the buffer when its storage is
+         * reallocated, so It is attached once */
+        texture::active_texture(GL_TEXTURE0 + palette_unit);
+        gl::bind_texture(GL_TEXTURE_BUFFER, id);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F,
+                    skinning::palette_buffer.id);
+        texture::active_texture(GL_TEXTURE0);
+    }
+
+    /* A new storage every time, the driver does not have to wait for
+     * the draws that still read the previous palette */
+    skinning::palette_buffer.bind();
+    skinning::palette_buffer.copy_data(palette.size_bytes(), palette.data(),
+                                       GL_STREAM_DRAW);
+
+    texture::active_texture(GL_TEXTURE0 + palette_unit);
+    gl::bind_texture(GL_TEXTURE_BUFFER, skinning::palette_texture.get());
+    texture::active_texture(GL_TEXTURE0);
+    shader::set(skinning::skinned_uniform(shader), true);
+}
+
+void skinning::unbind_palette(types::shader_name_t shader)
+{
+    shader::set(skinning::skinned_uniform(shader), false);
+}
+
+const types::uniform<bool> &
+skinning::skinned_uniform(const types::shader_name_t &shader)
+{
+    if (shader != skinning::skinned_shader)
+    {
+        skinning::skinned_shader = shader;
+        skinning::skinned = shader::get_uniform<bool>(shader, "skinned");
+    }
+    return skinning::skinned;
+}
+
+void skinning::destroy()
+{
+    skinning::palette_texture = types::texture_object();
+    skinning::palette_buffer = types::buffer();
+}
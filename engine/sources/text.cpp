@@ -26,13 +26,52 @@
 
 #include "text.hpp"
 
+#include "embedded_assets.hpp"
 #include "engine_logger.hpp"
+#include "gl_helper.hpp"
+#include "vfs.hpp"
 
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <vector>
 
 using namespace brenta;
 using namespace brenta::types;
 
+namespace
+{
+
+/*
+ * Layout of a baked font, all values little endian:
+ *
+ *   glyphs_header
+ *   glyph_entry[glyph_count]
+ *   bitmaps, one byte per pixel, rows tightly packed
+ */
+constexpr char glyphs_magic[4] = {'B', 'R', 'G', 'L'};
+
+struct glyphs_header
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t pixel_size;
+    std::uint32_t glyph_count;
+};
+
+struct glyph_entry
+{
+    std::uint32_t code;
+    std::int32_t width;
+    std::int32_t rows;
+    std::int32_t left;
+    std::int32_t top;
+    std::uint32_t advance;
+    std::uint64_t offset; // in bytes, from the start of the bitmaps
+};
+
+} // namespace
+
 types::shader_name_t text::text_shader;
 types::vao text::text_vao;
 types::buffer text::text_vbo;
@@ -46,6 +85,14 @@ void text::init()
     INFO("Text initialized");
 }
 
+void text::destroy()
+{
+    if (text::text_vao.vao_id == 0)
+        return;
+    text::text_vao.destroy();
+    text::text_vbo.destroy();
+}
+
 void text::load(std::string font, unsigned int font_size)
 {
     if (text_vao.get_vao() == 0)
@@ -53,85 +100,250 @@ void text::load(std::string font, unsigned int font_size)
         ERROR("Text not initialized");
         return;
     }
-    FT_Library ft;
-    if (FT_Init_FreeType(&ft))
-    {
-        ERROR("Could not init FreeType library");
-        return;
-    }
 
-    shader::create("TextShader", GL_VERTEX_SHADER,
-                   std::filesystem::absolute("engine/shaders/text.vs"),
-                   GL_FRAGMENT_SHADER,
-                   std::filesystem::absolute("engine/shaders/text.fs"));
+    /* Paths are virtual, the vfs resolves them */
+    shader::create(
+        "TextShader",
+        {{GL_VERTEX_SHADER,
+          embedded_assets::get_text("engine/shaders/text.vs")},
+         {GL_FRAGMENT_SHADER,
+          embedded_assets::get_text("engine/shaders/text.fs")}});
     text_shader = "TextShader";
     shader::use(text_shader);
 
-    // find path to font
-    std::string font_name = std::filesystem::absolute("assets/fonts/" + font);
-    if (font_name.empty())
+    std::string font_name = "assets/fonts/" + font;
+
+    // disable byte-alignment restriction
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    /* Prefer the glyphs baked offline, rasterizing is slow */
+    std::string baked = get_baked_path(font_name);
+    if (vfs::exists(baked) && load_baked(baked))
     {
-        ERROR("Could not find font");
+        INFO("Loaded baked font: {}", baked);
+    }
+    else if (!load_font(font_name))
         return;
+    texture::bind_texture(GL_TEXTURE_2D, 0);
+
+    // configure VAO/VBO for texture quads
+    text_vao.bind();
+    text_vbo.bind();
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    text_vbo.unbind();
+    text_vao.unbind();
+}
+
+bool text::load_font(const std::string &path)
+{
+    FT_Library ft;
+    if (FT_Init_FreeType(&ft))
+    {
+        ERROR("Could not init FreeType library");
+        return false;
     }
 
+    /* The font must stay in memory until the face is done */
+    types::asset font_file = vfs::read(path);
     FT_Face face;
-    if (FT_New_Face(ft, font_name.c_str(), 0, &face))
+    if (!font_file.is_valid()
+        || FT_New_Memory_Face(ft, font_file.data(), font_file.size(), 0,
+                              &face))
     {
         ERROR("Could not load font");
-        return;
+        FT_Done_FreeType(ft);
+        return false;
     }
-    else
-    {
-        // set size to load glyphs as
-        FT_Set_Pixel_Sizes(face, 0, 48);
 
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // set size to load glyphs as
+    FT_Set_Pixel_Sizes(face, 0, glyph_pixel_size);
 
-        // load first 128 characters of ASCII set
-        for (unsigned char c = 0; c < 128; c++)
+    // load first 128 characters of ASCII set
+    for (unsigned char c = 0; c < 128; c++)
+    {
+        // Load character glyph
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
         {
-            // Load character glyph
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-            {
-                ERROR("Could not load glyph");
-                continue;
-            }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            texture::bind_texture(GL_TEXTURE_2D, texture);
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width,
-                         face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE,
-                         face->glyph->bitmap.buffer);
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            character character_ = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x)};
-            characters.insert(std::pair<char, character>(c, character_));
+            ERROR("Could not load glyph");
+            continue;
         }
-        texture::bind_texture(GL_TEXTURE_2D, 0);
+        add_character(c, face->glyph->bitmap.width, face->glyph->bitmap.rows,
+                      face->glyph->bitmap_left, face->glyph->bitmap_top,
+                      static_cast<unsigned int>(face->glyph->advance.x),
+                      face->glyph->bitmap.buffer);
     }
+
     // destroy FreeType once we're finished
     FT_Done_Face(face);
     FT_Done_FreeType(ft);
+    return true;
+}
 
-    // configure VAO/VBO for texture quads
-    text_vao.bind();
-    text_vbo.bind();
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    text_vbo.unbind();
-    text_vao.unbind();
+bool text::load_baked(const std::string &path)
+{
+    types::asset file = vfs::read(path);
+    if (!file.is_valid() || file.size() < sizeof(glyphs_header))
+        return false;
+
+    glyphs_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, glyphs_magic, sizeof(glyphs_magic)) != 0
+        || header.version != text::baked_version
+        || header.pixel_size != text::glyph_pixel_size)
+    {
+        WARN("Baked font is stale: {}", path);
+        return false;
+    }
+
+    const std::size_t table_end =
+        sizeof(header) + (std::size_t) header.glyph_count * sizeof(glyph_entry);
+    if (table_end > file.size())
+        return false;
+    std::vector<glyph_entry> entries(header.glyph_count);
+    std::memcpy(entries.data(), file.data() + sizeof(header),
+                entries.size() * sizeof(glyph_entry));
+
+    /* Check every glyph before uploading any, so that a corrupted
+     * file falls back to FreeType with an empty map */
+    const std::size_t bitmaps_size = file.size() - table_end;
+    for (const auto &entry : entries)
+    {
+        if (entry.width < 0 || entry.rows < 0 || entry.code >= 128
+            || entry.offset > bitmaps_size
+            || (std::uint64_t) entry.width * entry.rows
+                   > bitmaps_size - entry.offset)
+        {
+            ERROR("Corrupted baked font: {}", path);
+            return false;
+        }
+    }
+
+    const unsigned char *bitmaps = file.data() + table_end;
+    for (const auto &entry : entries)
+    {
+        add_character(static_cast<unsigned char>(entry.code), entry.width,
+                      entry.rows, entry.left, entry.top, entry.advance,
+                      bitmaps + entry.offset);
+    }
+    return true;
+}
+
+void text::add_character(unsigned char c, int width, int rows, int left,
+                         int top, unsigned int advance,
+                         const unsigned char *bitmap)
+{
+    // generate texture
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    texture::bind_texture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, rows, 0, GL_RED,
+                 GL_UNSIGNED_BYTE, bitmap);
+    // set texture options
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // now store character for later use
+    character character_ = {texture, glm::ivec2(width, rows),
+                            glm::ivec2(left, top), advance};
+    characters.insert(std::pair<char, character>(c, character_));
+}
+
+bool text::bake(const std::string &font_path, const std::string &output_path)
+{
+    FT_Library ft;
+    if (FT_Init_FreeType(&ft))
+    {
+        ERROR("Could not init FreeType library");
+        return false;
+    }
+
+    types::asset font_file = vfs::read(font_path);
+    FT_Face face;
+    if (!font_file.is_valid()
+        || FT_New_Memory_Face(ft, font_file.data(), font_file.size(), 0,
+                              &face))
+    {
+        ERROR("Could not load font: {}", font_path);
+        FT_Done_FreeType(ft);
+        return false;
+    }
+    FT_Set_Pixel_Sizes(face, 0, glyph_pixel_size);
+
+    std::vector<glyph_entry> entries;
+    std::vector<unsigned char> bitmaps;
+    for (unsigned char c = 0; c < 128; c++)
+    {
+        if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+        {
+            ERROR("Could not load glyph");
+            continue;
+        }
+        const FT_Bitmap &bitmap = face->glyph->bitmap;
+        glyph_entry entry = {};
+        entry.code = c;
+        entry.width = bitmap.width;
+        entry.rows = bitmap.rows;
+        entry.left = face->glyph->bitmap_left;
+        entry.top = face->glyph->bitmap_top;
+        entry.advance = static_cast<std::uint32_t>(face->glyph->advance.x);
+        entry.offset = bitmaps.size();
+        entries.push_back(entry);
+
+        /* Rows are stored tightly packed, FreeType may pad them */
+        for (unsigned int row = 0; row < bitmap.rows; row++)
+        {
+            const unsigned char *line = bitmap.buffer + row * bitmap.pitch;
+            bitmaps.insert(bitmaps.end(), line, line + bitmap.width);
+        }
+    }
+    FT_Done_Face(face);
+    FT_Done_FreeType(ft);
+
+    glyphs_header header = {};
+    std::memcpy(header.magic, glyphs_magic, sizeof(glyphs_magic));
+    header.version = text::baked_version;
+    header.pixel_size = text::glyph_pixel_size;
+    header.glyph_count = entries.size();
+
+    /* Write to a temporary file first so that a reader never sees
+     * half of a file */
+    std::string tmp_path = vfs::get_temp_path(output_path);
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            ERROR("Could not write baked font: {}", tmp_path);
+            return false;
+        }
+        out.write((const char *) &header, sizeof(header));
+        out.write((const char *) entries.data(),
+                  entries.size() * sizeof(glyph_entry));
+        out.write((const char *) bitmaps.data(), bitmaps.size());
+        out.close();
+        if (!out)
+        {
+            ERROR("Could not write baked font: {}", tmp_path);
+            std::filesystem::remove(tmp_path);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, output_path, ec);
+    if (ec)
+    {
+        ERROR("Could not write baked font: {}", output_path);
+        std::filesystem::remove(tmp_path, ec);
+        return false;
+    }
+    return true;
+}
+
+std::string text::get_baked_path(const std::string &font_path)
+{
+    return std::filesystem::path(font_path).replace_extension(".glyphs");
 }
 
 void text::render_text(std::string text, float x, float y, float scale,
@@ -144,18 +356,16 @@ void text::render_text(std::string text, float x, float y, float scale,
     }
 
     shader::use(text_shader);
-    unsigned int textShaderId = shader::get_id(text_shader);
-
-    glUniform3f(glGetUniformLocation(textShaderId, "textColor"), color.x,
-                color.y, color.z);
+    shader::set_vec3(text_shader, "textColor", color);
 
     glm::mat4 projection =
         glm::ortho(0.0f, static_cast<float>(screen::get_width()), 0.0f,
                    static_cast<float>(screen::get_height()));
-    glUniformMatrix4fv(glGetUniformLocation(textShaderId, "projection"), 1,
-                       GL_FALSE, glm::value_ptr(projection));
+    shader::set_mat4(text_shader, "projection", projection);
 
-    glActiveTexture(GL_TEXTURE0);
+    gl::active_texture(GL_TEXTURE0);
+    /* The glyphs are sampled with their own parameters */
+    gl::bind_sampler(0, 0);
     text_vao.bind();
 
     // iterate through all characters
@@ -180,13 +390,13 @@ void text::render_text(std::string text, float x, float y, float scale,
             {xpos + w, ypos + h, 1.0, 0.0}};
 
         // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.texture_id);
+        gl::bind_texture(GL_TEXTURE_2D, ch.texture_id);
 
         // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, text_vbo.id);
+        gl::bind_buffer(GL_ARRAY_BUFFER, text_vbo.id);
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
 
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        gl::bind_buffer(GL_ARRAY_BUFFER, 0);
         // render quad
         glDrawArrays(GL_TRIANGLES, 0, 6);
         // now advance cursors for next glyph (note that advance is number
@@ -194,8 +404,8 @@ void text::render_text(std::string text, float x, float y, float scale,
         x += (ch.advance >> 6)
              * scale; // bitshift by 6 to get value in pixels (2^6 = 64)
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    gl::bind_vertex_array(0);
+    gl::bind_texture(GL_TEXTURE_2D, 0);
 
     /*
     // Render a test triangle
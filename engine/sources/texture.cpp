@@ -27,7 +27,16 @@
 #include "texture.hpp"
 
 #include "engine_logger.hpp"
+#include "gl_helper.hpp"
+#include "texture_cache.hpp"
+#include "texture_compression.hpp"
+#include "texture_streamer.hpp"
+#include "vfs.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
 #include <glad/glad.h>
 #include <iostream>
 #include <stb_image.h> /* Image loading library */
@@ -35,81 +44,195 @@
 
 using namespace brenta;
 
+types::texture_object::texture_object(unsigned int id) : id(id)
+{
+}
+
+types::texture_object::texture_object(texture_object &&other) noexcept
+    : id(other.id)
+{
+    other.id = 0;
+}
+
+types::texture_object &
+types::texture_object::operator=(texture_object &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (this->id != 0)
+        {
+            gl::forget_texture(this->id);
+            glDeleteTextures(1, &this->id);
+        }
+        this->id = other.id;
+        other.id = 0;
+    }
+    return *this;
+}
+
+types::texture_object::~texture_object()
+{
+    if (this->id != 0)
+    {
+        gl::forget_texture(this->id);
+        glDeleteTextures(1, &this->id);
+    }
+}
+
+unsigned int types::texture_object::get() const
+{
+    return this->id;
+}
+
+unsigned int types::texture_object::release()
+{
+    unsigned int released = this->id;
+    this->id = 0;
+    return released;
+}
+
 unsigned int texture::load_texture(std::string path, GLint wrapping,
                                    GLint filtering_min, GLint filtering_mag,
                                    GLboolean hasMipmap, GLint mipmap_min,
                                    GLint mipmap_mag, bool flip)
 {
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    // Texture::BindTexture(GL_TEXTURE_2D, texture, wrapping, filtering_min,
-    // filtering_mag, hasMipmap, mipmap_min, mipmap_mag);
+    return texture_cache::load(path, wrapping, filtering_min, filtering_mag,
+                               hasMipmap, mipmap_min, mipmap_mag, flip);
+}
 
-    read_image(path.c_str(), flip);
-    return texture;
+types::image texture::decode_image(std::string path, bool flip)
+{
+    std::string file = find_image(path);
+    return decode_image(vfs::read(file), file, flip);
 }
 
-void texture::active_texture(GLenum texture)
+types::image texture::decode_image(const types::asset &encoded,
+                                   const std::string &path, bool flip)
 {
-    glActiveTexture(texture);
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   ::tolower);
+
+    if (extension == ".ktx2")
+        return texture_compression::load_ktx2(encoded, path, flip);
+    if (extension == ".dds")
+        return texture_compression::load_dds(encoded, path, flip);
+
+    types::image image;
+    if (!encoded.is_valid())
+    {
+        ERROR("Failed to load texture at location: {}", path);
+        return image;
+    }
+    /* The thread local version lets workers decode concurrently */
+    stbi_set_flip_vertically_on_load_thread(flip);
+    unsigned char *data = stbi_load_from_memory(
+        encoded.data(), encoded.size(), &image.width, &image.height,
+        &image.channels, 0);
+    if (data)
+    {
+        image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+        image.size =
+            (std::size_t) image.width * image.height * image.channels;
+    }
+    else
+        ERROR("Failed to load texture at location: {}", path);
+    return image;
 }
 
-void texture::bind_texture(GLenum target, unsigned int texture, GLint wrapping,
-                           GLint filtering_min, GLint filtering_mag,
-                           GLboolean hasMipmap, GLint mipmap_min,
-                           GLint mipmap_mag)
+std::string texture::find_image(const std::string &path)
+{
+    std::filesystem::path file(path);
+    std::string extension = file.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   ::tolower);
+    if (extension == ".ktx2" || extension == ".dds")
+        return path;
+
+    /* Prefer a baked compressed version of the image */
+    for (const char *baked : {".ktx2", ".dds"})
+    {
+        std::filesystem::path compressed = file;
+        compressed.replace_extension(baked);
+        if (vfs::exists(compressed.string()))
+            return compressed.string();
+    }
+    return path;
+}
+
+unsigned int texture::upload_image(const types::image &image)
 {
-    glBindTexture(target, texture);
-    set_texture_wrapping(wrapping);
-    set_texture_filtering(filtering_min, filtering_mag);
-    set_mipmap(hasMipmap, mipmap_min, mipmap_mag);
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    gl::bind_texture(GL_TEXTURE_2D, texture);
+    if (image.pixels)
+        upload_pixels(image, image.pixels.get());
+    return texture;
 }
 
-void texture::set_texture_wrapping(GLint wrapping)
+bool texture::is_resident(unsigned int texture)
 {
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapping);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapping);
+    return texture_streamer::is_resident(texture);
 }
 
-void texture::set_texture_filtering(GLint filtering_min, GLint filtering_mag)
+void texture::active_texture(GLenum texture)
 {
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filtering_min);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filtering_mag);
+    gl::active_texture(texture);
 }
 
-void texture::set_mipmap(GLboolean hasMipmap, GLint mipmap_min,
-                         GLint mipmap_mag)
+void texture::bind_texture(GLenum target, unsigned int texture, GLint wrapping,
+                           GLint filtering_min, GLint filtering_mag,
+                           GLboolean hasMipmap, GLint mipmap_min,
+                           GLint mipmap_mag)
 {
+    gl::bind_texture(target, texture);
+    if (target != GL_TEXTURE_2D)
+        return;
+
+    /* The parameters are in a shared sampler instead of the texture,
+     * so binding It again changes nothing */
     if (hasMipmap)
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmap_min);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mipmap_mag);
+        filtering_min = mipmap_min;
+        filtering_mag = mipmap_mag;
     }
+    gl::bind_sampler(gl::get_active_texture() - GL_TEXTURE0,
+                     gl::get_sampler(wrapping, filtering_min, filtering_mag));
 }
 
-void texture::read_image(const char *path, bool flip)
+void texture::upload_pixels(const types::image &image, const void *pixels)
 {
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(flip);
-    unsigned char *data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        GLenum format = GL_RGB;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
-                     GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+    if (image.width == 0 || image.height == 0)
+        return;
+
+    /* Compressed images carry their own mipmap chain */
+    if (image.compressed_format != 0)
     {
-        ERROR("Failed to load texture at location: {}", path);
+        for (unsigned int i = 0; i < image.levels.size(); i++)
+        {
+            const types::mip_level &level = image.levels[i];
+            glCompressedTexImage2D(
+                GL_TEXTURE_2D, i, image.compressed_format, level.width,
+                level.height, 0, level.size,
+                (const void *) ((std::uintptr_t) pixels + level.offset));
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                        image.levels.size() - 1);
+        return;
     }
-    stbi_image_free(data);
+
+    GLenum format = GL_RGB;
+    if (image.channels == 1)
+        format = GL_RED;
+    else if (image.channels == 3)
+        format = GL_RGB;
+    else if (image.channels == 4)
+        format = GL_RGBA;
+
+    /* Rows of stb_image pixels are tightly packed */
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0,
+                 format, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
 }
@@ -0,0 +1,218 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "texture_cache.hpp"
+
+#include "engine_hash.hpp"
+#include "engine_logger.hpp"
+#include "gl_helper.hpp"
+#include "texture_streamer.hpp"
+
+#include <filesystem>
+
+using namespace brenta;
+
+std::unordered_map<std::uint64_t, texture_cache::entry> texture_cache::textures;
+std::unordered_map<unsigned int, std::uint64_t> texture_cache::keys;
+std::mutex texture_cache::mutex;
+
+std::uint64_t texture_cache::get_key(const std::string &path, GLint wrapping,
+                                     GLint filtering_min, GLint filtering_mag,
+                                     GLboolean has_mipmap, GLint mipmap_min,
+                                     GLint mipmap_mag, bool flip)
+{
+    std::error_code ec;
+    std::string canonical =
+        std::filesystem::weakly_canonical(path, ec).string();
+    if (ec)
+        canonical = path;
+
+    std::uint64_t key = hash::fnv1a(canonical);
+    key = hash::combine(key, wrapping);
+    key = hash::combine(key, filtering_min);
+    key = hash::combine(key, filtering_mag);
+    key = hash::combine(key, has_mipmap);
+    key = hash::combine(key, mipmap_min);
+    key = hash::combine(key, mipmap_mag);
+    key = hash::combine(key, flip);
+    return key;
+}
+
+bool texture_cache::contains(std::uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures.contains(key);
+}
+
+unsigned int texture_cache::load(const std::string &path, GLint wrapping,
+                                 GLint filtering_min, GLint filtering_mag,
+                                 GLboolean has_mipmap, GLint mipmap_min,
+                                 GLint mipmap_mag, bool flip)
+{
+    return load(path, types::image(), wrapping, filtering_min, filtering_mag,
+                has_mipmap, mipmap_min, mipmap_mag, flip);
+}
+
+unsigned int texture_cache::load(const std::string &path,
+                                 const types::image &decoded, GLint wrapping,
+                                 GLint filtering_min, GLint filtering_mag,
+                                 GLboolean has_mipmap, GLint mipmap_min,
+                                 GLint mipmap_mag, bool flip)
+{
+    std::uint64_t key =
+        get_key(path, wrapping, filtering_min, filtering_mag, has_mipmap,
+                mipmap_min, mipmap_mag, flip);
+
+    unsigned int id = find(key);
+    if (id != 0)
+        return id;
+
+    if (texture_streamer::is_enabled())
+        id = decoded.pixels ? texture_streamer::stream(decoded)
+                            : texture_streamer::stream(path, flip);
+    else if (decoded.pixels)
+        id = texture::upload_image(decoded);
+    else
+        id = texture::upload_image(texture::decode_image(path, flip));
+    gl::set_label(GL_TEXTURE, id, path);
+    return insert(key, path, id);
+}
+
+void texture_cache::retain(unsigned int id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = keys.find(id);
+    if (it == keys.end())
+        return;
+    textures[it->second].references++;
+}
+
+void texture_cache::release(unsigned int id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = keys.find(id);
+    if (it == keys.end())
+        return;
+
+    entry &e = textures[it->second];
+    if (e.references == 0)
+    {
+        WARN("Texture released more times than loaded: {}", e.path);
+        return;
+    }
+    e.references--;
+}
+
+std::size_t texture_cache::evict()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t evicted = 0;
+    for (auto it = textures.begin(); it != textures.end();)
+    {
+        /* Pending streamed textures are still written by the streamer */
+        if (it->second.references != 0
+            || !texture_streamer::is_resident(it->second.texture.get()))
+        {
+            ++it;
+            continue;
+        }
+
+        keys.erase(it->second.texture.get());
+        it = textures.erase(it);
+        evicted++;
+    }
+
+    if (evicted > 0)
+        DEBUG("Evicted {} textures", evicted);
+    return evicted;
+}
+
+void texture_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    textures.clear();
+    keys.clear();
+}
+
+std::size_t texture_cache::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return textures.size();
+}
+
+unsigned int texture_cache::insert(std::uint64_t key, const std::string &path,
+                                   unsigned int id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    /* Another thread may have loaded the same texture meanwhile, keep
+     * the first one and drop the duplicate */
+    auto it =
+        textures.try_emplace(key, entry{types::texture_object(id), 0, path})
+            .first;
+    it->second.references++;
+    id = it->second.texture.get();
+    keys[id] = key;
+    return id;
+}
+
+unsigned int texture_cache::find(std::uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = textures.find(key);
+    if (it == textures.end())
+        return 0;
+    it->second.references++;
+    return it->second.texture.get();
+}
+
+texture_cache::reference::reference(unsigned int id) : id(id)
+{
+}
+
+texture_cache::reference::reference(const reference &other) : id(other.id)
+{
+    if (this->id != 0)
+        texture_cache::retain(this->id);
+}
+
+texture_cache::reference::reference(reference &&other) noexcept
+    : id(other.id)
+{
+    other.id = 0;
+}
+
+texture_cache::reference &
+texture_cache::reference::operator=(reference other) noexcept
+{
+    std::swap(this->id, other.id);
+    return *this;
+}
+
+texture_cache::reference::~reference()
+{
+    if (this->id != 0)
+        texture_cache::release(this->id);
+}
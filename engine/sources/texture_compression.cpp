@@ -0,0 +1,1145 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "texture_compression.hpp"
+
+#include "engine_logger.hpp"
+#include "thread_pool.hpp"
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace brenta;
+
+namespace
+{
+
+/* DDS container, see the DirectX documentation */
+
+constexpr std::uint32_t make_four_cc(char a, char b, char c, char d)
+{
+    return (std::uint32_t) (unsigned char) a
+           | ((std::uint32_t) (unsigned char) b << 8)
+           | ((std::uint32_t) (unsigned char) c << 16)
+           | ((std::uint32_t) (unsigned char) d << 24);
+}
+
+constexpr std::uint32_t dds_magic = make_four_cc('D', 'D', 'S', ' ');
+
+struct dds_pixel_format
+{
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t four_cc;
+    std::uint32_t rgb_bit_count;
+    std::uint32_t masks[4];
+};
+
+struct dds_header
+{
+    std::uint32_t size;
+    std::uint32_t flags;
+    std::uint32_t height;
+    std::uint32_t width;
+    std::uint32_t pitch_or_linear_size;
+    std::uint32_t depth;
+    std::uint32_t mip_map_count;
+    std::uint32_t reserved1[11];
+    dds_pixel_format format;
+    std::uint32_t caps;
+    std::uint32_t caps2;
+    std::uint32_t caps3;
+    std::uint32_t caps4;
+    std::uint32_t reserved2;
+};
+
+struct dds_header_dx10
+{
+    std::uint32_t dxgi_format;
+    std::uint32_t resource_dimension;
+    std::uint32_t misc_flag;
+    std::uint32_t array_size;
+    std::uint32_t misc_flags2;
+};
+
+static_assert(sizeof(dds_header) == 124);
+static_assert(sizeof(dds_header_dx10) == 20);
+
+constexpr std::uint32_t dds_flags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000
+                                    | 0x80000;
+constexpr std::uint32_t dds_pixel_format_four_cc = 0x4;
+constexpr std::uint32_t dds_caps_complex = 0x8;
+constexpr std::uint32_t dds_caps_texture = 0x1000;
+constexpr std::uint32_t dds_caps_mipmap = 0x400000;
+constexpr std::uint32_t dds_dimension_texture2d = 3;
+
+enum dxgi_format : std::uint32_t
+{
+    DXGI_BC1_UNORM = 71,
+    DXGI_BC1_SRGB = 72,
+    DXGI_BC3_UNORM = 77,
+    DXGI_BC3_SRGB = 78,
+    DXGI_BC4_UNORM = 80,
+    DXGI_BC5_UNORM = 83,
+    DXGI_BC7_UNORM = 98,
+    DXGI_BC7_SRGB = 99,
+};
+
+/* KTX2 container, see the Khronos specification */
+
+constexpr unsigned char ktx2_identifier[12] = {0xAB, 'K',  'T', 'X',
+                                               ' ',  '2',  '0', 0xBB,
+                                               '\r', '\n', 0x1A, '\n'};
+
+struct ktx2_header
+{
+    unsigned char identifier[12];
+    std::uint32_t vk_format;
+    std::uint32_t type_size;
+    std::uint32_t pixel_width;
+    std::uint32_t pixel_height;
+    std::uint32_t pixel_depth;
+    std::uint32_t layer_count;
+    std::uint32_t face_count;
+    std::uint32_t level_count;
+    std::uint32_t supercompression_scheme;
+    std::uint32_t dfd_byte_offset;
+    std::uint32_t dfd_byte_length;
+    std::uint32_t kvd_byte_offset;
+    std::uint32_t kvd_byte_length;
+    std::uint64_t sgd_byte_offset;
+    std::uint64_t sgd_byte_length;
+};
+
+struct ktx2_level
+{
+    std::uint64_t byte_offset;
+    std::uint64_t byte_length;
+    std::uint64_t uncompressed_byte_length;
+};
+
+static_assert(sizeof(ktx2_header) == 80);
+
+enum vk_format : std::uint32_t
+{
+    VK_BC1_RGB_UNORM = 131,
+    VK_BC1_RGB_SRGB = 132,
+    VK_BC1_RGBA_UNORM = 133,
+    VK_BC1_RGBA_SRGB = 134,
+    VK_BC3_UNORM = 137,
+    VK_BC3_SRGB = 138,
+    VK_BC4_UNORM = 139,
+    VK_BC5_UNORM = 141,
+    VK_BC7_UNORM = 145,
+    VK_BC7_SRGB = 146,
+};
+
+/* BC7 mode 6 interpolation weights */
+constexpr int bc7_weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                 34, 38, 43, 47, 51, 55, 60, 64};
+
+GLenum to_gl_format(enums::block_format format, bool srgb)
+{
+    switch (format)
+    {
+    case enums::BC1:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                    : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+    case enums::BC3:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                    : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case enums::BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case enums::BC5:
+        return GL_COMPRESSED_RG_RGTC2;
+    case enums::BC7:
+        return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                    : GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+int get_channels(enums::block_format format)
+{
+    switch (format)
+    {
+    case enums::BC4:
+        return 1;
+    case enums::BC5:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+/* Largest side accepted from the header of a file */
+constexpr std::uint32_t max_texture_size = 16384;
+
+/* Check the size read from a header and cap the levels to a full
+ * chain, false if the size cannot be the one of a texture */
+bool check_size(std::uint32_t width, std::uint32_t height,
+                unsigned int &num_levels)
+{
+    if (width == 0 || height == 0 || width > max_texture_size
+        || height > max_texture_size)
+        return false;
+    num_levels = std::min<unsigned int>(
+        num_levels, std::bit_width(std::max(width, height)));
+    return true;
+}
+
+/* Allocate a compressed image and compute the layout of its levels */
+types::image make_image(enums::block_format format, bool srgb, int width,
+                        int height, unsigned int num_levels)
+{
+    types::image image;
+    image.width = width;
+    image.height = height;
+    image.channels = get_channels(format);
+    image.compressed_format = to_gl_format(format, srgb);
+
+    std::size_t block_size = texture_compression::get_block_size(format);
+    for (unsigned int i = 0; i < num_levels; i++)
+    {
+        types::mip_level level;
+        level.width = std::max(1, width >> i);
+        level.height = std::max(1, height >> i);
+        level.offset = image.size;
+        level.size = (std::size_t) ((level.width + 3) / 4)
+                     * ((level.height + 3) / 4) * block_size;
+        image.size += level.size;
+        image.levels.push_back(level);
+    }
+
+    image.pixels = std::shared_ptr<unsigned char>(
+        new unsigned char[image.size], std::default_delete<unsigned char[]>());
+    return image;
+}
+
+std::uint32_t get_bits(const unsigned char *block, int offset, int count)
+{
+    std::uint32_t value = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int bit = offset + i;
+        value |= (std::uint32_t) ((block[bit >> 3] >> (bit & 7)) & 1) << i;
+    }
+    return value;
+}
+
+void set_bits(unsigned char *block, int offset, int count,
+              std::uint32_t value)
+{
+    for (int i = 0; i < count; i++)
+    {
+        int bit = offset + i;
+        block[bit >> 3] &= (unsigned char) ~(1 << (bit & 7));
+        block[bit >> 3] |= (unsigned char) (((value >> i) & 1) << (bit & 7));
+    }
+}
+
+/* Reverse the first rows of a BC1 color block */
+void flip_bc1_block(unsigned char *block, int rows)
+{
+    std::reverse(block + 4, block + 4 + rows);
+}
+
+/* Reverse the first rows of a BC4 block, rows are 12 bits wide */
+void flip_bc4_block(unsigned char *block, int rows)
+{
+    std::uint32_t row_bits[4];
+    for (int r = 0; r < 4; r++)
+        row_bits[r] = get_bits(block, 16 + r * 12, 12);
+    std::reverse(row_bits, row_bits + rows);
+    for (int r = 0; r < 4; r++)
+        set_bits(block, 16 + r * 12, 12, row_bits[r]);
+}
+
+/* Only mode 6 blocks can be flipped */
+bool is_bc7_mode_6(const unsigned char *block)
+{
+    return (block[0] & 0x7F) == 0x40;
+}
+
+/* Reverse the first rows of a BC7 mode 6 block */
+void flip_bc7_block(unsigned char *block, int rows)
+{
+    int indices[16];
+    indices[0] = get_bits(block, 65, 3);
+    for (int i = 1; i < 16; i++)
+        indices[i] = get_bits(block, 68 + (i - 1) * 4, 4);
+
+    int flipped[16];
+    for (int y = 0; y < 4; y++)
+    {
+        int src = y < rows ? rows - 1 - y : y;
+        for (int x = 0; x < 4; x++)
+            flipped[y * 4 + x] = indices[src * 4 + x];
+    }
+
+    /* The anchor index has an implicit zero high bit */
+    if (flipped[0] & 8)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            std::uint32_t e0 = get_bits(block, 7 + c * 14, 7);
+            std::uint32_t e1 = get_bits(block, 14 + c * 14, 7);
+            set_bits(block, 7 + c * 14, 7, e1);
+            set_bits(block, 14 + c * 14, 7, e0);
+        }
+        std::uint32_t p0 = get_bits(block, 63, 1);
+        std::uint32_t p1 = get_bits(block, 64, 1);
+        set_bits(block, 63, 1, p1);
+        set_bits(block, 64, 1, p0);
+        for (int i = 0; i < 16; i++)
+            flipped[i] = 15 - flipped[i];
+    }
+
+    set_bits(block, 65, 3, flipped[0]);
+    for (int i = 1; i < 16; i++)
+        set_bits(block, 68 + (i - 1) * 4, 4, flipped[i]);
+}
+
+/* Principal axis of a set of points with power iteration */
+template <int N>
+void principal_axis(const float (&points)[16][N], float (&mean)[N],
+                    float (&axis)[N])
+{
+    for (int c = 0; c < N; c++)
+    {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; i++)
+            mean[c] += points[i][c];
+        mean[c] /= 16.0f;
+    }
+
+    float cov[N][N] = {};
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < N; a++)
+            for (int b = 0; b < N; b++)
+                cov[a][b] +=
+                    (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+
+    for (int c = 0; c < N; c++)
+        axis[c] = 1.0f;
+    for (int iter = 0; iter < 8; iter++)
+    {
+        float next[N] = {};
+        for (int a = 0; a < N; a++)
+            for (int b = 0; b < N; b++)
+                next[a] += cov[a][b] * axis[b];
+
+        float norm = 0.0f;
+        for (int c = 0; c < N; c++)
+            norm = std::max(norm, std::abs(next[c]));
+        if (norm < 1e-6f)
+        {
+            for (int c = 0; c < N; c++)
+                axis[c] = 0.0f;
+            return;
+        }
+        for (int c = 0; c < N; c++)
+            axis[c] = next[c] / norm;
+    }
+}
+
+std::uint16_t to_565(const float *rgb)
+{
+    auto q = [](float v, int max)
+    {
+        return (std::uint16_t) std::clamp((int) std::lround(v / 255.0f * max),
+                                          0, max);
+    };
+    return (std::uint16_t) ((q(rgb[0], 31) << 11) | (q(rgb[1], 63) << 5)
+                            | q(rgb[2], 31));
+}
+
+void from_565(std::uint16_t c, int *rgb)
+{
+    int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+/* Convert an image to RGBA8 */
+std::vector<unsigned char> to_rgba(const types::image &image)
+{
+    std::size_t count = (std::size_t) image.width * image.height;
+    std::vector<unsigned char> rgba(count * 4);
+    const unsigned char *src = image.pixels.get();
+    for (std::size_t i = 0; i < count; i++)
+    {
+        const unsigned char *p = src + i * image.channels;
+        unsigned char *d = rgba.data() + i * 4;
+        switch (image.channels)
+        {
+        case 1:
+            d[0] = d[1] = d[2] = p[0];
+            d[3] = 255;
+            break;
+        case 2:
+            d[0] = d[1] = d[2] = p[0];
+            d[3] = p[1];
+            break;
+        case 3:
+            d[0] = p[0], d[1] = p[1], d[2] = p[2];
+            d[3] = 255;
+            break;
+        default:
+            d[0] = p[0], d[1] = p[1], d[2] = p[2], d[3] = p[3];
+            break;
+        }
+    }
+    return rgba;
+}
+
+/* Box filter an RGBA8 image to half its size */
+std::vector<unsigned char> downsample(const std::vector<unsigned char> &src,
+                                      int width, int height)
+{
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    std::vector<unsigned char> dst((std::size_t) w * h * 4);
+    for (int y = 0; y < h; y++)
+    {
+        int y0 = std::min(y * 2, height - 1);
+        int y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < w; x++)
+        {
+            int x0 = std::min(x * 2, width - 1);
+            int x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = src[((std::size_t) y0 * width + x0) * 4 + c]
+                          + src[((std::size_t) y0 * width + x1) * 4 + c]
+                          + src[((std::size_t) y1 * width + x0) * 4 + c]
+                          + src[((std::size_t) y1 * width + x1) * 4 + c];
+                dst[((std::size_t) y * w + x) * 4 + c] =
+                    (unsigned char) ((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+} // namespace
+
+GLenum texture_compression::get_gl_format(enums::block_format format)
+{
+    return to_gl_format(format, false);
+}
+
+std::size_t texture_compression::get_block_size(enums::block_format format)
+{
+    return format == enums::BC1 || format == enums::BC4 ? 8 : 16;
+}
+
+bool texture_compression::from_gl_format(GLenum gl_format,
+                                         enums::block_format &format)
+{
+    for (auto f : {enums::BC1, enums::BC3, enums::BC4, enums::BC5, enums::BC7})
+    {
+        if (to_gl_format(f, false) == gl_format
+            || to_gl_format(f, true) == gl_format)
+        {
+            format = f;
+            return true;
+        }
+    }
+    if (gl_format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+    {
+        format = enums::BC1;
+        return true;
+    }
+    return false;
+}
+
+types::image texture_compression::load_dds(const std::string &path, bool flip)
+{
+    return load_dds(vfs::read(path), path, flip);
+}
+
+types::image texture_compression::load_dds(const types::asset &file,
+                                           const std::string &path, bool flip)
+{
+    if (!file.is_valid())
+    {
+        ERROR("Could not open DDS file: {}", path);
+        return types::image();
+    }
+
+    const unsigned char *data = file.data();
+    std::size_t offset = 4 + sizeof(dds_header);
+    std::uint32_t magic;
+    dds_header header;
+    if (file.size() < offset)
+    {
+        ERROR("DDS file too small: {}", path);
+        return types::image();
+    }
+    std::memcpy(&magic, data, 4);
+    std::memcpy(&header, data + 4, sizeof(header));
+    if (magic != dds_magic || header.size != sizeof(dds_header))
+    {
+        ERROR("Not a DDS file: {}", path);
+        return types::image();
+    }
+
+    enums::block_format format;
+    bool srgb = false;
+    bool known = true;
+    std::uint32_t four_cc = header.format.four_cc;
+    if (!(header.format.flags & dds_pixel_format_four_cc))
+        known = false;
+    else if (four_cc == make_four_cc('D', 'X', '1', '0'))
+    {
+        dds_header_dx10 dx10;
+        if (file.size() < offset + sizeof(dx10))
+        {
+            ERROR("DDS file too small: {}", path);
+            return types::image();
+        }
+        std::memcpy(&dx10, data + offset, sizeof(dx10));
+        offset += sizeof(dx10);
+
+        switch (dx10.dxgi_format)
+        {
+        case DXGI_BC1_SRGB:
+            srgb = true;
+            [[fallthrough]];
+        case DXGI_BC1_UNORM:
+            format = enums::BC1;
+            break;
+        case DXGI_BC3_SRGB:
+            srgb = true;
+            [[fallthrough]];
+        case DXGI_BC3_UNORM:
+            format = enums::BC3;
+            break;
+        case DXGI_BC4_UNORM:
+            format = enums::BC4;
+            break;
+        case DXGI_BC5_UNORM:
+            format = enums::BC5;
+            break;
+        case DXGI_BC7_SRGB:
+            srgb = true;
+            [[fallthrough]];
+        case DXGI_BC7_UNORM:
+            format = enums::BC7;
+            break;
+        default:
+            known = false;
+        }
+    }
+    else if (four_cc == make_four_cc('D', 'X', 'T', '1'))
+        format = enums::BC1;
+    else if (four_cc == make_four_cc('D', 'X', 'T', '5'))
+        format = enums::BC3;
+    else if (four_cc == make_four_cc('A', 'T', 'I', '1')
+             || four_cc == make_four_cc('B', 'C', '4', 'U'))
+        format = enums::BC4;
+    else if (four_cc == make_four_cc('A', 'T', 'I', '2')
+             || four_cc == make_four_cc('B', 'C', '5', 'U'))
+        format = enums::BC5;
+    else
+        known = false;
+
+    if (!known)
+    {
+        ERROR("Unsupported DDS format: {}", path);
+        return types::image();
+    }
+
+    unsigned int num_levels = std::max(1u, header.mip_map_count);
+    if (!check_size(header.width, header.height, num_levels))
+    {
+        ERROR("Invalid DDS size {}x{}: {}", header.width, header.height,
+              path);
+        return types::image();
+    }
+    types::image image = make_image(format, srgb, header.width, header.height,
+                                    num_levels);
+    if (file.size() < offset + image.size)
+    {
+        ERROR("DDS file truncated: {}", path);
+        return types::image();
+    }
+    std::memcpy(image.pixels.get(), data + offset, image.size);
+
+    if (flip)
+        flip_levels(image, format);
+    return image;
+}
+
+types::image texture_compression::load_ktx2(const std::string &path,
+                                            bool flip)
+{
+    return load_ktx2(vfs::read(path), path, flip);
+}
+
+types::image texture_compression::load_ktx2(const types::asset &file,
+                                            const std::string &path,
+                                            bool flip)
+{
+    if (!file.is_valid())
+    {
+        ERROR("Could not open KTX2 file: {}", path);
+        return types::image();
+    }
+
+    ktx2_header header;
+    if (file.size() < sizeof(header))
+    {
+        ERROR("KTX2 file too small: {}", path);
+        return types::image();
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.identifier, ktx2_identifier,
+                    sizeof(ktx2_identifier))
+        != 0)
+    {
+        ERROR("Not a KTX2 file: {}", path);
+        return types::image();
+    }
+    if (header.supercompression_scheme != 0 || header.pixel_depth > 1
+        || header.layer_count > 1 || header.face_count != 1)
+    {
+        ERROR("Only plain 2D KTX2 textures are supported: {}", path);
+        return types::image();
+    }
+
+    enums::block_format format;
+    bool srgb = false;
+    switch (header.vk_format)
+    {
+    case VK_BC1_RGB_SRGB:
+    case VK_BC1_RGBA_SRGB:
+        srgb = true;
+        [[fallthrough]];
+    case VK_BC1_RGB_UNORM:
+    case VK_BC1_RGBA_UNORM:
+        format = enums::BC1;
+        break;
+    case VK_BC3_SRGB:
+        srgb = true;
+        [[fallthrough]];
+    case VK_BC3_UNORM:
+        format = enums::BC3;
+        break;
+    case VK_BC4_UNORM:
+        format = enums::BC4;
+        break;
+    case VK_BC5_UNORM:
+        format = enums::BC5;
+        break;
+    case VK_BC7_SRGB:
+        srgb = true;
+        [[fallthrough]];
+    case VK_BC7_UNORM:
+        format = enums::BC7;
+        break;
+    default:
+        ERROR("Unsupported KTX2 format {}: {}", header.vk_format, path);
+        return types::image();
+    }
+
+    unsigned int num_levels = std::max(1u, header.level_count);
+    if (!check_size(header.pixel_width, header.pixel_height, num_levels))
+    {
+        ERROR("Invalid KTX2 size {}x{}: {}", header.pixel_width,
+              header.pixel_height, path);
+        return types::image();
+    }
+    if (file.size() < sizeof(header) + num_levels * sizeof(ktx2_level))
+    {
+        ERROR("KTX2 file truncated: {}", path);
+        return types::image();
+    }
+
+    types::image image = make_image(format, srgb, header.pixel_width,
+                                    header.pixel_height, num_levels);
+    for (unsigned int i = 0; i < num_levels; i++)
+    {
+        ktx2_level level;
+        std::memcpy(&level,
+                    file.data() + sizeof(header) + i * sizeof(ktx2_level),
+                    sizeof(level));
+        if (level.byte_length != image.levels[i].size
+            || level.byte_offset > file.size()
+            || level.byte_length > file.size() - level.byte_offset)
+        {
+            ERROR("Invalid KTX2 level {}: {}", i, path);
+            return types::image();
+        }
+        std::memcpy(image.pixels.get() + image.levels[i].offset,
+                    file.data() + level.byte_offset, level.byte_length);
+    }
+
+    if (flip)
+        flip_levels(image, format);
+    return image;
+}
+
+bool texture_compression::write_dds(const std::string &path,
+                                    const types::image &image)
+{
+    enums::block_format format;
+    if (!image.pixels || !from_gl_format(image.compressed_format, format))
+    {
+        ERROR("Only block compressed images can be written to DDS: {}",
+              path);
+        return false;
+    }
+    bool srgb = image.compressed_format != to_gl_format(format, false)
+                && image.compressed_format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+    dds_header header = {};
+    header.size = sizeof(dds_header);
+    header.flags = dds_flags;
+    header.height = image.height;
+    header.width = image.width;
+    header.pitch_or_linear_size = image.levels[0].size;
+    header.mip_map_count = image.levels.size();
+    header.format.size = sizeof(dds_pixel_format);
+    header.format.flags = dds_pixel_format_four_cc;
+    header.caps = dds_caps_texture;
+    if (image.levels.size() > 1)
+        header.caps |= dds_caps_complex | dds_caps_mipmap;
+
+    /* Legacy FourCC codes where possible, for older tools */
+    dds_header_dx10 dx10 = {};
+    bool use_dx10 = true;
+    if (!srgb && format == enums::BC1)
+    {
+        header.format.four_cc = make_four_cc('D', 'X', 'T', '1');
+        use_dx10 = false;
+    }
+    else if (!srgb && format == enums::BC3)
+    {
+        header.format.four_cc = make_four_cc('D', 'X', 'T', '5');
+        use_dx10 = false;
+    }
+    else
+    {
+        header.format.four_cc = make_four_cc('D', 'X', '1', '0');
+        dx10.resource_dimension = dds_dimension_texture2d;
+        dx10.array_size = 1;
+        switch (format)
+        {
+        case enums::BC1:
+            dx10.dxgi_format = DXGI_BC1_SRGB;
+            break;
+        case enums::BC3:
+            dx10.dxgi_format = DXGI_BC3_SRGB;
+            break;
+        case enums::BC4:
+            dx10.dxgi_format = DXGI_BC4_UNORM;
+            break;
+        case enums::BC5:
+            dx10.dxgi_format = DXGI_BC5_UNORM;
+            break;
+        case enums::BC7:
+            dx10.dxgi_format = srgb ? DXGI_BC7_SRGB : DXGI_BC7_UNORM;
+            break;
+        }
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        ERROR("Could not write DDS file: {}", path);
+        return false;
+    }
+    out.write((const char *) &dds_magic, sizeof(dds_magic));
+    out.write((const char *) &header, sizeof(header));
+    if (use_dx10)
+        out.write((const char *) &dx10, sizeof(dx10));
+    out.write((const char *) image.pixels.get(), image.size);
+    return out.good();
+}
+
+types::image texture_compression::encode(const types::image &image,
+                                         enums::block_format format,
+                                         bool mipmaps)
+{
+    if (!image.pixels || image.compressed_format != 0 || image.channels < 1
+        || image.channels > 4)
+    {
+        ERROR("Can only encode uncompressed images");
+        return types::image();
+    }
+
+    unsigned int num_levels = 1;
+    if (mipmaps)
+    {
+        int size = std::max(image.width, image.height);
+        while (size > 1)
+        {
+            size /= 2;
+            num_levels++;
+        }
+    }
+
+    types::image out =
+        make_image(format, false, image.width, image.height, num_levels);
+    std::size_t block_size = get_block_size(format);
+    std::vector<unsigned char> rgba = to_rgba(image);
+
+    for (unsigned int l = 0; l < num_levels; l++)
+    {
+        const types::mip_level &level = out.levels[l];
+        int w = level.width, h = level.height;
+        int blocks_x = (w + 3) / 4, blocks_y = (h + 3) / 4;
+        unsigned char *dst = out.pixels.get() + level.offset;
+
+        thread_pool::parallel_for(
+            blocks_y,
+            [&](std::size_t by)
+            {
+                for (int bx = 0; bx < blocks_x; bx++)
+                {
+                    /* Gather the block, clamping at the edges */
+                    unsigned char block[64];
+                    for (int y = 0; y < 4; y++)
+                    {
+                        int sy = std::min((int) by * 4 + y, h - 1);
+                        for (int x = 0; x < 4; x++)
+                        {
+                            int sx = std::min(bx * 4 + x, w - 1);
+                            std::memcpy(
+                                block + (y * 4 + x) * 4,
+                                rgba.data() + ((std::size_t) sy * w + sx) * 4,
+                                4);
+                        }
+                    }
+
+                    unsigned char *b =
+                        dst + (by * blocks_x + bx) * block_size;
+                    switch (format)
+                    {
+                    case enums::BC1:
+                        encode_bc1(block, b);
+                        break;
+                    case enums::BC3:
+                        encode_bc4(block, 3, b);
+                        encode_bc1(block, b + 8);
+                        break;
+                    case enums::BC4:
+                        encode_bc4(block, 0, b);
+                        break;
+                    case enums::BC5:
+                        encode_bc4(block, 0, b);
+                        encode_bc4(block, 1, b + 8);
+                        break;
+                    case enums::BC7:
+                        encode_bc7(block, b);
+                        break;
+                    }
+                }
+            });
+
+        if (l + 1 < num_levels)
+            rgba = downsample(rgba, w, h);
+    }
+    return out;
+}
+
+void texture_compression::flip_levels(types::image &image,
+                                      enums::block_format format)
+{
+    std::size_t block_size = get_block_size(format);
+    /* Every level is checked first, so that the image is either flipped
+     * whole or left untouched */
+    for (const auto &level : image.levels)
+    {
+        /* Rows can only be moved by whole blocks */
+        if (level.height > 4 && level.height % 4 != 0)
+        {
+            WARN("Cannot flip a compressed level of height {}", level.height);
+            return;
+        }
+        if (format != enums::BC7)
+            continue;
+
+        const unsigned char *data = image.pixels.get() + level.offset;
+        for (std::size_t b = 0; b < level.size; b += block_size)
+        {
+            if (!is_bc7_mode_6(data + b))
+            {
+                WARN("Only BC7 mode 6 blocks can be flipped, bake the "
+                     "texture already flipped");
+                return;
+            }
+        }
+    }
+
+    for (auto &level : image.levels)
+    {
+        int blocks_x = (level.width + 3) / 4;
+        int blocks_y = (level.height + 3) / 4;
+        int rows = std::min(4, level.height);
+        std::size_t row_size = blocks_x * block_size;
+        unsigned char *data = image.pixels.get() + level.offset;
+
+        for (int by = 0; by < blocks_y / 2; by++)
+            std::swap_ranges(data + by * row_size, data + (by + 1) * row_size,
+                             data + (blocks_y - 1 - by) * row_size);
+
+        for (std::size_t b = 0; b < level.size; b += block_size)
+        {
+            unsigned char *block = data + b;
+            switch (format)
+            {
+            case enums::BC1:
+                flip_bc1_block(block, rows);
+                break;
+            case enums::BC3:
+                flip_bc4_block(block, rows);
+                flip_bc1_block(block + 8, rows);
+                break;
+            case enums::BC4:
+                flip_bc4_block(block, rows);
+                break;
+            case enums::BC5:
+                flip_bc4_block(block, rows);
+                flip_bc4_block(block + 8, rows);
+                break;
+            case enums::BC7:
+                flip_bc7_block(block, rows);
+                break;
+            }
+        }
+    }
+}
+
+void texture_compression::encode_bc1(const unsigned char *rgba,
+                                     unsigned char *out)
+{
+    float points[16][3];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+            points[i][c] = rgba[i * 4 + c];
+
+    float mean[3], axis[3];
+    principal_axis(points, mean, axis);
+
+    /* The extremes along the principal axis become the endpoints */
+    int lo = 0, hi = 0;
+    float min_t = 0.0f, max_t = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 3; c++)
+            t += (points[i][c] - mean[c]) * axis[c];
+        if (i == 0 || t < min_t)
+            min_t = t, lo = i;
+        if (i == 0 || t > max_t)
+            max_t = t, hi = i;
+    }
+
+    std::uint16_t c0 = to_565(points[hi]);
+    std::uint16_t c1 = to_565(points[lo]);
+    if (c0 < c1)
+        std::swap(c0, c1);
+
+    int palette[4][3];
+    from_565(c0, palette[0]);
+    from_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    out[0] = c0 & 0xFF;
+    out[1] = c0 >> 8;
+    out[2] = c1 & 0xFF;
+    out[3] = c1 >> 8;
+    for (int y = 0; y < 4; y++)
+    {
+        unsigned char row = 0;
+        for (int x = 0; x < 4; x++)
+        {
+            const unsigned char *p = rgba + (y * 4 + x) * 4;
+            int best = 0, best_error = 1 << 30;
+            /* With equal endpoints only the first color is valid */
+            int num_colors = c0 == c1 ? 1 : 4;
+            for (int i = 0; i < num_colors; i++)
+            {
+                int error = 0;
+                for (int c = 0; c < 3; c++)
+                    error += (p[c] - palette[i][c]) * (p[c] - palette[i][c]);
+                if (error < best_error)
+                    best_error = error, best = i;
+            }
+            row |= best << (x * 2);
+        }
+        out[4 + y] = row;
+    }
+}
+
+void texture_compression::encode_bc4(const unsigned char *rgba, int channel,
+                                     unsigned char *out)
+{
+    int a0 = 0, a1 = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        a0 = std::max(a0, (int) rgba[i * 4 + channel]);
+        a1 = std::min(a1, (int) rgba[i * 4 + channel]);
+    }
+
+    int palette[8];
+    palette[0] = a0;
+    palette[1] = a1;
+    for (int i = 2; i < 8; i++)
+        palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+
+    out[0] = a0;
+    out[1] = a1;
+    std::uint64_t bits = 0;
+    for (int i = 0; i < 16 && a0 != a1; i++)
+    {
+        int v = rgba[i * 4 + channel];
+        int best = 0;
+        for (int j = 1; j < 8; j++)
+            if (std::abs(v - palette[j]) < std::abs(v - palette[best]))
+                best = j;
+        bits |= (std::uint64_t) best << (i * 3);
+    }
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (bits >> (i * 8)) & 0xFF;
+}
+
+void texture_compression::encode_bc7(const unsigned char *rgba,
+                                     unsigned char *out)
+{
+    /* Mode 6: one subset, RGBA 7 bit endpoints with a p-bit each and
+     * 4 bit indices */
+    float points[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            points[i][c] = rgba[i * 4 + c];
+
+    float mean[4], axis[4];
+    principal_axis(points, mean, axis);
+
+    float min_t = 0.0f, max_t = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; c++)
+            t += (points[i][c] - mean[c]) * axis[c];
+        min_t = std::min(min_t, t);
+        max_t = std::max(max_t, t);
+    }
+
+    int q[2][4], p[2];
+    for (int e = 0; e < 2; e++)
+    {
+        float t = e == 0 ? min_t : max_t;
+        float endpoint[4];
+        for (int c = 0; c < 4; c++)
+            endpoint[c] = std::clamp(mean[c] + t * axis[c], 0.0f, 255.0f);
+
+        /* Pick the p-bit that best represents the endpoint */
+        int best_error = 1 << 30;
+        for (int pbit = 0; pbit < 2; pbit++)
+        {
+            int error = 0, candidate[4];
+            for (int c = 0; c < 4; c++)
+            {
+                candidate[c] = std::clamp(
+                    (int) std::lround((endpoint[c] - pbit) / 2.0f), 0, 127);
+                int d = ((candidate[c] << 1) | pbit) - (int) endpoint[c];
+                error += d * d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                p[e] = pbit;
+                std::copy(candidate, candidate + 4, q[e]);
+            }
+        }
+    }
+
+    int palette[16][4];
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            int e0 = (q[0][c] << 1) | p[0];
+            int e1 = (q[1][c] << 1) | p[1];
+            palette[i][c] =
+                ((64 - bc7_weights[i]) * e0 + bc7_weights[i] * e1 + 32) >> 6;
+        }
+    }
+
+    int indices[16];
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, best_error = 1 << 30;
+        for (int j = 0; j < 16; j++)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; c++)
+            {
+                int d = rgba[i * 4 + c] - palette[j][c];
+                error += d * d;
+            }
+            if (error < best_error)
+                best_error = error, best = j;
+        }
+        indices[i] = best;
+    }
+
+    /* The anchor index has an implicit zero high bit */
+    if (indices[0] & 8)
+    {
+        std::swap(q[0], q[1]);
+        std::swap(p[0], p[1]);
+        for (int i = 0; i < 16; i++)
+            indices[i] = 15 - indices[i];
+    }
+
+    std::memset(out, 0, 16);
+    set_bits(out, 0, 7, 0x40);
+    for (int c = 0; c < 4; c++)
+    {
+        set_bits(out, 7 + c * 14, 7, q[0][c]);
+        set_bits(out, 14 + c * 14, 7, q[1][c]);
+    }
+    set_bits(out, 63, 1, p[0]);
+    set_bits(out, 64, 1, p[1]);
+    set_bits(out, 65, 3, indices[0]);
+    for (int i = 1; i < 16; i++)
+        set_bits(out, 68 + (i - 1) * 4, 4, indices[i]);
+}
@@ -0,0 +1,214 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "texture_streamer.hpp"
+
+#include "engine_logger.hpp"
+#include "gl_helper.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace brenta;
+
+bool texture_streamer::enabled = false;
+std::size_t texture_streamer::frame_budget = 0;
+std::deque<texture_streamer::upload> texture_streamer::uploads;
+std::unordered_set<unsigned int> texture_streamer::pending;
+std::vector<texture_streamer::pixel_buffer> texture_streamer::buffers;
+unsigned int texture_streamer::next_buffer = 0;
+
+void texture_streamer::init(std::size_t frame_budget)
+{
+    if (enabled)
+        return;
+
+    texture_streamer::frame_budget = frame_budget;
+    buffers.resize(num_buffers);
+    for (auto &buffer : buffers)
+        glGenBuffers(1, &buffer.id);
+    next_buffer = 0;
+    enabled = true;
+
+    INFO("Texture streaming enabled, {} bytes per frame", frame_budget);
+}
+
+void texture_streamer::destroy()
+{
+    if (!enabled)
+        return;
+
+    for (auto &buffer : buffers)
+    {
+        if (buffer.fence)
+            glDeleteSync(buffer.fence);
+        gl::forget_buffer(buffer.id);
+        glDeleteBuffers(1, &buffer.id);
+    }
+    buffers.clear();
+    uploads.clear();
+    pending.clear();
+    enabled = false;
+}
+
+bool texture_streamer::is_enabled()
+{
+    return enabled;
+}
+
+unsigned int texture_streamer::stream(const std::string &path, bool flip)
+{
+    unsigned int texture = create_placeholder();
+    upload up;
+    up.texture = texture;
+    up.decoding = thread_pool::submit(
+        [path, flip]() { return texture::decode_image(path, flip); });
+    uploads.push_back(std::move(up));
+    pending.insert(texture);
+    return texture;
+}
+
+unsigned int texture_streamer::stream(const types::image &image)
+{
+    unsigned int texture = create_placeholder();
+    upload up;
+    up.texture = texture;
+    up.image = image;
+    uploads.push_back(std::move(up));
+    pending.insert(texture);
+    return texture;
+}
+
+void texture_streamer::update()
+{
+    if (!enabled)
+        return;
+
+    std::size_t budget = frame_budget;
+    bool uploaded = false;
+    for (auto it = uploads.begin(); it != uploads.end();)
+    {
+        if (it->decoding.valid())
+        {
+            if (it->decoding.wait_for(std::chrono::seconds(0))
+                != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            it->image = it->decoding.get();
+        }
+
+        /* Failed decodes keep the placeholder */
+        if (!it->image.pixels)
+        {
+            pending.erase(it->texture);
+            it = uploads.erase(it);
+            continue;
+        }
+
+        std::size_t size = it->image.size;
+        if (uploaded && size > budget)
+            break;
+
+        pixel_buffer *buffer = acquire_buffer();
+        if (!buffer)
+            break;
+
+        transfer(*buffer, *it);
+        budget -= std::min(size, budget);
+        uploaded = true;
+
+        pending.erase(it->texture);
+        it = uploads.erase(it);
+    }
+}
+
+bool texture_streamer::is_resident(unsigned int texture)
+{
+    return !pending.contains(texture);
+}
+
+std::size_t texture_streamer::get_num_pending()
+{
+    return pending.size();
+}
+
+unsigned int texture_streamer::create_placeholder()
+{
+    static const unsigned char grey[4] = {128, 128, 128, 255};
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    gl::bind_texture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, grey);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    return texture;
+}
+
+texture_streamer::pixel_buffer *texture_streamer::acquire_buffer()
+{
+    pixel_buffer &buffer = buffers[next_buffer];
+    if (buffer.fence)
+    {
+        /* The GPU is still reading from the oldest buffer */
+        if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return nullptr;
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+    next_buffer = (next_buffer + 1) % buffers.size();
+    return &buffer;
+}
+
+void texture_streamer::transfer(pixel_buffer &buffer, const upload &up)
+{
+    std::size_t size = up.image.size;
+
+    gl::bind_buffer(GL_PIXEL_UNPACK_BUFFER, buffer.id);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                 GL_MAP_WRITE_BIT
+                                     | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!dst)
+    {
+        ERROR("Could not map the texture upload buffer");
+        gl::bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return;
+    }
+    std::memcpy(dst, up.image.pixels.get(), size);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    /* With an unpack buffer bound the pointer is an offset in It */
+    gl::bind_texture(GL_TEXTURE_2D, up.texture);
+    texture::upload_pixels(up.image, nullptr);
+    gl::bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,191 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "thread_pool.hpp"
+
+#include "engine_logger.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+
+using namespace brenta;
+
+std::vector<std::thread> thread_pool::workers;
+std::queue<std::function<void()>> thread_pool::jobs;
+std::mutex thread_pool::mutex;
+std::condition_variable thread_pool::condition;
+bool thread_pool::stopping = false;
+
+void thread_pool::init(unsigned int num_threads)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!workers.empty())
+        return;
+
+    if (num_threads == 0)
+    {
+        unsigned int hw = std::thread::hardware_concurrency();
+        num_threads = hw > 1 ? hw - 1 : 1;
+    }
+
+    /* Joinable workers would terminate the program when the statics
+     * are destroyed, so they are joined at exit if the engine did not
+     * stop them first */
+    static bool registered = false;
+    if (!registered)
+    {
+        std::atexit(destroy);
+        registered = true;
+    }
+
+    stopping = false;
+    for (unsigned int i = 0; i < num_threads; i++)
+        workers.emplace_back(worker_loop);
+
+    INFO("Thread pool started with {} workers", num_threads);
+}
+
+void thread_pool::destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (workers.empty())
+            return;
+        stopping = true;
+    }
+    condition.notify_all();
+    for (auto &worker : workers)
+        worker.join();
+    workers.clear();
+    INFO("Thread pool stopped");
+}
+
+unsigned int thread_pool::get_num_threads()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return workers.size();
+}
+
+void thread_pool::enqueue(std::function<void()> job)
+{
+    init();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push(std::move(job));
+    }
+    condition.notify_one();
+}
+
+void thread_pool::worker_loop()
+{
+    while (true)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
+
+void thread_pool::parallel_for(std::size_t count,
+                               const std::function<void(std::size_t)> &fn)
+{
+    if (count == 0)
+        return;
+    if (count == 1)
+    {
+        fn(0);
+        return;
+    }
+
+    /* Helpers may start after the loop is over, so the shared state
+     * must outlive this call */
+    struct loop_state
+    {
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> done{0};
+        std::size_t count;
+        const std::function<void(std::size_t)> *fn;
+        std::mutex mutex;
+        std::condition_variable finished;
+        /* First exception thrown by fn, the indices left are skipped */
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<loop_state>();
+    state->count = count;
+    state->fn = &fn;
+
+    auto run = [](const std::shared_ptr<loop_state> &s)
+    {
+        std::size_t i;
+        while ((i = s->next.fetch_add(1)) < s->count)
+        {
+            /* Rethrown by the caller once every index is done, fn
+             * must not be left running after parallel_for returns */
+            if (!s->failed.load())
+            {
+                try
+                {
+                    (*s->fn)(i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(s->mutex);
+                    if (!s->error)
+                        s->error = std::current_exception();
+                    s->failed.store(true);
+                }
+            }
+            if (s->done.fetch_add(1) + 1 == s->count)
+            {
+                std::lock_guard<std::mutex> lock(s->mutex);
+                s->finished.notify_all();
+            }
+        }
+    };
+
+    init();
+    std::size_t helpers = std::min<std::size_t>(count - 1, get_num_threads());
+    for (std::size_t h = 0; h < helpers; h++)
+        enqueue([state, run]() { run(state); });
+
+    /* The caller works too, then waits only for indices that have
+     * already been claimed by a helper */
+    run(state);
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(
+        lock, [&state] { return state->done.load() == state->count; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
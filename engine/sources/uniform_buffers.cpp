@@ -0,0 +1,184 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "uniform_buffers.hpp"
+
+#include "gl_helper.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace brenta;
+
+/* The layouts must match std140, checked against the offsets of the
+ * blocks in the shaders */
+static_assert(sizeof(types::camera_block) == 144);
+static_assert(sizeof(types::directional_light_block) == 64);
+static_assert(sizeof(types::point_light_block) == 64);
+static_assert(offsetof(types::lights_block, point_light_count) == 320);
+static_assert(sizeof(types::lights_block) == 336);
+static_assert(offsetof(types::object_block, atlas_size) == 128);
+static_assert(sizeof(types::object_block) == 144);
+
+types::camera_block uniform_buffers::camera;
+types::lights_block uniform_buffers::lights;
+types::object_block uniform_buffers::object;
+types::buffer uniform_buffers::camera_buffer;
+types::buffer uniform_buffers::lights_buffer;
+types::buffer uniform_buffers::object_buffer;
+
+namespace
+{
+
+/* Copies next in current, false if nothing changed and the buffer
+ * already holds it */
+template <typename T>
+bool changed(const T &next, T &current, const types::buffer &buffer)
+{
+    if (buffer.id != 0 && std::memcmp(&next, &current, sizeof(T)) == 0)
+        return false;
+    current = next;
+    return true;
+}
+
+} // namespace
+
+void uniform_buffers::set_camera(const glm::mat4 &view,
+                                 const glm::mat4 &projection,
+                                 const glm::vec3 &position)
+{
+    types::camera_block block;
+    block.view = view;
+    block.projection = projection;
+    block.position = position;
+    if (changed(block, uniform_buffers::camera, camera_buffer))
+        upload(camera_buffer, camera_binding, &camera, sizeof(camera));
+}
+
+void uniform_buffers::set_directional_light(
+    const types::directional_light_block *light)
+{
+    types::lights_block block = uniform_buffers::lights;
+    block.directional =
+        light != nullptr ? *light : types::directional_light_block();
+    block.use_directional = light != nullptr;
+    if (changed(block, uniform_buffers::lights, lights_buffer))
+        upload(lights_buffer, lights_binding, &lights, sizeof(lights));
+}
+
+void uniform_buffers::set_point_lights(
+    std::span<const types::point_light_block> lights)
+{
+    std::size_t count = std::min<std::size_t>(
+        lights.size(), types::lights_block::max_point_lights);
+
+    types::lights_block block = uniform_buffers::lights;
+    std::fill(std::begin(block.point_lights), std::end(block.point_lights),
+              types::point_light_block());
+    std::copy_n(lights.begin(), count, block.point_lights);
+    block.point_light_count = count;
+    if (changed(block, uniform_buffers::lights, lights_buffer))
+        upload(lights_buffer, lights_binding, &uniform_buffers::lights,
+               sizeof(uniform_buffers::lights));
+}
+
+void uniform_buffers::set_object(const glm::mat4 &model, int atlas_size,
+                                 int atlas_index)
+{
+    types::object_block block;
+    block.model = model;
+    block.normal_matrix =
+        glm::mat4(glm::transpose(glm::inverse(glm::mat3(model))));
+    block.atlas_size = atlas_size;
+    block.atlas_index = atlas_index;
+    if (changed(block, uniform_buffers::object, object_buffer))
+        upload(object_buffer, object_binding, &object, sizeof(object));
+}
+
+const types::camera_block &uniform_buffers::get_camera()
+{
+    return uniform_buffers::camera;
+}
+
+const types::lights_block &uniform_buffers::get_lights()
+{
+    return uniform_buffers::lights;
+}
+
+const types::object_block &uniform_buffers::get_object()
+{
+    return uniform_buffers::object;
+}
+
+void uniform_buffers::bind_blocks(unsigned int program)
+{
+    GLuint index = glGetUniformBlockIndex(program, "Camera");
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(program, index, camera_binding);
+        /* Drawing with a block that has no buffer is an error, the
+         * defaults are uploaded until the first write */
+        if (camera_buffer.id == 0)
+            upload(camera_buffer, camera_binding, &camera, sizeof(camera));
+    }
+
+    index = glGetUniformBlockIndex(program, "Lights");
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(program, index, lights_binding);
+        if (lights_buffer.id == 0)
+            upload(lights_buffer, lights_binding, &lights, sizeof(lights));
+    }
+
+    index = glGetUniformBlockIndex(program, "Object");
+    if (index != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(program, index, object_binding);
+        if (object_buffer.id == 0)
+            upload(object_buffer, object_binding, &object, sizeof(object));
+    }
+}
+
+void uniform_buffers::destroy()
+{
+    uniform_buffers::camera_buffer = types::buffer();
+    uniform_buffers::lights_buffer = types::buffer();
+    uniform_buffers::object_buffer = types::buffer();
+}
+
+void uniform_buffers::upload(types::buffer &buffer, unsigned int binding,
+                             const void *data, std::size_t size)
+{
+    if (buffer.id == 0)
+    {
+        buffer = types::buffer(GL_UNIFORM_BUFFER);
+        buffer.copy_data(size, data, GL_DYNAMIC_DRAW);
+        gl::bind_buffer_base(GL_UNIFORM_BUFFER, binding, buffer.id);
+        return;
+    }
+    buffer.copy_sub_data(0, size, data);
+}
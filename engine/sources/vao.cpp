@@ -27,6 +27,7 @@
 #include "vao.hpp"
 
 #include "engine_logger.hpp"
+#include "gl_helper.hpp"
 
 using namespace brenta::types;
 
@@ -36,7 +37,36 @@ void vao::init()
     bind();
 }
 
-unsigned int vao::get_vao()
+vao::vao(vao &&other) noexcept : vao_id(other.vao_id)
+{
+    other.vao_id = 0;
+}
+
+vao &vao::operator=(vao &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (this->vao_id != 0)
+        {
+            gl::forget_vertex_array(this->vao_id);
+            glDeleteVertexArrays(1, &this->vao_id);
+        }
+        this->vao_id = other.vao_id;
+        other.vao_id = 0;
+    }
+    return *this;
+}
+
+vao::~vao()
+{
+    if (this->vao_id != 0)
+    {
+        gl::forget_vertex_array(this->vao_id);
+        glDeleteVertexArrays(1, &this->vao_id);
+    }
+}
+
+unsigned int vao::get_vao() const
 {
     if (vao_id == 0)
     {
@@ -46,22 +76,22 @@ unsigned int vao::get_vao()
     return vao_id;
 }
 
-void vao::bind()
+void vao::bind() const
 {
     if (this->get_vao() == 0)
     {
         ERROR("VAO not initialized");
         return;
     }
-    glBindVertexArray(this->get_vao());
+    gl::bind_vertex_array(this->get_vao());
 }
 
-void vao::unbind()
+void vao::unbind() const
 {
-    glBindVertexArray(0);
+    gl::bind_vertex_array(0);
 }
 
-void vao::set_vertex_data(buffer buffer, unsigned int index, GLint size,
+void vao::set_vertex_data(const buffer &buffer, unsigned int index, GLint size,
                           GLenum type, GLboolean normalized, GLsizei stride,
                           const void *pointer)
 {
@@ -80,5 +110,7 @@ void vao::destroy()
         ERROR("VAO not initialized");
         return;
     }
+    gl::forget_vertex_array(this->vao_id);
     glDeleteVertexArrays(1, &this->vao_id);
+    this->vao_id = 0;
 }
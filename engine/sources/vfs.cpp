@@ -0,0 +1,494 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "vfs.hpp"
+
+#include "embedded_assets.hpp"
+#include "engine_logger.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define BRENTA_HAS_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace brenta;
+
+std::vector<vfs::mount_point> vfs::mount_points;
+std::mutex vfs::mutex;
+bool vfs::io_uring_enabled = false;
+
+namespace
+{
+
+#ifdef BRENTA_HAS_IO_URING
+
+/* Reads larger than this are split, the kernel caps a single read */
+constexpr std::size_t max_read_size = 1 << 30;
+
+/*
+ * A minimal io_uring that only reads files, talking to the kernel
+ * with the raw system calls so that there is no liburing dependency.
+ * Each batch sets up its own ring, so batches on different threads
+ * do not need to synchronize.
+ */
+class read_ring
+{
+  public:
+    read_ring(const read_ring &) = delete;
+    read_ring &operator=(const read_ring &) = delete;
+
+    read_ring(unsigned int entries)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        this->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+        if (this->fd < 0)
+            return;
+
+        this->sq_size =
+            params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        this->cq_size =
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap)
+            this->sq_size = this->cq_size = std::max(sq_size, cq_size);
+
+        this->sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (this->sq_ptr == MAP_FAILED)
+            return;
+        this->cq_ptr = single_mmap
+                           ? sq_ptr
+                           : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, fd,
+                                  IORING_OFF_CQ_RING);
+        if (this->cq_ptr == MAP_FAILED)
+            return;
+        this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes_ptr == MAP_FAILED)
+            return;
+        this->sqes = static_cast<io_uring_sqe *>(sqes_ptr);
+
+        char *sq = static_cast<char *>(sq_ptr);
+        this->sq_tail = (unsigned int *) (sq + params.sq_off.tail);
+        this->sq_mask = *(unsigned int *) (sq + params.sq_off.ring_mask);
+        this->sq_array = (unsigned int *) (sq + params.sq_off.array);
+        char *cq = static_cast<char *>(cq_ptr);
+        this->cq_head = (unsigned int *) (cq + params.cq_off.head);
+        this->cq_tail = (unsigned int *) (cq + params.cq_off.tail);
+        this->cq_mask = *(unsigned int *) (cq + params.cq_off.ring_mask);
+        this->cqes = (io_uring_cqe *) (cq + params.cq_off.cqes);
+        this->capacity = params.sq_entries;
+    }
+
+    ~read_ring()
+    {
+        if (this->sqes)
+            munmap(this->sqes, this->sqes_size);
+        if (this->cq_ptr != MAP_FAILED && this->cq_ptr != this->sq_ptr)
+            munmap(this->cq_ptr, this->cq_size);
+        if (this->sq_ptr != MAP_FAILED)
+            munmap(this->sq_ptr, this->sq_size);
+        if (this->fd >= 0)
+            close(this->fd);
+    }
+
+    bool is_valid() const
+    {
+        return this->sqes != nullptr;
+    }
+
+    unsigned int get_capacity() const
+    {
+        return this->capacity;
+    }
+
+    /* The caller keeps at most capacity reads in flight */
+    void push_read(int file, void *buffer, unsigned int size,
+                   std::uint64_t offset, std::uint64_t user_data)
+    {
+        unsigned int tail = *this->sq_tail;
+        unsigned int index = tail & this->sq_mask;
+        io_uring_sqe *sqe = &this->sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = file;
+        sqe->addr = (std::uint64_t) buffer;
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = user_data;
+        this->sq_array[index] = index;
+        /* The kernel must see the entry before the new tail */
+        __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        this->to_submit++;
+    }
+
+    /* Submits the pushed reads and waits for at least one completion */
+    bool submit_and_wait()
+    {
+        int ret;
+        do
+        {
+            ret = (int) syscall(__NR_io_uring_enter, this->fd,
+                                this->to_submit, 1, IORING_ENTER_GETEVENTS,
+                                nullptr, 0);
+        } while (ret < 0 && errno == EINTR);
+        /* The completion queue is full, reaping it makes room */
+        if (ret < 0)
+            return errno == EAGAIN || errno == EBUSY;
+        this->to_submit -= std::min<unsigned int>(ret, this->to_submit);
+        return true;
+    }
+
+    /* Waits for at least one completion, submitting nothing */
+    bool wait()
+    {
+        int ret;
+        do
+        {
+            ret = (int) syscall(__NR_io_uring_enter, this->fd, 0, 1,
+                                IORING_ENTER_GETEVENTS, nullptr, 0);
+        } while (ret < 0 && errno == EINTR);
+        return ret >= 0;
+    }
+
+    /* Forgets the pushed reads the kernel has not taken, they are
+     * never submitted, and returns how many they were */
+    unsigned int drop_unsubmitted()
+    {
+        unsigned int dropped = this->to_submit;
+        __atomic_store_n(this->sq_tail, *this->sq_tail - dropped,
+                         __ATOMIC_RELEASE);
+        this->to_submit = 0;
+        return dropped;
+    }
+
+    template <typename F> void for_each_completion(F &&fn)
+    {
+        unsigned int head = *this->cq_head;
+        unsigned int tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const io_uring_cqe &cqe = this->cqes[head & this->cq_mask];
+            fn(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+  private:
+    int fd = -1;
+    void *sq_ptr = MAP_FAILED;
+    void *cq_ptr = MAP_FAILED;
+    std::size_t sq_size = 0;
+    std::size_t cq_size = 0;
+    std::size_t sqes_size = 0;
+    io_uring_sqe *sqes = nullptr;
+    unsigned int *sq_tail = nullptr;
+    unsigned int *sq_array = nullptr;
+    unsigned int sq_mask = 0;
+    unsigned int *cq_head = nullptr;
+    unsigned int *cq_tail = nullptr;
+    unsigned int cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+    unsigned int capacity = 0;
+    unsigned int to_submit = 0;
+};
+
+bool probe_io_uring()
+{
+    read_ring ring(1);
+    return ring.is_valid();
+}
+
+#endif
+
+std::string normalize_prefix(const std::string &prefix)
+{
+    std::string key = asset_pack::get_key(prefix);
+    while (!key.empty() && key.back() == '/')
+        key.pop_back();
+    return key;
+}
+
+} // namespace
+
+void vfs::mount(const std::string &prefix, const std::string &directory)
+{
+    std::lock_guard<std::mutex> lock(vfs::mutex);
+    vfs::mount_points.push_back({normalize_prefix(prefix), directory});
+    std::stable_sort(vfs::mount_points.begin(), vfs::mount_points.end(),
+                     [](const mount_point &a, const mount_point &b)
+                     { return a.prefix.size() > b.prefix.size(); });
+    INFO("Mounted {} on {}", directory, prefix);
+}
+
+void vfs::unmount_all()
+{
+    std::lock_guard<std::mutex> lock(vfs::mutex);
+    vfs::mount_points.clear();
+}
+
+std::string vfs::resolve(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(vfs::mutex);
+    if (vfs::mount_points.empty())
+        return path;
+
+    std::string key = asset_pack::get_key(path);
+    for (const auto &mount : vfs::mount_points)
+    {
+        if (key == mount.prefix)
+            return mount.directory;
+        if (mount.prefix.empty())
+            return (std::filesystem::path(mount.directory) / key).string();
+        if (key.size() > mount.prefix.size()
+            && key.compare(0, mount.prefix.size(), mount.prefix) == 0
+            && key[mount.prefix.size()] == '/')
+        {
+            return (std::filesystem::path(mount.directory)
+                    / key.substr(mount.prefix.size() + 1))
+                .string();
+        }
+    }
+    return path;
+}
+
+bool vfs::exists(const std::string &path)
+{
+    std::error_code ec;
+    return asset_pack::contains(path) || embedded_assets::contains(path)
+           || std::filesystem::exists(resolve(path), ec);
+}
+
+types::asset vfs::read(const std::string &path)
+{
+    if (asset_pack::contains(path))
+        return asset_pack::load(path);
+    if (embedded_assets::contains(path))
+        return embedded_assets::load(path);
+    return read_file(resolve(path));
+}
+
+types::asset vfs::read_file(const std::string &path)
+{
+    auto file = std::make_shared<types::mapped_file>(path);
+    if (!file->is_open())
+        return types::asset();
+    std::span<const unsigned char> bytes(file->data(), file->size());
+    return types::asset(bytes, std::move(file));
+}
+
+std::vector<types::asset> vfs::read_batch(std::span<const std::string> paths)
+{
+    std::vector<types::asset> assets(paths.size());
+
+    /* Packs and embedded resources are already in memory, only the
+     * loose files need a read */
+    std::vector<std::size_t> loose;
+    std::vector<std::string> files;
+    for (std::size_t i = 0; i < paths.size(); i++)
+    {
+        if (asset_pack::contains(paths[i]))
+            assets[i] = asset_pack::load(paths[i]);
+        else if (embedded_assets::contains(paths[i]))
+            assets[i] = embedded_assets::load(paths[i]);
+        else
+        {
+            loose.push_back(i);
+            files.push_back(resolve(paths[i]));
+        }
+    }
+    if (files.empty())
+        return assets;
+
+    std::vector<types::asset> read(files.size());
+    if (!uses_io_uring() || !read_io_uring(files, read))
+    {
+        thread_pool::parallel_for(files.size(), [&](std::size_t i)
+                                  { read[i] = read_file(files[i]); });
+    }
+    for (std::size_t i = 0; i < loose.size(); i++)
+        assets[loose[i]] = std::move(read[i]);
+    return assets;
+}
+
+std::future<std::vector<types::asset>>
+vfs::read_async(std::vector<std::string> paths)
+{
+    return thread_pool::submit([paths = std::move(paths)]()
+                               { return read_batch(paths); });
+}
+
+void vfs::set_io_uring(bool enabled)
+{
+    vfs::io_uring_enabled = enabled;
+}
+
+bool vfs::uses_io_uring()
+{
+#ifdef BRENTA_HAS_IO_URING
+    /* Containers and hardened kernels often forbid io_uring */
+    static const bool supported = probe_io_uring();
+    return vfs::io_uring_enabled && supported;
+#else
+    return false;
+#endif
+}
+
+std::string vfs::get_temp_path(const std::string &path)
+{
+    static std::atomic<unsigned long> counter = 0;
+    return path + "." + std::to_string(getpid()) + "."
+           + std::to_string(counter++) + ".tmp";
+}
+
+bool vfs::read_io_uring(const std::vector<std::string> &files,
+                        std::vector<types::asset> &assets)
+{
+#ifdef BRENTA_HAS_IO_URING
+    read_ring ring(std::min<std::size_t>(queue_depth, files.size()));
+    if (!ring.is_valid())
+        return false;
+
+    struct request
+    {
+        int fd = -1;
+        unsigned char *buffer = nullptr;
+        std::size_t size = 0;
+        std::size_t done = 0;
+        bool failed = false;
+    };
+    std::vector<request> requests(files.size());
+    std::vector<std::shared_ptr<unsigned char>> buffers(files.size());
+
+    /* Opening is cheap next to reading, the reads are what overlap */
+    std::vector<std::size_t> pending;
+    for (std::size_t i = 0; i < files.size(); i++)
+    {
+        request &r = requests[i];
+        r.fd = open(files[i].c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (r.fd < 0 || fstat(r.fd, &st) != 0 || st.st_size == 0)
+        {
+            r.failed = true;
+            continue;
+        }
+        r.size = (std::size_t) st.st_size;
+        buffers[i] = std::shared_ptr<unsigned char>(
+            new unsigned char[r.size], std::default_delete<unsigned char[]>());
+        r.buffer = buffers[i].get();
+        pending.push_back(i);
+    }
+    std::reverse(pending.begin(), pending.end());
+
+    unsigned int in_flight = 0;
+    bool ring_failed = false;
+    while (!pending.empty() || in_flight > 0)
+    {
+        while (!ring_failed && !pending.empty()
+               && in_flight < ring.get_capacity())
+        {
+            std::size_t i = pending.back();
+            pending.pop_back();
+            request &r = requests[i];
+            std::size_t size = std::min(r.size - r.done, max_read_size);
+            ring.push_read(r.fd, r.buffer + r.done, (unsigned int) size,
+                           r.done, i);
+            in_flight++;
+        }
+        if (ring_failed)
+        {
+            if (!ring.wait())
+            {
+                /* The kernel may still write to the buffers, leak
+                 * them rather than free memory in use */
+                new std::vector<std::shared_ptr<unsigned char>>(buffers);
+                break;
+            }
+        }
+        else if (!ring.submit_and_wait())
+        {
+            /* The reads already submitted write to the buffers, so
+             * they are reaped before the buffers can be freed */
+            ring_failed = true;
+            in_flight -= ring.drop_unsubmitted();
+            pending.clear();
+            continue;
+        }
+        ring.for_each_completion(
+            [&](std::uint64_t i, int res)
+            {
+                in_flight--;
+                request &r = requests[i];
+                if (res == -EAGAIN || res == -EINTR)
+                    pending.push_back(i);
+                else if (res <= 0)
+                    r.failed = true;
+                else if ((r.done += res) < r.size)
+                    pending.push_back(i);
+            });
+        if (ring_failed)
+            pending.clear();
+    }
+
+    for (std::size_t i = 0; i < files.size(); i++)
+    {
+        request &r = requests[i];
+        if (r.fd >= 0)
+            close(r.fd);
+        if (!ring_failed && !r.failed && r.done == r.size)
+        {
+            std::span<const unsigned char> bytes(r.buffer, r.size);
+            assets[i] = types::asset(bytes, std::move(buffers[i]));
+        }
+        else
+            /* Old kernels do not know IORING_OP_READ, and a file may
+             * have changed meanwhile, map It instead */
+            assets[i] = read_file(files[i]);
+    }
+    return true;
+#else
+    (void) files;
+    (void) assets;
+    return false;
+#endif
+}
@@ -33,6 +33,7 @@
 
 #include <filesystem>
 #include <iostream>
+#include <memory>
 
 using namespace brenta;
 using namespace brenta::types;
@@ -59,7 +60,7 @@ struct transform_component : component
 
 struct model_component : component
 {
-    model mod;
+    std::shared_ptr<model> mod;
     float shininess;
     brenta::types::shader_name_t shader;
     bool hasAtlas;
@@ -68,14 +69,14 @@ struct model_component : component
     int elapsedFrames = 0;
 
     model_component()
-        : mod(model()), shininess(0.0f), shader("default_shader"),
+        : mod(nullptr), shininess(0.0f), shader("default_shader"),
           hasAtlas(false), atlasSize(0), atlasIndex(0)
     {
     }
-    model_component(model mod, float shininess,
+    model_component(std::shared_ptr<model> mod, float shininess,
                     brenta::types::shader_name_t shader)
-        : mod(mod), shininess(shininess), shader(shader), hasAtlas(false),
-          atlasSize(0), atlasIndex(0)
+        : mod(std::move(mod)), shininess(shininess), shader(shader),
+          hasAtlas(false), atlasSize(0), atlasIndex(0)
     {
     }
 };
@@ -115,7 +116,7 @@ struct renderer_system : system<model_component, transform_component>
                               model_c->shininess);
 
             shader::set_int(default_shader, "atlasIndex", 0);
-            my_model.draw(default_shader);
+            my_model->draw(default_shader);
         }
     }
 };
@@ -198,7 +199,8 @@ int main()
                        GL_FRAGMENT_SHADER,
                        std::filesystem::absolute("examples/default_shader.fs"));
     }
-    model mod(std::filesystem::absolute("assets/models/sphere/sphere.obj"));
+    auto mod = std::make_shared<model>(
+        std::filesystem::absolute("assets/models/sphere/sphere.obj"));
     auto model_c = model_component(mod, 32.0f, "default_shader");
     world::add_component<model_component>(room_entity, std::move(model_c));
     INFO("Room entity created");
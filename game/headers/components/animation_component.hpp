@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "engine.hpp"
+#include "viotecs/viotecs.hpp"
+
+#include <string>
+
+using namespace brenta;
+using namespace viotecs;
+
+/* Animation Component
+ *
+ * Plays the clip called clip of the skeleton of the model, the first
+ * one if the name is empty. The AnimationSystem binds the state once
+ * the model is resident and updates the palette every frame, the
+ * renderer uploads It when drawing the model.
+ */
+struct AnimationComponent : component
+{
+    std::string clip;
+    float speed;
+    brenta::types::animation_state state;
+
+    AnimationComponent() : speed(1.0f)
+    {
+    }
+    AnimationComponent(std::string clip, float speed = 1.0f)
+        : clip(clip), speed(speed)
+    {
+    }
+};
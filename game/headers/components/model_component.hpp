@@ -29,30 +29,48 @@
 #include "engine.hpp"
 #include "viotecs/viotecs.hpp"
 
+#include <memory>
+
 using namespace brenta;
 using namespace viotecs;
 
-/* Model Component */
+/* Model Component
+ *
+ * The model may still be loading, in that case the placeholder
+ * is drawn instead (if any). lod is the level of detail drawn in
+ * the last frame, the renderer updates It.
+ */
 struct ModelComponent : component
 {
-    model mod;
+    model_handle mod;
+    model_handle placeholder;
     float shininess;
     brenta::types::shader_name_t shader;
     bool hasAtlas;
     int atlasSize;
     int atlasIndex;
     int elapsedFrames = 0;
+    unsigned int lod = 0;
 
     ModelComponent()
-        : mod(model()), shininess(0.0f), shader("default_shader"),
+        : mod(model_handle()), shininess(0.0f), shader("default_shader"),
           hasAtlas(false), atlasSize(0), atlasIndex(0)
     {
     }
+    ModelComponent(model_handle mod, float shininess,
+                   brenta::types::shader_name_t shader, bool hasAtlas = false,
+                   int atlasSize = 0, int atlasIndex = 0,
+                   model_handle placeholder = model_handle())
+        : mod(mod), placeholder(placeholder), shininess(shininess),
+          shader(shader), hasAtlas(hasAtlas), atlasSize(atlasSize),
+          atlasIndex(atlasIndex)
+    {
+    }
     ModelComponent(model mod, float shininess,
                    brenta::types::shader_name_t shader, bool hasAtlas = false,
                    int atlasSize = 0, int atlasIndex = 0)
-        : mod(mod), shininess(shininess), shader(shader), hasAtlas(hasAtlas),
-          atlasSize(atlasSize), atlasIndex(atlasIndex)
+        : ModelComponent(model_handle(std::make_shared<model>(std::move(mod))),
+                         shininess, shader, hasAtlas, atlasSize, atlasIndex)
     {
     }
 };
@@ -36,6 +36,7 @@
 #include "entities/sphere_entity.hpp"
 
 /* Components */
+#include "components/animation_component.hpp"
 #include "components/directional_light_component.hpp"
 #include "components/model_component.hpp"
 #include "components/physics_component.hpp"
@@ -44,6 +45,7 @@
 #include "components/transform_component.hpp"
 
 /* Systems */
+#include "systems/animation_system.hpp"
 #include "systems/collisions_system.hpp"
 #include "systems/debug_text_system.hpp"
 #include "systems/directional_light_system.hpp"
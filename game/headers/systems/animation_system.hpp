@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "components/animation_component.hpp"
+#include "components/model_component.hpp"
+#include "engine.hpp"
+#include "viotecs/viotecs.hpp"
+
+#include <vector>
+
+using namespace viotecs;
+using namespace viotecs::types;
+
+/* Evaluates the pose of every animated model in parallel, must run
+ * before the RendererSystem */
+struct AnimationSystem : system<AnimationComponent, ModelComponent>
+{
+    void run(std::vector<entity_t> matches) const override
+    {
+        if (matches.empty())
+            return;
+
+        std::vector<brenta::types::animation_state *> states;
+        states.reserve(matches.size());
+        for (auto match : matches)
+        {
+            auto animation_component =
+                world::entity_to_component<AnimationComponent>(match);
+
+            auto model_component =
+                world::entity_to_component<ModelComponent>(match);
+
+            if (!model_component->mod.is_resident())
+                continue;
+            auto myModel = model_component->mod.get();
+            if (!myModel->has_skeleton())
+                continue;
+
+            /* Bind the state the first time the model is ready */
+            auto &state = animation_component->state;
+            if (state.skeleton != &myModel->get_skeleton())
+            {
+                state.skeleton = &myModel->get_skeleton();
+                if (!animation_component->clip.empty())
+                    state.clip =
+                        myModel->find_animation(animation_component->clip);
+                else if (!myModel->get_animations().empty())
+                    state.clip = &myModel->get_animations().front();
+                state.time = 0.0f;
+            }
+            state.speed = animation_component->speed;
+            states.push_back(&state);
+        }
+
+        animator::evaluate(states, time::get_delta_time());
+    }
+};
@@ -84,5 +84,19 @@ struct DebugTextSystem : system<none>
             "Radius: "
                 + std::to_string(default_camera.spherical_coordinates.radius),
             25.0f, screen::get_height() - 30.0f - offset * 9, 0.35f, color);
+
+        auto clusters = cluster_culler::get_stats();
+        text::render_text(
+            "Clusters: " + std::to_string(clusters.tested)
+                + " culled: " + std::to_string(clusters.frustum_culled)
+                + " frustum, " + std::to_string(clusters.backface_culled)
+                + " backface",
+            25.0f, screen::get_height() - 30.0f - offset * 10, 0.35f, color);
+
+        auto state = gl::get_stats();
+        text::render_text(
+            "GL state changes: " + std::to_string(state.issued)
+                + " filtered: " + std::to_string(state.filtered),
+            25.0f, screen::get_height() - 30.0f - offset * 11, 0.35f, color);
     }
 };
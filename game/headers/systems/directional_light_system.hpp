@@ -34,37 +34,27 @@
 
 using namespace viotecs;
 
+/* Load the light in the Lights uniform block, shared by all shaders */
 struct DirectionalLightSystem : system<DirectionalLightComponent>
 {
     void run(std::vector<entity_t> entities) const override
     {
         if (entities.empty())
-            return;
-
-        for (auto entity : entities)
         {
-            auto light =
-                world::entity_to_component<DirectionalLightComponent>(entity);
-
-            for (auto shader : light->shaders)
-            {
-                if (shader::get_id(shader) == (unsigned int) 0)
-                {
-                    ERROR("Light shader not found with name: {}", shader);
-                    continue;
-                }
-                shader::use(shader);
-
-                /* Set the light properties */
-                shader::set_vec3(shader, "dirLight.direction",
-                                 light->direction);
-                shader::set_vec3(shader, "dirLight.ambient", light->ambient);
-                shader::set_vec3(shader, "dirLight.diffuse", light->diffuse);
-                shader::set_vec3(shader, "dirLight.specular", light->specular);
-                shader::set_float(shader, "dirLight.dir_strength",
-                                  light->strength);
-                shader::set_bool(shader, "useDirLight", true);
-            }
+            uniform_buffers::set_directional_light(nullptr);
+            return;
         }
+
+        /* The shaders have a single directional light */
+        auto light =
+            world::entity_to_component<DirectionalLightComponent>(entities[0]);
+
+        brenta::types::directional_light_block block;
+        block.direction = light->direction;
+        block.strength = light->strength;
+        block.ambient = light->ambient;
+        block.diffuse = light->diffuse;
+        block.specular = light->specular;
+        uniform_buffers::set_directional_light(&block);
     }
 };
@@ -35,18 +35,18 @@
 
 using namespace viotecs;
 
-/* Load the lights on the shaders */
+/* Load the lights in the Lights uniform block, shared by all shaders */
 struct PointLightsSystem : system<TransformComponent, PointLightComponent>
 {
+    /* Reused every frame */
+    mutable std::vector<brenta::types::point_light_block> blocks;
+
     void run(std::vector<entity_t> entities) const override
     {
-        if (entities.empty())
-            return;
-
-        int counter = 0;
+        blocks.clear();
         for (auto entity : entities)
         {
-            if (counter >= 4)
+            if (blocks.size() >= brenta::types::lights_block::max_point_lights)
             {
                 ERROR("Only 4 lights are supported");
                 break;
@@ -57,39 +57,17 @@ struct PointLightsSystem : system<TransformComponent, PointLightComponent>
             auto light =
                 world::entity_to_component<PointLightComponent>(entity);
 
-            for (auto shader : light->shaders)
-            {
-                if (shader::get_id(shader) == (unsigned int) 0)
-                {
-                    ERROR("Light shader not found with name: {}", shader);
-                    continue;
-                }
-                shader::use(shader);
-
-                /* Set the light properties */
-                std::string lightn =
-                    "pointLights[" + std::to_string(counter) + "]";
-                shader::set_vec3(shader, (lightn + ".ambient").c_str(),
-                                 light->ambient);
-                shader::set_vec3(shader, (lightn + ".diffuse").c_str(),
-                                 light->diffuse);
-                shader::set_vec3(shader, (lightn + ".specular").c_str(),
-                                 light->specular);
-                shader::set_float(shader, (lightn + ".constant").c_str(),
-                                  light->constant);
-                shader::set_float(shader, (lightn + ".linear").c_str(),
-                                  light->linear);
-                shader::set_float(shader, (lightn + ".quadratic").c_str(),
-                                  light->quadratic);
-                shader::set_float(shader, (lightn + ".strength").c_str(),
-                                  light->strength);
-                shader::set_vec3(shader, (lightn + ".position").c_str(),
-                                 transform->position);
-                shader::set_float(shader, (lightn + ".point_strength").c_str(),
-                                  light->strength);
-                shader::set_int(shader, "nPointLights", entities.size());
-            }
-            counter++;
+            brenta::types::point_light_block block;
+            block.position = transform->position;
+            block.strength = light->strength;
+            block.ambient = light->ambient;
+            block.constant = light->constant;
+            block.diffuse = light->diffuse;
+            block.linear = light->linear;
+            block.specular = light->specular;
+            block.quadratic = light->quadratic;
+            blocks.push_back(block);
         }
+        uniform_buffers::set_point_lights(blocks);
     }
 };
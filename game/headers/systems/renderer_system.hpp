@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include "components/animation_component.hpp"
 #include "components/model_component.hpp"
 #include "components/player_component.hpp"
 #include "components/transform_component.hpp"
@@ -36,12 +37,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <span>
 #include <vector>
 
 #define ANIMATION_SPEED 24
 
 using namespace viotecs;
 
+/* Submit the models to the render queue, flushed once per frame */
 struct RendererSystem : system<ModelComponent, TransformComponent>
 {
     void run(std::vector<entity_t> matches) const override
@@ -49,6 +52,12 @@ struct RendererSystem : system<ModelComponent, TransformComponent>
         if (matches.empty())
             return;
 
+        /* Shared by every shader through the Camera uniform block */
+        glm::mat4 view = default_camera.get_view_matrix();
+        glm::mat4 projection = default_camera.get_projection_matrix();
+        uniform_buffers::set_camera(view, projection,
+                                    default_camera.get_position());
+
         for (auto match : matches)
         {
             /* Get the model component */
@@ -58,24 +67,37 @@ struct RendererSystem : system<ModelComponent, TransformComponent>
             auto transform_component =
                 world::entity_to_component<TransformComponent>(match);
 
-            auto myModel = model_component->mod;
+            /* Draw the placeholder until the model is on the GPU */
+            std::shared_ptr<model> myModel;
+            if (model_component->mod.is_resident())
+                myModel = model_component->mod.get();
+            else if (model_component->placeholder.is_resident())
+                myModel = model_component->placeholder.get();
+            else
+                continue;
+
             auto default_shader = model_component->shader;
 
             brenta::types::translation t = brenta::types::translation();
-            t.set_view(default_camera.get_view_matrix());
-            t.set_projection(default_camera.get_projection_matrix());
-
             t.set_model(glm::mat4(1.0f));
             t.translate(transform_component->position);
             t.rotate(transform_component->rotation);
             t.scale(transform_component->scale);
 
-            t.set_shader(default_shader);
-
-            shader::set_vec3(default_shader, "viewPos",
-                             default_camera.get_position());
-            shader::set_float(default_shader, "material.shininess",
-                              model_component->shininess);
+            brenta::types::draw_packet packet;
+            packet.target = myModel;
+            packet.shader = default_shader;
+            packet.model_matrix = t.model;
+            packet.shininess = model_component->shininess;
+
+            /* Skeletal animation, the placeholder is never skinned */
+            auto animation_component =
+                world::entity_to_component<AnimationComponent>(match);
+            if (animation_component != nullptr
+                && myModel == model_component->mod.get())
+            {
+                packet.palette = animation_component->state.palette;
+            }
 
             /* Animation control */
             if (model_component->hasAtlas)
@@ -94,17 +116,26 @@ struct RendererSystem : system<ModelComponent, TransformComponent>
                 {
                     model_component->elapsedFrames++;
                 }
-                shader::set_int(default_shader, "atlasSize",
-                                model_component->atlasSize);
-                shader::set_int(default_shader, "atlasIndex",
-                                model_component->atlasIndex);
-            }
-            else
-            {
-                shader::set_int(default_shader, "atlasIndex", 0);
+                packet.atlas_size = model_component->atlasSize;
+                packet.atlas_index = model_component->atlasIndex;
             }
 
-            myModel.draw(default_shader);
+            model_component->lod = myModel->select_lod(
+                t.model, view, projection, (float) screen::get_height(),
+                model_component->lod);
+            packet.lod = model_component->lod;
+            packet.culled = true;
+            packet.frustum =
+                cluster_culler::make_frustum(t.model, view, projection);
+
+            /* Drawn by the render queue, sorted by state and depth */
+            glm::vec4 center =
+                view * glm::vec4(transform_component->position, 1.0f);
+            packet.key = render_queue::make_key(
+                0, packet.translucent, -center.z,
+                shader::get_id(default_shader),
+                myModel->get_material_id(), myModel->get_vertex_array());
+            render_queue::submit(std::move(packet));
         }
     }
 };
@@ -61,7 +61,7 @@ void init_cube_entity()
         std::filesystem::absolute("assets/models/simple_cube/simple_cube.obj"));
 
     /* Add the model component */
-    auto model_component = ModelComponent(m, 32.0f, "cube_shader");
+    auto model_component = ModelComponent(std::move(m), 32.0f, "cube_shader");
     world::add_component<ModelComponent>(cube_entity,
                                          std::move(model_component));
 }
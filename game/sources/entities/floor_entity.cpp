@@ -57,7 +57,8 @@ void init_floor_entity()
     }
 
     /* Load the model */
-    model m(std::filesystem::absolute("assets/models/pane/pane.obj"));
+    auto m = model_registry::load(
+        std::filesystem::absolute("assets/models/pane/pane.obj"));
 
     /* Add the model component */
     auto model_component = ModelComponent(m, 32.0f, "default_shader");
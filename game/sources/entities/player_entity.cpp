@@ -61,11 +61,15 @@ void init_player_entity()
                        std::filesystem::absolute("game/shaders/shader.fs"));
     }
 
-    /* Load the model */
-    model m(std::filesystem::absolute("assets/models/backpack/backpack.obj"));
+    /* Load the model, a cube is drawn while It is loading */
+    auto m = model_registry::load(
+        std::filesystem::absolute("assets/models/backpack/backpack.obj"));
+    auto placeholder = model_registry::load(
+        std::filesystem::absolute("assets/models/simple_cube/simple_cube.obj"));
 
     /* Add the model component */
-    auto model_component = ModelComponent(m, 32.0f, "default_shader");
+    auto model_component = ModelComponent(m, 32.0f, "default_shader", false,
+                                          0, 0, placeholder);
     world::add_component<ModelComponent>(player_entity,
                                          std::move(model_component));
 }
@@ -55,10 +55,11 @@ void init_robot_entity()
     }
 
     /* Load the model */
-    model m(std::filesystem::absolute(
-                "assets/models/robot_sprite/robot_sprite.obj"),
-            GL_REPEAT, GL_NEAREST, GL_NEAREST, GL_TRUE,
-            GL_LINEAR_MIPMAP_NEAREST, GL_NEAREST, false);
+    auto m = model_registry::load(
+        std::filesystem::absolute(
+            "assets/models/robot_sprite/robot_sprite.obj"),
+        GL_REPEAT, GL_NEAREST, GL_NEAREST, GL_TRUE, GL_LINEAR_MIPMAP_NEAREST,
+        GL_NEAREST, false);
 
     /* Add the model component */
     auto model_component =
@@ -81,7 +81,8 @@ void init_sphere_entity()
     }
 
     /* Load the model */
-    model m1(std::filesystem::absolute("assets/models/sphere/sphere.obj"));
+    auto m1 = model_registry::load(
+        std::filesystem::absolute("assets/models/sphere/sphere.obj"));
 
     /* Add the model component */
     auto model_component1 = ModelComponent(m1, 32.0f, "default_shader");
@@ -128,7 +129,8 @@ void init_sphere_entity()
     }
 
     /* Load the model */
-    model m2(std::filesystem::absolute("assets/models/sphere/sphere.obj"));
+    auto m2 = model_registry::load(
+        std::filesystem::absolute("assets/models/sphere/sphere.obj"));
 
     /* Add the model component */
     auto model_component2 = ModelComponent(m2, 32.0f, "default_shader");
@@ -42,7 +42,8 @@ const int SCR_WIDTH = 1280;
 const int SCR_HEIGHT = 720;
 
 #ifdef USE_ECS
-REGISTER_SYSTEMS(RendererSystem, PointLightsSystem, // DebugTextSystem,
+REGISTER_SYSTEMS(AnimationSystem, RendererSystem,
+                 PointLightsSystem, // DebugTextSystem,
                  DirectionalLightSystem, PhysicsSystem, CollisionsSystem);
 #endif
 
@@ -74,6 +75,15 @@ int main()
                      .set_gl_cull_face(true)
                      .set_gl_multisample(true)
                      .set_gl_depth_test(true)
+                     .use_mesh_cache(true)
+                     .use_texture_streaming(true)
+                     .use_mesh_optimizer(true)
+                     .use_native_obj(true)
+                     .use_packed_vertices(true)
+                     .use_lods(true)
+                     .use_meshlets(true)
+                     .set_keep_cpu_data(false)
+                     .use_geometry_arena(true)
                      .build();
 
     default_camera =
@@ -133,6 +143,9 @@ int main()
     while (!screen::is_window_closed())
     {
         screen::poll_events();
+        texture_streamer::update();
+        cluster_culler::new_frame();
+        gl::new_frame();
 
 #ifdef USE_IMGUI
         gui::new_frame(&fb);
@@ -148,6 +161,7 @@ int main()
 #ifdef USE_ECS
         time::update(screen::get_time());
         world::tick();
+        render_queue::flush();
 #endif
 
 #ifdef USE_IMGUI
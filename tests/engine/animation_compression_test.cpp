@@ -0,0 +1,157 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "animation_compression.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace brenta;
+
+static types::skeleton make_skeleton()
+{
+    types::skeleton skeleton;
+    skeleton.joints.resize(2);
+    skeleton.joints[1].parent = 0;
+    skeleton.joints[1].bind_pose.translation = glm::vec3(0.0f, 1.0f, 0.0f);
+    return skeleton;
+}
+
+/* Two seconds of a joint swinging and turning, sampled at 60 fps */
+static types::animation_clip make_swing()
+{
+    types::animation_clip clip;
+    clip.name = "swing";
+    clip.duration = 2.0f;
+    types::animation_track track;
+    track.joint = 1;
+    for (int i = 0; i <= 120; i++)
+    {
+        float t = i / 60.0f;
+        track.translations.push_back(
+            {t, glm::vec3(std::sin(t * 3.0f), 1.0f, 0.0f)});
+        track.rotations.push_back(
+            {t, glm::angleAxis(t * 1.5f, glm::vec3(0.0f, 1.0f, 0.0f))});
+    }
+    clip.tracks.push_back(track);
+    return clip;
+}
+
+TEST(animation_compression_rotation, "Smallest three round trip")
+{
+    float worst = 0.0f;
+    for (int i = 0; i < 1000; i++)
+    {
+        glm::vec3 axis = glm::normalize(
+            glm::vec3(std::sin(i * 1.3f), std::cos(i * 0.7f), 0.3f));
+        glm::quat q = glm::angleAxis(i * 0.037f - 10.0f, axis);
+        std::uint16_t encoded[3];
+        animation_compression::encode_rotation(q, encoded);
+        glm::quat d = animation_compression::decode_rotation(encoded);
+        float d_dot = std::min(1.0f, std::abs(glm::dot(q, d)));
+        worst = std::max(worst, 2.0f * std::acos(d_dot));
+    }
+    ASSERT(worst < 0.001f);
+}
+
+TEST(animation_compression_reduce, "Linear channels keep the segment ends")
+{
+    types::skeleton skeleton = make_skeleton();
+    types::animation_clip clip;
+    clip.duration = 1.0f;
+    types::animation_track track;
+    track.joint = 0;
+    for (int i = 0; i <= 100; i++)
+        track.translations.push_back(
+            {i / 100.0f, glm::vec3(i / 100.0f, 0.0f, 0.0f)});
+    clip.tracks.push_back(track);
+
+    types::compressed_clip compressed =
+        animation_compression::compress(clip, skeleton, 0.001f, 0.25f);
+    ASSERT(compressed.segment_count == 4);
+    ASSERT(compressed.channels.size() == 1);
+    ASSERT(compressed.times.size() == 8);
+    ASSERT(compressed.key_offsets.size() == 5);
+}
+
+TEST(animation_compression_constant, "Drop or collapse constant channels")
+{
+    types::skeleton skeleton = make_skeleton();
+    types::animation_clip clip;
+    clip.duration = 1.0f;
+    types::animation_track bind, moved;
+    bind.joint = 1;
+    moved.joint = 0;
+    for (int i = 0; i <= 10; i++)
+    {
+        bind.translations.push_back({i / 10.0f, glm::vec3(0, 1, 0)});
+        moved.translations.push_back({i / 10.0f, glm::vec3(0, 5, 0)});
+    }
+    clip.tracks = {bind, moved};
+
+    types::compressed_clip compressed =
+        animation_compression::compress(clip, skeleton);
+    ASSERT(compressed.channels.size() == 1);
+    ASSERT(compressed.channels[0].joint == 0);
+    ASSERT(compressed.channels[0].is_constant);
+    ASSERT(compressed.times.empty());
+
+    std::vector<types::joint_pose> pose(2);
+    animation_compression::sample(compressed, skeleton, 0.3f, pose);
+    ASSERT(glm::length(pose[0].translation - glm::vec3(0, 5, 0)) < 1e-4f);
+    ASSERT(glm::length(pose[1].translation - glm::vec3(0, 1, 0)) < 1e-4f);
+}
+
+TEST(animation_compression_sample, "Stay close to the raw clip")
+{
+    types::skeleton skeleton = make_skeleton();
+    types::animation_clip clip = make_swing();
+    types::compressed_clip compressed =
+        animation_compression::compress(clip, skeleton, 0.001f);
+
+    std::vector<types::joint_pose> raw(2), decoded(2);
+    float position_error = 0.0f, rotation_error = 0.0f;
+    for (int i = 0; i <= 500; i++)
+    {
+        float t = i * 2.0f / 500.0f;
+        animator::sample(clip, skeleton, t, raw);
+        animation_compression::sample(compressed, skeleton, t, decoded);
+        position_error =
+            std::max(position_error, glm::length(raw[1].translation
+                                                 - decoded[1].translation));
+        float d = std::min(
+            1.0f, std::abs(glm::dot(raw[1].rotation, decoded[1].rotation)));
+        rotation_error = std::max(rotation_error, 2.0f * std::acos(d));
+    }
+    ASSERT(position_error < 0.005f);
+    ASSERT(rotation_error < 0.005f);
+
+    /* The rotation is a single slerp, a few keys are enough */
+    ASSERT(compressed.times.size() < 121);
+    ASSERT(animation_compression::get_size(compressed) * 3
+           < animation_compression::get_size(clip));
+}
@@ -0,0 +1,268 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "animation.hpp"
+#include "animation_compression.hpp"
+#include "skinning.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+using namespace brenta;
+
+/* A vertical chain of joints one unit apart, and a clip that bends
+ * every joint by 90 degrees around z in one second */
+static types::skeleton make_chain(unsigned int count)
+{
+    types::skeleton skeleton;
+    glm::mat4 global(1.0f);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        types::joint joint;
+        joint.name = "joint" + std::to_string(i);
+        joint.parent = (int) i - 1;
+        joint.bind_pose.translation =
+            i == 0 ? glm::vec3(0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        global = global * animator::compose(joint.bind_pose);
+        joint.inverse_bind = glm::inverse(global);
+        skeleton.joints.push_back(joint);
+    }
+    return skeleton;
+}
+
+static types::animation_clip make_bend(unsigned int count)
+{
+    types::animation_clip clip;
+    clip.name = "bend";
+    clip.duration = 1.0f;
+    glm::quat bent =
+        glm::angleAxis(glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    for (unsigned int i = 0; i < count; i++)
+    {
+        types::animation_track track;
+        track.joint = i;
+        track.rotations = {{0.0f, glm::quat(1.0f, 0.0f, 0.0f, 0.0f)},
+                           {1.0f, bent}};
+        clip.tracks.push_back(track);
+    }
+    return clip;
+}
+
+static bool near(glm::vec3 a, glm::vec3 b)
+{
+    return glm::length(a - b) < 1e-4f;
+}
+
+static bool near(const glm::mat4 &a, const glm::mat4 &b)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            if (std::abs(a[i][j] - b[i][j]) > 1e-4f)
+                return false;
+        }
+    }
+    return true;
+}
+
+TEST(animator_multiply, "The SIMD product matches glm")
+{
+    glm::mat4 a = glm::rotate(glm::mat4(1.0f), 0.7f, glm::vec3(1, 2, 3));
+    a = glm::translate(a, glm::vec3(4.0f, -2.0f, 0.5f));
+    glm::mat4 b = glm::scale(glm::mat4(1.0f), glm::vec3(2.0f, 1.0f, 0.5f));
+    b = glm::rotate(b, -1.3f, glm::vec3(0, 1, 0));
+    ASSERT(near(animator::multiply(a, b), a * b));
+}
+
+TEST(animator_bind_pose, "The bind pose gives identity skinning matrices")
+{
+    types::skeleton skeleton = make_chain(5);
+    types::animation_state state;
+    state.skeleton = &skeleton;
+    animator::update(state, 0.0f);
+
+    ASSERT(state.palette.size() == 5);
+    bool identity = true;
+    for (auto &m : state.palette)
+        identity = identity && near(m, glm::mat4(1.0f));
+    ASSERT(identity);
+}
+
+TEST(animator_sample, "Interpolate between keyframes")
+{
+    types::skeleton skeleton = make_chain(2);
+    types::animation_clip clip = make_bend(2);
+    clip.tracks[1].translations = {{0.0f, glm::vec3(0.0f, 1.0f, 0.0f)},
+                                   {1.0f, glm::vec3(0.0f, 3.0f, 0.0f)}};
+
+    std::vector<types::joint_pose> pose(2);
+    animator::sample(clip, skeleton, 0.5f, pose);
+    ASSERT(near(pose[1].translation, glm::vec3(0.0f, 2.0f, 0.0f)));
+    glm::vec3 x = pose[0].rotation * glm::vec3(1.0f, 0.0f, 0.0f);
+    ASSERT(near(x, glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f))));
+
+    /* Past the last key the pose holds */
+    animator::sample(clip, skeleton, 5.0f, pose);
+    ASSERT(near(pose[1].translation, glm::vec3(0.0f, 3.0f, 0.0f)));
+}
+
+TEST(animator_palette, "Accumulate the transforms along the hierarchy")
+{
+    types::skeleton skeleton = make_chain(2);
+    types::compressed_clip clip =
+        animation_compression::compress(make_bend(2), skeleton);
+    types::animation_state state;
+    state.skeleton = &skeleton;
+    state.clip = &clip;
+    state.loop = false;
+    animator::update(state, 1.0f);
+
+    /* The root bends the chain towards -x, the second joint bends the
+     * point above It once more */
+    glm::vec3 above = glm::vec3(state.palette[1] * glm::vec4(0, 2, 0, 1));
+    ASSERT(near(above, glm::vec3(-1.0f, -1.0f, 0.0f)));
+}
+
+TEST(animator_loop, "Looping clips wrap around")
+{
+    types::skeleton skeleton = make_chain(1);
+    types::compressed_clip clip =
+        animation_compression::compress(make_bend(1), skeleton);
+    types::animation_state state;
+    state.skeleton = &skeleton;
+    state.clip = &clip;
+    animator::update(state, 2.25f);
+    ASSERT(std::abs(state.time - 0.25f) < 1e-5f);
+
+    state.speed = -1.0f;
+    animator::update(state, 0.5f);
+    ASSERT(std::abs(state.time - 0.75f) < 1e-5f);
+}
+
+TEST(animator_evaluate, "Parallel evaluation matches the serial one")
+{
+    types::skeleton skeleton = make_chain(30);
+    types::compressed_clip clip =
+        animation_compression::compress(make_bend(30), skeleton);
+
+    std::vector<types::animation_state> parallel(100), serial(100);
+    std::vector<types::animation_state *> states;
+    for (unsigned int i = 0; i < parallel.size(); i++)
+    {
+        for (auto *s : {&parallel[i], &serial[i]})
+        {
+            s->skeleton = &skeleton;
+            s->clip = &clip;
+            s->time = i * 0.01f;
+        }
+        states.push_back(&parallel[i]);
+    }
+
+    animator::evaluate(states, 0.1f);
+    bool same = true;
+    for (unsigned int i = 0; i < serial.size(); i++)
+    {
+        animator::update(serial[i], 0.1f);
+        for (unsigned int j = 0; j < 30; j++)
+            same = same && near(parallel[i].palette[j], serial[i].palette[j]);
+    }
+    ASSERT(same);
+}
+
+TEST(skinning_pack_influences, "Keep the four heaviest joints")
+{
+    std::vector<std::uint32_t> joints = {7, 1, 2, 3, 4, 5};
+    std::vector<float> weights = {0.05f, 0.3f, 0.1f, 0.25f, 0.2f, 0.1f};
+    types::vertex_skin skin = skinning::pack_influences(joints, weights);
+
+    ASSERT(skin.joints[0] == 1);
+    ASSERT(skin.joints[1] == 3);
+    ASSERT(skin.joints[2] == 4);
+    int sum = 0;
+    for (auto w : skin.weights)
+        sum += w;
+    ASSERT(sum == 255);
+    ASSERT(skin.joints[0] != 7 && skin.joints[3] != 7);
+
+    types::vertex_skin none = skinning::pack_influences({}, {});
+    ASSERT(none.weights[0] == 0);
+}
+
+TEST(skinning_cpu, "Deform vertices with the blended joint matrices")
+{
+    std::vector<glm::mat4> palette = {
+        glm::translate(glm::mat4(1.0f), glm::vec3(2.0f, 0.0f, 0.0f)),
+        glm::rotate(glm::mat4(1.0f), glm::radians(90.0f),
+                    glm::vec3(0.0f, 0.0f, 1.0f))};
+
+    std::vector<types::vertex> vertices(3);
+    for (auto &v : vertices)
+    {
+        v.position = glm::vec3(1.0f, 0.0f, 0.0f);
+        v.normal = glm::vec3(1.0f, 0.0f, 0.0f);
+        v.tex_coords = glm::vec2(0.5f);
+    }
+    std::vector<std::uint32_t> first = {0}, second = {1}, both = {0, 1};
+    std::vector<float> one = {1.0f}, half = {0.5f, 0.5f};
+    std::vector<types::vertex_skin> skin = {
+        skinning::pack_influences(first, one),
+        skinning::pack_influences(second, one),
+        skinning::pack_influences(both, half)};
+
+    std::vector<types::vertex> out(3);
+    skinning::skin_vertices(vertices, skin, palette, out);
+    ASSERT(near(out[0].position, glm::vec3(3.0f, 0.0f, 0.0f)));
+    ASSERT(near(out[0].normal, glm::vec3(1.0f, 0.0f, 0.0f)));
+    ASSERT(near(out[1].position, glm::vec3(0.0f, 1.0f, 0.0f)));
+    ASSERT(near(out[1].normal, glm::vec3(0.0f, 1.0f, 0.0f)));
+    ASSERT(glm::length(out[2].position - glm::vec3(1.5f, 0.5f, 0.0f))
+           < 0.01f);
+    ASSERT(out[2].tex_coords == glm::vec2(0.5f));
+}
+
+BENCHMARK(animator_characters, "Characters evaluated per millisecond")
+{
+    /* A humanoid sized skeleton with every joint animated */
+    constexpr unsigned int characters = 1024;
+    types::skeleton skeleton = make_chain(64);
+    types::compressed_clip clip =
+        animation_compression::compress(make_bend(64), skeleton);
+    std::vector<types::animation_state> pool(characters);
+    std::vector<types::animation_state *> states;
+    for (unsigned int i = 0; i < characters; i++)
+    {
+        pool[i].skeleton = &skeleton;
+        pool[i].clip = &clip;
+        pool[i].time = (i % 100) * 0.01f;
+        states.push_back(&pool[i]);
+    }
+    animator::evaluate(states, 0.0f);
+
+    RUN_BENCHMARK(animator::evaluate(states, 1.0f / 60.0f));
+}
@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "asset_baker.hpp"
+#include "test_files.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <filesystem>
+
+using namespace brenta;
+using namespace brenta::types;
+
+TEST(asset_baker_classify, "Classify assets by extension")
+{
+    enums::asset_kind kind;
+    ASSERT(asset_baker::classify("a/b.PNG", kind) && kind == enums::TEXTURE);
+    ASSERT(asset_baker::classify("a/b.obj", kind) && kind == enums::MODEL);
+    ASSERT(asset_baker::classify("a/b.ttf", kind) && kind == enums::FONT);
+    ASSERT(asset_baker::classify("a/b.fs", kind) && kind == enums::SHADER);
+    /* Baked outputs and materials are not inputs */
+    ASSERT(!asset_baker::classify("a/b.dds", kind));
+    ASSERT(!asset_baker::classify("a/b.glyphs", kind));
+    ASSERT(!asset_baker::classify("a/b.mtl", kind));
+}
+
+TEST(asset_baker_dependencies, "Find the materials of an OBJ model")
+{
+    auto dir = make_temp_dir("brenta_bake_deps", "assets");
+    auto obj = dir / "assets" / "model.obj";
+    write_file(obj, "# comment\nmtllib a.mtl b.mtl\nv 0 0 0\n");
+
+    auto deps = asset_baker::find_dependencies(obj.string(), enums::MODEL);
+    ASSERT(deps.size() == 2);
+    ASSERT(deps[0] == (dir / "assets" / "a.mtl").generic_string());
+    ASSERT(deps[1] == (dir / "assets" / "b.mtl").generic_string());
+    ASSERT(asset_baker::find_dependencies(obj.string(), enums::SHADER)
+               .empty());
+}
+
+TEST(asset_baker_hash, "Dependencies change the hash of a node")
+{
+    auto dir = make_temp_dir("brenta_bake_hash", "assets");
+    auto obj = dir / "assets" / "model.obj";
+    auto mtl = dir / "assets" / "model.mtl";
+    write_file(obj, "mtllib model.mtl\n");
+    write_file(mtl, "newmtl a\n");
+
+    bake_node node;
+    node.input = obj.string();
+    node.kind = enums::MODEL;
+    node.dependencies = asset_baker::find_dependencies(node.input, node.kind);
+    auto before = asset_baker::hash_node(node);
+    ASSERT(before == asset_baker::hash_node(node));
+
+    write_file(mtl, "newmtl b\n");
+    ASSERT(before != asset_baker::hash_node(node));
+}
+
+TEST(asset_baker_manifest, "Write and read the bake manifest")
+{
+    auto dir = make_temp_dir("brenta_bake_manifest", "assets");
+    std::vector<bake_node> nodes(2);
+    nodes[0] = {"assets/b with space.png", enums::TEXTURE, 0xdeadbeef,
+                {}, {"assets/b with space.dds"}};
+    nodes[1] = {"assets/a.obj", enums::MODEL, 42, {"assets/a.mtl"}, {}};
+    auto path = (dir / "cache" / "bake.manifest").string();
+    ASSERT(asset_baker::write_manifest(path, nodes));
+
+    std::vector<bake_node> loaded;
+    ASSERT(asset_baker::read_manifest(path, loaded));
+    ASSERT(loaded.size() == 2);
+    /* Sorted by input */
+    ASSERT(loaded[0].input == "assets/a.obj");
+    ASSERT(loaded[0].kind == enums::MODEL);
+    ASSERT(loaded[0].hash == 42);
+    ASSERT(loaded[0].dependencies.size() == 1);
+    ASSERT(loaded[0].dependencies[0] == "assets/a.mtl");
+    ASSERT(loaded[1].input == "assets/b with space.png");
+    ASSERT(loaded[1].hash == 0xdeadbeef);
+    ASSERT(loaded[1].outputs.size() == 1);
+    ASSERT(loaded[1].outputs[0] == "assets/b with space.dds");
+
+    write_file(path, "brenta-bake 0\n");
+    ASSERT(!asset_baker::read_manifest(path, loaded));
+    ASSERT(loaded.empty());
+}
+
+TEST(asset_baker_incremental, "Only changed assets are baked again")
+{
+    auto dir = make_temp_dir("brenta_bake_incremental", "assets");
+    auto assets = (dir / "assets").string();
+    auto manifest = (dir / "bake.manifest").string();
+    write_file(dir / "assets" / "a.vs", "void main() {}\n");
+    write_file(dir / "assets" / "b.fs", "void main() {}\n");
+    write_file(dir / "assets" / "notes.txt", "not an asset\n");
+
+    auto report = asset_baker::bake({assets}, manifest);
+    ASSERT(report.total == 2);
+    ASSERT(report.baked == 2);
+    ASSERT(report.failed == 0);
+
+    report = asset_baker::bake({assets}, manifest);
+    ASSERT(report.baked == 0);
+    ASSERT(report.up_to_date == 2);
+
+    write_file(dir / "assets" / "b.fs", "void main() { discard; }\n");
+    report = asset_baker::bake({assets}, manifest);
+    ASSERT(report.baked == 1);
+    ASSERT(report.up_to_date == 1);
+
+    report = asset_baker::bake({assets}, manifest, true);
+    ASSERT(report.baked == 2);
+}
+
+TEST(asset_baker_texture, "Bake a texture to a compressed DDS")
+{
+    auto dir = make_temp_dir("brenta_bake_texture", "assets");
+    auto png = dir / "assets" / "texture.png";
+    std::filesystem::copy_file("assets/models/simple_cube/texture.png", png);
+    auto manifest = (dir / "bake.manifest").string();
+
+    auto report = asset_baker::bake({(dir / "assets").string()}, manifest);
+    ASSERT(report.baked == 1);
+    ASSERT(std::filesystem::exists(dir / "assets" / "texture.dds"));
+
+    /* A missing output makes the node dirty again */
+    std::filesystem::remove(dir / "assets" / "texture.dds");
+    report = asset_baker::bake({(dir / "assets").string()}, manifest);
+    ASSERT(report.baked == 1);
+
+    /* Removing the input removes its output */
+    std::filesystem::remove(png);
+    report = asset_baker::bake({(dir / "assets").string()}, manifest);
+    ASSERT(report.total == 0);
+    ASSERT(!std::filesystem::exists(dir / "assets" / "texture.dds"));
+}
@@ -0,0 +1,176 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "asset_pack.hpp"
+#include "lz4.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace brenta;
+
+TEST(lz4_round_trip, "LZ4 blocks decompress to the original data")
+{
+    std::vector<unsigned char> data;
+    for (int i = 0; i < 100000; i++)
+        data.push_back((unsigned char) ((i % 97) ^ (i / 1000)));
+
+    std::vector<unsigned char> compressed;
+    lz4::compress(data, compressed);
+    ASSERT(compressed.size() < data.size() / 4);
+    ASSERT(compressed.size() <= lz4::max_compressed_size(data.size()));
+
+    std::vector<unsigned char> output(data.size());
+    ASSERT(lz4::decompress(compressed, output));
+    ASSERT(output == data);
+
+    /* A wrong size or a truncated block must fail */
+    std::vector<unsigned char> small(data.size() - 1);
+    ASSERT(!lz4::decompress(compressed, small));
+    compressed.resize(compressed.size() / 2);
+    ASSERT(!lz4::decompress(compressed, output));
+}
+
+TEST(lz4_small_inputs, "LZ4 handles empty and incompressible blocks")
+{
+    std::vector<unsigned char> compressed;
+    std::vector<unsigned char> empty;
+    lz4::compress(empty, compressed);
+    ASSERT(lz4::decompress(compressed, empty));
+
+    std::vector<unsigned char> noise(1000);
+    unsigned int state = 12345;
+    for (auto &byte : noise)
+    {
+        state = state * 1103515245 + 12345;
+        byte = (unsigned char) (state >> 16);
+    }
+    lz4::compress(noise, compressed);
+    std::vector<unsigned char> output(noise.size());
+    ASSERT(lz4::decompress(compressed, output));
+    ASSERT(output == noise);
+}
+
+TEST(asset_pack_round_trip, "Assets are loaded from a mounted pack")
+{
+    auto dir = std::filesystem::temp_directory_path() / "brenta_asset_pack";
+    std::filesystem::create_directories(dir);
+    auto pack_path = (dir / "assets.pak").string();
+
+    std::string shader = "#version 330 core\nvoid main() {}\n";
+    std::vector<unsigned char> model(3 * asset_pack::chunk_size + 123);
+    for (std::size_t i = 0; i < model.size(); i++)
+        model[i] = (unsigned char) (i % 251);
+
+    asset_pack::writer writer;
+    writer.add("shaders/a.vs",
+               std::span((const unsigned char *) shader.data(), shader.size()));
+    writer.add("models/./cube.obj", model, true);
+    ASSERT(writer.write(pack_path));
+
+    ASSERT(!asset_pack::is_mounted());
+    ASSERT(asset_pack::mount(pack_path));
+    ASSERT(asset_pack::contains("shaders/a.vs"));
+    ASSERT(asset_pack::contains("models/cube.obj"));
+    ASSERT(!asset_pack::contains("models/missing.obj"));
+
+    auto loaded_shader = asset_pack::load("shaders/a.vs");
+    ASSERT(loaded_shader.is_valid());
+    ASSERT(loaded_shader.str() == shader);
+    /* Uncompressed assets point inside the mapping */
+    ASSERT((std::uintptr_t) loaded_shader.data() % 16 == 0);
+
+    auto loaded_model =
+        asset_pack::load(std::filesystem::absolute("models/cube.obj"));
+    ASSERT(loaded_model.is_valid());
+    ASSERT(loaded_model.size() == model.size());
+    ASSERT(std::memcmp(loaded_model.data(), model.data(), model.size()) == 0);
+
+    /* Loaded assets outlive the pack */
+    asset_pack::unmount_all();
+    ASSERT(!asset_pack::contains("shaders/a.vs"));
+    ASSERT(loaded_shader.str() == shader);
+
+    /* Files that are not in a pack come from the file system */
+    auto loose = asset_pack::load(pack_path);
+    ASSERT(loose.is_valid());
+    ASSERT(!asset_pack::load((dir / "missing").string()).is_valid());
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(asset_pack_corrupted, "Reject compressed assets whose sizes disagree")
+{
+    auto dir = std::filesystem::temp_directory_path() / "brenta_pack_bad";
+    std::filesystem::create_directories(dir);
+    auto pack_path = (dir / "assets.pak").string();
+
+    std::vector<unsigned char> model(2 * asset_pack::chunk_size + 7, 42);
+    asset_pack::writer writer;
+    writer.add("models/cube.obj", model, true);
+    ASSERT(writer.write(pack_path));
+
+    std::ifstream in(pack_path, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    in.close();
+
+    /* Offsets of the table of contents in the header and of the raw
+     * size in the only entry */
+    constexpr std::size_t toc_offset = 16, raw_size = 24;
+    std::uint64_t toc;
+    std::memcpy(&toc, bytes.data() + toc_offset, sizeof(toc));
+
+    /* Too large to allocate, then one byte more than the chunks hold,
+     * then one chunk less */
+    for (std::uint64_t size : {std::uint64_t(1) << 62,
+                               std::uint64_t(model.size() + 1),
+                               std::uint64_t(asset_pack::chunk_size + 7)})
+    {
+        auto corrupted = bytes;
+        std::memcpy(corrupted.data() + toc + raw_size, &size, sizeof(size));
+        std::ofstream out(pack_path, std::ios::binary);
+        out.write(corrupted.data(), corrupted.size());
+        out.close();
+
+        ASSERT(asset_pack::mount(pack_path));
+        ASSERT(!asset_pack::load("models/cube.obj").is_valid());
+        asset_pack::unmount_all();
+    }
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(asset_pack_key, "Asset keys are normalized relative paths")
+{
+    ASSERT(asset_pack::get_key("assets/./models/../fonts/a.ttf")
+           == "assets/fonts/a.ttf");
+    ASSERT(asset_pack::get_key(std::filesystem::absolute("assets/a.png"))
+           == "assets/a.png");
+}
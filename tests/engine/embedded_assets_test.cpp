@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "embedded_assets.hpp"
+#include "valfuzz/valfuzz.hpp"
+#include "vfs.hpp"
+
+#include <fstream>
+#include <sstream>
+
+using namespace brenta;
+
+TEST(embedded_assets_shaders, "The engine shaders are embedded")
+{
+    ASSERT(embedded_assets::get_count() > 0);
+    ASSERT(embedded_assets::contains("engine/shaders/text.vs"));
+    ASSERT(embedded_assets::contains("./engine/shaders/../shaders/text.fs"));
+    ASSERT(!embedded_assets::contains("engine/shaders/missing.vs"));
+    ASSERT(!embedded_assets::load("engine/shaders/missing.vs").is_valid());
+    ASSERT(embedded_assets::get_text("engine/shaders/missing.vs").empty());
+
+    std::ifstream file("engine/shaders/text.vs", std::ios::binary);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    ASSERT(embedded_assets::get_text("engine/shaders/text.vs")
+           == contents.str());
+}
+
+TEST(embedded_assets_vfs, "The vfs reads embedded resources")
+{
+    vfs::unmount_all();
+    /* Mount points only apply to the file system */
+    vfs::mount("engine", "/nonexistent");
+    ASSERT(vfs::exists("engine/shaders/text.vs"));
+    types::asset text = vfs::read("engine/shaders/text.vs");
+    ASSERT(text.is_valid());
+    ASSERT(text.str() == embedded_assets::get_text("engine/shaders/text.vs"));
+    ASSERT(text.data()[text.size()] == '\0');
+    vfs::unmount_all();
+}
@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "geometry_arena.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+using namespace brenta;
+using namespace brenta::types;
+
+TEST(range_allocator_first_fit, "Ranges are allocated in the first free hole")
+{
+    range_allocator allocator(100);
+    std::size_t a, b, c;
+    ASSERT(allocator.allocate(30, 1, a) && a == 0);
+    ASSERT(allocator.allocate(30, 1, b) && b == 30);
+    ASSERT(allocator.allocate(30, 1, c) && c == 60);
+    ASSERT(allocator.get_free() == 10);
+    ASSERT(!allocator.allocate(20, 1, a));
+
+    allocator.free(b, 30);
+    std::size_t d;
+    ASSERT(allocator.allocate(20, 1, d) && d == 30);
+    ASSERT(allocator.get_free() == 20);
+}
+
+TEST(range_allocator_alignment, "Allocated offsets respect the alignment")
+{
+    range_allocator allocator(64);
+    std::size_t a, b;
+    ASSERT(allocator.allocate(6, 4, a) && a == 0);
+    ASSERT(allocator.allocate(8, 4, b) && b == 8);
+    ASSERT(allocator.get_free() == 64 - 14);
+
+    /* The padding is given back when the neighbours are freed */
+    allocator.free(a, 6);
+    allocator.free(b, 8);
+    std::size_t c;
+    ASSERT(allocator.allocate(64, 4, c) && c == 0);
+}
+
+TEST(range_allocator_coalesce, "Freed neighbours are merged")
+{
+    range_allocator allocator(90);
+    std::size_t a, b, c;
+    allocator.allocate(30, 1, a);
+    allocator.allocate(30, 1, b);
+    allocator.allocate(30, 1, c);
+    allocator.free(a, 30);
+    allocator.free(c, 30);
+    allocator.free(b, 30);
+    ASSERT(allocator.get_free() == 90);
+
+    std::size_t d;
+    ASSERT(allocator.allocate(90, 1, d) && d == 0);
+}
+
+TEST(geometry_range_invalid, "Ranges outside of the arena do nothing")
+{
+    geometry_range range;
+    ASSERT(!range.is_valid());
+    ASSERT(!geometry_arena::is_enabled());
+    auto other = geometry_arena::allocate({}, 0, false, {});
+    ASSERT(!other.is_valid());
+}
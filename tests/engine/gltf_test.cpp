@@ -0,0 +1,307 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "gltf.hpp"
+#include "thread_pool.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace brenta;
+using namespace brenta::types;
+
+template <typename T>
+static void append(std::vector<unsigned char> &bytes, const T &value)
+{
+    const auto *p = reinterpret_cast<const unsigned char *>(&value);
+    bytes.insert(bytes.end(), p, p + sizeof(T));
+}
+
+static asset make_asset(std::vector<unsigned char> bytes)
+{
+    auto owner = std::make_shared<std::vector<unsigned char>>(std::move(bytes));
+    return asset(*owner, owner);
+}
+
+static asset make_asset(const std::string &text)
+{
+    return make_asset(std::vector<unsigned char>(text.begin(), text.end()));
+}
+
+/* A skinned triangle, two joints listed child first and an animation
+ * of the child */
+static const char *skinned_json = R"({
+  "asset": {"version": "2.0"},
+  "buffers": [{"byteLength": 264}],
+  "bufferViews": [
+    {"buffer": 0, "byteOffset": 0, "byteLength": 36},
+    {"buffer": 0, "byteOffset": 36, "byteLength": 6},
+    {"buffer": 0, "byteOffset": 44, "byteLength": 12},
+    {"buffer": 0, "byteOffset": 56, "byteLength": 48},
+    {"buffer": 0, "byteOffset": 104, "byteLength": 128},
+    {"buffer": 0, "byteOffset": 232, "byteLength": 8},
+    {"buffer": 0, "byteOffset": 240, "byteLength": 24}
+  ],
+  "accessors": [
+    {"bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3"},
+    {"bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR"},
+    {"bufferView": 2, "componentType": 5121, "count": 3, "type": "VEC4"},
+    {"bufferView": 3, "componentType": 5126, "count": 3, "type": "VEC4"},
+    {"bufferView": 4, "componentType": 5126, "count": 2, "type": "MAT4"},
+    {"bufferView": 5, "componentType": 5126, "count": 2, "type": "SCALAR"},
+    {"bufferView": 6, "componentType": 5126, "count": 2, "type": "VEC3"}
+  ],
+  "meshes": [{"name": "triangle", "primitives": [{
+    "attributes": {"POSITION": 0, "JOINTS_0": 2, "WEIGHTS_0": 3},
+    "indices": 1}]}],
+  "skins": [{"joints": [3, 2], "inverseBindMatrices": 4}],
+  "nodes": [
+    {"name": "root", "children": [2], "translation": [0, 1, 0]},
+    {"name": "mesh", "mesh": 0, "skin": 0},
+    {"name": "hip", "children": [3], "translation": [1, 0, 0]},
+    {"name": "knee", "translation": [0, 2, 0]}
+  ],
+  "scenes": [{"nodes": [0, 1]}],
+  "animations": [{"name": "bend",
+    "samplers": [{"input": 5, "output": 6, "interpolation": "STEP"}],
+    "channels": [{"sampler": 0,
+                  "target": {"node": 3, "path": "translation"}}]}]
+})";
+
+static std::vector<unsigned char> make_skinned_buffer()
+{
+    std::vector<unsigned char> bin;
+    for (float f : {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f})
+        append(bin, f);
+    for (std::uint16_t i : {0, 1, 2, 0}) // padded to 4 bytes
+        append(bin, i);
+    for (std::uint8_t j : {0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0})
+        append(bin, j);
+    for (int v = 0; v < 3; v++)
+    {
+        for (float f : {0.5f, 0.5f, 0.0f, 0.0f})
+            append(bin, f);
+    }
+    for (int m = 0; m < 2; m++)
+    {
+        for (int i = 0; i < 16; i++)
+            append(bin, i % 5 == 0 ? 1.0f : (i == 13 ? -2.0f * m : 0.0f));
+    }
+    for (float f : {0.0f, 1.0f})
+        append(bin, f);
+    for (float f : {0.0f, 2.0f, 0.0f, 0.0f, 3.0f, 0.0f})
+        append(bin, f);
+    return bin;
+}
+
+static std::vector<unsigned char>
+make_glb(std::string json, const std::vector<unsigned char> &bin)
+{
+    while (json.size() % 4 != 0)
+        json += ' ';
+
+    std::vector<unsigned char> glb;
+    append(glb, gltf::glb_magic);
+    append(glb, std::uint32_t(2));
+    append(glb, std::uint32_t(12 + 8 + json.size() + 8 + bin.size()));
+    append(glb, std::uint32_t(json.size()));
+    append(glb, gltf::json_chunk);
+    glb.insert(glb.end(), json.begin(), json.end());
+    append(glb, std::uint32_t(bin.size()));
+    append(glb, gltf::bin_chunk);
+    glb.insert(glb.end(), bin.begin(), bin.end());
+    return glb;
+}
+
+static bool parse_skinned(gltf_data &data)
+{
+    data.path = "skinned.glb";
+    data.directory = ".";
+    return gltf::parse(
+        make_asset(make_glb(skinned_json, make_skinned_buffer())), data);
+}
+
+static bool near(float a, float b)
+{
+    return std::fabs(a - b) < 1e-5f;
+}
+
+TEST(gltf_can_load, "Recognize glTF and GLB files")
+{
+    ASSERT(gltf::can_load("models/a.gltf"));
+    ASSERT(gltf::can_load("models/a.GLB"));
+    ASSERT(!gltf::can_load("models/a.obj"));
+    ASSERT(!gltf::can_load("gltf"));
+}
+
+TEST(gltf_glb, "Parse a GLB file without copying the binary chunk")
+{
+    thread_pool::init();
+    gltf_data data;
+    ASSERT(parse_skinned(data));
+    ASSERT(data.buffers.size() == 1);
+    ASSERT(data.buffers[0].size() == 264);
+    ASSERT(data.accessors.size() == 7);
+    ASSERT(data.meshes.size() == 1);
+    ASSERT(data.meshes[0].name == "triangle");
+
+    const auto &primitive = data.meshes[0].primitives[0];
+    ASSERT(primitive.attributes[GLTF_POSITION] == 0);
+    ASSERT(primitive.attributes[GLTF_NORMAL] == -1);
+    ASSERT(primitive.attributes[GLTF_JOINTS] == 2);
+    ASSERT(primitive.indices == 1);
+    ASSERT(primitive.mode == GL_TRIANGLES);
+
+    /* The accessors point in the buffer */
+    const auto &positions = data.accessors[0];
+    float y;
+    std::memcpy(&y, gltf::get_pointer(data, positions) + 7 * sizeof(float),
+                sizeof(float));
+    ASSERT(y == 1.0f);
+    ASSERT(gltf::get_stride(data, positions) == 12);
+    ASSERT(gltf::read_integers(data, 1)
+           == std::vector<std::uint32_t>({0, 1, 2}));
+}
+
+TEST(gltf_hierarchy, "Compute the transforms of the node hierarchy")
+{
+    gltf_data data;
+    ASSERT(parse_skinned(data));
+    ASSERT(data.nodes.size() == 4);
+    ASSERT(data.scene == std::vector<int>({0, 1}));
+    ASSERT(data.nodes[2].parent == 0);
+    ASSERT(data.nodes[3].parent == 2);
+    ASSERT(data.nodes[1].parent == -1);
+
+    glm::vec3 knee = glm::vec3(data.nodes[3].world[3]);
+    ASSERT(near(knee.x, 1.0f) && near(knee.y, 3.0f) && near(knee.z, 0.0f));
+    ASSERT(near(data.nodes[3].pose.translation.y, 2.0f));
+}
+
+TEST(gltf_skeleton, "Build a skeleton with the parents first")
+{
+    gltf_data data;
+    ASSERT(parse_skinned(data));
+
+    std::vector<std::uint16_t> remap;
+    skeleton s = gltf::build_skeleton(data, 0, remap);
+    ASSERT(s.joints.size() == 2);
+    ASSERT(s.joints[0].name == "hip");
+    ASSERT(s.joints[0].parent == -1);
+    ASSERT(s.joints[1].name == "knee");
+    ASSERT(s.joints[1].parent == 0);
+    ASSERT(remap == std::vector<std::uint16_t>({1, 0}));
+
+    /* The inverse bind matrices follow their joints */
+    ASSERT(near(s.joints[0].inverse_bind[3][1], -2.0f));
+    ASSERT(near(s.joints[1].inverse_bind[3][1], 0.0f));
+
+    std::vector<animation_clip> clips =
+        gltf::build_animations(data, 0, remap);
+    ASSERT(clips.size() == 1);
+    ASSERT(clips[0].name == "bend");
+    ASSERT(near(clips[0].duration, 1.0f));
+    ASSERT(clips[0].tracks.size() == 1);
+    ASSERT(clips[0].tracks[0].joint == 1);
+
+    /* A step key is held until the next one */
+    const auto &keys = clips[0].tracks[0].translations;
+    ASSERT(keys.size() == 3);
+    ASSERT(keys[1].time < 1.0f && near(keys[1].time, 1.0f));
+    ASSERT(keys[1].value.y == 2.0f);
+    ASSERT(keys[2].value.y == 3.0f);
+}
+
+TEST(gltf_data_uri, "Parse a glTF file with its buffer in a data URI")
+{
+    /* The bytes 1, 2, 3 and 4 */
+    std::string text = R"({
+      "asset": {"version": "2.0"},
+      "buffers": [{"byteLength": 4,
+                   "uri": "data:application/octet-stream;base64,AQIDBA=="}],
+      "bufferViews": [{"buffer": 0, "byteLength": 4, "byteStride": 2}],
+      "accessors": [
+        {"bufferView": 0, "componentType": 5121, "count": 2,
+         "type": "SCALAR"},
+        {"bufferView": 0, "componentType": 5121, "count": 2,
+         "type": "SCALAR", "byteOffset": 1, "normalized": true}
+      ]
+    })";
+
+    gltf_data data;
+    ASSERT(gltf::parse(make_asset(text), data));
+    ASSERT(data.buffers[0].size() == 4);
+    ASSERT(gltf::read_integers(data, 0) == std::vector<std::uint32_t>({1, 3}));
+
+    std::vector<float> normalized = gltf::read_floats(data, 1);
+    ASSERT(near(normalized[0], 2.0f / 255.0f));
+    ASSERT(near(normalized[1], 4.0f / 255.0f));
+}
+
+TEST(gltf_malformed, "Reject malformed files")
+{
+    gltf_data data;
+    ASSERT(!gltf::parse(make_asset(std::string("{}")), data));
+
+    /* Accessor past the end of its buffer view */
+    std::string json = skinned_json;
+    std::string from = R"("count": 3, "type": "VEC3")";
+    json.replace(json.find(from), from.size(), R"("count": 4, "type": "VEC3")");
+    gltf_data overflow;
+    ASSERT(!gltf::parse(make_asset(make_glb(json, make_skinned_buffer())),
+                        overflow));
+
+    /* Counts whose byte size wraps around, 2^58 matrices of 64 bytes,
+     * or negative */
+    from = R"("count": 2, "type": "MAT4")";
+    for (const char *count : {"288230376151711744", "-1"})
+    {
+        json = skinned_json;
+        std::string to = std::string("\"count\": ") + count;
+        json.replace(json.find(from), from.size(), to + R"(, "type": "MAT4")");
+        gltf_data wrapped;
+        ASSERT(!gltf::parse(
+            make_asset(make_glb(json, make_skinned_buffer())), wrapped));
+    }
+
+    /* Binary chunk shorter than the buffer */
+    std::vector<unsigned char> bin = make_skinned_buffer();
+    bin.resize(200);
+    gltf_data truncated;
+    ASSERT(!gltf::parse(make_asset(make_glb(skinned_json, bin)), truncated));
+
+    std::string required = R"({"asset": {"version": "2.0"},
+        "extensionsRequired": ["KHR_draco_mesh_compression"]})";
+    gltf_data extension;
+    ASSERT(!gltf::parse(make_asset(required), extension));
+}
@@ -0,0 +1,60 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "buffer.hpp"
+#include "mesh.hpp"
+#include "model.hpp"
+#include "texture.hpp"
+#include "valfuzz/valfuzz.hpp"
+#include "vao.hpp"
+
+#include <type_traits>
+
+using namespace brenta;
+
+TEST(gpu_resources_move_only, "GPU resources can be moved but not copied")
+{
+    ASSERT(!std::is_copy_constructible_v<types::buffer>);
+    ASSERT(std::is_nothrow_move_constructible_v<types::buffer>);
+    ASSERT(!std::is_copy_constructible_v<types::vao>);
+    ASSERT(std::is_nothrow_move_constructible_v<types::vao>);
+    ASSERT(!std::is_copy_constructible_v<types::texture_object>);
+    ASSERT(std::is_nothrow_move_constructible_v<types::texture_object>);
+    ASSERT(!std::is_copy_constructible_v<mesh>);
+    ASSERT(std::is_nothrow_move_constructible_v<mesh>);
+    ASSERT(!std::is_copy_constructible_v<model>);
+    ASSERT(std::is_nothrow_move_constructible_v<model>);
+}
+
+TEST(texture_object_release, "Releasing a texture gives up its ownership")
+{
+    types::texture_object texture(42);
+    types::texture_object moved(std::move(texture));
+    ASSERT(texture.get() == 0);
+    ASSERT(moved.get() == 42);
+    ASSERT(moved.release() == 42);
+    ASSERT(moved.get() == 0);
+}
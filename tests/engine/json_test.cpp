@@ -0,0 +1,86 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "json.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <string>
+
+using namespace brenta::types;
+
+TEST(json_parse_values, "Parse every kind of JSON value")
+{
+    json doc;
+    ASSERT(json::parse(R"({"a": [1, -2.5e2, true, false, null],
+                           "b": {"c": "text"}, "d": 12345678901})",
+                       doc));
+    ASSERT(doc.is_object());
+    ASSERT(doc.size() == 3);
+    ASSERT(doc["a"].is_array());
+    ASSERT(doc["a"].size() == 5);
+    ASSERT(doc["a"][0].as_int() == 1);
+    ASSERT(doc["a"][1].as_number() == -250.0);
+    ASSERT(doc["a"][2].as_bool());
+    ASSERT(!doc["a"][3].as_bool(true));
+    ASSERT(doc["a"][4].is_null());
+    ASSERT(doc["b"]["c"].as_string() == "text");
+    ASSERT(doc["d"].as_int() == 12345678901LL);
+    ASSERT(doc.get_members()[1].first == "b");
+}
+
+TEST(json_missing, "Missing members and elements are null")
+{
+    json doc;
+    ASSERT(json::parse(R"({"a": [1]})", doc));
+    ASSERT(!doc.contains("b"));
+    ASSERT(doc["b"]["c"][3].is_null());
+    ASSERT(doc["a"][1].is_null());
+    ASSERT(doc["a"][1].as_int(-1) == -1);
+    ASSERT(doc["a"]["x"].is_null());
+    ASSERT(doc["b"].as_string().empty());
+}
+
+TEST(json_strings, "Parse escapes and unicode in strings")
+{
+    json doc;
+    ASSERT(json::parse(R"(["a\"b\\c\/\n\t", "\u00e8", "\ud83d\ude00"])",
+                       doc));
+    ASSERT(doc[0].as_string() == "a\"b\\c/\n\t");
+    ASSERT(doc[1].as_string() == "\xc3\xa8");
+    ASSERT(doc[2].as_string() == "\xf0\x9f\x98\x80");
+}
+
+TEST(json_malformed, "Reject malformed documents")
+{
+    json doc;
+    ASSERT(!json::parse("", doc));
+    ASSERT(!json::parse("{\"a\": 1,}", doc));
+    ASSERT(!json::parse("[1 2]", doc));
+    ASSERT(!json::parse("\"open", doc));
+    ASSERT(!json::parse("{\"a\": 1} x", doc));
+    ASSERT(!json::parse("\"\\ud83d\"", doc));
+    ASSERT(!json::parse(std::string(json::max_depth + 1, '['), doc));
+}
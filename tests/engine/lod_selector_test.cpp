@@ -0,0 +1,82 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "lod_selector.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+using namespace brenta;
+
+TEST(lod_select, "The coarsest level under the threshold is selected")
+{
+    lod_selector::set_threshold(1.0f);
+    lod_selector::set_hysteresis(0.25f);
+    std::vector<float> errors = {0.0f, 0.01f, 0.1f, 1.0f};
+
+    /* 0.01 units cover 0.5 pixels, 0.1 units 5 pixels */
+    ASSERT(lod_selector::select(errors, 50.0f, 0) == 1);
+    ASSERT(lod_selector::select(errors, 1000.0f, 3) == 0);
+    ASSERT(lod_selector::select(errors, 0.1f, 0) == 3);
+    ASSERT(lod_selector::select({}, 1.0f, 2) == 0);
+}
+
+TEST(lod_hysteresis, "The level does not change inside the band")
+{
+    lod_selector::set_threshold(1.0f);
+    lod_selector::set_hysteresis(0.25f);
+    std::vector<float> errors = {0.0f, 0.01f};
+
+    /* 0.9 pixels: too close to the threshold to switch to level 1,
+     * but not enough to switch back from It */
+    ASSERT(lod_selector::select(errors, 90.0f, 0) == 0);
+    ASSERT(lod_selector::select(errors, 90.0f, 1) == 1);
+    ASSERT(lod_selector::select(errors, 70.0f, 0) == 1);
+    ASSERT(lod_selector::select(errors, 130.0f, 1) == 0);
+}
+
+TEST(lod_pixels_per_unit, "Projected size falls with the distance")
+{
+    glm::mat4 projection =
+        glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+    glm::mat4 near = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -10));
+    glm::mat4 far = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -20));
+    glm::mat4 view(1.0f);
+
+    float a = lod_selector::pixels_per_unit(near, view, projection,
+                                            glm::vec3(0.0f), 0.0f, 1000.0f);
+    float b = lod_selector::pixels_per_unit(far, view, projection,
+                                            glm::vec3(0.0f), 0.0f, 1000.0f);
+    /* With a 90 degrees fov, at distance 10 the screen spans 20 units */
+    ASSERT(std::abs(a - 50.0f) < 1e-3f);
+    ASSERT(std::abs(b - 25.0f) < 1e-3f);
+
+    glm::mat4 behind = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 10));
+    ASSERT(lod_selector::pixels_per_unit(behind, view, projection,
+                                         glm::vec3(0.0f), 1.0f, 1000.0f)
+           == 0.0f);
+}
@@ -0,0 +1,83 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh_cache.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace brenta;
+using namespace brenta::types;
+
+TEST(mesh_cache_round_trip, "Store and load a model in the mesh cache")
+{
+    auto dir = std::filesystem::temp_directory_path() / "brenta_mesh_cache";
+    auto source = (dir / "model.obj").string();
+    std::filesystem::create_directories(dir);
+    {
+        std::ofstream file(source);
+        file << "v 0 0 0\n";
+    }
+    mesh_cache::init((dir / "cache").string());
+
+    std::vector<vertex> vertices(4);
+    for (int i = 0; i < 4; i++)
+        vertices[i].position = glm::vec3((float) i);
+    std::vector<unsigned int> indices = {0, 1, 2, 2, 3, 0};
+
+    std::vector<cached_mesh> meshes(1);
+    meshes[0].vertices = vertices;
+    meshes[0].indices = indices;
+    meshes[0].textures.push_back({"texture_diffuse", "diffuse.png"});
+    meshes[0].lods = {{0, 6, 0.0f}, {3, 3, 0.5f}};
+    meshes[0].meshlets.push_back({0, 6, glm::vec3(1.5f), 2.0f,
+                                  glm::vec3(0.0f, 0.0f, 1.0f), 0.5f});
+    ASSERT(mesh_cache::store(source, 1, meshes));
+
+    mapped_file file;
+    std::vector<cached_mesh> loaded;
+    ASSERT(mesh_cache::load(source, 1, file, loaded));
+    ASSERT(loaded.size() == 1);
+    ASSERT(loaded[0].vertices.size() == 4);
+    ASSERT(loaded[0].vertices[3].position == glm::vec3(3.0f));
+    ASSERT(loaded[0].indices.size() == 6);
+    ASSERT(loaded[0].indices[4] == 3);
+    ASSERT(loaded[0].textures.size() == 1);
+    ASSERT(loaded[0].textures[0].path == "diffuse.png");
+    ASSERT(loaded[0].lods.size() == 2);
+    ASSERT(loaded[0].lods[1].index_offset == 3);
+    ASSERT(loaded[0].lods[1].error == 0.5f);
+    ASSERT(loaded[0].meshlets.size() == 1);
+    ASSERT(loaded[0].meshlets[0].center == glm::vec3(1.5f));
+    ASSERT(loaded[0].meshlets[0].cone_cutoff == 0.5f);
+
+    /* Different import flags must miss */
+    ASSERT(!mesh_cache::load(source, 2, file, loaded));
+
+    mesh_cache::destroy();
+    std::filesystem::remove_all(dir);
+}
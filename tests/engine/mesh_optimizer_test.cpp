@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh_optimizer.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <algorithm>
+#include <random>
+
+using namespace brenta;
+using namespace brenta::types;
+
+/* A shuffled grid with one vertex per triangle corner, like an OBJ */
+static void make_grid(int size, std::vector<vertex> &vertices,
+                      std::vector<unsigned int> &indices)
+{
+    std::vector<glm::ivec2> corners;
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            glm::ivec2 quad[6] = {{x, y},     {x + 1, y}, {x + 1, y + 1},
+                                  {x, y},     {x + 1, y + 1}, {x, y + 1}};
+            corners.insert(corners.end(), quad, quad + 6);
+        }
+    }
+
+    std::vector<int> order(corners.size() / 3);
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    for (auto t : order)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            vertex v = {};
+            v.position = glm::vec3(corners[t * 3 + k], 0.0f);
+            v.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            indices.push_back(vertices.size());
+            vertices.push_back(v);
+        }
+    }
+}
+
+TEST(mesh_optimizer_weld, "Weld identical vertices")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_grid(10, vertices, indices);
+
+    mesh_optimizer::weld(vertices, indices);
+    ASSERT(vertices.size() == 11 * 11);
+    ASSERT(indices.size() == 10 * 10 * 6);
+}
+
+TEST(mesh_optimizer_cache, "Optimize a mesh for the vertex cache")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_grid(32, vertices, indices);
+
+    mesh_optimizer::weld(vertices, indices);
+    auto before = mesh_optimizer::analyze(indices, vertices.size());
+    auto welded = vertices;
+    auto triangles = indices;
+
+    mesh_optimizer::optimize(vertices, indices);
+    auto after = mesh_optimizer::analyze(indices, vertices.size());
+    ASSERT(after.acmr < before.acmr * 0.5f);
+    ASSERT(after.atvr < before.atvr);
+    ASSERT(indices.size() == triangles.size());
+
+    /* Fetch order follows the index order */
+    unsigned int highest = 0;
+    bool sequential = true;
+    for (auto index : indices)
+    {
+        sequential = sequential && index <= highest + 1;
+        highest = std::max(highest, index);
+    }
+    ASSERT(sequential);
+}
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+using namespace brenta;
+using namespace brenta::types;
+
+TEST(packed_vertex_size, "Packed vertex is half the size of a vertex")
+{
+    ASSERT(sizeof(packed_vertex) * 2 == sizeof(vertex));
+}
+
+TEST(octahedral_round_trip, "Octahedral normals decode to the same normal")
+{
+    glm::vec3 normals[] = {{0.0f, 0.0f, 1.0f},   {0.0f, 0.0f, -1.0f},
+                           {1.0f, 0.0f, 0.0f},   {0.0f, -1.0f, 0.0f},
+                           {0.3f, -0.5f, 0.81f}, {-0.6f, 0.2f, -0.77f}};
+    for (auto n : normals)
+    {
+        n = glm::normalize(n);
+        glm::vec2 e = mesh::encode_octahedral(n);
+        ASSERT(std::abs(e.x) <= 1.0f && std::abs(e.y) <= 1.0f);
+        glm::vec3 d = mesh::decode_octahedral(e);
+        ASSERT(glm::dot(n, d) > 0.9999f);
+    }
+}
+
+TEST(pack_vertex_round_trip, "Packed vertices decode within quantization")
+{
+    glm::vec3 offset = glm::vec3(-2.0f, 0.0f, -1.0f);
+    glm::vec3 scale = glm::vec3(4.0f, 3.0f, 2.0f);
+
+    vertex v = {};
+    v.position = glm::vec3(1.25f, 2.5f, -0.3f);
+    v.normal = glm::normalize(glm::vec3(-0.2f, 0.4f, -0.9f));
+    v.tex_coords = glm::vec2(0.75f, 0.125f);
+
+    packed_vertex p = mesh::pack_vertex(v, scale, offset);
+    for (int i = 0; i < 3; i++)
+    {
+        float decoded = p.position[i] / 65535.0f * scale[i] + offset[i];
+        ASSERT(std::abs(decoded - v.position[i]) <= scale[i] / 65535.0f);
+    }
+
+    glm::vec2 e = glm::vec2(p.normal[0] / 32767.0f, p.normal[1] / 32767.0f);
+    ASSERT(glm::dot(mesh::decode_octahedral(e), v.normal) > 0.9999f);
+
+    ASSERT(glm::unpackHalf1x16(p.tex_coords[0]) == 0.75f);
+    ASSERT(glm::unpackHalf1x16(p.tex_coords[1]) == 0.125f);
+}
@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "mesh_simplifier.hpp"
+#include "test_meshes.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <cmath>
+
+using namespace brenta;
+using namespace brenta::types;
+
+/* A closed UV sphere, the poles and the seam are welded */
+static void make_sphere(int rings, int sectors, std::vector<vertex> &vertices,
+                        std::vector<unsigned int> &indices)
+{
+    vertices.push_back({{0.0f, 1.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {}});
+    for (int r = 1; r < rings; r++)
+    {
+        float phi = M_PI * r / rings;
+        for (int s = 0; s < sectors; s++)
+        {
+            float theta = 2.0f * M_PI * s / sectors;
+            glm::vec3 p(std::sin(phi) * std::cos(theta), std::cos(phi),
+                        std::sin(phi) * std::sin(theta));
+            vertices.push_back({p, p, {}});
+        }
+    }
+    vertices.push_back({{0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {}});
+
+    auto ring = [&](int r, int s)
+    { return (unsigned int) (1 + (r - 1) * sectors + s % sectors); };
+    unsigned int bottom = vertices.size() - 1;
+    for (int s = 0; s < sectors; s++)
+    {
+        indices.insert(indices.end(), {0, ring(1, s + 1), ring(1, s)});
+        for (int r = 1; r + 1 < rings; r++)
+        {
+            indices.insert(indices.end(),
+                           {ring(r, s), ring(r, s + 1), ring(r + 1, s)});
+            indices.insert(indices.end(), {ring(r, s + 1), ring(r + 1, s + 1),
+                                           ring(r + 1, s)});
+        }
+        indices.insert(indices.end(), {bottom, ring(rings - 1, s),
+                                       ring(rings - 1, s + 1)});
+    }
+}
+
+static glm::vec3 normal_sum(const std::vector<vertex> &vertices,
+                            const std::vector<unsigned int> &indices)
+{
+    glm::vec3 sum(0.0f);
+    for (std::size_t t = 0; t < indices.size(); t += 3)
+    {
+        glm::vec3 p0 = vertices[indices[t]].position;
+        glm::vec3 p1 = vertices[indices[t + 1]].position;
+        glm::vec3 p2 = vertices[indices[t + 2]].position;
+        sum += glm::cross(p1 - p0, p2 - p0);
+    }
+    return sum;
+}
+
+TEST(simplify_plane, "A flat grid collapses without error")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_plane(16, vertices, indices);
+
+    float error = 1.0f;
+    auto simplified =
+        mesh_simplifier::simplify(vertices, indices, 24, 0.01f, &error);
+    ASSERT(simplified.size() % 3 == 0);
+    ASSERT(simplified.size() <= 24);
+    ASSERT(error < 1e-3f);
+
+    /* The covered area and the facing are preserved */
+    glm::vec3 before = normal_sum(vertices, indices);
+    glm::vec3 after = normal_sum(vertices, simplified);
+    ASSERT(std::abs(before.y - after.y) < 1e-3f * std::abs(before.y));
+}
+
+TEST(simplify_sphere, "A sphere simplifies within the error bound")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_sphere(24, 32, vertices, indices);
+
+    float error = 0.0f;
+    auto simplified = mesh_simplifier::simplify(vertices, indices,
+                                                indices.size() / 4, 0.05f,
+                                                &error);
+    ASSERT(simplified.size() <= indices.size() / 4);
+    ASSERT(error > 0.0f && error <= 0.05f);
+    for (auto index : simplified)
+        ASSERT(index < vertices.size());
+
+    /* Still closed: every edge has a twin */
+    for (std::size_t t = 0; t < simplified.size(); t += 3)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            unsigned int a = simplified[t + k];
+            unsigned int b = simplified[t + (k + 1) % 3];
+            bool twin = false;
+            for (std::size_t u = 0; u < simplified.size() && !twin; u += 3)
+                for (int j = 0; j < 3; j++)
+                    if (simplified[u + j] == b
+                        && simplified[u + (j + 1) % 3] == a)
+                        twin = true;
+            ASSERT(twin);
+        }
+    }
+}
+
+TEST(simplify_error_limit, "Simplification stops at the target error")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_sphere(16, 16, vertices, indices);
+
+    float error = 0.0f;
+    auto simplified =
+        mesh_simplifier::simplify(vertices, indices, 0, 1e-4f, &error);
+    ASSERT(simplified.size() > 0);
+    ASSERT(error <= 1e-4f);
+}
+
+TEST(generate_lods, "LOD chains share the vertices and grow the error")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_sphere(24, 32, vertices, indices);
+    std::size_t full = indices.size();
+
+    auto lods = mesh_simplifier::generate_lods(vertices, indices, 4);
+    ASSERT(lods.size() == 4);
+    ASSERT(lods[0].index_offset == 0 && lods[0].index_count == full);
+    for (std::size_t l = 1; l < lods.size(); l++)
+    {
+        ASSERT(lods[l].index_count < lods[l - 1].index_count);
+        ASSERT(lods[l].error >= lods[l - 1].error);
+        ASSERT(lods[l].index_offset + lods[l].index_count <= indices.size());
+    }
+    ASSERT(lods.back().index_offset + lods.back().index_count
+           == indices.size());
+}
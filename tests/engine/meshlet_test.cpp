@@ -0,0 +1,131 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "cluster_culler.hpp"
+#include "meshlet_builder.hpp"
+#include "test_meshes.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <algorithm>
+#include <array>
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace brenta;
+using namespace brenta::types;
+
+static std::vector<std::array<unsigned int, 3>>
+sorted_triangles(const std::vector<unsigned int> &indices)
+{
+    std::vector<std::array<unsigned int, 3>> triangles;
+    for (std::size_t t = 0; t < indices.size(); t += 3)
+        triangles.push_back({indices[t], indices[t + 1], indices[t + 2]});
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+TEST(meshlet_build, "Meshlets cover every triangle within the limits")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_plane(32, vertices, indices);
+    auto original = sorted_triangles(indices);
+
+    auto meshlets = meshlet_builder::build(vertices, indices, 64, 124);
+    ASSERT(sorted_triangles(indices) == original);
+
+    std::size_t next = 0;
+    for (auto &m : meshlets)
+    {
+        ASSERT(m.index_offset == next);
+        ASSERT(m.index_count > 0 && m.index_count <= 124 * 3);
+        next += m.index_count;
+
+        std::vector<unsigned int> unique(indices.begin() + m.index_offset,
+                                         indices.begin() + m.index_offset
+                                             + m.index_count);
+        std::sort(unique.begin(), unique.end());
+        unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+        ASSERT(unique.size() <= 64);
+        for (auto v : unique)
+            ASSERT(glm::length(vertices[v].position - m.center)
+                   <= m.radius + 1e-4f);
+    }
+    ASSERT(next == indices.size());
+    /* 2048 triangles need at least 17 meshlets, growth keeps them full */
+    ASSERT(meshlets.size() >= 17 && meshlets.size() <= 40);
+}
+
+TEST(meshlet_cone, "A flat meshlet has a tight normal cone")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_plane(4, vertices, indices);
+
+    auto m = meshlet_builder::compute_bounds(vertices, indices);
+    ASSERT(glm::dot(m.cone_axis, glm::vec3(0.0f, 1.0f, 0.0f)) > 0.999f);
+    ASSERT(m.cone_cutoff < 1e-3f);
+}
+
+TEST(cluster_cull, "Clusters outside the frustum or facing away are culled")
+{
+    std::vector<vertex> vertices;
+    std::vector<unsigned int> indices;
+    make_plane(32, vertices, indices);
+    auto meshlets = meshlet_builder::build(vertices, indices);
+
+    glm::mat4 projection =
+        glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f);
+    glm::mat4 model(1.0f);
+    std::vector<index_range> ranges;
+
+    /* From above, looking down on the middle: all facing, some out */
+    glm::mat4 above = glm::lookAt(glm::vec3(16.0f, 10.0f, 16.0f),
+                                  glm::vec3(16.0f, 0.0f, 16.0f),
+                                  glm::vec3(0.0f, 0.0f, 1.0f));
+    auto frustum = cluster_culler::make_frustum(model, above, projection);
+    cluster_culler::new_frame();
+    cluster_culler::cull(meshlets, frustum, ranges);
+    cluster_culler::new_frame();
+    auto stats = cluster_culler::get_stats();
+    ASSERT(stats.tested == meshlets.size());
+    ASSERT(stats.backface_culled == 0);
+    ASSERT(stats.frustum_culled > 0 && stats.frustum_culled < meshlets.size());
+    ASSERT(!ranges.empty());
+    for (std::size_t i = 1; i < ranges.size(); i++)
+        ASSERT(ranges[i - 1].offset + ranges[i - 1].count < ranges[i].offset);
+
+    /* From below every cluster faces away */
+    glm::mat4 below = glm::lookAt(glm::vec3(16.0f, -10.0f, 16.0f),
+                                  glm::vec3(16.0f, 0.0f, 16.0f),
+                                  glm::vec3(0.0f, 0.0f, 1.0f));
+    frustum = cluster_culler::make_frustum(model, below, projection);
+    cluster_culler::cull(meshlets, frustum, ranges);
+    cluster_culler::new_frame();
+    stats = cluster_culler::get_stats();
+    ASSERT(ranges.empty());
+    ASSERT(stats.frustum_culled + stats.backface_culled == meshlets.size());
+    ASSERT(stats.backface_culled > 0);
+}
@@ -0,0 +1,47 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "model_registry.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+using namespace brenta;
+
+TEST(model_registry_dedupe, "Share models loaded with the same options")
+{
+    model_registry::clear();
+    {
+        auto a = model_registry::load("assets/models/sphere/sphere.obj");
+        auto b = model_registry::load("assets/models/../models/sphere/"
+                                      "sphere.obj");
+        auto c = model_registry::load("assets/models/sphere/sphere.obj",
+                                      GL_CLAMP_TO_EDGE);
+        ASSERT(a == b);
+        ASSERT(!(a == c));
+        ASSERT(model_registry::size() == 2);
+    }
+    /* Entries go away with the last handle */
+    ASSERT(model_registry::size() == 0);
+}
@@ -0,0 +1,236 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "obj_parser.hpp"
+#include "thread_pool.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include <cstdlib>
+#include <string>
+
+using namespace brenta;
+using namespace brenta::types;
+
+static bool parses_as(const std::string &text, float expected)
+{
+    float value = 0.0f;
+    const char *end = obj_parser::parse_float(
+        text.data(), text.data() + text.size(), value);
+    return end == text.data() + text.size() && value == expected;
+}
+
+/* A grid of quads written with relative indices, large enough to be
+ * split in many chunks */
+static std::string make_grid(int size)
+{
+    std::string text = "o grid\n";
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            text += "v " + std::to_string(x) + ".5 " + std::to_string(y)
+                    + ".25 -0.000001\n";
+        }
+    }
+    text += "vn 0.0 0.0 1.0\n";
+    for (int y = 0; y + 1 < size; y++)
+    {
+        for (int x = 0; x + 1 < size; x++)
+        {
+            int a = y * size + x + 1 - size * size - 1;
+            text += "f " + std::to_string(a) + "//-1 "
+                    + std::to_string(a + 1) + "//-1 "
+                    + std::to_string(a + size + 1) + "//-1 "
+                    + std::to_string(a + size) + "//-1\n";
+        }
+    }
+    return text;
+}
+
+TEST(obj_parse_float, "Parse floats like strtof")
+{
+    ASSERT(parses_as("0", 0.0f));
+    ASSERT(parses_as("-1.5", -1.5f));
+    ASSERT(parses_as("+2.25", 2.25f));
+    ASSERT(parses_as("0.800000", 0.8f));
+    ASSERT(parses_as(".5", 0.5f));
+    ASSERT(parses_as("3.", 3.0f));
+    ASSERT(parses_as("1e3", 1000.0f));
+    ASSERT(parses_as("-2.5E-2", -0.025f));
+    ASSERT(parses_as("12345678.87654321", 12345678.87654321f));
+    ASSERT(parses_as("0.000000000000000000000000000001", 1e-30f));
+    ASSERT(parses_as("123456789012345678901234567890", 1.2345679e29f));
+    ASSERT(parses_as("1e-60", 0.0f));
+
+    const char *strings[] = {"0.123456", "-98.7654321", "3.14159265358979",
+                             "1.17549435e-38", "6.02214076e23",
+                             "0.999999940395355224609375"};
+    for (const char *s : strings)
+        ASSERT(parses_as(s, std::strtof(s, nullptr)));
+
+    /* Stops at the first character that is not part of the number */
+    std::string text = "1.5/2";
+    float value;
+    ASSERT(obj_parser::parse_float(text.data(), text.data() + 5, value)
+           == text.data() + 3);
+    ASSERT(obj_parser::parse_float(text.data() + 3, text.data() + 5, value)
+           == text.data() + 3);
+}
+
+TEST(obj_parse, "Parse, triangulate and weld an OBJ file")
+{
+    std::string text = "# comment\n"
+                       "mtllib a.mtl\n"
+                       "o quad\n"
+                       "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+                       "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+                       "vn 0 0 1\n"
+                       "usemtl red\n"
+                       "f 1/1/1 2/2/1 3/3/1 4/4/1\r\n"
+                       "usemtl blue\n"
+                       "f -4/-4/-1 -2/-2/-1 -1/-1/-1\n"
+                       "o smooth\n"
+                       "f 1 2 3\n";
+    obj_data data;
+    ASSERT(obj_parser::parse(text, data));
+    ASSERT(data.libraries.size() == 1 && data.libraries[0] == "a.mtl");
+    ASSERT(data.meshes.size() == 3);
+
+    obj_mesh &quad = data.meshes[0];
+    ASSERT(quad.name == "quad" && quad.material == "red");
+    ASSERT(quad.vertices.size() == 4);
+    ASSERT((quad.indices == std::vector<unsigned int>{0, 1, 2, 0, 2, 3}));
+    ASSERT(quad.vertices[2].position == glm::vec3(1.0f, 1.0f, 0.0f));
+    ASSERT(quad.vertices[2].normal == glm::vec3(0.0f, 0.0f, 1.0f));
+    /* Flipped like Assimp does */
+    ASSERT(quad.vertices[1].tex_coords == glm::vec2(1.0f, 1.0f));
+
+    ASSERT(data.meshes[1].material == "blue");
+    ASSERT(data.meshes[1].vertices.size() == 3);
+    ASSERT(data.meshes[1].vertices[1].position
+           == glm::vec3(1.0f, 1.0f, 0.0f));
+
+    /* No normals in the file, they come from the faces */
+    obj_mesh &smooth = data.meshes[2];
+    ASSERT(smooth.name == "smooth" && smooth.material == "blue");
+    ASSERT(smooth.vertices[0].normal == glm::vec3(0.0f, 0.0f, 1.0f));
+    ASSERT(smooth.vertices[0].tex_coords == glm::vec2(0.0f));
+
+    obj_data broken;
+    ASSERT(!obj_parser::parse("v 0 0 0\nf 1 2 3\n", broken));
+    ASSERT(!obj_parser::parse("v 0 0 0\nf 0 1 1\n", broken));
+    /* Indices that do not fit in 32 bits are rejected, not wrapped */
+    ASSERT(!obj_parser::parse("v 0 0 0\nf 4294967297 1 1\n", broken));
+    ASSERT(!obj_parser::parse("f -2147483648 -2147483648 -2147483648\n"
+                              "v 0 0 0\n",
+                              broken));
+    ASSERT(!obj_parser::parse("v 0 0 0\nf 1 1 99999999999999999999999\n",
+                              broken));
+}
+
+TEST(obj_parse_chunks, "Relative indices across chunks")
+{
+    thread_pool::init();
+    constexpr int size = 100;
+    std::string text = make_grid(size);
+    ASSERT(text.size() > 4 * obj_parser::chunk_size);
+
+    obj_data data;
+    ASSERT(obj_parser::parse(text, data));
+    ASSERT(data.meshes.size() == 1);
+    obj_mesh &grid = data.meshes[0];
+    ASSERT(grid.vertices.size() == size * size);
+    ASSERT(grid.indices.size() == (size - 1) * (size - 1) * 6);
+
+    /* The last quad is made of the last vertices of the file */
+    std::size_t last = grid.indices.size() - 6;
+    ASSERT(grid.vertices[grid.indices[last]].position
+           == glm::vec3(size - 2 + 0.5f, size - 2 + 0.25f, -0.000001f));
+    ASSERT(grid.vertices[grid.indices[last + 2]].position
+           == glm::vec3(size - 1 + 0.5f, size - 1 + 0.25f, -0.000001f));
+}
+
+TEST(obj_parse_materials, "Parse the textures of MTL materials")
+{
+    auto materials =
+        obj_parser::parse_materials("newmtl a\n"
+                                    "Kd 0.8 0.8 0.8\n"
+                                    "map_Kd diffuse.png\n"
+                                    "map_Ks -s 1 1 1 specular.png\n"
+                                    "newmtl b\n");
+    ASSERT(materials.size() == 2);
+    ASSERT(materials["a"].size() == 2);
+    ASSERT(materials["a"][0].type == "texture_diffuse");
+    ASSERT(materials["a"][0].path == "diffuse.png");
+    ASSERT(materials["a"][1].type == "texture_specular");
+    ASSERT(materials["a"][1].path == "specular.png");
+    ASSERT(materials["b"].empty());
+}
+
+TEST(obj_load, "Load a bundled model and its materials")
+{
+    ASSERT(obj_parser::can_load("assets/models/pane/pane.OBJ"));
+    ASSERT(!obj_parser::can_load("assets/models/pane/pane.fbx"));
+
+    obj_data data;
+    ASSERT(obj_parser::load("assets/models/pane/pane.obj", data));
+    ASSERT(data.meshes.size() == 1);
+    ASSERT(data.meshes[0].vertices.size() == 4);
+    ASSERT(data.meshes[0].indices.size() == 6);
+    ASSERT(data.meshes[0].textures.size() == 2);
+    ASSERT(data.meshes[0].textures[0].path == "texture_diffuse.png");
+
+    ASSERT(!obj_parser::load("assets/models/missing.obj", data));
+}
+
+BENCHMARK(obj_parser_bench, "Parse the bundled OBJ models, native and Assimp")
+{
+    const char *models[] = {"assets/models/sphere/sphere.obj",
+                            "assets/models/robot_sprite/robot_sprite.obj",
+                            "assets/models/pane/pane.obj",
+                            "assets/models/room/Room.obj"};
+    thread_pool::init();
+    for (const char *path : models)
+    {
+        RUN_BENCHMARK(
+            [&]()
+            {
+                obj_data data;
+                return obj_parser::load(path, data);
+            }());
+        RUN_BENCHMARK(
+            [&]()
+            {
+                Assimp::Importer importer;
+                return importer.ReadFile(
+                           path, aiProcess_Triangulate | aiProcess_FlipUVs)
+                       != nullptr;
+            }());
+    }
+}
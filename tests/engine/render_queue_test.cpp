@@ -0,0 +1,101 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "render_queue.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace brenta;
+
+TEST(render_queue_key_fields, "Pass and translucency come before the state")
+{
+    auto opaque = render_queue::make_key(0, false, 100.0f, 3, 7, 9);
+    auto translucent = render_queue::make_key(0, true, 0.5f, 1, 1, 1);
+    auto overlay = render_queue::make_key(1, false, 0.0f, 0, 0, 0);
+    ASSERT(opaque < translucent);
+    ASSERT(translucent < overlay);
+
+    /* Same depth band, sorted by program, material and mesh */
+    auto a = render_queue::make_key(0, false, 10.0f, 1, 9, 9);
+    auto b = render_queue::make_key(0, false, 10.1f, 2, 0, 0);
+    auto c = render_queue::make_key(0, false, 10.1f, 2, 0, 1);
+    ASSERT(a < b);
+    ASSERT(b < c);
+}
+
+TEST(render_queue_key_depth, "Opaque front to back, translucent back to front")
+{
+    ASSERT(render_queue::make_key(0, false, 1.0f, 5, 0, 0)
+           < render_queue::make_key(0, false, 50.0f, 0, 0, 0));
+    ASSERT(render_queue::make_key(0, true, 50.0f, 5, 0, 0)
+           < render_queue::make_key(0, true, 1.0f, 0, 0, 0));
+    /* Translucent packets keep the full depth */
+    ASSERT(render_queue::make_key(0, true, 10.1f, 0, 0, 0)
+           < render_queue::make_key(0, true, 10.0f, 0, 0, 0));
+
+    /* Negative distances are clamped */
+    ASSERT(render_queue::make_key(0, false, -5.0f, 1, 2, 3)
+           == render_queue::make_key(0, false, 0.0f, 1, 2, 3));
+}
+
+TEST(render_queue_sort, "The radix sort matches a stable sort")
+{
+    std::mt19937_64 rng(42);
+    std::vector<types::sort_entry> entries, scratch;
+    for (std::uint32_t i = 0; i < 5000; i++)
+    {
+        /* Few distinct keys, to check the stability */
+        entries.push_back({(rng() % 64) << 40 | (rng() % 4), i});
+    }
+
+    auto expected = entries;
+    std::stable_sort(expected.begin(), expected.end(),
+                     [](const auto &a, const auto &b)
+                     { return a.key < b.key; });
+
+    render_queue::sort(entries, scratch);
+    ASSERT(entries.size() == expected.size());
+    for (std::size_t i = 0; i < entries.size(); i++)
+    {
+        ASSERT(entries[i].key == expected[i].key);
+        ASSERT(entries[i].index == expected[i].index);
+    }
+}
+
+TEST(render_queue_sort_small, "Empty and uniform inputs are left as they are")
+{
+    std::vector<types::sort_entry> entries, scratch;
+    render_queue::sort(entries, scratch);
+    ASSERT(entries.empty());
+
+    entries = {{7, 0}, {7, 1}, {7, 2}};
+    render_queue::sort(entries, scratch);
+    ASSERT(entries[0].index == 0 && entries[1].index == 1
+           && entries[2].index == 2);
+}
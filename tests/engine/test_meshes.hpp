@@ -0,0 +1,57 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "mesh.hpp"
+
+#include <vector>
+
+/* A welded grid of size x size quads on the xz plane, facing up */
+inline void make_plane(int size, std::vector<brenta::types::vertex> &vertices,
+                       std::vector<unsigned int> &indices)
+{
+    for (int y = 0; y <= size; y++)
+    {
+        for (int x = 0; x <= size; x++)
+        {
+            brenta::types::vertex v = {};
+            v.position = glm::vec3((float) x, 0.0f, (float) y);
+            v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertices.push_back(v);
+        }
+    }
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            unsigned int i = y * (size + 1) + x;
+            unsigned int quad[6] = {i, i + size + 1, i + 1,
+                                    i + 1, i + size + 1, i + size + 2};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+}
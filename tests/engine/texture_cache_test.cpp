@@ -0,0 +1,47 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "texture_cache.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+using namespace brenta;
+
+TEST(texture_cache_key, "Texture keys depend on the file and its settings")
+{
+    auto key = [](std::string path, GLint wrapping, bool flip)
+    {
+        return texture_cache::get_key(path, wrapping, GL_NEAREST, GL_LINEAR,
+                                      GL_TRUE, GL_LINEAR_MIPMAP_LINEAR,
+                                      GL_LINEAR, flip);
+    };
+
+    auto a = key("assets/textures/atlas.png", GL_REPEAT, true);
+    ASSERT(a == key("assets/textures/../textures/atlas.png", GL_REPEAT, true));
+    ASSERT(a != key("assets/textures/other.png", GL_REPEAT, true));
+    ASSERT(a != key("assets/textures/atlas.png", GL_CLAMP_TO_EDGE, true));
+    ASSERT(a != key("assets/textures/atlas.png", GL_REPEAT, false));
+    ASSERT(!texture_cache::contains(a));
+}
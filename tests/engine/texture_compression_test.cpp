@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "texture_compression.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace brenta;
+
+static types::image make_solid_image(int width, int height,
+                                     unsigned char r, unsigned char g,
+                                     unsigned char b)
+{
+    types::image image;
+    image.width = width;
+    image.height = height;
+    image.channels = 3;
+    image.size = (std::size_t) width * height * 3;
+    image.pixels = std::shared_ptr<unsigned char>(
+        new unsigned char[image.size], std::default_delete<unsigned char[]>());
+    for (std::size_t i = 0; i < image.size; i += 3)
+    {
+        image.pixels.get()[i] = r;
+        image.pixels.get()[i + 1] = g;
+        image.pixels.get()[i + 2] = b;
+    }
+    return image;
+}
+
+static types::asset make_asset(const std::vector<unsigned char> &bytes)
+{
+    auto owner = std::make_shared<std::vector<unsigned char>>(bytes);
+    return types::asset(*owner, owner);
+}
+
+static types::image load_dds_bytes(const std::vector<unsigned char> &bytes)
+{
+    return texture_compression::load_dds(make_asset(bytes), "garbage.dds",
+                                         false);
+}
+
+static types::image load_ktx2_bytes(const std::vector<unsigned char> &bytes)
+{
+    return texture_compression::load_ktx2(make_asset(bytes), "garbage.ktx2",
+                                          false);
+}
+
+static void write_u32(std::vector<unsigned char> &bytes, std::size_t offset,
+                      std::uint32_t value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+TEST(texture_compression_bc1, "Encode a solid color to BC1")
+{
+    auto image = make_solid_image(8, 8, 255, 0, 0);
+    auto bc1 = texture_compression::encode(image, enums::BC1);
+
+    ASSERT(bc1.compressed_format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT);
+    ASSERT(bc1.levels.size() == 4);
+    ASSERT(bc1.levels[0].size == 4 * 8);
+    ASSERT(bc1.levels[3].width == 1);
+    /* Both endpoints are pure red in 565 */
+    const unsigned char *block = bc1.pixels.get();
+    ASSERT(block[0] == 0x00 && block[1] == 0xF8);
+    ASSERT(block[2] == 0x00 && block[3] == 0xF8);
+}
+
+TEST(texture_compression_dds, "Write and load a DDS file")
+{
+    auto path =
+        (std::filesystem::temp_directory_path() / "brenta_test.dds").string();
+    auto image = make_solid_image(16, 4, 10, 200, 30);
+
+    for (auto format : {enums::BC1, enums::BC4, enums::BC7})
+    {
+        auto encoded = texture_compression::encode(image, format);
+        ASSERT(texture_compression::write_dds(path, encoded));
+
+        auto loaded = texture_compression::load_dds(path, false);
+        ASSERT(loaded.compressed_format == encoded.compressed_format);
+        ASSERT(loaded.levels.size() == encoded.levels.size());
+        ASSERT(loaded.size == encoded.size);
+        ASSERT(std::memcmp(loaded.pixels.get(), encoded.pixels.get(),
+                           encoded.size)
+               == 0);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(texture_compression_flip, "Flip a mip chain whole or not at all")
+{
+    auto path =
+        (std::filesystem::temp_directory_path() / "brenta_flip.dds").string();
+
+    for (int size : {16, 24})
+    {
+        /* Rows of different colors, so that flipping changes the blocks */
+        auto image = make_solid_image(size, size, 0, 0, 0);
+        for (std::size_t i = 0; i < image.size; i++)
+            image.pixels.get()[i] = (unsigned char) (i / (size * 3) * 10);
+
+        auto encoded = texture_compression::encode(image, enums::BC1);
+        ASSERT(texture_compression::write_dds(path, encoded));
+        auto flipped = texture_compression::load_dds(path, true);
+        auto unflipped = texture_compression::load_dds(path, false);
+        ASSERT(flipped.pixels && unflipped.pixels);
+
+        /* The third level of the 24 pixels chain is 6 pixels high, It
+         * can not be flipped by whole blocks */
+        bool same = std::memcmp(flipped.pixels.get(), unflipped.pixels.get(),
+                                unflipped.size)
+                    == 0;
+        ASSERT(same == (size == 24));
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(texture_compression_garbage, "Reject DDS and KTX2 files with bad headers")
+{
+    auto path =
+        (std::filesystem::temp_directory_path() / "brenta_bad.dds").string();
+    auto encoded =
+        texture_compression::encode(make_solid_image(16, 4, 1, 2, 3),
+                                    enums::BC1);
+    ASSERT(texture_compression::write_dds(path, encoded));
+    std::ifstream in(path, std::ios::binary);
+    std::vector<unsigned char> dds((std::istreambuf_iterator<char>(in)),
+                                   std::istreambuf_iterator<char>());
+    in.close();
+    std::filesystem::remove(path);
+
+    /* Offsets in the file, after the 4 bytes of the magic */
+    constexpr std::size_t height = 12, width = 16, mip_map_count = 28;
+
+    /* Too many levels are capped to a full chain */
+    auto bytes = dds;
+    write_u32(bytes, mip_map_count, 0xFFFFFFFF);
+    auto loaded = load_dds_bytes(bytes);
+    ASSERT(loaded.pixels && loaded.levels.size() == encoded.levels.size());
+
+    bytes = dds;
+    write_u32(bytes, width, 0x80000000);
+    ASSERT(!load_dds_bytes(bytes).pixels);
+    bytes = dds;
+    write_u32(bytes, height, 0);
+    ASSERT(!load_dds_bytes(bytes).pixels);
+
+    bytes.assign(dds.begin(), dds.begin() + 100);
+    ASSERT(!load_dds_bytes(bytes).pixels);
+    bytes.assign(dds.begin(), dds.end() - 1);
+    ASSERT(!load_dds_bytes(bytes).pixels);
+
+    /* A 4x4 BC1 KTX2 with one level whose offset wraps around */
+    const unsigned char identifier[12] = {0xAB, 'K',  'T', 'X',  ' ',  '2',
+                                          '0',  0xBB, '\r', '\n', 0x1A, '\n'};
+    constexpr std::size_t vk_format = 12, pixel_width = 20, pixel_height = 24,
+                          face_count = 36, level_count = 40, levels = 80;
+    std::vector<unsigned char> ktx2(levels + 24 + 8, 0);
+    std::memcpy(ktx2.data(), identifier, sizeof(identifier));
+    write_u32(ktx2, vk_format, 133); /* BC1 RGBA */
+    write_u32(ktx2, pixel_width, 4);
+    write_u32(ktx2, pixel_height, 4);
+    write_u32(ktx2, face_count, 1);
+    write_u32(ktx2, level_count, 1);
+    std::uint64_t level[3] = {~std::uint64_t(0) - 4, 8, 8};
+    std::memcpy(ktx2.data() + levels, level, sizeof(level));
+    ASSERT(!load_ktx2_bytes(ktx2).pixels);
+
+    /* The same file with a valid offset loads */
+    level[0] = levels + 24;
+    std::memcpy(ktx2.data() + levels, level, sizeof(level));
+    ASSERT(load_ktx2_bytes(ktx2).pixels);
+
+    /* Too many levels for the file */
+    write_u32(ktx2, pixel_width, 16384);
+    write_u32(ktx2, pixel_height, 16384);
+    write_u32(ktx2, level_count, 0xFFFFFFFF);
+    ASSERT(!load_ktx2_bytes(ktx2).pixels);
+}
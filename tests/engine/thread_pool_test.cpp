@@ -0,0 +1,96 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "thread_pool.hpp"
+#include "valfuzz/valfuzz.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace brenta;
+
+TEST(thread_pool_submit, "Get the result of a job from its future")
+{
+    auto future = thread_pool::submit([]() { return 42; });
+    ASSERT(future.get() == 42);
+}
+
+TEST(thread_pool_parallel_for, "Visit every index exactly once")
+{
+    std::vector<std::atomic<int>> visits(1000);
+    thread_pool::parallel_for(visits.size(),
+                              [&](std::size_t i) { visits[i]++; });
+
+    bool all_once = true;
+    for (auto &v : visits)
+        all_once = all_once && v == 1;
+    ASSERT(all_once);
+}
+
+TEST(thread_pool_nested, "Call parallel_for from inside a job")
+{
+    auto future = thread_pool::submit(
+        []()
+        {
+            std::atomic<int> sum = 0;
+            thread_pool::parallel_for(100, [&](std::size_t i)
+                                      { sum += (int) i; });
+            return sum.load();
+        });
+    ASSERT(future.get() == 4950);
+}
+
+TEST(thread_pool_parallel_for_throw, "Rethrow an exception after the loop")
+{
+    std::atomic<int> running = 0;
+    bool caught = false;
+    try
+    {
+        thread_pool::parallel_for(1000,
+                                  [&](std::size_t i)
+                                  {
+                                      running++;
+                                      if (i % 100 == 7)
+                                          throw std::runtime_error("fail");
+                                      running--;
+                                  });
+    }
+    catch (const std::runtime_error &)
+    {
+        caught = true;
+    }
+    ASSERT(caught);
+
+    /* Every call is over, only the ones that threw did not return */
+    int thrown = running.load();
+    ASSERT(thrown >= 1 && thrown <= 10);
+
+    /* The pool is still usable */
+    std::atomic<int> sum = 0;
+    thread_pool::parallel_for(10, [&](std::size_t i) { sum += (int) i; });
+    ASSERT(sum == 45);
+}
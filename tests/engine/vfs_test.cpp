@@ -0,0 +1,128 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include "test_files.hpp"
+#include "thread_pool.hpp"
+#include "valfuzz/valfuzz.hpp"
+#include "vfs.hpp"
+
+#include <filesystem>
+
+using namespace brenta;
+using namespace brenta::types;
+
+TEST(vfs_resolve, "Resolve virtual paths through the mount points")
+{
+    vfs::unmount_all();
+    ASSERT(vfs::resolve("assets/a.png") == "assets/a.png");
+
+    vfs::mount("assets", "/data/game");
+    vfs::mount("assets/models/", "/data/models");
+    ASSERT(vfs::resolve("assets/a.png") == "/data/game/a.png");
+    ASSERT(vfs::resolve("./assets/textures/../a.png") == "/data/game/a.png");
+    /* The longest prefix wins */
+    ASSERT(vfs::resolve("assets/models/a.obj") == "/data/models/a.obj");
+    /* Only whole directory names match */
+    ASSERT(vfs::resolve("assets2/a.png") == "assets2/a.png");
+    ASSERT(vfs::resolve(std::filesystem::absolute("assets/a.png"))
+           == "/data/game/a.png");
+    vfs::unmount_all();
+    ASSERT(vfs::resolve("assets/a.png") == "assets/a.png");
+}
+
+TEST(vfs_temp_path, "Temporary paths are never shared")
+{
+    auto a = vfs::get_temp_path("cache/model.bin");
+    auto b = vfs::get_temp_path("cache/model.bin");
+    ASSERT(a != b);
+    ASSERT(a.starts_with("cache/model.bin.") && a.ends_with(".tmp"));
+}
+
+TEST(vfs_read, "Read a file through a mount point")
+{
+    auto dir = make_temp_dir("brenta_vfs_read", "sub");
+    write_file(dir / "sub" / "a.txt", "hello");
+
+    vfs::unmount_all();
+    vfs::mount("virtual", (dir / "sub").string());
+    ASSERT(vfs::exists("virtual/a.txt"));
+    ASSERT(!vfs::exists("virtual/b.txt"));
+    asset file = vfs::read("virtual/a.txt");
+    ASSERT(file.is_valid());
+    ASSERT(file.str() == "hello");
+    ASSERT(!vfs::read("virtual/b.txt").is_valid());
+    vfs::unmount_all();
+}
+
+TEST(vfs_read_batch, "Read many files at once with every backend")
+{
+    auto dir = make_temp_dir("brenta_vfs_batch", "sub");
+    std::vector<std::string> paths;
+    for (int i = 0; i < 100; i++)
+    {
+        auto path = dir / "sub" / ("file" + std::to_string(i));
+        write_file(path, std::string(1000 * i + 1, 'a' + i % 26));
+        paths.push_back(path.string());
+    }
+    paths.push_back((dir / "missing").string());
+
+    for (bool io_uring : {true, false})
+    {
+        vfs::set_io_uring(io_uring);
+        auto assets = vfs::read_batch(paths);
+        ASSERT(assets.size() == paths.size());
+        for (int i = 0; i < 100; i++)
+        {
+            ASSERT(assets[i].is_valid());
+            ASSERT(assets[i].size() == (std::size_t) 1000 * i + 1);
+            ASSERT(assets[i].data()[assets[i].size() - 1] == 'a' + i % 26);
+        }
+        ASSERT(!assets.back().is_valid());
+    }
+    vfs::set_io_uring(false);
+
+    auto assets = vfs::read_async(paths).get();
+    ASSERT(assets.size() == paths.size());
+    ASSERT(assets[42].size() == 42001);
+}
+
+BENCHMARK(vfs_read_batch_bench, "Read 256 files of 64KiB in a batch")
+{
+    auto dir = make_temp_dir("brenta_vfs_bench", "sub");
+    std::vector<std::string> paths;
+    for (int i = 0; i < 256; i++)
+    {
+        auto path = dir / "sub" / ("file" + std::to_string(i));
+        write_file(path, std::string(64 * 1024, 'x'));
+        paths.push_back(path.string());
+    }
+    thread_pool::init();
+
+    vfs::set_io_uring(true);
+    RUN_BENCHMARK(vfs::read_batch(paths));
+    vfs::set_io_uring(false);
+    RUN_BENCHMARK(vfs::read_batch(paths));
+}
@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/**
+ * brenta-bake, converts the assets to the formats the engine loads
+ * directly and bakes again only what changed since the last run.
+ *
+ * Run It from the root of the project, the same directory the game
+ * runs from, so that the paths in the mesh cache match. The model
+ * settings must match the ones the game uses in the engine builder.
+ */
+
+#include "asset_baker.hpp"
+#include "engine_logger.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include "obj_parser.hpp"
+#include "thread_pool.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace brenta;
+
+namespace
+{
+
+void print_usage(const char *program)
+{
+    std::cout
+        << "Usage: " << program << " [options] [directories...]\n"
+        << "\n"
+        << "Bakes textures, models, fonts and shaders found in the given\n"
+        << "directories, by default assets engine/shaders game/shaders.\n"
+        << "\n"
+        << "Options:\n"
+        << "  --manifest <path>    Dependency graph of the last bake\n"
+        << "                       (default cache/bake.manifest)\n"
+        << "  --mesh-cache <dir>   Mesh cache directory\n"
+        << "                       (default cache/meshes)\n"
+        << "  --lod-levels <n>     Levels of detail, 0 disables them\n"
+        << "                       (default 4)\n"
+        << "  --no-optimizer       Do not optimize the meshes\n"
+        << "  --no-meshlets        Do not build meshlets\n"
+        << "  --native-obj         Parse OBJ models without Assimp\n"
+        << "  --threads <n>        Number of worker threads\n"
+        << "  --force              Bake everything again\n"
+        << "  --verbose            Log every baked asset\n"
+        << "  --help               Show this message\n";
+}
+
+/* The whole argument must be a number */
+bool parse_number(const char *text, unsigned int &value)
+{
+    const char *end = text + std::strlen(text);
+    auto [ptr, ec] = std::from_chars(text, end, value);
+    return ec == std::errc() && ptr == end && ptr != text;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> roots;
+    std::string manifest = "cache/bake.manifest";
+    std::string mesh_cache_directory = "cache/meshes";
+    unsigned int lod_levels = 4;
+    unsigned int threads = 0;
+    bool optimizer = true;
+    bool meshlets = true;
+    bool native_obj = false;
+    bool force = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--manifest" && has_value)
+            manifest = argv[++i];
+        else if (arg == "--mesh-cache" && has_value)
+            mesh_cache_directory = argv[++i];
+        else if (arg == "--lod-levels" && has_value)
+        {
+            if (!parse_number(argv[++i], lod_levels))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            if (!parse_number(argv[++i], threads))
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (arg == "--no-optimizer")
+            optimizer = false;
+        else if (arg == "--no-meshlets")
+            meshlets = false;
+        else if (arg == "--native-obj")
+            native_obj = true;
+        else if (arg == "--force")
+            force = true;
+        else if (arg == "--verbose")
+            verbose = true;
+        else if (arg == "--help" || arg == "-h")
+        {
+            print_usage(argv[0]);
+            return 0;
+        }
+        else if (arg.starts_with("-"))
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        else
+            roots.push_back(arg);
+    }
+    if (roots.empty())
+        roots = {"assets", "engine/shaders", "game/shaders"};
+
+    oak::init_writer();
+    oak::set_level(verbose ? oak::level::info : oak::level::warn);
+
+    thread_pool::init(threads);
+    mesh_cache::init(mesh_cache_directory);
+    mesh_optimizer::set_enabled(optimizer);
+    mesh_simplifier::set_enabled(lod_levels > 0);
+    mesh_simplifier::set_levels(lod_levels);
+    meshlet_builder::set_enabled(meshlets);
+    obj_parser::set_enabled(native_obj);
+
+    types::bake_report report = asset_baker::bake(roots, manifest, force);
+
+    thread_pool::destroy();
+    mesh_cache::destroy();
+    oak::stop_writer();
+
+    std::cout << "brenta-bake: " << report.total << " assets, "
+              << report.baked << " baked, " << report.up_to_date
+              << " up to date, " << report.failed << " failed\n";
+    return report.failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 Giovanni Santini
+
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Hashing helpers used to build stable keys for caches and asset tables.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace brenta
+{
+
+namespace hash
+{
+
+/**
+ * @brief FNV-1a offset basis (64 bit)
+ */
+constexpr std::uint64_t fnv1a_basis = 0xcbf29ce484222325ULL;
+/**
+ * @brief FNV-1a prime (64 bit)
+ */
+constexpr std::uint64_t fnv1a_prime = 0x100000001b3ULL;
+
+/**
+ * @brief Hash a block of memory with FNV-1a
+ *
+ * The result is stable between runs and platforms, so It can be
+ * written to disk and used as a key in on-disk caches.
+ *
+ * @param data Pointer to the data
+ * @param size Size of the data in bytes
+ * @param seed Previous hash value, used to chain multiple blocks
+ * @return The 64 bit hash
+ */
+inline std::uint64_t fnv1a(const void *data, std::size_t size,
+                           std::uint64_t seed = fnv1a_basis)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    std::uint64_t h = seed;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= fnv1a_prime;
+    }
+    return h;
+}
+
+/**
+ * @brief Hash a string with FNV-1a
+ *
+ * @param str The string to hash
+ * @param seed Previous hash value, used to chain multiple strings
+ * @return The 64 bit hash
+ */
+constexpr std::uint64_t fnv1a(std::string_view str,
+                              std::uint64_t seed = fnv1a_basis)
+{
+    std::uint64_t h = seed;
+    for (char c : str)
+    {
+        h ^= static_cast<unsigned char>(c);
+        h *= fnv1a_prime;
+    }
+    return h;
+}
+
+/**
+ * @brief Combine a value into an existing hash
+ *
+ * @param seed The current hash
+ * @param value The value to mix in
+ * @return The new hash
+ */
+template <typename T> inline std::uint64_t combine(std::uint64_t seed, T value)
+{
+    return fnv1a(&value, sizeof(T), seed);
+}
+
+} // namespace hash
+
+} // namespace brenta